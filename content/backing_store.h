@@ -32,6 +32,12 @@ enum backing_store_flags {
 	BACKING_STORE_NONE = 0,
 	/** data is metadata */
 	BACKING_STORE_META = 1,
+	/**
+	 * data is a decoded image bitmap of the object. It is
+	 *  optional, may be mapped rather than read on retrieval and
+	 *  is discarded with the object data.
+	 */
+	BACKING_STORE_BITMAP = 2,
 };
 
 /**
@@ -25,6 +25,16 @@
  * This implementation uses libcurl's 'multi' interface.
  *
  * The CURL handles are cached in the curl_handle_ring.
+ *
+ * When built with WITH_CURL_THREAD the multi handle is driven by a
+ * dedicated network thread so TLS handshakes and content decoding do
+ * not block the user interface. The network thread never calls into
+ * the rest of the browser, not even the log; headers, body data,
+ * progress, completion and log lines are copied into events and passed
+ * to the main thread through a lock-free queue which is drained from
+ * the scheduled fetcher poll.
+ * Requests to add and remove transfers travel the other way on a
+ * short mutex protected list.
  */
 
 /* must come first to ensure winsock2.h vs windows.h ordering issues */
@@ -33,11 +43,18 @@
 #include <assert.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <stdarg.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <string.h>
 #include <strings.h>
 #include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
+#ifdef WITH_CURL_THREAD
+#include <pthread.h>
+#endif
 
 #include <libwapcaplet/libwapcaplet.h>
 #include <nsutils/time.h>
@@ -52,6 +69,9 @@
 #include "utils/useragent.h"
 #include "utils/file.h"
 #include "utils/string.h"
+#ifdef WITH_CURL_THREAD
+#include "utils/spsc.h"
+#endif
 #include "netsurf/fetch.h"
 #include "netsurf/misc.h"
 #include "desktop/gui_internal.h"
@@ -83,6 +103,19 @@
 	/* Remove any PFS suites using weak DSA key exchange */	\
 	"-DSS"
 
+#ifdef WITH_CURL_THREAD
+/** Log category and level of a line logged from the network thread. */
+enum curl_log_kind {
+	CURL_LOG_FETCH_DEBUG, /**< fetch category at DEBUG level */
+	CURL_LOG_DEBUG, /**< netsurf category at DEBUG level */
+	CURL_LOG_WARNING, /**< netsurf category at WARNING level */
+};
+
+static void fetch_curl_thread_log(enum curl_log_kind kind,
+				  const char *format, ...)
+	__attribute__ ((format (printf, 2, 3)));
+#endif
+
 /* Open SSL compatability for certificate handling */
 #ifdef WITH_OPENSSL
 
@@ -210,12 +243,451 @@ static hashmap_parameters_t curl_fetch_ssl_hashmap_parameters = {
 
 static hashmap_t *curl_fetch_ssl_hashmap = NULL;
 
+#ifdef WITH_OPENSSL
+/* Persistent TLS session store
+ *
+ * Resumable sessions are captured as they are issued by servers and
+ * kept per host so the first connection to a host after a restart can
+ * skip the full handshake. cURL's own session cache is still used for
+ * the lifetime of the process; this store only supplies a session when
+ * cURL has none.
+ */
+
+/** Maximum number of resumable sessions kept for each host */
+#define TLS_SESSIONS_PER_HOST 2
+
+/** Largest serialised session accepted from the session file */
+#define TLS_SESSION_MAX_DER 16384
+
+/** Signature line of the session file */
+#define TLS_SESSION_FILE_MAGIC "NetSurf TLS sessions 1\n"
+
+/** Resumable sessions for a single host */
+struct tls_session_entry {
+	uint8_t *der[TLS_SESSIONS_PER_HOST]; /**< DER encoded sessions */
+	size_t der_len[TLS_SESSIONS_PER_HOST]; /**< length of each session */
+	time_t expires[TLS_SESSIONS_PER_HOST]; /**< session expiry times */
+	unsigned int next; /**< slot to be replaced next */
+};
+
+static void *curl_tls_session_key_clone(void *key)
+{
+	return strdup(key);
+}
+
+static uint32_t curl_tls_session_key_hash(void *key)
+{
+	const char *host = key;
+	uint32_t z = 0x811c9dc5;
+
+	while (*host != '\0') {
+		z *= 0x01000193;
+		z ^= *host++;
+	}
+
+	return z;
+}
+
+static bool curl_tls_session_key_eq(void *key1, void *key2)
+{
+	return strcmp(key1, key2) == 0;
+}
+
+static void *curl_tls_session_value_alloc(void *key)
+{
+	return calloc(1, sizeof(struct tls_session_entry));
+}
+
+static void curl_tls_session_value_destroy(void *value)
+{
+	struct tls_session_entry *entry = value;
+	unsigned int slot;
+
+	for (slot = 0; slot < TLS_SESSIONS_PER_HOST; slot++) {
+		free(entry->der[slot]);
+	}
+	free(entry);
+}
+
+static hashmap_parameters_t curl_tls_session_hashmap_parameters = {
+	.key_clone = curl_tls_session_key_clone,
+	.key_destroy = free,
+	.key_eq = curl_tls_session_key_eq,
+	.key_hash = curl_tls_session_key_hash,
+	.value_alloc = curl_tls_session_value_alloc,
+	.value_destroy = curl_tls_session_value_destroy,
+};
+
+/** Resumable sessions keyed by host name */
+static hashmap_t *curl_tls_session_hashmap = NULL;
+
+/** cURL's new session callback, chained from ours */
+static int (*curl_tls_session_new_chain)(SSL *ssl, SSL_SESSION *sess);
+
+#ifdef WITH_CURL_THREAD
+/** Sessions are stored from the network thread and saved from main */
+static pthread_mutex_t curl_tls_session_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define TLS_SESSION_LOCK() pthread_mutex_lock(&curl_tls_session_mutex)
+#define TLS_SESSION_UNLOCK() pthread_mutex_unlock(&curl_tls_session_mutex)
+#else
+#define TLS_SESSION_LOCK()
+#define TLS_SESSION_UNLOCK()
+#endif
+
+
+/**
+ * Add a serialised session to the store.
+ *
+ * \param host The host the session was issued by.
+ * \param der The DER encoded session, ownership is taken.
+ * \param der_len The length of der.
+ * \param expires The time the session expires.
+ */
+static void
+fetch_curl_tls_session_add(const char *host,
+			   uint8_t *der,
+			   size_t der_len,
+			   time_t expires)
+{
+	struct tls_session_entry *entry;
+	unsigned int slot;
+
+	TLS_SESSION_LOCK();
+	entry = hashmap_lookup(curl_tls_session_hashmap, (void *)host);
+	if (entry == NULL) {
+		entry = hashmap_insert(curl_tls_session_hashmap, (void *)host);
+	}
+	if (entry == NULL) {
+		TLS_SESSION_UNLOCK();
+		free(der);
+		return;
+	}
+
+	/* replace the oldest session for the host */
+	slot = entry->next;
+	free(entry->der[slot]);
+	entry->der[slot] = der;
+	entry->der_len[slot] = der_len;
+	entry->expires[slot] = expires;
+	entry->next = (slot + 1) % TLS_SESSIONS_PER_HOST;
+	TLS_SESSION_UNLOCK();
+}
+
+
+/**
+ * Take the newest unexpired session for a host out of the store.
+ *
+ * Sessions are removed as they are used because TLS 1.3 tickets should
+ * not be offered twice; the server issues fresh ones on resumption.
+ *
+ * \param host The host to find a session for.
+ * \return The session or NULL if there is none. Caller owns the result.
+ */
+static SSL_SESSION *fetch_curl_tls_session_take(const char *host)
+{
+	struct tls_session_entry *entry;
+	SSL_SESSION *sess = NULL;
+	const unsigned char *p;
+	time_t now = time(NULL);
+	unsigned int count;
+	unsigned int slot;
+
+	TLS_SESSION_LOCK();
+	entry = hashmap_lookup(curl_tls_session_hashmap, (void *)host);
+	if (entry != NULL) {
+		slot = entry->next;
+		for (count = 0; count < TLS_SESSIONS_PER_HOST; count++) {
+			/* walk backwards from the newest */
+			slot = (slot + TLS_SESSIONS_PER_HOST - 1) %
+				TLS_SESSIONS_PER_HOST;
+			if (entry->der[slot] == NULL) {
+				continue;
+			}
+			if (entry->expires[slot] > now) {
+				p = entry->der[slot];
+				sess = d2i_SSL_SESSION(NULL, &p,
+						       entry->der_len[slot]);
+			}
+			free(entry->der[slot]);
+			entry->der[slot] = NULL;
+			if (sess != NULL) {
+				break;
+			}
+		}
+	}
+	TLS_SESSION_UNLOCK();
+
+	return sess;
+}
+
+
+/**
+ * OpenSSL new session callback.
+ *
+ * Copies each resumable session into the store then passes it on to
+ * cURL's own session cache.
+ */
+static int fetch_curl_tls_session_new(SSL *ssl, SSL_SESSION *sess)
+{
+	const char *host;
+	unsigned char *der;
+	unsigned char *p;
+	int der_len;
+
+	host = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+	if ((host != NULL) &&
+#if (OPENSSL_VERSION_NUMBER >= 0x10101000L) && !defined(LIBRESSL_VERSION_NUMBER)
+	    SSL_SESSION_is_resumable(sess) &&
+#endif
+	    ((der_len = i2d_SSL_SESSION(sess, NULL)) > 0) &&
+	    (der_len <= TLS_SESSION_MAX_DER)) {
+		der = malloc(der_len);
+		if (der != NULL) {
+			p = der;
+			i2d_SSL_SESSION(sess, &p);
+			fetch_curl_tls_session_add(host, der, der_len,
+					SSL_SESSION_get_time(sess) +
+					SSL_SESSION_get_timeout(sess));
+		}
+	}
+
+	if (curl_tls_session_new_chain != NULL) {
+		return curl_tls_session_new_chain(ssl, sess);
+	}
+
+	/* no reference kept */
+	return 0;
+}
+
+
+/**
+ * OpenSSL information callback.
+ *
+ * cURL sets up any session it has cached before the handshake starts,
+ * if it had none offer a stored one from a previous run. The server
+ * simply performs a full handshake if it no longer accepts it.
+ */
+static void fetch_curl_tls_info(const SSL *cssl, int where, int ret)
+{
+	SSL *ssl = (SSL *)cssl; /* callback API is const but we modify */
+	const char *host;
+	SSL_SESSION *sess;
+
+	if ((where & SSL_CB_HANDSHAKE_START) == 0 ||
+	    SSL_get_session(ssl) != NULL) {
+		return;
+	}
+
+	host = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+	if (host == NULL) {
+		return;
+	}
+
+	sess = fetch_curl_tls_session_take(host);
+	if (sess != NULL) {
+#ifdef WITH_CURL_THREAD
+		fetch_curl_thread_log(CURL_LOG_DEBUG,
+				      "Offering stored TLS session for %s",
+				      host);
+#else
+		NSLOG(netsurf, DEBUG, "Offering stored TLS session for %s",
+		      host);
+#endif
+		SSL_set_session(ssl, sess);
+		SSL_SESSION_free(sess);
+	}
+}
+
+
+/**
+ * Load stored sessions from a file.
+ *
+ * Each record is a line holding the host name and length of the
+ * session followed by the DER encoded session.
+ *
+ * \param path The file to read.
+ */
+static void fetch_curl_tls_session_load(const char *path)
+{
+	FILE *fp;
+	char line[300];
+	char host[256];
+	size_t der_len;
+	uint8_t *der;
+	const unsigned char *p;
+	SSL_SESSION *sess;
+	time_t expires;
+	time_t now = time(NULL);
+	int loaded = 0;
+
+	fp = fopen(path, "rb");
+	if (fp == NULL) {
+		return;
+	}
+
+	if ((fgets(line, sizeof(line), fp) == NULL) ||
+	    (strcmp(line, TLS_SESSION_FILE_MAGIC) != 0)) {
+		NSLOG(netsurf, INFO, "Ignoring TLS session file %s", path);
+		fclose(fp);
+		return;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if ((sscanf(line, "%255s %zu", host, &der_len) != 2) ||
+		    (der_len == 0) ||
+		    (der_len > TLS_SESSION_MAX_DER)) {
+			break;
+		}
+
+		der = malloc(der_len);
+		if (der == NULL) {
+			break;
+		}
+		if (fread(der, 1, der_len, fp) != der_len) {
+			free(der);
+			break;
+		}
+
+		/* validate and determine expiry from the session itself */
+		p = der;
+		sess = d2i_SSL_SESSION(NULL, &p, der_len);
+		if (sess == NULL) {
+			free(der);
+			continue;
+		}
+		expires = SSL_SESSION_get_time(sess) +
+			SSL_SESSION_get_timeout(sess);
+		SSL_SESSION_free(sess);
+
+		if (expires <= now) {
+			free(der);
+			continue;
+		}
+
+		fetch_curl_tls_session_add(host, der, der_len, expires);
+		loaded++;
+	}
+
+	fclose(fp);
+
+	NSLOG(netsurf, INFO, "Loaded %d TLS sessions from %s", loaded, path);
+}
+
+
+/**
+ * Hashmap iterator writing the unexpired sessions of a host to a file.
+ */
+static bool fetch_curl_tls_session_save_cb(void *key, void *value, void *ctx)
+{
+	const char *host = key;
+	struct tls_session_entry *entry = value;
+	FILE *fp = ctx;
+	time_t now = time(NULL);
+	unsigned int count;
+	unsigned int slot = entry->next;
+
+	/* oldest first so the newest is in the same place after load */
+	for (count = 0; count < TLS_SESSIONS_PER_HOST; count++) {
+		if ((entry->der[slot] != NULL) &&
+		    (entry->expires[slot] > now)) {
+			fprintf(fp, "%s %zu\n", host, entry->der_len[slot]);
+			fwrite(entry->der[slot], 1, entry->der_len[slot], fp);
+		}
+		slot = (slot + 1) % TLS_SESSIONS_PER_HOST;
+	}
+
+	return false;
+}
+
+
+/**
+ * Save the stored sessions to a file.
+ *
+ * The sessions hold key material so the file is only readable by the
+ * user.
+ *
+ * \param path The file to write.
+ */
+static void fetch_curl_tls_session_save(const char *path)
+{
+	FILE *fp;
+	int fd;
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		NSLOG(netsurf, INFO, "Unable to save TLS sessions to %s", path);
+		return;
+	}
+
+	fp = fdopen(fd, "wb");
+	if (fp == NULL) {
+		close(fd);
+		return;
+	}
+
+	fputs(TLS_SESSION_FILE_MAGIC, fp);
+	hashmap_iterate(curl_tls_session_hashmap,
+			fetch_curl_tls_session_save_cb,
+			fp);
+
+	fclose(fp);
+}
+#endif /* WITH_OPENSSL */
+
 /** SSL certificate info */
 struct cert_info {
 	X509 *cert;		/**< Pointer to certificate */
 	long err;		/**< OpenSSL error code */
 };
 
+#ifdef WITH_CURL_THREAD
+/**
+ * Number of events which may be waiting for the main thread before
+ * the network thread stops reading from the network.
+ */
+#define CURL_EVENT_QUEUE_SIZE 256
+
+#if LIBCURL_VERSION_NUM >= 0x074400
+/** Network thread poll timeout in ms, commands wake it explicitly */
+#define CURL_THREAD_POLL_MS 1000
+#else
+/** Network thread poll timeout in ms, sets command latency */
+#define CURL_THREAD_POLL_MS 10
+#endif
+
+/** Types of message passed between the main and network threads. */
+enum curl_event_type {
+	CURL_COMMAND_ADD, /**< main: start the transfer */
+	CURL_COMMAND_REMOVE, /**< main: abandon the transfer */
+	CURL_EVENT_HEADER, /**< net: a response header line */
+	CURL_EVENT_DATA, /**< net: a block of response body */
+	CURL_EVENT_PROGRESS, /**< net: transfer progress */
+	CURL_EVENT_DONE, /**< net: transfer complete, handle released */
+	CURL_EVENT_RELEASE, /**< net: a remove command was processed */
+	CURL_EVENT_LOG, /**< net: a line for the log */
+};
+
+/**
+ * Message passed between the main and network threads.
+ *
+ * Every command sent to the network thread is answered by exactly one
+ * CURL_EVENT_DONE or CURL_EVENT_RELEASE, which is how the main thread
+ * knows when the network thread has finished with a fetch.
+ */
+struct curl_event {
+	enum curl_event_type type; /**< Kind of message */
+	struct curl_fetch_info *f; /**< Fetch the message is about */
+	struct curl_event *next; /**< Next command in the command list */
+	long http_code; /**< Response code when the event was raised */
+	CURLcode result; /**< Transfer result for ::CURL_EVENT_DONE */
+	double dltotal; /**< Expected body size for ::CURL_EVENT_PROGRESS */
+	double dlnow; /**< Body received for ::CURL_EVENT_PROGRESS */
+	enum curl_log_kind log; /**< Where a ::CURL_EVENT_LOG line goes */
+	size_t len; /**< Length of data */
+	uint8_t data[FLEX_ARRAY_LEN_DECL]; /**< Header, body data or log line */
+};
+#endif
+
 /** Information for a single fetch. */
 struct curl_fetch_info {
 	struct fetch *fetch_handle; /**< The fetch handle we're parented by. */
@@ -239,6 +711,13 @@ struct curl_fetch_info {
 	uint64_t last_progress_update;	/**< Time of last progress update */
 	int cert_depth; /**< deepest certificate in use */
 	struct cert_info cert_data[MAX_CERT_DEPTH]; /**< HTTPS certificate data */
+#ifdef WITH_CURL_THREAD
+	int worker_refs;	/**< Commands not yet answered by network thread */
+	bool free_pending;	/**< Free when network thread is finished */
+	int cancel;		/**< Network thread should stop the transfer */
+	bool in_multi;		/**< Handle is in the multi (network thread) */
+	struct curl_event *done_event; /**< Completion event (network thread) */
+#endif
 };
 
 /** curl handle cache entry */
@@ -274,6 +753,40 @@ static char fetch_proxy_userpwd[100];
 /** Interlock to prevent initiation during callbacks */
 static bool inside_curl = false;
 
+#ifdef WITH_CURL_THREAD
+/** The network thread */
+static pthread_t curl_thread;
+
+/** The network thread has been started */
+static bool curl_thread_running = false;
+
+/** Request for the network thread to exit, accessed atomically */
+static int curl_thread_quit = 0;
+
+/** Events from the network thread to the main thread */
+static struct spsc_queue *curl_event_queue = NULL;
+
+/** Lock for waiting on space in ::curl_event_queue */
+static pthread_mutex_t curl_event_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** Signalled when the main thread takes events from a full queue */
+static pthread_cond_t curl_event_space = PTHREAD_COND_INITIALIZER;
+
+/** The network thread is waiting for space, accessed atomically */
+static int curl_event_waiting = 0;
+
+/** Lock protecting the command list */
+static pthread_mutex_t curl_command_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** Commands from the main thread waiting for the network thread */
+static struct curl_event *curl_command_list = NULL;
+
+/** Last command in ::curl_command_list */
+static struct curl_event *curl_command_tail = NULL;
+
+static void fetch_curl_thread_finalise(void);
+#endif
+
 
 /**
  * Initialise a cURL fetcher.
@@ -305,6 +818,21 @@ static void fetch_curl_finalise(lwc_string *scheme)
 		NSLOG(netsurf, INFO,
 		      "All cURL fetchers finalised, closing down cURL");
 
+#ifdef WITH_CURL_THREAD
+		fetch_curl_thread_finalise();
+#endif
+
+#ifdef WITH_OPENSSL
+		if (curl_tls_session_hashmap != NULL) {
+			if (nsoption_charp(tls_session_file) != NULL) {
+				fetch_curl_tls_session_save(
+					nsoption_charp(tls_session_file));
+			}
+			hashmap_destroy(curl_tls_session_hashmap);
+			curl_tls_session_hashmap = NULL;
+		}
+#endif
+
 		curl_easy_cleanup(fetch_blank_curl);
 
 		codem = curl_multi_cleanup(fetch_curl_multi);
@@ -493,6 +1021,14 @@ fetch_curl_setup(struct fetch *parent_fetch,
 	memset(fetch->cert_data, 0, sizeof(fetch->cert_data));
 	fetch->cert_depth = -1;
 
+#ifdef WITH_CURL_THREAD
+	fetch->worker_refs = 0;
+	fetch->free_pending = false;
+	fetch->cancel = 0;
+	fetch->in_multi = false;
+	fetch->done_event = NULL;
+#endif
+
 	if ((fetch->host == NULL) ||
 	    (post_multipart != NULL && fetch->post_multipart == NULL) ||
 	    (post_urlenc != NULL && fetch->post_urlenc == NULL)) {
@@ -786,7 +1322,12 @@ static int fetch_curl_cert_verify_callback(X509_STORE_CTX *x509_ctx, void *parm)
 		ok = X509_verify_cert(x509_ctx);
 	}
 
+#ifndef WITH_CURL_THREAD
+	/* with a network thread the chain is cached by the main thread
+	 * when it is reported
+	 */
 	fetch_curl_store_certs_in_cache(f);
+#endif
 
 	return ok;
 }
@@ -837,6 +1378,21 @@ fetch_curl_sslctxfun(CURL *curl_handle, void *_sslctx, void *parm)
 	SSL_CTX_clear_options(sslctx, SSL_OP_NO_TICKET);
 #endif
 
+	if (curl_tls_session_hashmap != NULL) {
+		/* cURL installs the same callback on every context */
+		if (SSL_CTX_sess_get_new_cb(sslctx) !=
+		    fetch_curl_tls_session_new) {
+			curl_tls_session_new_chain =
+				SSL_CTX_sess_get_new_cb(sslctx);
+		}
+		SSL_CTX_set_session_cache_mode(sslctx,
+				SSL_CTX_get_session_cache_mode(sslctx) |
+				SSL_SESS_CACHE_CLIENT |
+				SSL_SESS_CACHE_NO_INTERNAL_STORE);
+		SSL_CTX_sess_set_new_cb(sslctx, fetch_curl_tls_session_new);
+		SSL_CTX_set_info_callback(sslctx, fetch_curl_tls_info);
+	}
+
 	return CURLE_OK;
 }
 
@@ -853,6 +1409,12 @@ fetch_curl_report_certs_upstream(struct curl_fetch_info *f)
 	fetch_msg msg;
 	struct cert_chain *chain;
 
+#if defined(WITH_CURL_THREAD) && defined(WITH_OPENSSL)
+	if (f->cert_depth >= 0) {
+		fetch_curl_store_certs_in_cache(f);
+	}
+#endif
+
 	chain = hashmap_lookup(curl_fetch_ssl_hashmap, f->url);
 
 	if (chain != NULL) {
@@ -974,69 +1536,480 @@ static CURLcode fetch_curl_set_options(struct curl_fetch_info *f)
 	return CURLE_OK;
 }
 
+#ifdef WITH_CURL_THREAD
+
 /**
- * Initiate a fetch from the queue.
+ * Allocate a message for passing between threads.
  *
- * \param fetch fetch to use to fetch content.
- * \param handle CURL handle to be used to fetch the content.
- * \return true if the fetch was successfully initiated else false.
+ * \param type The type of message.
+ * \param f The fetch the message concerns.
+ * \param data Data to copy into the message or NULL.
+ * \param len The length of data.
+ * \return The new message or NULL on allocation failure.
  */
-static bool
-fetch_curl_initiate_fetch(struct curl_fetch_info *fetch, CURL *handle)
+static struct curl_event *
+fetch_curl_event_create(enum curl_event_type type,
+			struct curl_fetch_info *f,
+			const void *data,
+			size_t len)
 {
-	CURLcode code;
-	CURLMcode codem;
-
-	fetch->curl_handle = handle;
+	struct curl_event *ev;
 
-	/* Initialise the handle */
-	code = fetch_curl_set_options(fetch);
-	if (code != CURLE_OK) {
-		fetch->curl_handle = 0;
-		/* The handle maybe went bad, eat it */
-		NSLOG(netsurf, WARNING, "cURL handle maybe went bad, retry later");
-		curl_easy_cleanup(handle);
-		return false;
+	/* extra byte ensures header lines are always terminated */
+	ev = malloc(sizeof(*ev) + len + 1);
+	if (ev == NULL) {
+		return NULL;
 	}
 
-	/* add to the global curl multi handle */
-	codem = curl_multi_add_handle(fetch_curl_multi, fetch->curl_handle);
-	assert(codem == CURLM_OK || codem == CURLM_CALL_MULTI_PERFORM);
+	ev->type = type;
+	ev->f = f;
+	ev->next = NULL;
+	ev->http_code = 0;
+	ev->result = CURLE_OK;
+	ev->dltotal = 0;
+	ev->dlnow = 0;
+	ev->log = CURL_LOG_DEBUG;
+	ev->len = len;
+	if (data != NULL) {
+		memcpy(ev->data, data, len);
+	}
+	ev->data[len] = 0;
 
-	return true;
+	return ev;
 }
 
 
 /**
- * Find a CURL handle to use to dispatch a job
+ * Pass a command to the network thread.
+ *
+ * Called from the main thread only.
+ *
+ * \param cmd The command to pass.
  */
-static CURL *fetch_curl_get_handle(lwc_string *host)
+static void fetch_curl_thread_command(struct curl_event *cmd)
 {
-	struct cache_handle *h;
-	CURL *ret;
-	RING_FINDBYLWCHOST(curl_handle_ring, h, host);
-	if (h) {
-		ret = h->handle;
-		lwc_string_unref(h->host);
-		RING_REMOVE(curl_handle_ring, h);
-		free(h);
+	cmd->f->worker_refs++;
+	cmd->next = NULL;
+
+	pthread_mutex_lock(&curl_command_mutex);
+	if (curl_command_tail == NULL) {
+		curl_command_list = cmd;
 	} else {
-		ret = curl_easy_duphandle(fetch_blank_curl);
+		curl_command_tail->next = cmd;
 	}
-	return ret;
+	curl_command_tail = cmd;
+	pthread_mutex_unlock(&curl_command_mutex);
+
+#if LIBCURL_VERSION_NUM >= 0x074400
+	curl_multi_wakeup(fetch_curl_multi);
+#endif
 }
 
 
 /**
- * Dispatch a single job
+ * Ask the network thread to stop a transfer.
+ *
+ * Called from the main thread only. The transfer is stopped at the next
+ * callback, for aborted fetches the handle is also removed from the
+ * multi handle straight away.
+ *
+ * \param f The fetch to stop.
+ * \param remove Remove the handle from the multi immediately.
  */
-static bool fetch_curl_start(void *vfetch)
+static void fetch_curl_thread_cancel(struct curl_fetch_info *f, bool remove)
 {
-	struct curl_fetch_info *fetch = (struct curl_fetch_info*)vfetch;
-	if (inside_curl) {
-		NSLOG(netsurf, DEBUG, "Deferring fetch because we're inside cURL");
-		return false;
-	}
+	struct curl_event *cmd;
+
+	__atomic_store_n(&f->cancel, 1, __ATOMIC_RELEASE);
+
+	if (remove) {
+		cmd = fetch_curl_event_create(CURL_COMMAND_REMOVE, f, NULL, 0);
+		if (cmd != NULL) {
+			fetch_curl_thread_command(cmd);
+		}
+		/* otherwise the progress callback ends the transfer */
+	}
+}
+
+
+/**
+ * Pass an event to the main thread.
+ *
+ * Called from the network thread only. If the main thread has fallen
+ * behind this blocks until the main thread makes space, pausing all
+ * transfers, rather than buffering without limit.
+ *
+ * \param ev The event to pass, ownership is taken.
+ * \param handle The transfer handle to read the response code from or
+ *               NULL once the main thread may have released it.
+ * \return true if the event was queued, false if the thread is exiting.
+ */
+static bool fetch_curl_thread_post(struct curl_event *ev, CURL *handle)
+{
+	bool queued = true;
+
+	if (handle != NULL) {
+		curl_easy_getinfo(handle, CURLINFO_HTTP_CODE, &ev->http_code);
+	}
+
+	if (spsc_queue_push(curl_event_queue, ev)) {
+		return true;
+	}
+
+	/* The waiting flag is raised before pushing again so either the
+	 * push sees space made by the main thread or the main thread sees
+	 * the flag after making it and signals.
+	 */
+	pthread_mutex_lock(&curl_event_mutex);
+	__atomic_store_n(&curl_event_waiting, 1, __ATOMIC_SEQ_CST);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	while (spsc_queue_push(curl_event_queue, ev) == false) {
+		if (__atomic_load_n(&curl_thread_quit, __ATOMIC_ACQUIRE)) {
+			free(ev);
+			queued = false;
+			break;
+		}
+		pthread_cond_wait(&curl_event_space, &curl_event_mutex);
+	}
+	__atomic_store_n(&curl_event_waiting, 0, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&curl_event_mutex);
+
+	return queued;
+}
+
+
+/**
+ * Wake the network thread if it is waiting for space in the queue.
+ *
+ * Called from the main thread after taking an event from the queue.
+ */
+static void fetch_curl_thread_space(void)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&curl_event_waiting, __ATOMIC_RELAXED)) {
+		pthread_mutex_lock(&curl_event_mutex);
+		pthread_cond_signal(&curl_event_space);
+		pthread_mutex_unlock(&curl_event_mutex);
+	}
+}
+
+
+/**
+ * Pass a line for the log to the main thread.
+ *
+ * Called from the network thread, which must not use the log itself.
+ * Lines which cannot be allocated are dropped.
+ *
+ * \param kind The log category and level of the line.
+ * \param format The printf style format of the line.
+ */
+static void fetch_curl_thread_log(enum curl_log_kind kind,
+				  const char *format, ...)
+{
+	struct curl_event *ev;
+	va_list ap;
+	int len;
+
+	va_start(ap, format);
+	len = vsnprintf(NULL, 0, format, ap);
+	va_end(ap);
+	if (len < 0) {
+		return;
+	}
+
+	ev = fetch_curl_event_create(CURL_EVENT_LOG, NULL, NULL, len);
+	if (ev == NULL) {
+		return;
+	}
+	ev->log = kind;
+
+	va_start(ap, format);
+	vsnprintf((char *)ev->data, len + 1, format, ap);
+	va_end(ap);
+
+	fetch_curl_thread_post(ev, NULL);
+}
+
+
+/**
+ * Complete a transfer on the network thread.
+ *
+ * The handle must already have been removed from the multi handle.
+ * Reuses the event allocated when the transfer was added so completion
+ * cannot fail for lack of memory.
+ *
+ * \param f The fetch which completed.
+ * \param result The result of the transfer.
+ */
+static void fetch_curl_thread_done(struct curl_fetch_info *f, CURLcode result)
+{
+	struct curl_event *ev = f->done_event;
+
+	f->in_multi = false;
+	f->done_event = NULL;
+
+	ev->type = CURL_EVENT_DONE;
+	ev->result = result;
+	fetch_curl_thread_post(ev, f->curl_handle);
+}
+
+
+/**
+ * Process commands waiting for the network thread.
+ */
+static void fetch_curl_thread_commands(void)
+{
+	struct curl_event *cmd;
+	struct curl_event *next;
+	struct curl_fetch_info *f;
+	CURLMcode codem;
+
+	pthread_mutex_lock(&curl_command_mutex);
+	cmd = curl_command_list;
+	curl_command_list = NULL;
+	curl_command_tail = NULL;
+	pthread_mutex_unlock(&curl_command_mutex);
+
+	for (; cmd != NULL; cmd = next) {
+		next = cmd->next;
+		f = cmd->f;
+
+		switch (cmd->type) {
+		case CURL_COMMAND_ADD:
+			f->done_event = cmd;
+			codem = curl_multi_add_handle(fetch_curl_multi,
+						      f->curl_handle);
+			if (codem != CURLM_OK &&
+			    codem != CURLM_CALL_MULTI_PERFORM) {
+				fetch_curl_thread_log(CURL_LOG_WARNING,
+						"curl_multi_add_handle: %i %s",
+						codem,
+						curl_multi_strerror(codem));
+				fetch_curl_thread_done(f, CURLE_FAILED_INIT);
+			} else {
+				f->in_multi = true;
+			}
+			break;
+
+		case CURL_COMMAND_REMOVE:
+			if (f->in_multi) {
+				curl_multi_remove_handle(fetch_curl_multi,
+							 f->curl_handle);
+				fetch_curl_thread_done(f,
+						CURLE_ABORTED_BY_CALLBACK);
+			}
+			cmd->type = CURL_EVENT_RELEASE;
+			fetch_curl_thread_post(cmd, NULL);
+			break;
+
+		default:
+			free(cmd);
+			break;
+		}
+	}
+}
+
+
+/**
+ * Network thread main loop.
+ *
+ * Owns the curl multi handle and every easy handle added to it until
+ * the transfer completes.
+ */
+static void *fetch_curl_thread(void *unused)
+{
+	int running, queue;
+	CURLMcode codem;
+	CURLMsg *curl_msg;
+	CURL *handle;
+	CURLcode result;
+	struct curl_fetch_info *f;
+	char **_hideous_hack = (char **) (void *) &f;
+
+	while (!__atomic_load_n(&curl_thread_quit, __ATOMIC_ACQUIRE)) {
+		fetch_curl_thread_commands();
+
+		codem = curl_multi_perform(fetch_curl_multi, &running);
+		if (codem != CURLM_OK && codem != CURLM_CALL_MULTI_PERFORM) {
+			fetch_curl_thread_log(CURL_LOG_WARNING,
+					      "curl_multi_perform: %i %s",
+					      codem,
+					      curl_multi_strerror(codem));
+		}
+
+		/* release completed transfers */
+		curl_msg = curl_multi_info_read(fetch_curl_multi, &queue);
+		while (curl_msg) {
+			if (curl_msg->msg == CURLMSG_DONE) {
+				/* message is invalid after removal */
+				handle = curl_msg->easy_handle;
+				result = curl_msg->data.result;
+
+				curl_easy_getinfo(handle, CURLINFO_PRIVATE,
+						  _hideous_hack);
+				curl_multi_remove_handle(fetch_curl_multi,
+							 handle);
+				fetch_curl_thread_done(f, result);
+			}
+			curl_msg = curl_multi_info_read(fetch_curl_multi,
+							&queue);
+		}
+
+#if LIBCURL_VERSION_NUM >= 0x074400
+		curl_multi_poll(fetch_curl_multi, NULL, 0,
+				CURL_THREAD_POLL_MS, NULL);
+#else
+		curl_multi_wait(fetch_curl_multi, NULL, 0,
+				CURL_THREAD_POLL_MS, NULL);
+#endif
+	}
+
+	return NULL;
+}
+
+
+/**
+ * Start the network thread.
+ *
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror fetch_curl_thread_init(void)
+{
+	curl_event_queue = spsc_queue_create(CURL_EVENT_QUEUE_SIZE);
+	if (curl_event_queue == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	curl_thread_quit = 0;
+	if (pthread_create(&curl_thread, NULL, fetch_curl_thread, NULL) != 0) {
+		NSLOG(netsurf, CRITICAL, "Unable to start cURL network thread");
+		spsc_queue_destroy(curl_event_queue);
+		curl_event_queue = NULL;
+		return NSERROR_INIT_FAILED;
+	}
+	curl_thread_running = true;
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Stop the network thread and discard any messages in flight.
+ */
+static void fetch_curl_thread_finalise(void)
+{
+	struct curl_event *ev;
+
+	if (curl_thread_running == false) {
+		return;
+	}
+
+	__atomic_store_n(&curl_thread_quit, 1, __ATOMIC_RELEASE);
+#if LIBCURL_VERSION_NUM >= 0x074400
+	curl_multi_wakeup(fetch_curl_multi);
+#endif
+	/* release the thread if it is waiting for space in the queue */
+	pthread_mutex_lock(&curl_event_mutex);
+	pthread_cond_broadcast(&curl_event_space);
+	pthread_mutex_unlock(&curl_event_mutex);
+	pthread_join(curl_thread, NULL);
+	curl_thread_running = false;
+
+	while ((ev = spsc_queue_pop(curl_event_queue)) != NULL) {
+		free(ev);
+	}
+	spsc_queue_destroy(curl_event_queue);
+	curl_event_queue = NULL;
+
+	while (curl_command_list != NULL) {
+		ev = curl_command_list;
+		curl_command_list = ev->next;
+		free(ev);
+	}
+	curl_command_tail = NULL;
+}
+
+#endif /* WITH_CURL_THREAD */
+
+
+/**
+ * Initiate a fetch from the queue.
+ *
+ * \param fetch fetch to use to fetch content.
+ * \param handle CURL handle to be used to fetch the content.
+ * \return true if the fetch was successfully initiated else false.
+ */
+static bool
+fetch_curl_initiate_fetch(struct curl_fetch_info *fetch, CURL *handle)
+{
+	CURLcode code;
+#ifdef WITH_CURL_THREAD
+	struct curl_event *cmd;
+#else
+	CURLMcode codem;
+#endif
+
+	fetch->curl_handle = handle;
+
+	/* Initialise the handle */
+	code = fetch_curl_set_options(fetch);
+	if (code != CURLE_OK) {
+		fetch->curl_handle = 0;
+		/* The handle maybe went bad, eat it */
+		NSLOG(netsurf, WARNING, "cURL handle maybe went bad, retry later");
+		curl_easy_cleanup(handle);
+		return false;
+	}
+
+#ifdef WITH_CURL_THREAD
+	/* hand the handle to the network thread */
+	cmd = fetch_curl_event_create(CURL_COMMAND_ADD, fetch, NULL, 0);
+	if (cmd == NULL) {
+		fetch->curl_handle = 0;
+		curl_easy_cleanup(handle);
+		return false;
+	}
+	fetch_curl_thread_command(cmd);
+#else
+	/* add to the global curl multi handle */
+	codem = curl_multi_add_handle(fetch_curl_multi, fetch->curl_handle);
+	assert(codem == CURLM_OK || codem == CURLM_CALL_MULTI_PERFORM);
+#endif
+
+	return true;
+}
+
+
+/**
+ * Find a CURL handle to use to dispatch a job
+ */
+static CURL *fetch_curl_get_handle(lwc_string *host)
+{
+	struct cache_handle *h;
+	CURL *ret;
+	RING_FINDBYLWCHOST(curl_handle_ring, h, host);
+	if (h) {
+		ret = h->handle;
+		lwc_string_unref(h->host);
+		RING_REMOVE(curl_handle_ring, h);
+		free(h);
+	} else {
+		ret = curl_easy_duphandle(fetch_blank_curl);
+	}
+	return ret;
+}
+
+
+/**
+ * Dispatch a single job
+ */
+static bool fetch_curl_start(void *vfetch)
+{
+	struct curl_fetch_info *fetch = (struct curl_fetch_info*)vfetch;
+	if (inside_curl) {
+		NSLOG(netsurf, DEBUG, "Deferring fetch because we're inside cURL");
+		return false;
+	}
 	return fetch_curl_initiate_fetch(fetch,
 			fetch_curl_get_handle(fetch->host));
 }
@@ -1099,16 +2072,20 @@ static void fetch_curl_cache_handle(CURL *handle, lwc_string *host)
  */
 static void fetch_curl_stop(struct curl_fetch_info *f)
 {
+#ifndef WITH_CURL_THREAD
 	CURLMcode codem;
+#endif
 
 	assert(f);
 	NSLOG(netsurf, INFO, "fetch %p, url '%s'", f, nsurl_access(f->url));
 
 	if (f->curl_handle) {
+#ifndef WITH_CURL_THREAD
 		/* remove from curl multi handle */
 		codem = curl_multi_remove_handle(fetch_curl_multi,
 				f->curl_handle);
 		assert(codem == CURLM_OK);
+#endif
 		/* Put this curl handle into the cache if wanted. */
 		fetch_curl_cache_handle(f->curl_handle, f->host);
 		f->curl_handle = 0;
@@ -1127,6 +2104,14 @@ static void fetch_curl_abort(void *vf)
 	assert(f);
 	NSLOG(netsurf, INFO, "fetch %p, url '%s'", f, nsurl_access(f->url));
 	if (f->curl_handle) {
+#ifdef WITH_CURL_THREAD
+		/* the network thread owns the handle, cleanup happens
+		 * when it reports the transfer is done.
+		 */
+		NSLOG(netsurf, DEBUG, "Deferring cleanup to network thread");
+		f->abort = true;
+		fetch_curl_thread_cancel(f, true);
+#else
 		if (inside_curl) {
 			NSLOG(netsurf, DEBUG, "Deferring cleanup");
 			f->abort = true;
@@ -1135,6 +2120,7 @@ static void fetch_curl_abort(void *vf)
 			fetch_curl_stop(f);
 			fetch_free(f->fetch_handle);
 		}
+#endif
 	} else {
 		fetch_remove_from_queues(f->fetch_handle);
 		fetch_free(f->fetch_handle);
@@ -1150,6 +2136,16 @@ static void fetch_curl_free(void *vf)
 	struct curl_fetch_info *f = (struct curl_fetch_info *)vf;
 	int i;
 
+#ifdef WITH_CURL_THREAD
+	if (f->worker_refs > 0) {
+		/* the network thread may still refer to the fetch so
+		 * the free is completed when its last command is answered.
+		 */
+		f->free_pending = true;
+		return;
+	}
+#endif
+
 	if (f->curl_handle) {
 		curl_easy_cleanup(f->curl_handle);
 	}
@@ -1242,23 +2238,15 @@ static bool fetch_curl_process_headers(struct curl_fetch_info *f)
 /**
  * Handle a completed fetch (CURLMSG_DONE from curl_multi_info_read()).
  *
- * \param curl_handle curl easy handle of fetch
+ * \param f The fetch which completed.
  * \param result The result code of the completed fetch.
  */
-static void fetch_curl_done(CURL *curl_handle, CURLcode result)
+static void fetch_curl_done(struct curl_fetch_info *f, CURLcode result)
 {
 	bool finished = false;
 	bool error = false;
 	bool cert = false;
 	bool abort_fetch;
-	struct curl_fetch_info *f;
-	char **_hideous_hack = (char **) (void *) &f;
-	CURLcode code;
-
-	/* find the structure associated with this fetch */
-	/* For some reason, cURL thinks CURLINFO_PRIVATE should be a string?! */
-	code = curl_easy_getinfo(curl_handle, CURLINFO_PRIVATE, _hideous_hack);
-	assert(code == CURLE_OK);
 
 	abort_fetch = f->abort;
 	NSLOG(netsurf, INFO, "done %s", nsurl_access(f->url));
@@ -1291,9 +2279,12 @@ static void fetch_curl_done(CURL *curl_handle, CURLcode result)
 		else {
 			finished = true;
 		}
-	} else if (result == CURLE_WRITE_ERROR && f->stopped) {
+	} else if ((result == CURLE_WRITE_ERROR ||
+		    result == CURLE_ABORTED_BY_CALLBACK) && f->stopped) {
 		/* CURLE_WRITE_ERROR occurs when fetch_curl_data
-		 * returns 0, which we use to abort intentionally
+		 * returns 0, which we use to abort intentionally,
+		 * the network thread may also stop the transfer from
+		 * the progress callback.
 		 */
 		;
 	} else if (result == CURLE_SSL_PEER_CERTIFICATE ||
@@ -1350,117 +2341,60 @@ static void fetch_curl_done(CURL *curl_handle, CURLcode result)
 
 
 /**
- * Do some work on current fetches.
+ * Record the HTTP response code of a fetch if not already known.
  *
- * Must be called regularly to make progress on fetches.
+ * \param f The fetch.
+ * \param http_code The response code reported by cURL.
  */
-static void fetch_curl_poll(lwc_string *scheme_ignored)
+static void fetch_curl_set_http_code(struct curl_fetch_info *f, long http_code)
 {
-	int running, queue;
-	CURLMcode codem;
-	CURLMsg *curl_msg;
+	if (!f->http_code) {
+		f->http_code = http_code;
+		fetch_set_http_code(f->fetch_handle, f->http_code);
+	}
+}
 
-	if (nsoption_bool(suppress_curl_debug) == false) {
-		fd_set read_fd_set, write_fd_set, exc_fd_set;
-		int max_fd = -1;
-		int i;
 
-		FD_ZERO(&read_fd_set);
-		FD_ZERO(&write_fd_set);
-		FD_ZERO(&exc_fd_set);
+/**
+ * Rate limit each fetch's progress notifications.
+ *
+ * \param f The fetch.
+ * \return true if a progress notification should be sent now.
+ */
+static bool fetch_curl_progress_due(struct curl_fetch_info *f)
+{
+	uint64_t time_now_ms;
 
-		codem = curl_multi_fdset(fetch_curl_multi,
-				&read_fd_set, &write_fd_set,
-				&exc_fd_set, &max_fd);
-		assert(codem == CURLM_OK);
+	nsu_getmonotonic_ms(&time_now_ms);
+#define UPDATE_DELAY_MS (1000 / UPDATES_PER_SECOND)
+	if (time_now_ms - f->last_progress_update < UPDATE_DELAY_MS) {
+		return false;
+	}
+#undef UPDATE_DELAY_MS
+	f->last_progress_update = time_now_ms;
 
-		NSLOG(netsurf, DEEPDEBUG,
-		      "Curl file descriptor states (maxfd=%i):", max_fd);
-		for (i = 0; i <= max_fd; i++) {
-			bool read = false;
-			bool write = false;
-			bool error = false;
-
-			if (FD_ISSET(i, &read_fd_set)) {
-				read = true;
-			}
-			if (FD_ISSET(i, &write_fd_set)) {
-				write = true;
-			}
-			if (FD_ISSET(i, &exc_fd_set)) {
-				error = true;
-			}
-			if (read || write || error) {
-				NSLOG(netsurf, DEEPDEBUG, "  fd %i: %s %s %s", i,
-				      read ? "read" : "    ",
-				      write ? "write" : "     ",
-				      error ? "error" : "     ");
-			}
-		}
-	}
-
-	/* do any possible work on the current fetches */
-	inside_curl = true;
-	do {
-		codem = curl_multi_perform(fetch_curl_multi, &running);
-		if (codem != CURLM_OK && codem != CURLM_CALL_MULTI_PERFORM) {
-			NSLOG(netsurf, WARNING,
-			      "curl_multi_perform: %i %s",
-			      codem, curl_multi_strerror(codem));
-			return;
-		}
-	} while (codem == CURLM_CALL_MULTI_PERFORM);
-
-	/* process curl results */
-	curl_msg = curl_multi_info_read(fetch_curl_multi, &queue);
-	while (curl_msg) {
-		switch (curl_msg->msg) {
-			case CURLMSG_DONE:
-				fetch_curl_done(curl_msg->easy_handle,
-						curl_msg->data.result);
-				break;
-			default:
-				break;
-		}
-		curl_msg = curl_multi_info_read(fetch_curl_multi, &queue);
-	}
-	inside_curl = false;
+	return true;
 }
 
 
-
-
 /**
- * Callback function for fetch progress.
+ * Send a progress notification for a fetch.
+ *
+ * \param f The fetch.
+ * \param dltotal The expected size of the body or zero if unknown.
+ * \param dlnow The amount of body received so far.
  */
-static int
-fetch_curl_progress(void *clientp,
-		    double dltotal,
-		    double dlnow,
-		    double ultotal,
-		    double ulnow)
+static void
+fetch_curl_report_progress(struct curl_fetch_info *f,
+			   double dltotal,
+			   double dlnow)
 {
 	static char fetch_progress_buffer[256]; /**< Progress buffer for cURL */
-	struct curl_fetch_info *f = (struct curl_fetch_info *) clientp;
-	uint64_t time_now_ms;
 	fetch_msg msg;
 
-	if (f->abort) {
-		return 0;
-        }
-
 	msg.type = FETCH_PROGRESS;
 	msg.data.progress = fetch_progress_buffer;
 
-	/* Rate limit each fetch's progress notifications */
-        nsu_getmonotonic_ms(&time_now_ms);
-#define UPDATE_DELAY_MS (1000 / UPDATES_PER_SECOND)
-	if (time_now_ms - f->last_progress_update < UPDATE_DELAY_MS) {
-		return 0;
-        }
-#undef UPDATE_DELAY_MS
-	f->last_progress_update = time_now_ms;
-
 	if (dltotal > 0) {
 		snprintf(fetch_progress_buffer, 255,
 				messages_get("Progress"),
@@ -1473,99 +2407,73 @@ fetch_curl_progress(void *clientp,
 				human_friendly_bytesize(dlnow));
 		fetch_send_callback(&msg, f->fetch_handle);
 	}
-
-	return 0;
-}
-
-
-/**
- * Format curl debug for nslog
- */
-static int
-fetch_curl_debug(CURL *handle,
-		 curl_infotype type,
-		 char *data,
-		 size_t size,
-		 void *userptr)
-{
-	static const char s_infotype[CURLINFO_END][3] = {
-		"* ", "< ", "> ", "{ ", "} ", "{ ", "} "
-	};
-	switch(type) {
-	case CURLINFO_TEXT:
-	case CURLINFO_HEADER_OUT:
-	case CURLINFO_HEADER_IN:
-		NSLOG(fetch, DEBUG, "%s%.*s", s_infotype[type], (int)size - 1, data);
-		break;
-
-	default:
-		break;
-	}
-	return 0;
 }
 
 
 /**
- * Callback function for cURL.
+ * Pass a block of received body data to the caller.
+ *
+ * \param f The fetch.
+ * \param data The data received.
+ * \param len The length of data.
+ * \return true to continue the transfer or false to stop it.
  */
-static size_t fetch_curl_data(char *data, size_t size, size_t nmemb, void *_f)
+static bool
+fetch_curl_process_data(struct curl_fetch_info *f,
+			const uint8_t *data,
+			size_t len)
 {
-	struct curl_fetch_info *f = _f;
-	CURLcode code;
 	fetch_msg msg;
 
-	/* ensure we only have to get this information once */
-	if (!f->http_code) {
-		code = curl_easy_getinfo(f->curl_handle, CURLINFO_HTTP_CODE,
-					 &f->http_code);
-		fetch_set_http_code(f->fetch_handle, f->http_code);
-		assert(code == CURLE_OK);
-	}
-
 	/* ignore body if this is a 401 reply by skipping it and reset
 	 * the HTTP response code to enable follow up fetches.
 	 */
 	if (f->http_code == 401) {
 		f->http_code = 0;
-		return size * nmemb;
+		return true;
 	}
 
 	if (f->abort || (!f->had_headers && fetch_curl_process_headers(f))) {
 		f->stopped = true;
-		return 0;
+		return false;
 	}
 
 	/* send data to the caller */
 	msg.type = FETCH_DATA;
-	msg.data.header_or_data.buf = (const uint8_t *) data;
-	msg.data.header_or_data.len = size * nmemb;
+	msg.data.header_or_data.buf = data;
+	msg.data.header_or_data.len = len;
 	fetch_send_callback(&msg, f->fetch_handle);
 
 	if (f->abort) {
 		f->stopped = true;
-		return 0;
+		return false;
 	}
 
-	return size * nmemb;
+	return true;
 }
 
 
 /**
- * Callback function for headers.
+ * Pass a received header line to the caller.
  *
  * See RFC 2616 4.2.
+ *
+ * \param f The fetch.
+ * \param data The header line.
+ * \param size The length of the header line.
+ * \return true to continue the transfer or false to stop it.
  */
-static size_t
-fetch_curl_header(char *data, size_t size, size_t nmemb, void *_f)
+static bool
+fetch_curl_process_header(struct curl_fetch_info *f,
+			  const char *data,
+			  size_t size)
 {
-	struct curl_fetch_info *f = _f;
 	int i;
 	fetch_msg msg;
-	size *= nmemb;
 
 	if (f->abort) {
 		f->stopped = true;
-		return 0;
+		return false;
 	}
 
 	if (f->sent_ssl_chain == false) {
@@ -1585,7 +2493,7 @@ fetch_curl_header(char *data, size_t size, size_t nmemb, void *_f)
 		f->location = malloc(size);
 		if (!f->location) {
 			NSLOG(netsurf, INFO, "malloc failed");
-			return size;
+			return true;
 		}
 		SKIP_ST(9);
 		strncpy(f->location, data + i, size - i);
@@ -1634,10 +2542,357 @@ fetch_curl_header(char *data, size_t size, size_t nmemb, void *_f)
 		fetch_set_cookie(f->fetch_handle, &data[i]);
 	}
 
-	return size;
+	return true;
 #undef SKIP_ST
 }
 
+
+#ifdef WITH_CURL_THREAD
+
+/**
+ * Act upon an event from the network thread.
+ *
+ * \param ev The event, ownership is taken.
+ */
+static void fetch_curl_process_event(struct curl_event *ev)
+{
+	struct curl_fetch_info *f = ev->f;
+
+	switch (ev->type) {
+	case CURL_EVENT_HEADER:
+		if (!f->stopped &&
+		    !fetch_curl_process_header(f, (const char *)ev->data,
+					       ev->len)) {
+			fetch_curl_thread_cancel(f, false);
+		}
+		break;
+
+	case CURL_EVENT_DATA:
+		if (!f->stopped) {
+			fetch_curl_set_http_code(f, ev->http_code);
+			if (!fetch_curl_process_data(f, ev->data, ev->len)) {
+				fetch_curl_thread_cancel(f, false);
+			}
+		}
+		break;
+
+	case CURL_EVENT_PROGRESS:
+		if (!f->stopped && !f->abort) {
+			fetch_curl_report_progress(f, ev->dltotal, ev->dlnow);
+		}
+		break;
+
+	case CURL_EVENT_DONE:
+		f->worker_refs--;
+		fetch_curl_set_http_code(f, ev->http_code);
+		fetch_curl_done(f, ev->result);
+		/* f may have been freed */
+		break;
+
+	case CURL_EVENT_RELEASE:
+		f->worker_refs--;
+		if (f->free_pending && f->worker_refs == 0) {
+			fetch_curl_free(f);
+		}
+		break;
+
+	case CURL_EVENT_LOG:
+		switch (ev->log) {
+		case CURL_LOG_FETCH_DEBUG:
+			NSLOG(fetch, DEBUG, "%s", (const char *)ev->data);
+			break;
+
+		case CURL_LOG_DEBUG:
+			NSLOG(netsurf, DEBUG, "%s", (const char *)ev->data);
+			break;
+
+		case CURL_LOG_WARNING:
+			NSLOG(netsurf, WARNING, "%s", (const char *)ev->data);
+			break;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	free(ev);
+}
+
+
+/**
+ * Do some work on current fetches.
+ *
+ * Must be called regularly to make progress on fetches. The transfers
+ * themselves progress on the network thread, this delivers everything
+ * it has received since the last call.
+ */
+static void fetch_curl_poll(lwc_string *scheme_ignored)
+{
+	struct curl_event *ev;
+
+	while ((ev = spsc_queue_pop(curl_event_queue)) != NULL) {
+		fetch_curl_thread_space();
+		fetch_curl_process_event(ev);
+	}
+}
+
+
+/**
+ * Callback function for fetch progress.
+ *
+ * Called on the network thread.
+ */
+static int
+fetch_curl_progress(void *clientp,
+		    double dltotal,
+		    double dlnow,
+		    double ultotal,
+		    double ulnow)
+{
+	struct curl_fetch_info *f = (struct curl_fetch_info *) clientp;
+	struct curl_event *ev;
+
+	if (__atomic_load_n(&f->cancel, __ATOMIC_ACQUIRE)) {
+		/* ends transfers no data callback will stop */
+		return 1;
+	}
+
+	if (!fetch_curl_progress_due(f)) {
+		return 0;
+	}
+
+	ev = fetch_curl_event_create(CURL_EVENT_PROGRESS, f, NULL, 0);
+	if (ev != NULL) {
+		ev->dltotal = dltotal;
+		ev->dlnow = dlnow;
+		fetch_curl_thread_post(ev, f->curl_handle);
+	}
+
+	return 0;
+}
+
+
+/**
+ * Callback function for cURL.
+ *
+ * Called on the network thread.
+ */
+static size_t fetch_curl_data(char *data, size_t size, size_t nmemb, void *_f)
+{
+	struct curl_fetch_info *f = _f;
+	struct curl_event *ev;
+
+	size *= nmemb;
+
+	if (__atomic_load_n(&f->cancel, __ATOMIC_ACQUIRE)) {
+		return 0;
+	}
+
+	ev = fetch_curl_event_create(CURL_EVENT_DATA, f, data, size);
+	if (ev == NULL || !fetch_curl_thread_post(ev, f->curl_handle)) {
+		return 0;
+	}
+
+	return size;
+}
+
+
+/**
+ * Callback function for headers.
+ *
+ * Called on the network thread.
+ */
+static size_t
+fetch_curl_header(char *data, size_t size, size_t nmemb, void *_f)
+{
+	struct curl_fetch_info *f = _f;
+	struct curl_event *ev;
+
+	size *= nmemb;
+
+	if (__atomic_load_n(&f->cancel, __ATOMIC_ACQUIRE)) {
+		return 0;
+	}
+
+	ev = fetch_curl_event_create(CURL_EVENT_HEADER, f, data, size);
+	if (ev == NULL || !fetch_curl_thread_post(ev, f->curl_handle)) {
+		return 0;
+	}
+
+	return size;
+}
+
+
+/**
+ * The network thread waits on the transfer sockets itself so there is
+ * nothing for the frontend to select on.
+ */
+static int fetch_curl_fdset(lwc_string *scheme, fd_set *read_set,
+			    fd_set *write_set, fd_set *error_set)
+{
+	return -1;
+}
+
+#else /* WITH_CURL_THREAD */
+
+/**
+ * Do some work on current fetches.
+ *
+ * Must be called regularly to make progress on fetches.
+ */
+static void fetch_curl_poll(lwc_string *scheme_ignored)
+{
+	int running, queue;
+	CURLMcode codem;
+	CURLMsg *curl_msg;
+	struct curl_fetch_info *f;
+	char **_hideous_hack = (char **) (void *) &f;
+	CURLcode code;
+
+	if (nsoption_bool(suppress_curl_debug) == false) {
+		fd_set read_fd_set, write_fd_set, exc_fd_set;
+		int max_fd = -1;
+		int i;
+
+		FD_ZERO(&read_fd_set);
+		FD_ZERO(&write_fd_set);
+		FD_ZERO(&exc_fd_set);
+
+		codem = curl_multi_fdset(fetch_curl_multi,
+				&read_fd_set, &write_fd_set,
+				&exc_fd_set, &max_fd);
+		assert(codem == CURLM_OK);
+
+		NSLOG(netsurf, DEEPDEBUG,
+		      "Curl file descriptor states (maxfd=%i):", max_fd);
+		for (i = 0; i <= max_fd; i++) {
+			bool read = false;
+			bool write = false;
+			bool error = false;
+
+			if (FD_ISSET(i, &read_fd_set)) {
+				read = true;
+			}
+			if (FD_ISSET(i, &write_fd_set)) {
+				write = true;
+			}
+			if (FD_ISSET(i, &exc_fd_set)) {
+				error = true;
+			}
+			if (read || write || error) {
+				NSLOG(netsurf, DEEPDEBUG, "  fd %i: %s %s %s", i,
+				      read ? "read" : "    ",
+				      write ? "write" : "     ",
+				      error ? "error" : "     ");
+			}
+		}
+	}
+
+	/* do any possible work on the current fetches */
+	inside_curl = true;
+	do {
+		codem = curl_multi_perform(fetch_curl_multi, &running);
+		if (codem != CURLM_OK && codem != CURLM_CALL_MULTI_PERFORM) {
+			NSLOG(netsurf, WARNING,
+			      "curl_multi_perform: %i %s",
+			      codem, curl_multi_strerror(codem));
+			return;
+		}
+	} while (codem == CURLM_CALL_MULTI_PERFORM);
+
+	/* process curl results */
+	curl_msg = curl_multi_info_read(fetch_curl_multi, &queue);
+	while (curl_msg) {
+		switch (curl_msg->msg) {
+			case CURLMSG_DONE:
+				/* find the structure associated with this
+				 * fetch. For some reason, cURL thinks
+				 * CURLINFO_PRIVATE should be a string?!
+				 */
+				code = curl_easy_getinfo(curl_msg->easy_handle,
+							 CURLINFO_PRIVATE,
+							 _hideous_hack);
+				assert(code == CURLE_OK);
+
+				fetch_curl_done(f, curl_msg->data.result);
+				break;
+			default:
+				break;
+		}
+		curl_msg = curl_multi_info_read(fetch_curl_multi, &queue);
+	}
+	inside_curl = false;
+}
+
+
+/**
+ * Callback function for fetch progress.
+ */
+static int
+fetch_curl_progress(void *clientp,
+		    double dltotal,
+		    double dlnow,
+		    double ultotal,
+		    double ulnow)
+{
+	struct curl_fetch_info *f = (struct curl_fetch_info *) clientp;
+
+	if (f->abort) {
+		return 0;
+	}
+
+	if (fetch_curl_progress_due(f)) {
+		fetch_curl_report_progress(f, dltotal, dlnow);
+	}
+
+	return 0;
+}
+
+
+/**
+ * Callback function for cURL.
+ */
+static size_t fetch_curl_data(char *data, size_t size, size_t nmemb, void *_f)
+{
+	struct curl_fetch_info *f = _f;
+	long http_code;
+	CURLcode code;
+
+	/* ensure we only have to get this information once */
+	if (!f->http_code) {
+		code = curl_easy_getinfo(f->curl_handle, CURLINFO_HTTP_CODE,
+					 &http_code);
+		assert(code == CURLE_OK);
+		fetch_curl_set_http_code(f, http_code);
+	}
+
+	if (!fetch_curl_process_data(f, (const uint8_t *)data, size * nmemb)) {
+		return 0;
+	}
+
+	return size * nmemb;
+}
+
+
+/**
+ * Callback function for headers.
+ */
+static size_t
+fetch_curl_header(char *data, size_t size, size_t nmemb, void *_f)
+{
+	struct curl_fetch_info *f = _f;
+
+	size *= nmemb;
+
+	if (!fetch_curl_process_header(f, data, size)) {
+		return 0;
+	}
+
+	return size;
+}
+
+
 static int fetch_curl_fdset(lwc_string *scheme, fd_set *read_set,
 			    fd_set *write_set, fd_set *error_set)
 {
@@ -1654,6 +2909,41 @@ static int fetch_curl_fdset(lwc_string *scheme, fd_set *read_set,
 	return maxfd;
 }
 
+#endif /* WITH_CURL_THREAD */
+
+
+/**
+ * Format curl debug for nslog
+ */
+static int
+fetch_curl_debug(CURL *handle,
+		 curl_infotype type,
+		 char *data,
+		 size_t size,
+		 void *userptr)
+{
+	static const char s_infotype[CURLINFO_END][3] = {
+		"* ", "< ", "> ", "{ ", "} ", "{ ", "} "
+	};
+	switch(type) {
+	case CURLINFO_TEXT:
+	case CURLINFO_HEADER_OUT:
+	case CURLINFO_HEADER_IN:
+#ifdef WITH_CURL_THREAD
+		/* called on the network thread */
+		fetch_curl_thread_log(CURL_LOG_FETCH_DEBUG, "%s%.*s",
+				      s_infotype[type], (int)size - 1, data);
+#else
+		NSLOG(fetch, DEBUG, "%s%.*s", s_infotype[type], (int)size - 1, data);
+#endif
+		break;
+
+	default:
+		break;
+	}
+	return 0;
+}
+
 
 
 /* exported function documented in content/fetchers/curl.h */
@@ -1751,7 +3041,11 @@ nserror fetch_curl_register(void)
 	SETOPT(CURLOPT_PROGRESSFUNCTION, fetch_curl_progress);
 	SETOPT(CURLOPT_NOPROGRESS, 0);
 	SETOPT(CURLOPT_USERAGENT, user_agent_string());
-	SETOPT(CURLOPT_ENCODING, "gzip");
+	/* An empty string makes libcurl advertise every content coding
+	 * it was built with (gzip, deflate and, where available, br and
+	 * zstd) and decode them as the body streams in.
+	 */
+	SETOPT(CURLOPT_ENCODING, "");
 	SETOPT(CURLOPT_LOW_SPEED_LIMIT, 1L);
 	SETOPT(CURLOPT_LOW_SPEED_TIME, 180L);
 	SETOPT(CURLOPT_NOSIGNAL, 1L);
@@ -1791,6 +3085,12 @@ nserror fetch_curl_register(void)
 	NSLOG(netsurf, INFO, "cURL %slinked against openssl",
 	      curl_with_openssl ? "" : "not ");
 
+#ifdef WITH_CURL_THREAD
+	if (fetch_curl_thread_init() != NSERROR_OK) {
+		return NSERROR_INIT_FAILED;
+	}
+#endif
+
 	/* cURL initialised okay, register the fetchers */
 
 	data = curl_version_info(CURLVERSION_NOW);
@@ -1801,6 +3101,20 @@ nserror fetch_curl_register(void)
 		return NSERROR_NOMEM;
 	}
 
+#ifdef WITH_OPENSSL
+	/* restore resumable sessions from the previous run */
+	if (curl_with_openssl &&
+	    (nsoption_charp(tls_session_file) != NULL) &&
+	    (nsoption_charp(tls_session_file)[0] != '\0')) {
+		curl_tls_session_hashmap =
+			hashmap_create(&curl_tls_session_hashmap_parameters);
+		if (curl_tls_session_hashmap != NULL) {
+			fetch_curl_tls_session_load(
+				nsoption_charp(tls_session_file));
+		}
+	}
+#endif
+
 	for (i = 0; data->protocols[i]; i++) {
 		if (strcmp(data->protocols[i], "http") == 0) {
 			scheme = lwc_string_ref(corestring_lwc_http);
@@ -25,7 +25,9 @@
  * \todo Consider improving eviction sorting to include objects size
  *         and remaining lifetime and other cost metrics.
  *
- * \todo Implement mmap retrieval where supported.
+ * Decoded image bitmaps are kept as a third, optional, element of an
+ * object's entry so they share its lifetime and the eviction budget.
+ * Where supported they are mapped rather than read on retrieval.
  *
  * \todo Implement static retrieval for metadata objects as their heap
  *         lifetime is typically very short, though this may be obsoleted
@@ -33,6 +35,8 @@
  *
  */
 
+#include "utils/config.h"
+
 #include <unistd.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -41,7 +45,11 @@
 #include <errno.h>
 #include <time.h>
 #include <stdlib.h>
+#include <zlib.h>
 #include <nsutils/unistd.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 
 #include "netsurf/inttypes.h"
 #include "utils/filepath.h"
@@ -56,7 +64,7 @@
 #include "content/backing_store.h"
 
 /** Backing store file format version */
-#define CONTROL_VERSION 202
+#define CONTROL_VERSION 204
 
 /**
  * Number of milliseconds after a update before control data
@@ -85,9 +93,15 @@
 /** log2 size of metadata blocks (8k) */
 #define BLOCK_META_SIZE 13
 
+/** log2 size of bitmap blocks (8k) */
+#define BLOCK_BITMAP_SIZE 13
+
 /** length in bytes of a block files use map */
 #define BLOCK_USE_MAP_SIZE (1 << (BLOCK_ENTRY_COUNT - 3))
 
+/** size of buffer used when streaming compressed data from a file */
+#define INFLATE_CHUNK_SIZE (16 * 1024)
+
 /**
  * The type used to store index values referring to store entries. Care
  * must be taken with this type as it is used to build address to
@@ -117,7 +131,8 @@ typedef uint16_t block_index_t;
 enum store_entry_elem_idx {
 	ENTRY_ELEM_DATA = 0, /**< entry element is data */
 	ENTRY_ELEM_META = 1,  /**< entry element is metadata */
-	ENTRY_ELEM_COUNT = 2, /**< count of elements on an entry */
+	ENTRY_ELEM_BITMAP = 2, /**< entry element is a decoded bitmap */
+	ENTRY_ELEM_COUNT = 3, /**< count of elements on an entry */
 };
 
 /**
@@ -133,8 +148,13 @@ enum store_entry_elem_flags {
 	ENTRY_ELEM_FLAG_MMAP = 0x2,
 	/** entry data allocation is in small object pool */
 	ENTRY_ELEM_FLAG_SMALL = 0x4,
+	/** entry data is deflated on disc */
+	ENTRY_ELEM_FLAG_COMPRESSED = 0x8,
 };
 
+/** entry element flags which indicate the store holds an allocation */
+#define ENTRY_ELEM_FLAG_ALLOC (ENTRY_ELEM_FLAG_HEAP | ENTRY_ELEM_FLAG_MMAP)
+
 
 enum store_entry_flags {
 	/** entry is normal */
@@ -149,7 +169,7 @@ enum store_entry_flags {
  * An element keeps data about:
  *  - the current memory allocation
  *  - the number of outstanding references to the memory
- *  - the size of the element data
+ *  - the size of the element data on disc and in memory
  *  - flags controlling how the memory and element are handled
  *
  * @note Order is important to avoid excessive structure packing overhead.
@@ -157,6 +177,7 @@ enum store_entry_flags {
 struct store_entry_element {
 	uint8_t* data; /**< data allocated */
 	uint32_t size; /**< size of entry element on disc */
+	uint32_t len; /**< size of entry element data once read */
 	block_index_t block; /**< small object data block */
 	uint8_t ref; /**< element data reference count */
 	uint8_t flags; /**< entry flags */
@@ -165,10 +186,10 @@ struct store_entry_element {
 /**
  * Backing store object index entry.
  *
- * An entry in the backing store contains two elements for the actual
- * data and the metadata. The two elements are treated identically for
- * storage lifetime but as a collective whole for expiration and
- * indexing.
+ * An entry in the backing store contains elements for the actual
+ * data, the metadata and optionally a decoded bitmap of the data. The
+ * elements are treated identically for storage lifetime but as a
+ * collective whole for expiration and indexing.
  *
  * @note Order is important to avoid excessive structure packing overhead.
  */
@@ -177,7 +198,7 @@ struct store_entry {
 	int64_t last_used; /**< UNIX time the entry was last used */
 	uint16_t use_count; /**< number of times this entry has been accessed */
 	uint8_t flags; /**< entry flags */
-	/** Entry element (data or meta) specific information */
+	/** Entry element (data, meta or bitmap) specific information */
 	struct store_entry_element elem[ENTRY_ELEM_COUNT];
 };
 
@@ -196,7 +217,8 @@ struct block_file {
  */
 static const unsigned int log2_block_size[ENTRY_ELEM_COUNT] = {
 	BLOCK_DATA_SIZE, /**< Data block size */
-	BLOCK_META_SIZE  /**< Metadata block size */
+	BLOCK_META_SIZE, /**< Metadata block size */
+	BLOCK_BITMAP_SIZE /**< Bitmap block size */
 };
 
 /**
@@ -207,6 +229,7 @@ struct store_state {
 	char *path; /**< The path to the backing store */
 	size_t limit; /**< The backing store upper bound target size */
 	size_t hysteresis; /**< The hysteresis around the target size */
+	bool compress; /**< Whether to deflate object data */
 
 	/**
 	 * The cache object hash
@@ -335,7 +358,7 @@ store_fname(struct store_state *state,
 
 	/* directories used to separate elements */
 	const char *base_dir_table[] = {
-		"d", "m", "dblk", "mblk"
+		"d", "m", "b", "dblk", "mblk", "bblk"
 	};
 
 	/* RFC4648 base32 encoding table (six bits) */
@@ -395,6 +418,7 @@ store_fname(struct store_state *state,
 	switch (elem_idx) {
 	case ENTRY_ELEM_DATA:
 	case ENTRY_ELEM_META:
+	case ENTRY_ELEM_BITMAP:
 		netsurf_mkpath(&fname, NULL, 8,
 			       state->path, b32u_d[0], b32u_d[1], b32u_d[2],
 			       b32u_d[3], b32u_d[4], b32u_d[5], b32u_i);
@@ -402,6 +426,7 @@ store_fname(struct store_state *state,
 
 	case (ENTRY_ELEM_COUNT + ENTRY_ELEM_META):
 	case (ENTRY_ELEM_COUNT + ENTRY_ELEM_DATA):
+	case (ENTRY_ELEM_COUNT + ENTRY_ELEM_BITMAP):
 		netsurf_mkpath(&fname, NULL, 3,
 			       state->path, b32u_d[0], b32u_d[1]);
 		break;
@@ -468,15 +493,18 @@ static nserror
 invalidate_entry(struct store_state *state, struct store_entry *bse)
 {
 	nserror ret;
+	int elem_idx;
 
 	/* mark entry as invalid */
 	bse->flags |= ENTRY_FLAGS_INVALID;
 
 	/* check if the entry has storage already allocated */
-	if (((bse->elem[ENTRY_ELEM_DATA].flags &
-	     (ENTRY_ELEM_FLAG_HEAP | ENTRY_ELEM_FLAG_MMAP)) != 0) ||
-	    ((bse->elem[ENTRY_ELEM_META].flags &
-	      (ENTRY_ELEM_FLAG_HEAP | ENTRY_ELEM_FLAG_MMAP)) != 0)) {
+	for (elem_idx = 0; elem_idx < ENTRY_ELEM_COUNT; elem_idx++) {
+		if ((bse->elem[elem_idx].flags & ENTRY_ELEM_FLAG_ALLOC) != 0) {
+			break;
+		}
+	}
+	if (elem_idx != ENTRY_ELEM_COUNT) {
 		/*
 		 * This entry cannot be immediately removed as it has
 		 * associated allocation so wait for allocation release.
@@ -498,6 +526,13 @@ invalidate_entry(struct store_state *state, struct store_entry *bse)
 		NSLOG(netsurf, ERROR, "Error invalidating data element");
 	}
 
+	if (bse->elem[ENTRY_ELEM_BITMAP].size != 0) {
+		ret = invalidate_element(state, bse, ENTRY_ELEM_BITMAP);
+		if (ret != NSERROR_OK) {
+			NSLOG(netsurf, ERROR, "Error invalidating bitmap element");
+		}
+	}
+
 	/* As our final act we remove bse from the cache */
 	hashmap_remove(state->entries, bse->url);
 	/* From now, bse is invalid memory */
@@ -513,25 +548,20 @@ static int compar(const void *va, const void *vb)
 {
 	const struct store_entry *a = *(const struct store_entry **)va;
 	const struct store_entry *b = *(const struct store_entry **)vb;
+	int elem_idx;
 
 	/* consider the allocation flags - if an entry has an
 	 * allocation it is considered more valuable as it cannot be
 	 * freed.
 	 */
-	if ((a->elem[ENTRY_ELEM_DATA].flags == ENTRY_ELEM_FLAG_NONE) &&
-	    (b->elem[ENTRY_ELEM_DATA].flags != ENTRY_ELEM_FLAG_NONE)) {
-		return -1;
-	} else if ((a->elem[ENTRY_ELEM_DATA].flags != ENTRY_ELEM_FLAG_NONE) &&
-		   (b->elem[ENTRY_ELEM_DATA].flags == ENTRY_ELEM_FLAG_NONE)) {
-		return 1;
-	}
-
-	if ((a->elem[ENTRY_ELEM_META].flags == ENTRY_ELEM_FLAG_NONE) &&
-	    (b->elem[ENTRY_ELEM_META].flags != ENTRY_ELEM_FLAG_NONE)) {
-		return -1;
-	} else if ((a->elem[ENTRY_ELEM_META].flags != ENTRY_ELEM_FLAG_NONE) &&
-		   (b->elem[ENTRY_ELEM_META].flags == ENTRY_ELEM_FLAG_NONE)) {
-		return 1;
+	for (elem_idx = 0; elem_idx < ENTRY_ELEM_COUNT; elem_idx++) {
+		if (((a->elem[elem_idx].flags & ENTRY_ELEM_FLAG_ALLOC) == 0) &&
+		    ((b->elem[elem_idx].flags & ENTRY_ELEM_FLAG_ALLOC) != 0)) {
+			return -1;
+		} else if (((a->elem[elem_idx].flags & ENTRY_ELEM_FLAG_ALLOC) != 0) &&
+			   ((b->elem[elem_idx].flags & ENTRY_ELEM_FLAG_ALLOC) == 0)) {
+			return 1;
+		}
 	}
 
 	if (a->use_count < b->use_count) {
@@ -630,6 +660,7 @@ static nserror store_evict(struct store_state *state)
 
 		removed += bse->elem[ENTRY_ELEM_DATA].size;
 		removed += bse->elem[ENTRY_ELEM_META].size;
+		removed += bse->elem[ENTRY_ELEM_BITMAP].size;
 
 		ret = invalidate_entry(state, bse);
 		if (ret != NSERROR_OK) {
@@ -975,6 +1006,7 @@ static block_index_t alloc_block(struct store_state *state, int elem_idx)
  * @param elem_idx The index of the entry element to use.
  * @param data The data to store
  * @param datalen The length of data in \a data
+ * @param disclen The length of the data as written to disc.
  * @param bse Pointer used to return value.
  * @return NSERROR_OK and \a bse updated on success or NSERROR_NOT_FOUND
  *         if no entry corresponds to the url.
@@ -985,6 +1017,7 @@ set_store_entry(struct store_state *state,
 		int elem_idx,
 		uint8_t *data,
 		const size_t datalen,
+		const size_t disclen,
 		struct store_entry **bse)
 {
 	struct store_entry *se;
@@ -1022,18 +1055,44 @@ set_store_entry(struct store_state *state,
 		return NSERROR_PERMISSION;
 	}
 
-	/* set the common entry data */
-	se->use_count = 1;
+	if ((elem_idx == ENTRY_ELEM_BITMAP) && (elem->size != 0)) {
+		/* a replacement bitmap may change between block and
+		 * file storage so release the old one first.
+		 */
+		invalidate_element(state, se, elem_idx);
+		memset(elem, 0, sizeof(*elem));
+	} else if ((elem_idx == ENTRY_ELEM_DATA) &&
+		   (se->elem[ENTRY_ELEM_BITMAP].size != 0) &&
+		   ((se->elem[ENTRY_ELEM_BITMAP].flags &
+		     ENTRY_ELEM_FLAG_ALLOC) == 0)) {
+		/* the bitmap was decoded from the data being replaced */
+		invalidate_element(state, se, ENTRY_ELEM_BITMAP);
+		memset(&se->elem[ENTRY_ELEM_BITMAP], 0,
+		       sizeof(struct store_entry_element));
+	}
+
+	/* set the common entry data, a bitmap is derived from the
+	 * stored data so does not restart its use count.
+	 */
+	if (elem_idx != ENTRY_ELEM_BITMAP) {
+		se->use_count = 1;
+	}
 	se->last_used = time(NULL);
 
 	/* store the data in the element */
 	elem->flags |= ENTRY_ELEM_FLAG_HEAP;
+	if (disclen != datalen) {
+		elem->flags |= ENTRY_ELEM_FLAG_COMPRESSED;
+	} else {
+		elem->flags &= ~ENTRY_ELEM_FLAG_COMPRESSED;
+	}
 	elem->data = data;
+	elem->len = datalen;
 	elem->ref = 1;
 
 	/* account for size of entry element */
 	state->total_alloc -= elem->size;
-	elem->size = datalen;
+	elem->size = disclen;
 	state->total_alloc += elem->size;
 
 	/* if the element will fit in a small block attempt to allocate one */
@@ -1199,9 +1258,11 @@ read_entries(struct store_state *state)
 			/* Note the size allocation */
 			state->total_alloc += ent->elem[ENTRY_ELEM_DATA].size;
 			state->total_alloc += ent->elem[ENTRY_ELEM_META].size;
+			state->total_alloc += ent->elem[ENTRY_ELEM_BITMAP].size;
 			/* And ensure we don't pretend to have this in memory yet */
 			ent->elem[ENTRY_ELEM_DATA].flags &= ~(ENTRY_ELEM_FLAG_HEAP | ENTRY_ELEM_FLAG_MMAP);
 			ent->elem[ENTRY_ELEM_META].flags &= ~(ENTRY_ELEM_FLAG_HEAP | ENTRY_ELEM_FLAG_MMAP);
+			ent->elem[ENTRY_ELEM_BITMAP].flags &= ~(ENTRY_ELEM_FLAG_HEAP | ENTRY_ELEM_FLAG_MMAP);
 
 		}
 		close(fd);
@@ -1263,12 +1324,14 @@ read_blocks(struct store_state *state)
 		/* ensure block 0 (invalid sentinel) is skipped */
 		state->blocks[ENTRY_ELEM_DATA][0].use_map[0] = 1;
 		state->blocks[ENTRY_ELEM_META][0].use_map[0] = 1;
+		state->blocks[ENTRY_ELEM_BITMAP][0].use_map[0] = 1;
 	}
 
 	/* initialise block file file descriptors */
 	for (bfidx = 0; bfidx < BLOCK_FILE_COUNT; bfidx++) {
 		state->blocks[ENTRY_ELEM_DATA][bfidx].fd = -1;
 		state->blocks[ENTRY_ELEM_META][bfidx].fd = -1;
+		state->blocks[ENTRY_ELEM_BITMAP][bfidx].fd = -1;
 	}
 
 	return NSERROR_OK;
@@ -1454,6 +1517,7 @@ initialise(const struct llcache_store_parameters *parameters)
 	newstate->path = strdup(parameters->path);
 	newstate->limit = parameters->limit;
 	newstate->hysteresis = parameters->hysteresis;
+	newstate->compress = parameters->compress;
 
 	/* read store control and create new if required */
 	ret = read_control(newstate);
@@ -1549,6 +1613,9 @@ finalise(void)
 			if (storestate->blocks[ENTRY_ELEM_META][bf].fd != -1) {
 				close(storestate->blocks[ENTRY_ELEM_META][bf].fd);
 			}
+			if (storestate->blocks[ENTRY_ELEM_BITMAP][bf].fd != -1) {
+				close(storestate->blocks[ENTRY_ELEM_BITMAP][bf].fd);
+			}
 		}
 
 		op_count = storestate->hit_count + storestate->miss_count;
@@ -1581,11 +1648,13 @@ finalise(void)
  * \param state The backing store state to use.
  * \param bse The entry to store
  * \param elem_idx The element index within the entry.
+ * \param data The data to write, the elements size in length.
  * \return NSERROR_OK on success or error code.
  */
 static nserror store_write_block(struct store_state *state,
 			 struct store_entry *bse,
-			 int elem_idx)
+			 int elem_idx,
+			 const uint8_t *data)
 {
 	block_index_t bf = (bse->elem[elem_idx].block >> BLOCK_ENTRY_COUNT) &
 		((1 << BLOCK_FILE_COUNT) - 1); /* block file block resides in */
@@ -1609,7 +1678,7 @@ static nserror store_write_block(struct store_state *state,
 	offst = (unsigned int)bi << log2_block_size[elem_idx];
 
 	wr = nsu_pwrite(state->blocks[elem_idx][bf].fd,
-			bse->elem[elem_idx].data,
+			data,
 			bse->elem[elem_idx].size,
 			offst);
 	if (wr != (ssize_t)bse->elem[elem_idx].size) {
@@ -1617,7 +1686,7 @@ static nserror store_write_block(struct store_state *state,
 		      "Write failed %"PRIssizet" of %d bytes from %p at %"PRIsizet" block %d errno %d",
 		      wr,
 		      bse->elem[elem_idx].size,
-		      bse->elem[elem_idx].data,
+		      data,
 		      (size_t)offst,
 		      bse->elem[elem_idx].block,
 		      errno);
@@ -1626,7 +1695,7 @@ static nserror store_write_block(struct store_state *state,
 
 	NSLOG(netsurf, INFO,
 	      "Wrote %"PRIssizet" bytes from %p at %"PRIsizet" block %d", wr,
-	      bse->elem[elem_idx].data, (size_t)offst,
+	      data, (size_t)offst,
 	      bse->elem[elem_idx].block);
 
 	return NSERROR_OK;
@@ -1638,11 +1707,13 @@ static nserror store_write_block(struct store_state *state,
  * \param state The backing store state to use.
  * \param bse The entry to store
  * \param elem_idx The element index within the entry.
+ * \param data The data to write, the elements size in length.
  * \return NSERROR_OK on success or error code.
  */
 static nserror store_write_file(struct store_state *state,
 			 struct store_entry *bse,
-			 int elem_idx)
+			 int elem_idx,
+			 const uint8_t *data)
 {
 	ssize_t wr;
 	int fd;
@@ -1655,7 +1726,7 @@ static nserror store_write_file(struct store_state *state,
 		return NSERROR_SAVE_FAILED;
 	}
 
-	wr = write(fd, bse->elem[elem_idx].data, bse->elem[elem_idx].size);
+	wr = write(fd, data, bse->elem[elem_idx].size);
 	err = errno; /* close can change errno */
 
 	close(fd);
@@ -1664,23 +1735,88 @@ static nserror store_write_file(struct store_state *state,
 		      "Write failed %"PRIssizet" of %d bytes from %p errno %d",
 		      wr,
 		      bse->elem[elem_idx].size,
-		      bse->elem[elem_idx].data,
+		      data,
 		      err);
 
 		/** @todo Delete the file? */
 		return NSERROR_SAVE_FAILED;
 	}
 
-	NSLOG(netsurf, VERBOSE, "Wrote %"PRIssizet" bytes from %p", wr,
-	      bse->elem[elem_idx].data);
+	NSLOG(netsurf, VERBOSE, "Wrote %"PRIssizet" bytes from %p", wr, data);
 
 	return NSERROR_OK;
 }
 
+/**
+ * Compress element data for writing to disc.
+ *
+ * Data is only compressed if doing so saves at least an eighth of its
+ * size, which avoids paying the inflate cost on readback for content
+ * such as images which is already compressed.
+ *
+ * \param data The data to compress.
+ * \param datalen The length of \a data.
+ * \param disc_out Updated with the compressed data on success.
+ * \param disclen_out Updated with the length of the compressed data.
+ * \return NSERROR_OK on success, NSERROR_NOT_FOUND if compression
+ *         was not worthwhile or NSERROR_NOMEM on allocation failure.
+ */
+static nserror
+store_deflate(const uint8_t *data,
+	      size_t datalen,
+	      uint8_t **disc_out,
+	      size_t *disclen_out)
+{
+	uLongf disclen;
+	uint8_t *disc;
+
+	if ((datalen < 256) || (datalen > UINT32_MAX)) {
+		return NSERROR_NOT_FOUND;
+	}
+
+	/* there is no point in keeping output larger than the limit */
+	disclen = datalen - (datalen / 8);
+	disc = malloc(disclen);
+	if (disc == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	if (compress2(disc, &disclen, data, datalen, Z_BEST_SPEED) != Z_OK) {
+		/* includes Z_BUF_ERROR when the output did not fit */
+		free(disc);
+		return NSERROR_NOT_FOUND;
+	}
+
+	*disc_out = disc;
+	*disclen_out = disclen;
+
+	return NSERROR_OK;
+}
+
+/**
+ * Get the entry element index used for storage flags.
+ *
+ * \param bsflags The flags passed to a store operation.
+ * \return The index of the element the operation is for.
+ */
+static int store_elem_idx(enum backing_store_flags bsflags)
+{
+	if ((bsflags & BACKING_STORE_BITMAP) != 0) {
+		return ENTRY_ELEM_BITMAP;
+	}
+	if ((bsflags & BACKING_STORE_META) != 0) {
+		return ENTRY_ELEM_META;
+	}
+	return ENTRY_ELEM_DATA;
+}
+
 /**
  * Place an object in the backing store.
  *
- * takes ownership of the heap block passed in.
+ * takes ownership of the heap block passed in. A bitmap is only
+ * stored if the object data it was decoded from is already in the
+ * store and, unlike other data, remains owned by the caller when it
+ * could not be stored.
  *
  * @param url The url is used as the unique primary key for the data.
  * @param bsflags The flags to control how the object is stored.
@@ -1697,6 +1833,8 @@ store(nsurl *url,
 	nserror ret;
 	struct store_entry *bse;
 	int elem_idx;
+	uint8_t *disc = data; /* data as written to disc */
+	size_t disclen = datalen; /* length of data on disc */
 
 	/* check backing store is initialised */
 	if (storestate == NULL) {
@@ -1704,25 +1842,52 @@ store(nsurl *url,
 	}
 
 	/* calculate the entry element index */
-	if ((bsflags & BACKING_STORE_META) != 0) {
-		elem_idx = ENTRY_ELEM_META;
-	} else {
-		elem_idx = ENTRY_ELEM_DATA;
+	elem_idx = store_elem_idx(bsflags);
+
+	if (elem_idx == ENTRY_ELEM_BITMAP) {
+		/* bitmaps are only kept of data which is itself stored */
+		bse = hashmap_lookup(storestate->entries, url);
+		if ((bse == NULL) ||
+		    ((bse->flags & ENTRY_FLAGS_INVALID) != 0) ||
+		    (bse->elem[ENTRY_ELEM_DATA].size == 0)) {
+			return NSERROR_NOT_FOUND;
+		}
+	}
+
+	/* compress object data if configured to */
+	if ((storestate->compress) && (elem_idx == ENTRY_ELEM_DATA)) {
+		ret = store_deflate(data, datalen, &disc, &disclen);
+		if (ret == NSERROR_OK) {
+			NSLOG(netsurf, DEBUG, "deflated %"PRIsizet" to %"PRIsizet,
+			      datalen, disclen);
+		}
 	}
 
 	/* set the store entry up */
-	ret = set_store_entry(storestate, url, elem_idx, data, datalen, &bse);
+	ret = set_store_entry(storestate, url, elem_idx,
+			      data, datalen, disclen, &bse);
 	if (ret != NSERROR_OK) {
 		NSLOG(netsurf, ERROR, "store entry setting failed");
-		return ret;
-	}
-
-	if (bse->elem[elem_idx].block != 0) {
+		bse = NULL;
+	} else if (bse->elem[elem_idx].block != 0) {
 		/* small block storage */
-		ret = store_write_block(storestate, bse, elem_idx);
+		ret = store_write_block(storestate, bse, elem_idx, disc);
 	} else {
 		/* separate file in backing store */
-		ret = store_write_file(storestate, bse, elem_idx);
+		ret = store_write_file(storestate, bse, elem_idx, disc);
+	}
+
+	if ((ret != NSERROR_OK) &&
+	    (bse != NULL) &&
+	    (elem_idx == ENTRY_ELEM_BITMAP)) {
+		/* hand the bitmap back and forget the partial write */
+		invalidate_element(storestate, bse, elem_idx);
+		memset(&bse->elem[elem_idx], 0,
+		       sizeof(struct store_entry_element));
+	}
+
+	if (disc != data) {
+		free(disc);
 	}
 
 	return ret;
@@ -1741,10 +1906,71 @@ static nserror entry_release_alloc(struct store_entry_element *elem)
 			elem->flags &= ~ENTRY_ELEM_FLAG_HEAP;
 		}
 	}
+#ifdef HAVE_MMAP
+	if ((elem->flags & ENTRY_ELEM_FLAG_MMAP) != 0) {
+		elem->ref--;
+		if (elem->ref == 0) {
+			NSLOG(netsurf, DEEPDEBUG, "unmapping %p", elem->data);
+			munmap(elem->data, elem->len);
+			elem->flags &= ~ENTRY_ELEM_FLAG_MMAP;
+		}
+	}
+#endif
 	return NSERROR_OK;
 }
 
 
+/**
+ * Initialise a decompression stream to fill an entry elements data.
+ *
+ * \param elem The element to fill, the data allocation must be len long.
+ * \param strm The stream to initialise.
+ * \return NSERROR_OK on success or error code.
+ */
+static nserror
+store_inflate_init(struct store_entry_element *elem, z_stream *strm)
+{
+	memset(strm, 0, sizeof(*strm));
+	if (inflateInit(strm) != Z_OK) {
+		return NSERROR_NOMEM;
+	}
+	strm->next_out = elem->data;
+	strm->avail_out = elem->len;
+
+	return NSERROR_OK;
+}
+
+/**
+ * Decompress a chunk of on disc element data.
+ *
+ * \param strm The decompression stream.
+ * \param buf The compressed data.
+ * \param buflen The length of \a buf.
+ * \param complete Updated to true when the end of stream is reached.
+ * \return NSERROR_OK on success or NSERROR_INVALID on corrupt data.
+ */
+static nserror
+store_inflate(z_stream *strm, uint8_t *buf, size_t buflen, bool *complete)
+{
+	int zret;
+
+	strm->next_in = buf;
+	strm->avail_in = buflen;
+
+	zret = inflate(strm, Z_NO_FLUSH);
+	if (zret == Z_STREAM_END) {
+		*complete = (strm->avail_out == 0);
+		return *complete ? NSERROR_OK : NSERROR_INVALID;
+	}
+	if ((zret != Z_OK) && (zret != Z_BUF_ERROR)) {
+		NSLOG(netsurf, ERROR, "inflate failed %d", zret);
+		return NSERROR_INVALID;
+	}
+	*complete = false;
+
+	return NSERROR_OK;
+}
+
 /**
  * Read an element of an entry from a small block file in the backing storage.
  *
@@ -1762,6 +1988,10 @@ static nserror store_read_block(struct store_state *state,
 	block_index_t bi = bse->elem[elem_idx].block & ((1 << BLOCK_ENTRY_COUNT) -1); /* block index in file */
 	ssize_t rd;
 	off_t offst;
+	uint8_t *buf = bse->elem[elem_idx].data; /* buffer to read into */
+	z_stream strm;
+	bool complete = false;
+	nserror ret;
 
 	/* ensure the block file fd is good */
 	if (state->blocks[elem_idx][bf].fd == -1) {
@@ -1778,8 +2008,16 @@ static nserror store_read_block(struct store_state *state,
 
 	offst = (unsigned int)bi << log2_block_size[elem_idx];
 
+	if ((bse->elem[elem_idx].flags & ENTRY_ELEM_FLAG_COMPRESSED) != 0) {
+		/* compressed data is read whole, the block is small */
+		buf = malloc(bse->elem[elem_idx].size);
+		if (buf == NULL) {
+			return NSERROR_NOMEM;
+		}
+	}
+
 	rd = nsu_pread(state->blocks[elem_idx][bf].fd,
-		       bse->elem[elem_idx].data,
+		       buf,
 		       bse->elem[elem_idx].size,
 		       offst);
 	if (rd != (ssize_t)bse->elem[elem_idx].size) {
@@ -1787,19 +2025,36 @@ static nserror store_read_block(struct store_state *state,
 		      "Failed reading %"PRIssizet" of %d bytes into %p from %"PRIsizet" block %d errno %d",
 		      rd,
 		      bse->elem[elem_idx].size,
-		      bse->elem[elem_idx].data,
+		      buf,
 		      (size_t)offst,
 		      bse->elem[elem_idx].block,
 		      errno);
+		if (buf != bse->elem[elem_idx].data) {
+			free(buf);
+		}
 		return NSERROR_SAVE_FAILED;
 	}
 
 	NSLOG(netsurf, DEEPDEBUG,
 	      "Read %"PRIssizet" bytes into %p from %"PRIsizet" block %d", rd,
-	      bse->elem[elem_idx].data, (size_t)offst,
+	      buf, (size_t)offst,
 	      bse->elem[elem_idx].block);
 
-	return NSERROR_OK;
+	if (buf == bse->elem[elem_idx].data) {
+		return NSERROR_OK;
+	}
+
+	ret = store_inflate_init(&bse->elem[elem_idx], &strm);
+	if (ret == NSERROR_OK) {
+		ret = store_inflate(&strm, buf, rd, &complete);
+		if ((ret == NSERROR_OK) && (complete == false)) {
+			ret = NSERROR_INVALID;
+		}
+		inflateEnd(&strm);
+	}
+	free(buf);
+
+	return ret;
 }
 
 /**
@@ -1818,6 +2073,9 @@ static nserror store_read_file(struct store_state *state,
 	ssize_t rd; /* return from read */
 	int ret = NSERROR_OK;
 	size_t tot = 0; /* total size */
+	uint8_t *buf = NULL; /* compressed data chunk */
+	z_stream strm;
+	bool complete = false;
 
 	/* separate file in backing store */
 	fd = store_open(storestate, nsurl_hash(bse->url), elem_idx, O_RDONLY);
@@ -1827,10 +2085,33 @@ static nserror store_read_file(struct store_state *state,
 		return NSERROR_NOT_FOUND;
 	}
 
+	if ((bse->elem[elem_idx].flags & ENTRY_ELEM_FLAG_COMPRESSED) != 0) {
+		/* stream the file through inflate a chunk at a time */
+		buf = malloc(INFLATE_CHUNK_SIZE);
+		if (buf == NULL) {
+			close(fd);
+			return NSERROR_NOMEM;
+		}
+		ret = store_inflate_init(&bse->elem[elem_idx], &strm);
+		if (ret != NSERROR_OK) {
+			free(buf);
+			close(fd);
+			return ret;
+		}
+	}
+
 	while (tot < bse->elem[elem_idx].size) {
-		rd = read(fd,
-			  bse->elem[elem_idx].data + tot,
-			  bse->elem[elem_idx].size - tot);
+		if (buf != NULL) {
+			size_t chunk = bse->elem[elem_idx].size - tot;
+			if (chunk > INFLATE_CHUNK_SIZE) {
+				chunk = INFLATE_CHUNK_SIZE;
+			}
+			rd = read(fd, buf, chunk);
+		} else {
+			rd = read(fd,
+				  bse->elem[elem_idx].data + tot,
+				  bse->elem[elem_idx].size - tot);
+		}
 		if (rd <= 0) {
 			NSLOG(netsurf, ERROR,
 			      "read error returned %"PRIssizet" errno %d",
@@ -1840,16 +2121,83 @@ static nserror store_read_file(struct store_state *state,
 			break;
 		}
 		tot += rd;
+
+		if (buf != NULL) {
+			ret = store_inflate(&strm, buf, rd, &complete);
+			if (ret != NSERROR_OK) {
+				break;
+			}
+		}
 	}
 
 	close(fd);
 
+	if (buf != NULL) {
+		if ((ret == NSERROR_OK) && (complete == false)) {
+			NSLOG(netsurf, ERROR, "compressed data truncated");
+			ret = NSERROR_INVALID;
+		}
+		inflateEnd(&strm);
+		free(buf);
+	}
+
 	NSLOG(netsurf, DEEPDEBUG, "Read %"PRIsizet" bytes into %p", tot,
 	      bse->elem[elem_idx].data);
 
 	return ret;
 }
 
+#ifdef HAVE_MMAP
+/**
+ * Map an element of an entry from an individual file in the backing storage.
+ *
+ * The element must not be compressed. On success the element data is
+ * the mapping and the element is flagged as mapped.
+ *
+ * \param state The backing store state to use.
+ * \param bse The entry to map.
+ * \param elem_idx The element index within the entry.
+ * \return NSERROR_OK on success or error code.
+ */
+static nserror store_map_file(struct store_state *state,
+			      struct store_entry *bse,
+			      int elem_idx)
+{
+	struct store_entry_element *elem = &bse->elem[elem_idx];
+	struct stat sb;
+	void *map;
+	int fd;
+
+	fd = store_open(state, nsurl_hash(bse->url), elem_idx, O_RDONLY);
+	if (fd < 0) {
+		NSLOG(netsurf, ERROR, "Open failed %d errno %d", fd, errno);
+		return NSERROR_NOT_FOUND;
+	}
+
+	/* a short file would fault when the mapping is read */
+	if ((fstat(fd, &sb) != 0) || (sb.st_size < (off_t)elem->len)) {
+		NSLOG(netsurf, ERROR, "File shorter than %d bytes", elem->len);
+		close(fd);
+		return NSERROR_NOT_FOUND;
+	}
+
+	map = mmap(NULL, elem->len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		NSLOG(netsurf, ERROR, "mmap failed errno %d", errno);
+		return NSERROR_NOMEM;
+	}
+
+	elem->data = map;
+	elem->flags |= ENTRY_ELEM_FLAG_MMAP;
+	elem->ref = 1;
+
+	NSLOG(netsurf, DEEPDEBUG, "Mapped %d bytes at %p", elem->len, map);
+
+	return NSERROR_OK;
+}
+#endif
+
 /**
  * Retrieve an object from the backing store.
  *
@@ -1888,15 +2236,16 @@ fetch(nsurl *url,
 	      nsurl_access(url));
 
 	/* calculate the entry element index */
-	if ((bsflags & BACKING_STORE_META) != 0) {
-		elem_idx = ENTRY_ELEM_META;
-	} else {
-		elem_idx = ENTRY_ELEM_DATA;
-	}
+	elem_idx = store_elem_idx(bsflags);
 	elem = &bse->elem[elem_idx];
 
+	if ((elem_idx == ENTRY_ELEM_BITMAP) && (elem->size == 0)) {
+		/* no bitmap has been stored for the entry */
+		return NSERROR_NOT_FOUND;
+	}
+
 	/* if an allocation already exists return it */
-	if ((elem->flags & ENTRY_ELEM_FLAG_HEAP) != 0) {
+	if ((elem->flags & ENTRY_ELEM_FLAG_ALLOC) != 0) {
 		/* use the existing allocation and bump the ref count. */
 		elem->ref++;
 
@@ -1904,9 +2253,19 @@ fetch(nsurl *url,
 		      "Using existing entry (%p) allocation %p refs:%d", bse,
 		      elem->data, elem->ref);
 
+#ifdef HAVE_MMAP
+	} else if ((elem_idx == ENTRY_ELEM_BITMAP) &&
+		   (elem->block == 0) &&
+		   ((elem->flags & ENTRY_ELEM_FLAG_COMPRESSED) == 0)) {
+		/* map bitmaps held in their own file */
+		ret = store_map_file(storestate, bse, elem_idx);
+		if (ret != NSERROR_OK) {
+			return ret;
+		}
+#endif
 	} else {
 		/* allocate from the heap */
-		elem->data = malloc(elem->size);
+		elem->data = malloc(elem->len);
 		if (elem->data == NULL) {
 			NSLOG(netsurf, ERROR,
 			      "Failed to create new heap allocation");
@@ -1932,10 +2291,10 @@ fetch(nsurl *url,
 		entry_release_alloc(elem);
 	} else {
 		/* update stats and setup return pointers */
-		storestate->hit_size += elem->size;
+		storestate->hit_size += elem->len;
 
 		*data_out = elem->data;
-		*datalen_out = elem->size;
+		*datalen_out = elem->len;
 	}
 
 	return ret;
@@ -1967,11 +2326,7 @@ static nserror release(nsurl *url, enum backing_store_flags bsflags)
 	}
 
 	/* the entry element */
-	if ((bsflags & BACKING_STORE_META) != 0) {
-		elem = &bse->elem[ENTRY_ELEM_META];
-	} else {
-		elem = &bse->elem[ENTRY_ELEM_DATA];
-	}
+	elem = &bse->elem[store_elem_idx(bsflags)];
 
 	ret = entry_release_alloc(elem);
 
@@ -17,6 +17,7 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 
@@ -239,6 +240,393 @@ static void nscss_dom_user_data_handler(dom_node_operation operation,
 	}
 }
 
+/** Number of recently styled elements a style sharing cache keeps */
+#define STYLE_SHARE_ENTRIES 8
+
+/**
+ * Selection results, with a count of the elements using them
+ */
+struct nscss_select_results {
+	css_select_results results; /**< Results, first so pointers convert */
+	unsigned int refcnt; /**< Number of elements using the results */
+};
+
+/**
+ * Element whose selection results may be shared
+ */
+struct nscss_style_share_entry {
+	dom_node *node; /**< Element, or NULL if the entry is unused */
+	dom_node *parent; /**< Parent of the element */
+	const css_computed_style *parent_style; /**< Style of the parent */
+	css_select_results *styles; /**< Selection results of the element */
+};
+
+/**
+ * Style sharing cache
+ *
+ * Selection for an element depends on its name and attributes, its
+ * ancestors and the stylesheets, and also on its siblings and children
+ * if selectors ask about them. The callbacks answering those questions
+ * taint the element being selected for. Untainted elements are kept so
+ * later siblings with the same name and attributes can share their
+ * results; siblings have the same ancestors, so selection for them
+ * would find the same answers to every question it asks.
+ */
+struct nscss_style_share {
+	/** Recently styled elements which may be shared */
+	struct nscss_style_share_entry entry[STYLE_SHARE_ENTRIES];
+	unsigned int next; /**< Entry to replace next */
+
+	dom_node *node; /**< Element being selected for, or NULL */
+	bool tainted; /**< Whether selection for node asked about more */
+
+	unsigned int lookups; /**< Elements which might have shared */
+	unsigned int hits; /**< Elements which shared results */
+	unsigned int parents; /**< Refused as they have element children */
+	unsigned int styles; /**< Computed styles shared */
+};
+
+
+/**
+ * Take a reference to selection results.
+ *
+ * \param results  Results obtained from nscss_get_style()
+ * \return results
+ */
+static css_select_results *
+nscss_select_results_ref(css_select_results *results)
+{
+	struct nscss_select_results *shared;
+
+	shared = (struct nscss_select_results *) results;
+	shared->refcnt++;
+
+	return results;
+}
+
+/* exported interface documented in css/select.h */
+void nscss_select_results_destroy(css_select_results *results)
+{
+	struct nscss_select_results *shared;
+	int pseudo_element;
+
+	shared = (struct nscss_select_results *) results;
+	if (--shared->refcnt > 0)
+		return;
+
+	for (pseudo_element = CSS_PSEUDO_ELEMENT_NONE;
+			pseudo_element < CSS_PSEUDO_ELEMENT_COUNT;
+			pseudo_element++) {
+		if (results->styles[pseudo_element] != NULL)
+			css_computed_style_destroy(
+					results->styles[pseudo_element]);
+	}
+
+	free(shared);
+}
+
+/**
+ * Note that selection for a node asked about its siblings or children.
+ *
+ * \param pw    Selection context
+ * \param node  DOM node asked about
+ */
+static inline void nscss_style_share_taint(void *pw, void *node)
+{
+	nscss_select_ctx *ctx = pw;
+
+	if (ctx->share != NULL && ctx->share->node == node)
+		ctx->share->tainted = true;
+}
+
+/**
+ * Release an entry of a style sharing cache.
+ *
+ * \param entry  Entry to release
+ */
+static void
+nscss_style_share_entry_clear(struct nscss_style_share_entry *entry)
+{
+	if (entry->node == NULL)
+		return;
+
+	dom_node_unref(entry->node);
+	dom_node_unref(entry->parent);
+	nscss_select_results_destroy(entry->styles);
+	entry->node = NULL;
+}
+
+/**
+ * Compare an attribute of two elements.
+ *
+ * \param attrs_a  Attributes of the first element
+ * \param attrs_b  Attributes of the second element
+ * \param index    Index of the attribute to compare
+ * \return true if both elements have the same attribute at index
+ */
+static bool nscss_style_share_match_attr(dom_namednodemap *attrs_a,
+		dom_namednodemap *attrs_b, uint32_t index)
+{
+	dom_attr *attr_a = NULL, *attr_b = NULL;
+	dom_string *name_a = NULL, *name_b = NULL;
+	dom_string *value_a = NULL, *value_b = NULL;
+	bool match = false;
+
+	if (dom_namednodemap_item(attrs_a, index,
+			(void *) &attr_a) != DOM_NO_ERR || attr_a == NULL ||
+			dom_namednodemap_item(attrs_b, index,
+			(void *) &attr_b) != DOM_NO_ERR || attr_b == NULL)
+		goto out;
+
+	if (dom_attr_get_name(attr_a, &name_a) != DOM_NO_ERR ||
+			dom_attr_get_name(attr_b, &name_b) != DOM_NO_ERR ||
+			dom_attr_get_value(attr_a, &value_a) != DOM_NO_ERR ||
+			dom_attr_get_value(attr_b, &value_b) != DOM_NO_ERR)
+		goto out;
+
+	match = dom_string_isequal(name_a, name_b) &&
+			dom_string_isequal(value_a, value_b);
+
+out:
+	if (value_b != NULL)
+		dom_string_unref(value_b);
+	if (value_a != NULL)
+		dom_string_unref(value_a);
+	if (name_b != NULL)
+		dom_string_unref(name_b);
+	if (name_a != NULL)
+		dom_string_unref(name_a);
+	if (attr_b != NULL)
+		dom_node_unref(attr_b);
+	if (attr_a != NULL)
+		dom_node_unref(attr_a);
+
+	return match;
+}
+
+/**
+ * Compare the names and attributes of two elements.
+ *
+ * \param a  First element
+ * \param b  Second element
+ * \return true if the elements have the same name and the same
+ *         attributes in the same order
+ */
+static bool nscss_style_share_match(dom_node *a, dom_node *b)
+{
+	dom_namednodemap *attrs_a = NULL, *attrs_b = NULL;
+	dom_string *name_a = NULL, *name_b = NULL;
+	uint32_t length_a, length_b, index;
+	bool match = false;
+
+	if (dom_node_get_node_name(a, &name_a) != DOM_NO_ERR ||
+			dom_node_get_node_name(b, &name_b) != DOM_NO_ERR ||
+			dom_string_isequal(name_a, name_b) == false)
+		goto out;
+
+	if (dom_node_get_attributes(a, &attrs_a) != DOM_NO_ERR ||
+			attrs_a == NULL ||
+			dom_node_get_attributes(b, &attrs_b) != DOM_NO_ERR ||
+			attrs_b == NULL)
+		goto out;
+
+	if (dom_namednodemap_get_length(attrs_a, &length_a) != DOM_NO_ERR ||
+			dom_namednodemap_get_length(attrs_b,
+					&length_b) != DOM_NO_ERR ||
+			length_a != length_b)
+		goto out;
+
+	for (index = 0; index != length_a; index++) {
+		if (nscss_style_share_match_attr(attrs_a, attrs_b,
+				index) == false)
+			goto out;
+	}
+
+	match = true;
+
+out:
+	if (attrs_b != NULL)
+		dom_namednodemap_unref(attrs_b);
+	if (attrs_a != NULL)
+		dom_namednodemap_unref(attrs_a);
+	if (name_b != NULL)
+		dom_string_unref(name_b);
+	if (name_a != NULL)
+		dom_string_unref(name_a);
+
+	return match;
+}
+
+/**
+ * Determine if a node has element children.
+ *
+ * \param node  DOM node
+ * \return true if node has element children, or on error
+ */
+static bool nscss_node_has_element_child(dom_node *node)
+{
+	dom_node *n, *next;
+	dom_node_type type;
+	dom_exception err;
+
+	err = dom_node_get_first_child(node, &n);
+	if (err != DOM_NO_ERR)
+		return true;
+
+	while (n != NULL) {
+		err = dom_node_get_node_type(n, &type);
+		if (err != DOM_NO_ERR || type == DOM_ELEMENT_NODE) {
+			dom_node_unref(n);
+			return true;
+		}
+
+		err = dom_node_get_next_sibling(n, &next);
+		dom_node_unref(n);
+		if (err != DOM_NO_ERR)
+			return true;
+
+		n = next;
+	}
+
+	return false;
+}
+
+/**
+ * Find a sibling element whose selection results an element can share.
+ *
+ * \param share         Style sharing cache
+ * \param n             Element being selected for
+ * \param parent_style  Style of the element's parent
+ * \return Results to share, with a reference taken, or NULL if none
+ */
+static css_select_results *nscss_style_share_find(
+		struct nscss_style_share *share, dom_node *n,
+		const css_computed_style *parent_style)
+{
+	struct nscss_style_share_entry *entry;
+	css_select_results *styles = NULL;
+	dom_node *parent;
+	bool leaf = false;
+	int pseudo_element;
+	unsigned int i;
+
+	share->lookups++;
+
+	if (dom_node_get_parent_node(n, &parent) != DOM_NO_ERR ||
+			parent == NULL)
+		return NULL;
+
+	for (i = 0; i != STYLE_SHARE_ENTRIES; i++) {
+		entry = &share->entry[i];
+
+		if (entry->node == NULL || entry->parent != parent ||
+				entry->parent_style != parent_style)
+			continue;
+
+		/* Selection leaves libcss node data, holding the ancestor
+		 * filter, on the element; selection for its children starts
+		 * from it. Were an element with element children to skip
+		 * selection, its children would be selected without that
+		 * filter and lose its quick rejection of ancestor selectors,
+		 * costing more than sharing saves. Only leaf elements, such
+		 * as list items, table cells and options holding just text,
+		 * share; the parents counter records the candidates this
+		 * refuses. */
+		if (leaf == false) {
+			if (nscss_node_has_element_child(n)) {
+				share->parents++;
+				break;
+			}
+			leaf = true;
+		}
+
+		if (nscss_style_share_match(entry->node, n)) {
+			styles = nscss_select_results_ref(entry->styles);
+			break;
+		}
+	}
+
+	dom_node_unref(parent);
+
+	if (styles == NULL)
+		return NULL;
+
+	share->hits++;
+	for (pseudo_element = CSS_PSEUDO_ELEMENT_NONE;
+			pseudo_element < CSS_PSEUDO_ELEMENT_COUNT;
+			pseudo_element++) {
+		if (styles->styles[pseudo_element] != NULL)
+			share->styles++;
+	}
+
+	return styles;
+}
+
+/**
+ * Keep an element's selection results for its later siblings to share.
+ *
+ * \param share         Style sharing cache
+ * \param n             Element selected for
+ * \param parent_style  Style of the element's parent
+ * \param styles        Selection results for the element
+ */
+static void nscss_style_share_add(struct nscss_style_share *share,
+		dom_node *n, const css_computed_style *parent_style,
+		css_select_results *styles)
+{
+	struct nscss_style_share_entry *entry = &share->entry[share->next];
+	dom_node *parent;
+
+	if (dom_node_get_parent_node(n, &parent) != DOM_NO_ERR ||
+			parent == NULL)
+		return;
+
+	nscss_style_share_entry_clear(entry);
+
+	entry->node = dom_node_ref(n);
+	entry->parent = parent;
+	entry->parent_style = parent_style;
+	entry->styles = nscss_select_results_ref(styles);
+
+	share->next = (share->next + 1) % STYLE_SHARE_ENTRIES;
+}
+
+/* exported interface documented in css/select.h */
+nserror nscss_style_share_create(struct nscss_style_share **share_out)
+{
+	struct nscss_style_share *share;
+
+	share = calloc(1, sizeof(*share));
+	if (share == NULL)
+		return NSERROR_NOMEM;
+
+	*share_out = share;
+
+	return NSERROR_OK;
+}
+
+/* exported interface documented in css/select.h */
+void nscss_style_share_destroy(struct nscss_style_share *share)
+{
+	unsigned int i;
+
+	if (share == NULL)
+		return;
+
+	NSLOG(netsurf, INFO,
+	      "Shared styles of %u of %u elements (%u%%): %u computed styles, %zu bytes of results, %u refused for element children",
+	      share->hits, share->lookups,
+	      share->lookups == 0 ? 0 : share->hits * 100 / share->lookups,
+	      share->styles,
+	      share->hits * sizeof(struct nscss_select_results),
+	      share->parents);
+
+	for (i = 0; i != STYLE_SHARE_ENTRIES; i++)
+		nscss_style_share_entry_clear(&share->entry[i]);
+
+	free(share);
+}
+
 /**
  * Get style selection results for an element
  *
@@ -248,22 +636,40 @@ static void nscss_dom_user_data_handler(dom_node_operation operation,
  * \param unit_unit_len_ctx    Unit length conversion context
  * \param inline_style    Inline style associated with element, or NULL
  * \return Pointer to selection results (containing computed styles),
- *         or NULL on failure
+ *         or NULL on failure; release with nscss_select_results_destroy()
  */
 css_select_results *nscss_get_style(nscss_select_ctx *ctx, dom_node *n,
 		const css_media *media,
 		const css_unit_ctx *unit_len_ctx,
 		const css_stylesheet *inline_style)
 {
+	struct nscss_style_share *share = NULL;
+	struct nscss_select_results *shared;
 	css_computed_style *composed;
 	css_select_results *styles;
 	int pseudo_element;
 	css_error error;
 
+	/* Share the results of a sibling, if there is one like the node */
+	if (ctx->share != NULL && ctx->parent_style != NULL &&
+			inline_style == NULL) {
+		share = ctx->share;
+
+		styles = nscss_style_share_find(share, n, ctx->parent_style);
+		if (styles != NULL)
+			return styles;
+
+		share->node = n;
+		share->tainted = false;
+	}
+
 	/* Select style for node */
 	error = css_select_style(ctx->ctx, n, unit_len_ctx, media, inline_style,
 			&selection_handler, ctx, &styles);
 
+	if (share != NULL)
+		share->node = NULL;
+
 	if (error != CSS_OK || styles == NULL) {
 		/* Failed selecting partial style -- bail out */
 		return NULL;
@@ -320,7 +726,24 @@ css_select_results *nscss_get_style(nscss_select_ctx *ctx, dom_node *n,
 		styles->styles[pseudo_element] = composed;
 	}
 
-	return styles;
+	/* Move the results to where they can be shared */
+	shared = malloc(sizeof(*shared));
+	if (shared == NULL) {
+		css_select_results_destroy(styles);
+		return NULL;
+	}
+
+	shared->results = *styles;
+	shared->refcnt = 1;
+
+	memset(styles->styles, 0, sizeof(styles->styles));
+	css_select_results_destroy(styles);
+
+	if (share != NULL && share->tainted == false)
+		nscss_style_share_add(share, n, ctx->parent_style,
+				&shared->results);
+
+	return &shared->results;
 }
 
 /**
@@ -516,6 +939,7 @@ css_error named_sibling_node(void *pw, void *node,
 	dom_exception err;
 
 	*sibling = NULL;
+	nscss_style_share_taint(pw, node);
 
 	/* Find sibling element */
 	err = dom_node_get_previous_sibling(n, &n);
@@ -584,6 +1008,7 @@ css_error named_generic_sibling_node(void *pw, void *node,
 	dom_exception err;
 
 	*sibling = NULL;
+	nscss_style_share_taint(pw, node);
 
 	err = dom_node_get_previous_sibling(n, &n);
 	if (err != DOM_NO_ERR)
@@ -1320,6 +1745,8 @@ css_error node_count_siblings(void *pw, void *n, bool same_name,
 	dom_exception exc;
 	dom_string *node_name = NULL;
 
+	nscss_style_share_taint(pw, n);
+
 	if (same_name) {
 		dom_node *node = n;
 		exc = dom_node_get_node_name(node, &node_name);
@@ -1384,6 +1811,8 @@ css_error node_is_empty(void *pw, void *node, bool *match)
 
 	*match = true;
 
+	nscss_style_share_taint(pw, node);
+
 	err = dom_node_get_first_child(n, &n);
 	if (err != DOM_NO_ERR) {
 		return CSS_BADPARM;
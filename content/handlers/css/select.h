@@ -25,8 +25,11 @@
 
 #include <libcss/libcss.h>
 
+#include "utils/errors.h"
+
 struct content;
 struct nsurl;
+struct nscss_style_share;
 
 /**
  * Selection context
@@ -39,6 +42,7 @@ typedef struct nscss_select_ctx
 	lwc_string *universal;
 	const css_computed_style *root_style;
 	const css_computed_style *parent_style;
+	struct nscss_style_share *share; /**< Style sharing cache, or NULL */
 } nscss_select_ctx;
 
 css_stylesheet *nscss_create_inline_style(const uint8_t *data, size_t len,
@@ -49,6 +53,37 @@ css_select_results *nscss_get_style(nscss_select_ctx *ctx, dom_node *n,
 		const css_unit_ctx *unit_len_ctx,
 		const css_stylesheet *inline_style);
 
+/**
+ * Release selection results obtained from nscss_get_style().
+ *
+ * The results may be shared with other elements, and are only destroyed
+ * once every element has released them.
+ *
+ * \param results  Selection results to release
+ */
+void nscss_select_results_destroy(css_select_results *results);
+
+/**
+ * Create a style sharing cache.
+ *
+ * While a cache is given in the selection context, nscss_get_style()
+ * reuses the results of a recently styled sibling element with the same
+ * name and attributes instead of selecting again. The cache must only be
+ * used while the parent styles passed in the selection context remain
+ * valid, such as for one box tree construction.
+ *
+ * \param share_out  Updated to the new cache
+ * \return NSERROR_OK on success, or NSERROR_NOMEM
+ */
+nserror nscss_style_share_create(struct nscss_style_share **share_out);
+
+/**
+ * Destroy a style sharing cache, logging how much it shared.
+ *
+ * \param share  Cache to destroy, or NULL
+ */
+void nscss_style_share_destroy(struct nscss_style_share *share);
+
 css_computed_style *nscss_get_blank_style(nscss_select_ctx *ctx,
 		const css_unit_ctx *unit_len_ctx,
 		const css_computed_style *parent);
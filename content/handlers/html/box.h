@@ -41,6 +41,7 @@ struct nsurl;
 struct dom_node;
 struct dom_string;
 struct rect;
+struct form_control;
 
 #define UNKNOWN_WIDTH INT_MAX
 #define UNKNOWN_MAX_WIDTH INT_MAX
@@ -86,7 +87,9 @@ typedef enum {
 	REPLACE_DIM = 1 << 9,	/* replaced element has given dimensions */
 	IFRAME      = 1 << 10,	/* box contains an iframe */
 	CONVERT_CHILDREN = 1 << 11,  /* wanted children converting */
-	IS_REPLACED = 1 << 12	/* box is a replaced element */
+	IS_REPLACED = 1 << 12,	/* box is a replaced element */
+	NEEDS_LAYOUT = 1 << 13,	/* box or a descendant changed since layout */
+	HAS_POSITIONED = 1 << 14 /* a descendant is not statically positioned */
 } box_flags;
 
 
@@ -170,29 +173,114 @@ struct object_params {
 
 
 /**
- * Node in box tree. All dimensions are in pixels.
+ * Rarely used data of a box.
+ *
+ * Kept apart from struct box so that tree traversals do not pull it
+ * through the cache; most boxes have none.
  */
-struct box {
+struct box_extra {
 	/**
-	 * Type of box.
+	 * value of id attribute (or name for anchors)
 	 */
-	box_type type;
+	lwc_string *id;
 
 	/**
-	 * Box flags
+	 * Link, or NULL.
 	 */
-	box_flags flags;
+	struct nsurl *href;
 
 	/**
-	 * DOM node that generated this box or NULL
+	 * Link target, or NULL.
 	 */
-	struct dom_node *node;
+	const char *target;
 
 	/**
-	 * Computed styles for elements and their pseudo elements.
-	 *  NULL on non-element boxes.
+	 * Title, or NULL.
 	 */
-	css_select_results *styles;
+	const char *title;
+
+	/**
+	 * List marker box if this is a list-item, or NULL.
+	 */
+	struct box *list_marker;
+
+	/**
+	 * Form control data, or NULL if not a form control.
+	 */
+	struct form_control *gadget;
+
+	/**
+	 * (Image)map to use with this object, or NULL if none
+	 */
+	char *usemap;
+
+	/**
+	 * Parameters for the object, or NULL.
+	 */
+	struct object_params *object_params;
+};
+
+
+/**
+ * Child of a box in its vertical index.
+ */
+struct box_index_entry {
+	/**
+	 * The child.
+	 */
+	struct box *box;
+
+	/**
+	 * Least top of this and the following children's descendant
+	 * boxes, relative to the parent.
+	 */
+	int top;
+
+	/**
+	 * Greatest bottom of this and the preceding children's descendant
+	 * boxes, relative to the parent.
+	 */
+	int bottom;
+};
+
+
+/**
+ * Index of the in-flow children of a box by their vertical extent.
+ *
+ * The children stay in document order, so painting order is kept,
+ * while the running extents let the children that cannot intersect a
+ * horizontal band be skipped with a binary search at either end.
+ */
+struct box_index {
+	/**
+	 * Number of entries.
+	 */
+	unsigned int count;
+
+	/**
+	 * The in-flow children, in document order.
+	 */
+	struct box_index_entry entry[];
+};
+
+
+/**
+ * Node in box tree. All dimensions are in pixels.
+ *
+ * The members read by redraw and hit testing come first, so walking
+ * the tree touches as few cache lines of each box as possible. Those
+ * only used while constructing and laying out the tree follow.
+ */
+struct box {
+	/**
+	 * Type of box.
+	 */
+	box_type type;
+
+	/**
+	 * Box flags
+	 */
+	box_flags flags;
 
 	/**
 	 * Style for this box. 0 for INLINE_CONTAINER and
@@ -202,12 +290,6 @@ struct box {
 	 */
 	css_computed_style *style;
 
-	/**
-	 *  value of id attribute (or name for anchors)
-	 */
-	lwc_string *id;
-
-
 	/**
 	 * Next sibling box, or NULL.
 	 */
@@ -233,13 +315,6 @@ struct box {
 	 */
 	struct box *parent;
 
-	/**
-	 * INLINE_END box corresponding to this INLINE box, or INLINE
-	 * box corresponding to this INLINE_END box.
-	 */
-	struct box *inline_end;
-
-
 	/**
 	 * First float child box, or NULL. Float boxes are in the tree
 	 * twice, in this list for the block box which defines the
@@ -253,23 +328,6 @@ struct box {
 	 */
 	struct box *next_float;
 
-	/**
-	 * If box is a float, points to box's containing block
-	 */
-	struct box *float_container;
-
-	/**
-	 * Level below which subsequent floats must be cleared.  This
-	 * is used only for boxes with float_children
-	 */
-	int clear_level;
-
-	/**
-	 * Level below which floats have been placed.
-	 */
-	int cached_place_below_level;
-
-
 	/**
 	 * Coordinate of left padding edge relative to parent box, or
 	 * relative to ancestor that contains this box in
@@ -334,18 +392,6 @@ struct box {
 	 */
 	struct scrollbar *scroll_y;
 
-	/**
-	 * Width of box taking all line breaks (including margins
-	 * etc). Must be non-negative.
-	 */
-	int min_width;
-
-	/**
-	 * Width that would be taken with no line breaks. Must be
-	 * non-negative.
-	 */
-	int max_width;
-
 
 	/**
 	 * Text, or NULL if none. Unterminated.
@@ -363,93 +409,210 @@ struct box {
 	int space;
 
 	/**
-	 * Byte offset within a textual representation of this content.
+	 * Position of the box in its parent's child index, only meaningful
+	 * while the parent has one.
 	 */
-	size_t byte_offset;
-
+	unsigned int index_position;
 
 	/**
-	 * Link, or NULL.
+	 * Object in this box (usually an image), or NULL if none.
 	 */
-	struct nsurl *href;
+	struct hlcache_handle* object;
 
 	/**
-	 * Link target, or NULL.
+	 * Background image for this box, or NULL if none
 	 */
-	const char *target;
+	struct hlcache_handle *background;
 
 	/**
-	 * Title, or NULL.
+	 * Iframe's browser_window, or NULL if none
 	 */
-	const char *title;
-
+	struct browser_window *iframe;
 
 	/**
-	 * Number of columns for TABLE / TABLE_CELL.
+	 * Rarely used data for the box, or NULL if it has none.
 	 */
-	unsigned int columns;
+	struct box_extra *extra;
 
 	/**
-	 * Number of rows for TABLE only.
+	 * Index of the children by vertical extent, or NULL if the box has
+	 * too few children to need one or has not been laid out since it
+	 * last changed.
 	 */
-	unsigned int rows;
+	struct box_index *child_index;
+
 
 	/**
-	 * Start column for TABLE_CELL only.
+	 * DOM node that generated this box or NULL
 	 */
-	unsigned int start_column;
+	struct dom_node *node;
 
 	/**
-	 * Array of table column data for TABLE only.
+	 * Computed styles for elements and their pseudo elements.
+	 *  NULL on non-element boxes.
 	 */
-	struct column *col;
+	css_select_results *styles;
 
 	/**
-	 * List item value.
+	 * INLINE_END box corresponding to this INLINE box, or INLINE
+	 * box corresponding to this INLINE_END box.
 	 */
-	int list_value;
+	struct box *inline_end;
 
 	/**
-	 * List marker box if this is a list-item, or NULL.
+	 * If box is a float, points to box's containing block
 	 */
-	struct box *list_marker;
-
+	struct box *float_container;
 
 	/**
-	 * Form control data, or NULL if not a form control.
+	 * Level below which subsequent floats must be cleared.  This
+	 * is used only for boxes with float_children
 	 */
-	struct form_control* gadget;
+	int clear_level;
 
+	/**
+	 * Level below which floats have been placed.
+	 */
+	int cached_place_below_level;
 
 	/**
-	 * (Image)map to use with this object, or NULL if none
+	 * Width of box taking all line breaks (including margins
+	 * etc). Must be non-negative.
 	 */
-	char *usemap;
+	int min_width;
 
+	/**
+	 * Width that would be taken with no line breaks. Must be
+	 * non-negative.
+	 */
+	int max_width;
 
 	/**
-	 * Background image for this box, or NULL if none
+	 * Width available to the box when it was last laid out, or
+	 * UNKNOWN_WIDTH if that layout may not be reused. Only kept
+	 * for inline containers and tables.
 	 */
-	struct hlcache_handle *background;
+	int layout_width;
 
+	/**
+	 * Byte offset within a textual representation of this content.
+	 */
+	size_t byte_offset;
 
 	/**
-	 * Object in this box (usually an image), or NULL if none.
+	 * Number of columns for TABLE / TABLE_CELL.
 	 */
-	struct hlcache_handle* object;
+	unsigned int columns;
 
 	/**
-	 * Parameters for the object, or NULL.
+	 * Number of rows for TABLE only.
 	 */
-	struct object_params *object_params;
+	unsigned int rows;
 
+	/**
+	 * Start column for TABLE_CELL only.
+	 */
+	unsigned int start_column;
 
 	/**
-	 * Iframe's browser_window, or NULL if none
+	 * Array of table column data for TABLE only, owned by the box.
 	 */
-	struct browser_window *iframe;
+	struct column *col;
 
+	/**
+	 * List item value.
+	 */
+	int list_value;
 };
 
 
+/**
+ * Get the id of a box.
+ *
+ * \param b box to get the id of
+ * \return the id attribute value, or NULL if none
+ */
+static inline lwc_string *box_id(const struct box *b)
+{
+	return b->extra != NULL ? b->extra->id : NULL;
+}
+
+/**
+ * Get the link of a box.
+ *
+ * \param b box to get the link of
+ * \return the link, or NULL if none
+ */
+static inline struct nsurl *box_href(const struct box *b)
+{
+	return b->extra != NULL ? b->extra->href : NULL;
+}
+
+/**
+ * Get the link target of a box.
+ *
+ * \param b box to get the link target of
+ * \return the target, or NULL if none
+ */
+static inline const char *box_target(const struct box *b)
+{
+	return b->extra != NULL ? b->extra->target : NULL;
+}
+
+/**
+ * Get the title of a box.
+ *
+ * \param b box to get the title of
+ * \return the title, or NULL if none
+ */
+static inline const char *box_title(const struct box *b)
+{
+	return b->extra != NULL ? b->extra->title : NULL;
+}
+
+/**
+ * Get the list marker of a box.
+ *
+ * \param b box to get the list marker of
+ * \return the list marker box, or NULL if b is not a list-item
+ */
+static inline struct box *box_list_marker(const struct box *b)
+{
+	return b->extra != NULL ? b->extra->list_marker : NULL;
+}
+
+/**
+ * Get the form control of a box.
+ *
+ * \param b box to get the form control of
+ * \return the form control, or NULL if b is not a form control
+ */
+static inline struct form_control *box_gadget(const struct box *b)
+{
+	return b->extra != NULL ? b->extra->gadget : NULL;
+}
+
+/**
+ * Get the image map used by a box.
+ *
+ * \param b box to get the image map name of
+ * \return the map name, or NULL if none
+ */
+static inline const char *box_usemap(const struct box *b)
+{
+	return b->extra != NULL ? b->extra->usemap : NULL;
+}
+
+/**
+ * Get the object parameters of a box.
+ *
+ * \param b box to get the object parameters of
+ * \return the parameters, or NULL if none
+ */
+static inline struct object_params *box_object_params(const struct box *b)
+{
+	return b->extra != NULL ? b->extra->object_params : NULL;
+}
+
+
 #endif
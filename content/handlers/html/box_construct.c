@@ -32,6 +32,7 @@
 #include "utils/nsoption.h"
 #include "utils/corestrings.h"
 #include "utils/talloc.h"
+#include "utils/arena.h"
 #include "utils/string.h"
 #include "utils/ascii.h"
 #include "utils/nsurl.h"
@@ -61,6 +62,14 @@ struct box_construct_ctx {
 	box_construct_complete_cb cb;	/**< Callback to invoke on completion */
 
 	int *bctx;			/**< talloc context */
+
+	struct arena *box_arena;	/**< arena for boxes */
+
+	struct arena *text_arena;	/**< arena for box text */
+
+	struct arena *extra_arena;	/**< arena for rarely used box data */
+
+	struct nscss_style_share *share; /**< style sharing cache */
 };
 
 /**
@@ -174,9 +183,9 @@ box_extract_properties(dom_node *n, struct box_construct_props *props)
 
 			if (parent_box != NULL) {
 				props->parent_style = parent_box->style;
-				props->href = parent_box->href;
-				props->target = parent_box->target;
-				props->title = parent_box->title;
+				props->href = box_href(parent_box);
+				props->target = box_target(parent_box);
+				props->title = box_title(parent_box);
 
 				dom_node_unref(parent_node);
 				break;
@@ -240,13 +249,15 @@ box_extract_properties(dom_node *n, struct box_construct_props *props)
  * \param  parent_style    style at this point in xml tree, or NULL for root
  * \param  root_style      root node's style, or NULL for root
  * \param  n               node in xml tree
+ * \param  share           style sharing cache, or NULL
  * \return  the new style, or NULL on memory exhaustion
  */
 static css_select_results *
 box_get_style(html_content *c,
 	      const css_computed_style *parent_style,
 	      const css_computed_style *root_style,
-	      dom_node *n)
+	      dom_node *n,
+	      struct nscss_style_share *share)
 {
 	dom_string *s;
 	dom_exception err;
@@ -280,6 +291,7 @@ box_get_style(html_content *c,
 	ctx.universal = c->universal;
 	ctx.root_style = root_style;
 	ctx.parent_style = parent_style;
+	ctx.share = share;
 
 	/* Select style for element */
 	styles = nscss_get_style(&ctx, n, &c->media, &c->unit_len_ctx,
@@ -336,7 +348,8 @@ box_construct_generate(dom_node *n,
 
 		/** \todo Not wise to drop const from the computed style */
 		gen = box_create(NULL, (css_computed_style *) style,
-				false, NULL, NULL, NULL, NULL, content->bctx);
+				false, NULL, NULL, NULL, NULL,
+				content->box_arena, content->extra_arena);
 		if (gen == NULL) {
 			return;
 		}
@@ -370,7 +383,7 @@ box_construct_marker(struct box *box,
 	enum css_list_style_type_e list_style_type;
 
 	marker = box_create(NULL, box->style, false, NULL, NULL, title,
-			NULL, ctx->bctx);
+			NULL, ctx->box_arena, ctx->extra_arena);
 	if (marker == false)
 		return false;
 
@@ -432,7 +445,10 @@ box_construct_marker(struct box *box,
 		nsurl_unref(url);
 	}
 
-	box->list_marker = marker;
+	if (box_get_extra(box, ctx->extra_arena) == NULL)
+		return false;
+
+	box->extra->list_marker = marker;
 	marker->parent = box;
 
 	return true;
@@ -474,7 +490,7 @@ box_construct_element(struct box_construct_ctx *ctx, bool *convert_children)
 	}
 
 	styles = box_get_style(ctx->content, props.parent_style, root_style,
-			ctx->n);
+			ctx->n, ctx->share);
 	if (styles == NULL)
 		return false;
 
@@ -514,7 +530,7 @@ box_construct_element(struct box_construct_ctx *ctx, bool *convert_children)
 
 	box = box_create(styles, styles->styles[CSS_PSEUDO_ELEMENT_NONE], false,
 			props.href, props.target, props.title, id,
-			ctx->bctx);
+			ctx->box_arena, ctx->extra_arena);
 	if (box == NULL)
 		return false;
 
@@ -591,19 +607,19 @@ box_construct_element(struct box_construct_ctx *ctx, bool *convert_children)
 	    (ns_computed_display(box->style,
 				 props.node_is_root) == CSS_DISPLAY_NONE &&
 	     props.node_is_root == false)) {
-		css_select_results_destroy(styles);
+		nscss_select_results_destroy(styles);
 		box->styles = NULL;
 		box->style = NULL;
 
 		/* Invalidate associated gadget, if any */
-		if (box->gadget != NULL) {
-			box->gadget->box = NULL;
-			box->gadget = NULL;
+		if (box_gadget(box) != NULL) {
+			box->extra->gadget->box = NULL;
+			box->extra->gadget = NULL;
 		}
 
 		/* Can't do this, because the lifetimes of boxes and gadgets
-		 * are inextricably linked. Fortunately, talloc will save us
-		 * (for now) */
+		 * are inextricably linked. Fortunately, destroying the box
+		 * arena will save us (for now) */
 		/* box_free_box(box); */
 
 		*convert_children = false;
@@ -635,7 +651,8 @@ box_construct_element(struct box_construct_ctx *ctx, bool *convert_children)
 				"Box must have containing block.");
 
 		props.inline_container = box_create(NULL, NULL, false, NULL,
-				NULL, NULL, NULL, ctx->bctx);
+				NULL, NULL, NULL, ctx->box_arena,
+				ctx->extra_arena);
 		if (props.inline_container == NULL)
 			return false;
 
@@ -697,7 +714,7 @@ box_construct_element(struct box_construct_ctx *ctx, bool *convert_children)
 			/* Float: insert a float between the parent and box. */
 			struct box *flt = box_create(NULL, NULL, false,
 					props.href, props.target, props.title,
-					NULL, ctx->bctx);
+					NULL, ctx->box_arena, ctx->extra_arena);
 			if (flt == NULL)
 				return false;
 
@@ -757,7 +774,9 @@ static void box_construct_element_after(dom_node *n, html_content *content)
 		if (props.inline_container == NULL) {
 			/* Create inline container if we don't have one */
 			props.inline_container = box_create(NULL, NULL, false,
-					NULL, NULL, NULL, NULL, content->bctx);
+					NULL, NULL, NULL, NULL,
+					content->box_arena,
+					content->extra_arena);
 			if (props.inline_container == NULL)
 				return;
 
@@ -768,9 +787,10 @@ static void box_construct_element_after(dom_node *n, html_content *content)
 		}
 
 		inline_end = box_create(NULL, box->style, false,
-				box->href, box->target, box->title,
-				box->id == NULL ? NULL :
-				lwc_string_ref(box->id), content->bctx);
+				box_href(box), box_target(box), box_title(box),
+				box_id(box) == NULL ? NULL :
+				lwc_string_ref(box_id(box)), content->box_arena,
+				content->extra_arena);
 		if (inline_end != NULL) {
 			inline_end->type = BOX_INLINE_END;
 
@@ -999,7 +1019,8 @@ static bool box_construct_text(struct box_construct_ctx *ctx)
 			 * (i.e. this box is the first child of its parent, or
 			 * was preceded by block-level siblings) */
 			props.inline_container = box_create(NULL, NULL, false,
-					NULL, NULL, NULL, NULL, ctx->bctx);
+					NULL, NULL, NULL, NULL, ctx->box_arena,
+					ctx->extra_arena);
 			if (props.inline_container == NULL) {
 				free(text);
 				return false;
@@ -1015,7 +1036,7 @@ static bool box_construct_text(struct box_construct_ctx *ctx)
 		box = box_create(NULL,
 				(css_computed_style *) props.parent_style,
 				false, props.href, props.target, props.title,
-				NULL, ctx->bctx);
+				NULL, ctx->box_arena, ctx->extra_arena);
 		if (box == NULL) {
 			free(text);
 			return false;
@@ -1023,7 +1044,7 @@ static bool box_construct_text(struct box_construct_ctx *ctx)
 
 		box->type = BOX_TEXT;
 
-		box->text = talloc_strdup(ctx->bctx, text);
+		box->text = arena_strdup(ctx->text_arena, text);
 		free(text);
 		if (box->text == NULL)
 			return false;
@@ -1117,7 +1138,8 @@ static bool box_construct_text(struct box_construct_ctx *ctx)
 				 * siblings) */
 				props.inline_container = box_create(NULL, NULL,
 						false, NULL, NULL, NULL, NULL,
-						ctx->bctx);
+						ctx->box_arena,
+						ctx->extra_arena);
 				if (props.inline_container == NULL) {
 					free(text);
 					return false;
@@ -1134,7 +1156,7 @@ static bool box_construct_text(struct box_construct_ctx *ctx)
 			box = box_create(NULL,
 				(css_computed_style *) props.parent_style,
 				false, props.href, props.target, props.title,
-				NULL, ctx->bctx);
+				NULL, ctx->box_arena, ctx->extra_arena);
 			if (box == NULL) {
 				free(text);
 				return false;
@@ -1142,7 +1164,7 @@ static bool box_construct_text(struct box_construct_ctx *ctx)
 
 			box->type = BOX_TEXT;
 
-			box->text = talloc_strdup(ctx->bctx, current);
+			box->text = arena_strdup(ctx->text_arena, current);
 			if (box->text == NULL) {
 				free(text);
 				return false;
@@ -1160,7 +1182,8 @@ static bool box_construct_text(struct box_construct_ctx *ctx)
 				/* Linebreak: create new inline container */
 				props.inline_container = box_create(NULL, NULL,
 						false, NULL, NULL, NULL, NULL,
-						ctx->bctx);
+						ctx->box_arena,
+						ctx->extra_arena);
 				if (props.inline_container == NULL) {
 					free(text);
 					return false;
@@ -1205,6 +1228,7 @@ static void convert_xml_to_box(struct box_construct_ctx *ctx)
 		if (box_construct_element(ctx, &convert_children) == false) {
 			ctx->cb(ctx->content, false);
 			dom_node_unref(ctx->n);
+			nscss_style_share_destroy(ctx->share);
 			free(ctx);
 			return;
 		}
@@ -1219,6 +1243,7 @@ static void convert_xml_to_box(struct box_construct_ctx *ctx)
 			if (err != DOM_NO_ERR) {
 				ctx->cb(ctx->content, false);
 				dom_node_unref(next);
+				nscss_style_share_destroy(ctx->share);
 				free(ctx);
 				return;
 			}
@@ -1231,6 +1256,7 @@ static void convert_xml_to_box(struct box_construct_ctx *ctx)
 				if (box_construct_text(ctx) == false) {
 					ctx->cb(ctx->content, false);
 					dom_node_unref(ctx->n);
+					nscss_style_share_destroy(ctx->share);
 					free(ctx);
 					return;
 				}
@@ -1264,6 +1290,7 @@ static void convert_xml_to_box(struct box_construct_ctx *ctx)
 
 			assert(ctx->n == NULL);
 
+			nscss_style_share_destroy(ctx->share);
 			free(ctx);
 			return;
 		}
@@ -1293,16 +1320,48 @@ dom_to_box(dom_node *n,
 		}
 	}
 
+	if (c->box_arena == NULL) {
+		/* boxes and their text are allocated from arenas which
+		 * are released in one go with the box tree */
+		c->box_arena = arena_create(0);
+		if (c->box_arena == NULL) {
+			return NSERROR_NOMEM;
+		}
+	}
+
+	if (c->text_arena == NULL) {
+		c->text_arena = arena_create(0);
+		if (c->text_arena == NULL) {
+			return NSERROR_NOMEM;
+		}
+	}
+
+	if (c->extra_arena == NULL) {
+		c->extra_arena = arena_create(0);
+		if (c->extra_arena == NULL) {
+			return NSERROR_NOMEM;
+		}
+	}
+
 	ctx = malloc(sizeof(*ctx));
 	if (ctx == NULL) {
 		return NSERROR_NOMEM;
 	}
 
+	/* sibling elements may share styles until the tree is built */
+	if (nscss_style_share_create(&ctx->share) != NSERROR_OK) {
+		free(ctx);
+		return NSERROR_NOMEM;
+	}
+
 	ctx->content = c;
 	ctx->n = dom_node_ref(n);
 	ctx->root_box = NULL;
 	ctx->cb = cb;
 	ctx->bctx = c->bctx;
+	ctx->box_arena = c->box_arena;
+	ctx->text_arena = c->text_arena;
+	ctx->extra_arena = c->extra_arena;
 
 	*box_conversion_context = ctx;
 
@@ -1322,6 +1381,7 @@ nserror cancel_dom_to_box(void *box_conversion_context)
 	}
 
 	dom_node_unref(ctx->n);
+	nscss_style_share_destroy(ctx->share);
 	free(ctx);
 
 	return NSERROR_OK;
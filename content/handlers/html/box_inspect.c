@@ -53,6 +53,75 @@ enum box_walk_dir {
 #define box_is_float(box) (box->type == BOX_FLOAT_LEFT ||	\
 			   box->type == BOX_FLOAT_RIGHT)
 
+/**
+ * Narrow an area around a point to where a rectangle test has the same result.
+ *
+ * After narrowing, every point in the area is inside the rectangle if
+ * the point is, and outside it if the point is not. Outside, the area
+ * is cut at whichever edge of the rectangle leaves the most of it.
+ *
+ * \param area  area containing the point, updated
+ * \param x     point x coordinate
+ * \param y     point y coordinate
+ * \param r     rectangle tested, in the coordinates of the point
+ */
+static void
+box_area_narrow(struct rect *area, int x, int y, const struct rect *r)
+{
+	struct rect cut[4];
+	unsigned int count = 0;
+	unsigned int best = 0;
+	unsigned int i;
+	double size, best_size = 0;
+
+	if (x >= r->x0 && x < r->x1 && y >= r->y0 && y < r->y1) {
+		if (area->x0 < r->x0)
+			area->x0 = r->x0;
+		if (area->y0 < r->y0)
+			area->y0 = r->y0;
+		if (area->x1 > r->x1)
+			area->x1 = r->x1;
+		if (area->y1 > r->y1)
+			area->y1 = r->y1;
+		return;
+	}
+
+	if (area->x1 <= r->x0 || r->x1 <= area->x0 ||
+	    area->y1 <= r->y0 || r->y1 <= area->y0) {
+		/* no point of the area is inside the rectangle */
+		return;
+	}
+
+	/* the point is beyond at least one edge; cut the area there */
+	if (x < r->x0) {
+		cut[count] = *area;
+		cut[count++].x1 = r->x0;
+	}
+	if (x >= r->x1) {
+		cut[count] = *area;
+		cut[count++].x0 = r->x1;
+	}
+	if (y < r->y0) {
+		cut[count] = *area;
+		cut[count++].y1 = r->y0;
+	}
+	if (y >= r->y1) {
+		cut[count] = *area;
+		cut[count++].y0 = r->y1;
+	}
+
+	for (i = 0; i != count; i++) {
+		size = (double)(cut[i].x1 - cut[i].x0) *
+				(cut[i].y1 - cut[i].y0);
+		if (i == 0 || size > best_size) {
+			best = i;
+			best_size = size;
+		}
+	}
+
+	*area = cut[best];
+}
+
 /**
  * Determine if a point lies within a box.
  *
@@ -66,6 +135,8 @@ enum box_walk_dir {
  *                         dimensions but is in the area defined by the box's
  *                         descendants.  If function returns false, physically
  *                         is undefined.
+ * \param[in,out] area     Area around the point, relative to box, narrowed
+ *                         to where the result is the same, or NULL
  * \return  true if the point is within the box or a descendant box
  *
  * This is a helper function for box_at_point().
@@ -75,9 +146,19 @@ box_contains_point(const css_unit_ctx *unit_len_ctx,
 		   const struct box *box,
 		   int x,
 		   int y,
-		   bool *physically)
+		   bool *physically,
+		   struct rect *area)
 {
+	const struct box *marker = box_list_marker(box);
 	css_computed_clip_rect css_rect;
+	struct rect border = {
+		.x0 = -box->border[LEFT].width,
+		.y0 = -box->border[TOP].width,
+		.x1 = box->padding[LEFT] + box->width +
+			box->padding[RIGHT] + box->border[RIGHT].width,
+		.y1 = box->padding[TOP] + box->height +
+			box->padding[BOTTOM] + box->border[BOTTOM].width
+	};
 
 	if (box->style != NULL &&
 	    css_computed_position(box->style) == CSS_POSITION_ABSOLUTE &&
@@ -98,6 +179,9 @@ box_contains_point(const css_unit_ctx *unit_len_ctx,
 		} else {
 			*physically = false;
 		}
+		if (area != NULL) {
+			box_area_narrow(area, x, y, &r);
+		}
 
 		/* Adjust rect to css clip region */
 		if (css_rect.left_auto == false) {
@@ -132,6 +216,9 @@ box_contains_point(const css_unit_ctx *unit_len_ctx,
 		}
 
 		/* Test if point is in clipped box */
+		if (area != NULL) {
+			box_area_narrow(area, x, y, &r);
+		}
 		if (x >= r.x0 && x < r.x1 && y >= r.y0 && y < r.y1) {
 			/* inside clip area */
 			return true;
@@ -140,34 +227,45 @@ box_contains_point(const css_unit_ctx *unit_len_ctx,
 		/* Not inside clip area */
 		return false;
 	}
-	if (x >= -box->border[LEFT].width &&
-	    x < box->padding[LEFT] + box->width +
-	    box->padding[RIGHT] + box->border[RIGHT].width &&
-	    y >= -box->border[TOP].width &&
-	    y < box->padding[TOP] + box->height +
-	    box->padding[BOTTOM] + box->border[BOTTOM].width) {
-		*physically = true;
-		return true;
+	if (area != NULL) {
+		box_area_narrow(area, x, y, &border);
 	}
-	if (box->list_marker && box->list_marker->x - box->x <= x +
-	    box->list_marker->border[LEFT].width &&
-	    x < box->list_marker->x - box->x +
-	    box->list_marker->padding[LEFT] +
-	    box->list_marker->width +
-	    box->list_marker->border[RIGHT].width +
-	    box->list_marker->padding[RIGHT] &&
-	    box->list_marker->y - box->y <= y +
-	    box->list_marker->border[TOP].width &&
-	    y < box->list_marker->y - box->y +
-	    box->list_marker->padding[TOP] +
-	    box->list_marker->height +
-	    box->list_marker->border[BOTTOM].width +
-	    box->list_marker->padding[BOTTOM]) {
+	if (x >= border.x0 && x < border.x1 &&
+	    y >= border.y0 && y < border.y1) {
 		*physically = true;
 		return true;
 	}
+	if (marker) {
+		struct rect m = {
+			.x0 = marker->x - box->x - marker->border[LEFT].width,
+			.y0 = marker->y - box->y - marker->border[TOP].width,
+			.x1 = marker->x - box->x + marker->padding[LEFT] +
+				marker->width + marker->border[RIGHT].width +
+				marker->padding[RIGHT],
+			.y1 = marker->y - box->y + marker->padding[TOP] +
+				marker->height + marker->border[BOTTOM].width +
+				marker->padding[BOTTOM]
+		};
+
+		if (area != NULL) {
+			box_area_narrow(area, x, y, &m);
+		}
+		if (x >= m.x0 && x < m.x1 && y >= m.y0 && y < m.y1) {
+			*physically = true;
+			return true;
+		}
+	}
 	if ((box->style && css_computed_overflow_x(box->style) ==
 	     CSS_OVERFLOW_VISIBLE) || !box->style) {
+		if (area != NULL) {
+			struct rect band = {
+				.x0 = box->descendant_x0,
+				.y0 = area->y0,
+				.x1 = box->descendant_x1,
+				.y1 = area->y1
+			};
+			box_area_narrow(area, x, y, &band);
+		}
 		if (box->descendant_x0 <= x &&
 		    x < box->descendant_x1) {
 			*physically = false;
@@ -176,6 +274,15 @@ box_contains_point(const css_unit_ctx *unit_len_ctx,
 	}
 	if ((box->style && css_computed_overflow_y(box->style) ==
 	     CSS_OVERFLOW_VISIBLE) || !box->style) {
+		if (area != NULL) {
+			struct rect band = {
+				.x0 = area->x0,
+				.y0 = box->descendant_y0,
+				.x1 = area->x1,
+				.y1 = box->descendant_y1
+			};
+			box_area_narrow(area, x, y, &band);
+		}
 		if (box->descendant_y0 <= y &&
 		    y < box->descendant_y1) {
 			*physically = false;
@@ -414,7 +521,7 @@ box_nearer_text_box(struct box *box,
 		return true;
 	}
 
-	if (box->parent->list_marker != box) {
+	if (box_list_marker(box->parent) != box) {
 		if (dir < 0) {
 			/* consider only those children (partly) above-left */
 			if (by <= y && bx < x) {
@@ -522,11 +629,12 @@ box_nearest_text_box(struct box *box,
 						tx, ty, nr_xd, nr_yd))
 				return true;
 		} else {
-			if (child->list_marker) {
-				if (box_nearer_text_box(
-						child->list_marker,
-						c_bx + child->list_marker->x,
-						c_by + child->list_marker->y,
+			struct box *marker = box_list_marker(child);
+
+			if (marker) {
+				if (box_nearer_text_box(marker,
+						c_bx + marker->x,
+						c_by + marker->y,
 						x, y, dir, nearest,
 						tx, ty, nr_xd, nr_yd))
 					return true;
@@ -577,22 +685,131 @@ void box_bounds(struct box *box, struct rect *r)
 }
 
 
-/* Exported function documented in html/box.h */
+/**
+ * Skip the siblings of a box which its parent's child index excludes.
+ *
+ * The walk is moved on to the next sibling, from the box itself, which
+ * may contain the point. If there is none, it is moved to the last
+ * child of the parent, which must then be passed over without a test.
+ *
+ * \param[in,out] box    box walked to, updated
+ * \param[in]     y      point y coordinate, in global document coordinates
+ * \param[in,out] box_x  position of box, updated
+ * \param[in,out] box_y  position of box, updated
+ * \param[in,out] area   area around the point, narrowed to where the
+ *                       same boxes are skipped, or NULL
+ * \return true if no remaining sibling can contain the point
+ */
+static bool
+box_index_skip(struct box **box, int y, int *box_x, int *box_y,
+	       struct rect *area)
+{
+	struct box *b = *box;
+	struct box *to;
+	const struct box_index *index;
+	unsigned int pos, first, end;
+	bool done;
+	int origin;
+
+	if (b->parent == NULL || box_is_float(b))
+		return false;
+
+	index = b->parent->child_index;
+	if (index == NULL)
+		return false;
+
+	pos = b->index_position;
+	if (pos >= index->count || index->entry[pos].box != b)
+		return false;
+
+	/* the index is relative to the parent's children */
+	origin = *box_y - b->y;
+	box_index_range(index, y - origin, y - origin, &first, &end);
+
+	if (pos >= first && pos < end)
+		return false;
+
+	if (pos < first) {
+		/* every sibling before the first candidate ends above */
+		if (area != NULL && area->y0 < origin +
+				index->entry[first - 1].bottom - 1)
+			area->y0 = origin + index->entry[first - 1].bottom - 1;
+		pos = first;
+	}
+
+	if (pos < end) {
+		to = index->entry[pos].box;
+		done = false;
+	} else {
+		/* every sibling from here starts below */
+		if (area != NULL && pos < index->count &&
+				area->y1 > origin + index->entry[pos].top)
+			area->y1 = origin + index->entry[pos].top;
+		to = index->entry[index->count - 1].box;
+		done = true;
+	}
+
+	*box_x += to->x - b->x;
+	*box_y += to->y - b->y;
+	*box = to;
+
+	return done;
+}
+
+
+/* Exported function documented in html/box_inspect.h */
 struct box *
 box_at_point(const css_unit_ctx *unit_len_ctx,
 	     struct box *box,
 	     const int x, const int y,
 	     int *box_x, int *box_y)
+{
+	return box_at_point_area(unit_len_ctx, box, x, y, box_x, box_y, NULL);
+}
+
+
+/* Exported function documented in html/box_inspect.h */
+struct box *
+box_at_point_area(const css_unit_ctx *unit_len_ctx,
+		  struct box *box,
+		  const int x, const int y,
+		  int *box_x, int *box_y,
+		  struct rect *area)
 {
 	bool skip_children;
 	bool physically;
+	bool inside;
+	struct rect r;
 
 	assert(box);
 
 	skip_children = false;
 	while ((box = box_next_xy(box, box_x, box_y, skip_children))) {
-		if (box_contains_point(unit_len_ctx, box, x - *box_x, y - *box_y,
-				       &physically)) {
+		if (box_index_skip(&box, y, box_x, box_y, area)) {
+			skip_children = true;
+			continue;
+		}
+
+		if (area != NULL) {
+			/* narrow the area relative to the box */
+			r.x0 = area->x0 - *box_x;
+			r.y0 = area->y0 - *box_y;
+			r.x1 = area->x1 - *box_x;
+			r.y1 = area->y1 - *box_y;
+			inside = box_contains_point(unit_len_ctx, box,
+					x - *box_x, y - *box_y,
+					&physically, &r);
+			area->x0 = r.x0 + *box_x;
+			area->y0 = r.y0 + *box_y;
+			area->x1 = r.x1 + *box_x;
+			area->y1 = r.y1 + *box_y;
+		} else {
+			inside = box_contains_point(unit_len_ctx, box,
+					x - *box_x, y - *box_y,
+					&physically, NULL);
+		}
+
+		if (inside) {
 			*box_x -= scrollbar_get_offset(box->scroll_x);
 			*box_y -= scrollbar_get_offset(box->scroll_y);
 
@@ -615,8 +832,8 @@ struct box *box_find_by_id(struct box *box, lwc_string *id)
 	struct box *a, *b;
 	bool m;
 
-	if (box->id != NULL &&
-	    lwc_string_isequal(id, box->id, &m) == lwc_error_ok &&
+	if (box_id(box) != NULL &&
+	    lwc_string_isequal(id, box_id(box), &m) == lwc_error_ok &&
 	    m == true) {
 		return box;
 	}
@@ -644,6 +861,37 @@ bool box_visible(struct box *box)
 }
 
 
+/* Exported function documented in html/box_inspect.h */
+void box_index_range(const struct box_index *index, int y0, int y1,
+		unsigned int *first, unsigned int *end)
+{
+	unsigned int lo = 0;
+	unsigned int hi = index->count;
+	unsigned int mid;
+
+	/* the running bottoms rise, so skip those ending above the band */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (index->entry[mid].bottom < y0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*first = lo;
+
+	/* the running tops rise too; stop at the first below the band */
+	hi = index->count;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (index->entry[mid].top <= y1)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*end = lo;
+}
+
+
 /* Exported function documented in html/box.h */
 void box_dump(FILE *stream, struct box *box, unsigned int depth, bool style)
 {
@@ -740,18 +988,18 @@ void box_dump(FILE *stream, struct box *box, unsigned int depth, bool style)
 	if (box->iframe) {
 		fprintf(stream, "(iframe) ");
 	}
-	if (box->gadget)
+	if (box_gadget(box))
 		fprintf(stream, "(gadget) ");
 	if (style && box->style)
 		nscss_dump_computed_style(stream, box->style);
-	if (box->href)
-		fprintf(stream, " -> '%s'", nsurl_access(box->href));
-	if (box->target)
-		fprintf(stream, " |%s|", box->target);
-	if (box->title)
-		fprintf(stream, " [%s]", box->title);
-	if (box->id)
-		fprintf(stream, " ID:%s", lwc_string_data(box->id));
+	if (box_href(box))
+		fprintf(stream, " -> '%s'", nsurl_access(box_href(box)));
+	if (box_target(box))
+		fprintf(stream, " |%s|", box_target(box));
+	if (box_title(box))
+		fprintf(stream, " [%s]", box_title(box));
+	if (box_id(box))
+		fprintf(stream, " ID:%s", lwc_string_data(box_id(box)));
 	if (box->type == BOX_INLINE || box->type == BOX_INLINE_END)
 		fprintf(stream, " inline_end %p", box->inline_end);
 	if (box->float_children)
@@ -790,11 +1038,11 @@ void box_dump(FILE *stream, struct box *box, unsigned int depth, bool style)
 	}
 	fprintf(stream, "\n");
 
-	if (box->list_marker) {
+	if (box_list_marker(box)) {
 		for (i = 0; i != depth; i++)
 			fprintf(stream, "  ");
 		fprintf(stream, "list_marker:\n");
-		box_dump(stream, box->list_marker, depth + 1, style);
+		box_dump(stream, box_list_marker(box), depth + 1, style);
 	}
 
 	for (c = box->children; c && c->next; c = c->next)
@@ -70,6 +70,30 @@ void box_bounds(struct box *box, struct rect *r);
 struct box *box_at_point(const css_unit_ctx *unit_len_ctx, struct box *box, const int x, const int y, int *box_x, int *box_y);
 
 
+/**
+ * Find the boxes at a point, and the area they are found throughout.
+ *
+ * As box_at_point(), and also narrows area to a rectangle around the
+ * point in which the same boxes, at the same positions, are found by
+ * this call. Narrowing area through every call of a search gives the
+ * area the whole search would find the same boxes in, until the layout
+ * or scroll offsets change.
+ *
+ * \param  unit_len_ctx  CSS length conversion context for document.
+ * \param  box      box to search children of
+ * \param  x        point to find, in global document coordinates
+ * \param  y        point to find, in global document coordinates
+ * \param  box_x    position of box, in global document coordinates, updated
+ *                  to position of returned box, if any
+ * \param  box_y    position of box, in global document coordinates, updated
+ *                  to position of returned box, if any
+ * \param  area     area containing the point, in global document
+ *                  coordinates, updated
+ * \return  box at given point, or 0 if none found
+ */
+struct box *box_at_point_area(const css_unit_ctx *unit_len_ctx, struct box *box, const int x, const int y, int *box_x, int *box_y, struct rect *area);
+
+
 /**
  * Find a box based upon its id attribute.
  *
@@ -89,6 +113,22 @@ struct box *box_find_by_id(struct box *box, lwc_string *id);
 bool box_visible(struct box *box);
 
 
+/**
+ * Find the children in a vertical index which may intersect a band.
+ *
+ * Children outside the returned range lie wholly above or below the
+ * band; those inside it may still miss it and must be tested.
+ *
+ * \param  index  index of the children of a box
+ * \param  y0     top of the band, relative to the box
+ * \param  y1     bottom of the band, relative to the box, inclusive
+ * \param  first  updated to the first entry to visit
+ * \param  end    updated to one past the last entry to visit
+ */
+void box_index_range(const struct box_index *index, int y0, int y1,
+		unsigned int *first, unsigned int *end);
+
+
 /**
  * Print a box tree to a file.
  */
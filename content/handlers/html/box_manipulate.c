@@ -26,12 +26,17 @@
  */
 
 
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "utils/errors.h"
-#include "utils/talloc.h"
+#include "utils/arena.h"
 #include "utils/nsurl.h"
 #include "netsurf/types.h"
 #include "netsurf/mouse.h"
 #include "desktop/scrollbar.h"
+#include "css/select.h"
 
 #include "html/private.h"
 #include "html/form_internal.h"
@@ -39,14 +44,16 @@
 #include "html/box.h"
 #include "html/box_manipulate.h"
 
+/** Fewest in-flow children a box is given a vertical index for */
+#define BOX_INDEX_MIN_CHILDREN 32
+
 
 /**
- * Destructor for box nodes which own styles
+ * Release the references and resources owned by a box.
  *
  * \param b The box being destroyed.
- * \return 0 to allow talloc to continue destroying the tree.
  */
-static int box_talloc_destructor(struct box *b)
+static void box_release(struct box *b)
 {
 	struct html_scrollbar_data *data;
 
@@ -56,34 +63,64 @@ static int box_talloc_destructor(struct box *b)
 	}
 
 	if (b->styles != NULL) {
-		css_select_results_destroy(b->styles);
+		nscss_select_results_destroy(b->styles);
 		b->styles = NULL;
 	}
 
-	if (b->href != NULL)
-		nsurl_unref(b->href);
+	if (b->extra != NULL) {
+		if (b->extra->href != NULL) {
+			nsurl_unref(b->extra->href);
+			b->extra->href = NULL;
+		}
 
-	if (b->id != NULL) {
-		lwc_string_unref(b->id);
+		if (b->extra->id != NULL) {
+			lwc_string_unref(b->extra->id);
+			b->extra->id = NULL;
+		}
 	}
 
 	if (b->node != NULL) {
 		dom_node_unref(b->node);
+		b->node = NULL;
 	}
 
 	if (b->scroll_x != NULL) {
 		data = scrollbar_get_data(b->scroll_x);
 		scrollbar_destroy(b->scroll_x);
 		free(data);
+		b->scroll_x = NULL;
 	}
 
 	if (b->scroll_y != NULL) {
 		data = scrollbar_get_data(b->scroll_y);
 		scrollbar_destroy(b->scroll_y);
 		free(data);
+		b->scroll_y = NULL;
 	}
 
-	return 0;
+	free(b->col);
+	b->col = NULL;
+
+	box_index_free(b);
+}
+
+
+/**
+ * Release a box found in a box arena which is being destroyed.
+ *
+ * Clones share the references of the box they were split from, and
+ * freed boxes have been cleared, so neither has anything to release.
+ *
+ * \param ptr The box.
+ * \param pw Unused.
+ */
+static void box_arena_release(void *ptr, void *pw)
+{
+	struct box *b = ptr;
+
+	if (!(b->flags & CLONE)) {
+		box_release(b);
+	}
 }
 
 
@@ -96,17 +133,28 @@ box_create(css_select_results *styles,
 	   const char *target,
 	   const char *title,
 	   lwc_string *id,
-	   void *context)
+	   struct arena *arena,
+	   struct arena *extra_arena)
 {
 	unsigned int i;
 	struct box *box;
 
-	box = talloc(context, struct box);
+	box = arena_alloc(arena, sizeof(struct box));
 	if (!box) {
 		return 0;
 	}
 
-	talloc_set_destructor(box, box_talloc_destructor);
+	box->extra = NULL;
+	if (href != NULL || target != NULL || title != NULL || id != NULL) {
+		if (box_get_extra(box, extra_arena) == NULL) {
+			arena_free(arena, box, sizeof(struct box));
+			return 0;
+		}
+		box->extra->href = (href == NULL) ? NULL : nsurl_ref(href);
+		box->extra->target = target;
+		box->extra->title = title;
+		box->extra->id = id;
+	}
 
 	box->type = BOX_INLINE;
 	box->flags = 0;
@@ -123,13 +171,12 @@ box_create(css_select_results *styles,
 	box->scroll_x = box->scroll_y = NULL;
 	box->min_width = 0;
 	box->max_width = UNKNOWN_MAX_WIDTH;
+	box->layout_width = UNKNOWN_WIDTH;
 	box->byte_offset = 0;
 	box->text = NULL;
 	box->length = 0;
 	box->space = 0;
-	box->href = (href == NULL) ? NULL : nsurl_ref(href);
-	box->target = target;
-	box->title = title;
+	box->index_position = 0;
 	box->columns = 1;
 	box->rows = 1;
 	box->start_column = 0;
@@ -144,21 +191,37 @@ box_create(css_select_results *styles,
 	box->next_float = NULL;
 	box->cached_place_below_level = 0;
 	box->list_value = 1;
-	box->list_marker = NULL;
 	box->col = NULL;
-	box->gadget = NULL;
-	box->usemap = NULL;
-	box->id = id;
 	box->background = NULL;
 	box->object = NULL;
-	box->object_params = NULL;
 	box->iframe = NULL;
+	box->child_index = NULL;
 	box->node = NULL;
 
 	return box;
 }
 
 
+/* Exported function documented in html/box_manipulate.h */
+struct box_extra *box_get_extra(struct box *box, struct arena *arena)
+{
+	struct box_extra *extra;
+
+	if (box->extra != NULL) {
+		return box->extra;
+	}
+
+	extra = arena_alloc(arena, sizeof(struct box_extra));
+	if (extra == NULL) {
+		return NULL;
+	}
+	memset(extra, 0, sizeof(struct box_extra));
+	box->extra = extra;
+
+	return extra;
+}
+
+
 /* Exported function documented in html/box.h */
 void box_add_child(struct box *parent, struct box *child)
 {
@@ -175,6 +238,8 @@ void box_add_child(struct box *parent, struct box *child)
 
 	parent->last = child;
 	child->parent = parent;
+
+	box_index_free(parent);
 }
 
 
@@ -189,11 +254,14 @@ void box_insert_sibling(struct box *box, struct box *new_box)
 		new_box->next->prev = new_box;
 	else if (new_box->parent)
 		new_box->parent->last = new_box;
+
+	if (new_box->parent)
+		box_index_free(new_box->parent);
 }
 
 
 /* Exported function documented in html/box.h */
-void box_unlink_and_free(struct box *box)
+void box_unlink_and_free(struct box *box, struct arena *arena)
 {
 	struct box *parent = box->parent;
 	struct box *next = box->next;
@@ -204,6 +272,7 @@ void box_unlink_and_free(struct box *box)
 			parent->children = next;
 		if (parent->last == box)
 			parent->last = next ? next : prev;
+		box_index_free(parent);
 	}
 
 	if (prev)
@@ -211,41 +280,116 @@ void box_unlink_and_free(struct box *box)
 	if (next)
 		next->prev = prev;
 
-	box_free(box);
+	box_free(box, arena);
 }
 
 
 /* Exported function documented in html/box.h */
-void box_free(struct box *box)
+void box_free(struct box *box, struct arena *arena)
 {
 	struct box *child, *next;
 
 	/* free children first */
 	for (child = box->children; child; child = next) {
 		next = child->next;
-		box_free(child);
+		box_free(child, arena);
 	}
 
 	/* last this box */
-	box_free_box(box);
+	box_free_box(box, arena);
 }
 
 
 /* Exported function documented in html/box.h */
-void box_free_box(struct box *box)
+void box_free_box(struct box *box, struct arena *arena)
 {
 	if (!(box->flags & CLONE)) {
-		if (box->gadget)
-			form_free_control(box->gadget);
-		if (box->scroll_x != NULL)
-			scrollbar_destroy(box->scroll_x);
-		if (box->scroll_y != NULL)
-			scrollbar_destroy(box->scroll_y);
-		if (box->styles != NULL)
-			css_select_results_destroy(box->styles);
+		if (box_gadget(box) != NULL)
+			form_free_control(box_gadget(box));
+		box_release(box);
+	}
+
+	/* clear the box so destroying the arena finds nothing in it */
+	memset(box, 0, sizeof(*box));
+	arena_free(arena, box, sizeof(*box));
+}
+
+
+/* Exported function documented in html/box_manipulate.h */
+nserror box_index_children(struct box *box)
+{
+	struct box_index *index;
+	struct box *child;
+	unsigned int count = 0;
+	unsigned int i;
+	int top = INT_MAX;
+	int bottom = INT_MIN;
+
+	box_index_free(box);
+
+	for (child = box->children; child; child = child->next) {
+		if (child->type != BOX_FLOAT_LEFT &&
+				child->type != BOX_FLOAT_RIGHT)
+			count++;
+	}
+	if (count < BOX_INDEX_MIN_CHILDREN) {
+		return NSERROR_OK;
+	}
+
+	index = malloc(sizeof(*index) + count * sizeof(index->entry[0]));
+	if (index == NULL) {
+		return NSERROR_NOMEM;
+	}
+	index->count = count;
+
+	/* running bottoms, forwards through the children */
+	i = 0;
+	for (child = box->children; child; child = child->next) {
+		if (child->type == BOX_FLOAT_LEFT ||
+				child->type == BOX_FLOAT_RIGHT)
+			continue;
+
+		/* the redraw clip test treats the bottom as inclusive */
+		if (child->y + child->descendant_y1 + 1 > bottom)
+			bottom = child->y + child->descendant_y1 + 1;
+
+		index->entry[i].box = child;
+		index->entry[i].top = child->y + child->descendant_y0;
+		index->entry[i].bottom = bottom;
+		child->index_position = i;
+		i++;
+	}
+
+	/* running tops, backwards through them */
+	while (i-- > 0) {
+		if (index->entry[i].top < top)
+			top = index->entry[i].top;
+		index->entry[i].top = top;
+	}
+
+	box->child_index = index;
+
+	return NSERROR_OK;
+}
+
+
+/* Exported function documented in html/box_manipulate.h */
+void box_index_free(struct box *box)
+{
+	free(box->child_index);
+	box->child_index = NULL;
+}
+
+
+/* Exported function documented in html/box_manipulate.h */
+void box_arena_destroy(struct arena *arena)
+{
+	if (arena == NULL) {
+		return;
 	}
 
-	talloc_free(box);
+	arena_walk(arena, sizeof(struct box), box_arena_release, NULL);
+	arena_destroy(arena);
 }
 
 
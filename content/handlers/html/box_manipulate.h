@@ -25,6 +25,7 @@
 #ifndef NETSURF_HTML_BOX_MANIPULATE_H
 #define NETSURF_HTML_BOX_MANIPULATE_H
 
+struct arena;
 
 /**
  * Create a box tree node.
@@ -36,13 +37,27 @@
  * \param  target       target for the box (not copied), or 0
  * \param  title        title for the box (not copied), or 0
  * \param  id           id for the box (not copied), or 0
- * \param  context      context for allocations
+ * \param  arena        box arena to allocate from
+ * \param  extra_arena  arena to allocate rarely used box data from
  * \return  allocated and initialised box, or 0 on memory exhaustion
  *
  * styles is always owned by the box, if it is set.
  * style is only owned by the box in the case of implied boxes.
  */
-struct box * box_create(css_select_results *styles, css_computed_style *style, bool style_owned, struct nsurl *href, const char *target, const char *title, lwc_string *id, void *context);
+struct box * box_create(css_select_results *styles, css_computed_style *style, bool style_owned, struct nsurl *href, const char *target, const char *title, lwc_string *id, struct arena *arena, struct arena *extra_arena);
+
+
+/**
+ * Get the rarely used data of a box, creating it if the box has none.
+ *
+ * The data is released along with the box; its memory stays in the
+ * arena until the arena is destroyed.
+ *
+ * \param box    box to get the data of
+ * \param arena  arena to allocate the data from
+ * \return  the box's data, or NULL on memory exhaustion
+ */
+struct box_extra *box_get_extra(struct box *box, struct arena *arena);
 
 
 /**
@@ -67,26 +82,62 @@ void box_insert_sibling(struct box *box, struct box *new_box);
  * Unlink a box from the box tree and then free it recursively.
  *
  * \param box box to unlink and free recursively.
+ * \param arena box arena the box was allocated from
  */
-void box_unlink_and_free(struct box *box);
+void box_unlink_and_free(struct box *box, struct arena *arena);
 
 
 /**
  * Free a box tree recursively.
  *
- * \param  box  box to free recursively
+ * \param  box    box to free recursively
+ * \param  arena  box arena the boxes were allocated from
  *
  * The box and all its children is freed.
  */
-void box_free(struct box *box);
+void box_free(struct box *box, struct arena *arena);
 
 
 /**
  * Free the data in a single box structure.
  *
  * \param box box to free
+ * \param arena box arena the box was allocated from
+ */
+void box_free_box(struct box *box, struct arena *arena);
+
+
+/**
+ * Index the in-flow children of a box by their vertical extent.
+ *
+ * The positions and descendant boxes of the children must be final.
+ * Any previous index is discarded, and boxes with few children are
+ * left without one.
+ *
+ * \param box  box to index the children of
+ * \return NSERROR_OK on success, or NSERROR_NOMEM if the index could not
+ *         be allocated, in which case the box has none
+ */
+nserror box_index_children(struct box *box);
+
+
+/**
+ * Discard the vertical index of the children of a box, if it has one.
+ *
+ * \param box  box whose children have moved or changed
+ */
+void box_index_free(struct box *box);
+
+
+/**
+ * Free every box allocated from a box arena, and the arena itself.
+ *
+ * This releases a whole box tree at once, including boxes which are
+ * no longer linked into it.
+ *
+ * \param arena box arena to destroy, or NULL
  */
-void box_free_box(struct box *box);
+void box_arena_destroy(struct arena *arena);
 
 
 /**
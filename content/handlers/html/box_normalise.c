@@ -195,8 +195,9 @@ box_normalise_table_row(struct box *row,
 			if (style == NULL)
 				return false;
 
-			cell = box_create(NULL, style, true, row->href,
-					row->target, NULL, NULL, c->bctx);
+			cell = box_create(NULL, style, true, box_href(row),
+					box_target(row), NULL, NULL,
+					c->box_arena, c->extra_arena);
 			if (cell == NULL) {
 				css_computed_style_destroy(style);
 				return false;
@@ -332,8 +333,9 @@ box_normalise_table_row_group(struct box *row_group,
 			if (style == NULL)
 				return false;
 
-			row = box_create(NULL, style, true, row_group->href,
-					row_group->target, NULL, NULL, c->bctx);
+			row = box_create(NULL, style, true, box_href(row_group),
+					box_target(row_group), NULL, NULL,
+					c->box_arena, c->extra_arena);
 			if (row == NULL) {
 				css_computed_style_destroy(style);
 				return false;
@@ -410,8 +412,9 @@ box_normalise_table_row_group(struct box *row_group,
 			return false;
 		}
 
-		row = box_create(NULL, style, true, row_group->href,
-				row_group->target, NULL, NULL, c->bctx);
+		row = box_create(NULL, style, true, box_href(row_group),
+				box_target(row_group), NULL, NULL,
+				c->box_arena, c->extra_arena);
 		if (row == NULL) {
 			css_computed_style_destroy(style);
 			return false;
@@ -542,9 +545,11 @@ box_normalise_table_spans(struct box *table,
 						return false;
 
 					cell = box_create(NULL, style, true,
-							table_row->href,
-							table_row->target,
-							NULL, NULL, c->bctx);
+							box_href(table_row),
+							box_target(table_row),
+							NULL, NULL,
+							c->box_arena,
+							c->extra_arena);
 					if (cell == NULL) {
 						css_computed_style_destroy(
 								style);
@@ -668,8 +673,10 @@ box_normalise_table(struct box *table, const struct box *root, html_content * c)
 				return false;
 			}
 
-			row_group = box_create(NULL, style, true, table->href,
-					table->target, NULL, NULL, c->bctx);
+			row_group = box_create(NULL, style, true,
+					box_href(table), box_target(table),
+					NULL, NULL,
+					c->box_arena, c->extra_arena);
 			if (row_group == NULL) {
 				css_computed_style_destroy(style);
 				free(col_info.spans);
@@ -756,8 +763,9 @@ box_normalise_table(struct box *table, const struct box *root, html_content * c)
 			return false;
 		}
 
-		row_group = box_create(NULL, style, true, table->href,
-				table->target, NULL, NULL, c->bctx);
+		row_group = box_create(NULL, style, true, box_href(table),
+				box_target(table), NULL, NULL,
+				c->box_arena, c->extra_arena);
 		if (row_group == NULL) {
 			css_computed_style_destroy(style);
 			free(col_info.spans);
@@ -768,16 +776,17 @@ box_normalise_table(struct box *table, const struct box *root, html_content * c)
 		style = nscss_get_blank_style(&ctx, &c->unit_len_ctx,
 				row_group->style);
 		if (style == NULL) {
-			box_free(row_group);
+			box_free(row_group, c->box_arena);
 			free(col_info.spans);
 			return false;
 		}
 
-		row = box_create(NULL, style, true, row_group->href,
-				row_group->target, NULL, NULL, c->bctx);
+		row = box_create(NULL, style, true, box_href(row_group),
+				box_target(row_group), NULL, NULL,
+				c->box_arena, c->extra_arena);
 		if (row == NULL) {
 			css_computed_style_destroy(style);
-			box_free(row_group);
+			box_free(row_group, c->box_arena);
 			free(col_info.spans);
 			return false;
 		}
@@ -867,7 +876,7 @@ box_normalise_inline_container(struct box *cont,
 				else
 					child->parent->last = child->prev;
 
-				box_free(child);
+				box_free(child, c->box_arena);
 			}
 			break;
 		case BOX_BLOCK:
@@ -960,8 +969,9 @@ box_normalise_block(struct box *block, const struct box *root, html_content *c)
 			if (style == NULL)
 				return false;
 
-			table = box_create(NULL, style, true, block->href,
-					block->target, NULL, NULL, c->bctx);
+			table = box_create(NULL, style, true, box_href(block),
+					box_target(block), NULL, NULL,
+					c->box_arena, c->extra_arena);
 			if (table == NULL) {
 				css_computed_style_destroy(style);
 				return false;
@@ -35,6 +35,7 @@
 #include "utils/log.h"
 #include "utils/messages.h"
 #include "utils/talloc.h"
+#include "utils/arena.h"
 #include "utils/string.h"
 #include "utils/ascii.h"
 #include "utils/nsurl.h"
@@ -550,6 +551,35 @@ box_get_attribute(dom_node *n,
 }
 
 
+/**
+ * Get the image map a box uses from the usemap attribute of its element.
+ *
+ * \param n        DOM element
+ * \param content  html content the box belongs to
+ * \param box      box to set the image map of
+ * \return  true on success, false on memory exhaustion
+ */
+static bool
+box_get_usemap(dom_node *n, html_content *content, struct box *box)
+{
+	char *usemap = NULL;
+
+	if (!box_get_attribute(n, "usemap", content->bctx, &usemap))
+		return false;
+	if (usemap == NULL)
+		return true;
+
+	if (box_get_extra(box, content->extra_arena) == NULL)
+		return false;
+
+	if (usemap[0] == '#')
+		usemap++;
+	box->extra->usemap = usemap;
+
+	return true;
+}
+
+
 /**
  * Helper function for adding textarea widget to box.
  *
@@ -563,16 +593,17 @@ box_input_text(html_content *html, struct box *box, struct dom_node *node)
 
 	box->type = BOX_INLINE_BLOCK;
 
-	inline_container = box_create(NULL, 0, false, 0, 0, 0, 0, html->bctx);
+	inline_container = box_create(NULL, 0, false, 0, 0, 0, 0,
+			html->box_arena, html->extra_arena);
 	if (!inline_container)
 		return false;
 	inline_container->type = BOX_INLINE_CONTAINER;
-	inline_box = box_create(NULL, box->style, false, 0, 0, box->title, 0,
-			html->bctx);
+	inline_box = box_create(NULL, box->style, false, 0, 0,
+			box_title(box), 0, html->box_arena, html->extra_arena);
 	if (!inline_box)
 		return false;
 	inline_box->type = BOX_TEXT;
-	inline_box->text = talloc_strdup(html->bctx, "");
+	inline_box->text = arena_strdup(html->text_arena, "");
 
 	box_add_child(inline_container, inline_box);
 	box_add_child(box, inline_container);
@@ -679,6 +710,11 @@ box_a(dom_node *n,
 	nsurl *url;
 	dom_string *s;
 	dom_exception err;
+	struct box_extra *extra;
+
+	extra = box_get_extra(box, content->extra_arena);
+	if (extra == NULL)
+		return false;
 
 	err = dom_element_get_attribute(n, corestring_dom_href, &s);
 	if (err == DOM_NO_ERR && s != NULL) {
@@ -687,9 +723,9 @@ box_a(dom_node *n,
 		if (!ok)
 			return false;
 		if (url) {
-			if (box->href != NULL)
-				nsurl_unref(box->href);
-			box->href = url;
+			if (extra->href != NULL)
+				nsurl_unref(extra->href);
+			extra->href = url;
 		}
 	}
 
@@ -705,10 +741,10 @@ box_a(dom_node *n,
 		if (err == DOM_NO_ERR) {
 			/* name replaces existing id
 			 * TODO: really? */
-			if (box->id != NULL)
-				lwc_string_unref(box->id);
+			if (extra->id != NULL)
+				lwc_string_unref(extra->id);
 
-			box->id = lwc_name;
+			extra->id = lwc_name;
 		}
 	}
 
@@ -717,24 +753,24 @@ box_a(dom_node *n,
 	if (err == DOM_NO_ERR && s != NULL) {
 		if (dom_string_caseless_lwc_isequal(s,
 				corestring_lwc__blank))
-			box->target = "_blank";
+			extra->target = "_blank";
 		else if (dom_string_caseless_lwc_isequal(s,
 				corestring_lwc__top))
-			box->target = "_top";
+			extra->target = "_top";
 		else if (dom_string_caseless_lwc_isequal(s,
 				corestring_lwc__parent))
-			box->target = "_parent";
+			extra->target = "_parent";
 		else if (dom_string_caseless_lwc_isequal(s,
 				corestring_lwc__self))
 			/* the default may have been overridden by a
 			 * <base target=...>, so this is different to 0 */
-			box->target = "_self";
+			extra->target = "_self";
 		else {
 			/* 6.16 says that frame names must begin with [a-zA-Z]
 			 * This doesn't match reality, so just take anything */
-			box->target = talloc_strdup(content->bctx,
+			extra->target = talloc_strdup(content->bctx,
 					dom_string_data(s));
-			if (!box->target) {
+			if (!extra->target) {
 				dom_string_unref(s);
 				return false;
 			}
@@ -797,8 +833,11 @@ box_button(dom_node *n,
 	if (!gadget)
 		return false;
 
+	if (box_get_extra(box, content->extra_arena) == NULL)
+		return false;
+
 	gadget->html = content;
-	box->gadget = gadget;
+	box->extra->gadget = gadget;
 	box->flags |= IS_REPLACED;
 	gadget->box = box;
 
@@ -963,7 +1002,9 @@ box_embed(dom_node *n,
 
 	dom_namednodemap_unref(attrs);
 
-	box->object_params = params;
+	if (box_get_extra(box, content->extra_arena) == NULL)
+		return false;
+	box->extra->object_params = params;
 
 	/* start fetch */
 	box->flags |= IS_REPLACED;
@@ -1165,7 +1206,7 @@ box_image(dom_node *n,
 		dom_string_unref(s);
 		if (alt == NULL)
 			return false;
-		box->text = talloc_strdup(content->bctx, alt);
+		box->text = arena_strdup(content->text_arena, alt);
 		free(alt);
 		if (box->text == NULL)
 			return false;
@@ -1177,10 +1218,8 @@ box_image(dom_node *n,
 	}
 
 	/* imagemap associated with this image */
-	if (!box_get_attribute(n, "usemap", content->bctx, &box->usemap))
+	if (!box_get_usemap(n, content, box))
 		return false;
-	if (box->usemap && box->usemap[0] == '#')
-		box->usemap++;
 
 	/* get image URL */
 	err = dom_element_get_attribute(n, corestring_dom_src, &s);
@@ -1238,7 +1277,10 @@ box_input(dom_node *n,
 		return false;
 	}
 
-	box->gadget = gadget;
+	if (box_get_extra(box, content->extra_arena) == NULL)
+		return false;
+
+	box->extra->gadget = gadget;
 	box->flags |= IS_REPLACED;
 	gadget->box = box;
 	gadget->html = content;
@@ -1283,30 +1325,31 @@ box_input(dom_node *n,
 			goto no_memory;
 
 		inline_container = box_create(NULL, 0, false, 0, 0, 0, 0,
-				content->bctx);
+				content->box_arena, content->extra_arena);
 		if (inline_container == NULL)
 			goto no_memory;
 
 		inline_container->type = BOX_INLINE_CONTAINER;
 
 		inline_box = box_create(NULL, box->style, false, 0, 0,
-				box->title, 0, content->bctx);
+				box_title(box), 0, content->box_arena,
+				content->extra_arena);
 		if (inline_box == NULL)
 			goto no_memory;
 
 		inline_box->type = BOX_TEXT;
 
-		if (box->gadget->value != NULL)
-			inline_box->text = talloc_strdup(content->bctx,
-					box->gadget->value);
-		else if (box->gadget->type == GADGET_SUBMIT)
-			inline_box->text = talloc_strdup(content->bctx,
+		if (gadget->value != NULL)
+			inline_box->text = arena_strdup(content->text_arena,
+					gadget->value);
+		else if (gadget->type == GADGET_SUBMIT)
+			inline_box->text = arena_strdup(content->text_arena,
 					messages_get("Form_Submit"));
-		else if (box->gadget->type == GADGET_RESET)
-			inline_box->text = talloc_strdup(content->bctx,
+		else if (gadget->type == GADGET_RESET)
+			inline_box->text = arena_strdup(content->text_arena,
 					messages_get("Form_Reset"));
 		else
-			inline_box->text = talloc_strdup(content->bctx,
+			inline_box->text = arena_strdup(content->text_arena,
 							 "Button");
 
 		if (inline_box->text == NULL)
@@ -1409,11 +1452,8 @@ box_object(dom_node *n,
 	    ns_computed_display(box->style, box_is_root(n)) == CSS_DISPLAY_NONE)
 		return true;
 
-	if (box_get_attribute(n, "usemap", content->bctx, &box->usemap) ==
-			false)
+	if (!box_get_usemap(n, content, box))
 		return false;
-	if (box->usemap && box->usemap[0] == '#')
-		box->usemap++;
 
 	params = talloc(content->bctx, struct object_params);
 	if (params == NULL)
@@ -1617,7 +1657,9 @@ box_object(dom_node *n,
 		c = next;
 	}
 
-	box->object_params = params;
+	if (box_get_extra(box, content->extra_arena) == NULL)
+		return false;
+	box->extra->object_params = params;
 
 	/* start fetch (MIME type is ok or not specified) */
 	box->flags |= IS_REPLACED;
@@ -1762,17 +1804,24 @@ box_select(dom_node *n,
 		return true;
 	}
 
+	if (box_get_extra(box, content->extra_arena) == NULL) {
+		form_free_control(gadget);
+		return false;
+	}
+
 	box->type = BOX_INLINE_BLOCK;
-	box->gadget = gadget;
+	box->extra->gadget = gadget;
 	box->flags |= IS_REPLACED;
 	gadget->box = box;
 
-	inline_container = box_create(NULL, 0, false, 0, 0, 0, 0, content->bctx);
+	inline_container = box_create(NULL, 0, false, 0, 0, 0, 0,
+			content->box_arena, content->extra_arena);
 	if (inline_container == NULL)
 		goto no_memory;
 	inline_container->type = BOX_INLINE_CONTAINER;
-	inline_box = box_create(NULL, box->style, false, 0, 0, box->title, 0,
-			content->bctx);
+	inline_box = box_create(NULL, box->style, false, 0, 0,
+			box_title(box), 0, content->box_arena,
+			content->extra_arena);
 	if (inline_box == NULL)
 		goto no_memory;
 	inline_box->type = BOX_TEXT;
@@ -1790,13 +1839,13 @@ box_select(dom_node *n,
 	}
 
 	if (gadget->data.select.num_selected == 0)
-		inline_box->text = talloc_strdup(content->bctx,
+		inline_box->text = arena_strdup(content->text_arena,
 				messages_get("Form_None"));
 	else if (gadget->data.select.num_selected == 1)
-		inline_box->text = talloc_strdup(content->bctx,
+		inline_box->text = arena_strdup(content->text_arena,
 				gadget->data.select.current->text);
 	else
-		inline_box->text = talloc_strdup(content->bctx,
+		inline_box->text = arena_strdup(content->text_arena,
 				messages_get("Form_Many"));
 	if (inline_box->text == NULL)
 		goto no_memory;
@@ -1819,14 +1868,17 @@ static bool box_textarea(dom_node *n,
 			struct box *box,
 			bool *convert_children)
 {
+	if (box_get_extra(box, content->extra_arena) == NULL)
+		return false;
+
 	/* Get the form_control for the DOM node */
-	box->gadget = html_forms_get_control_for_node(content->forms, n);
-	if (box->gadget == NULL)
+	box->extra->gadget = html_forms_get_control_for_node(content->forms, n);
+	if (box->extra->gadget == NULL)
 		return false;
 
 	box->flags |= IS_REPLACED;
-	box->gadget->html = content;
-	box->gadget->box = box;
+	box->extra->gadget->html = content;
+	box->extra->gadget->box = box;
 
 	if (!box_input_text(content, box, n))
 		return false;
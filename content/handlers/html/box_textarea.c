@@ -42,9 +42,9 @@
 
 nserror box_textarea_keypress(html_content *html, struct box *box, uint32_t key)
 {
-	struct form_control *gadget = box->gadget;
+	struct form_control *gadget = box_gadget(box);
 	struct textarea *ta = gadget->data.text.ta;
-	struct form* form = box->gadget->form;
+	struct form* form = gadget->form;
 	struct content *c = (struct content *)html;
 	nserror res = NSERROR_OK;
 
@@ -196,7 +196,7 @@ static void box_textarea_callback(void *data, struct textarea_msg *msg)
 
 		box_coords(box, &x, &y);
 
-		content__request_redraw((struct content *)html,
+		html__request_redraw(html,
 				x + msg->data.redraw.x0,
 				y + msg->data.redraw.y0,
 				msg->data.redraw.x1 - msg->data.redraw.x0,
@@ -271,7 +271,7 @@ bool box_textarea_create_textarea(html_content *html,
 	};
 	bool read_only = false;
 	bool disabled = false;
-	struct form_control *gadget = box->gadget;
+	struct form_control *gadget = box_gadget(box);
 	const char *text;
 
 	assert(gadget != NULL);
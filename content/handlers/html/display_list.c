@@ -0,0 +1,1045 @@
+/*
+ * Copyright 2026 NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Display list of the plot operations of a laid out HTML document.
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libwapcaplet/libwapcaplet.h>
+
+#include "utils/errors.h"
+#include "utils/log.h"
+#include "netsurf/types.h"
+#include "netsurf/content.h"
+#include "netsurf/browser_window.h"
+#include "netsurf/plotters.h"
+
+#include "html/display_list.h"
+
+/** Height of a band, in target pixels */
+#define DISPLAY_LIST_BAND_HEIGHT 512
+
+/** Size of the recorded bands above which those not in view are dropped */
+#define DISPLAY_LIST_MAX_SIZE (8 * 1024 * 1024)
+
+/** Alignment of the data stored for operations */
+#define DISPLAY_LIST_ALIGN 8
+
+/** Offset of stored data which is absent */
+#define DISPLAY_LIST_NONE SIZE_MAX
+
+/** No object fallback is being recorded */
+#define DISPLAY_LIST_NO_FALLBACK UINT_MAX
+
+/**
+ * Type of a recorded operation.
+ */
+enum display_op_type {
+	DISPLAY_OP_CLIP,
+	DISPLAY_OP_ARC,
+	DISPLAY_OP_DISC,
+	DISPLAY_OP_LINE,
+	DISPLAY_OP_RECTANGLE,
+	DISPLAY_OP_POLYGON,
+	DISPLAY_OP_PATH,
+	DISPLAY_OP_BITMAP,
+	DISPLAY_OP_TEXT,
+	DISPLAY_OP_GROUP_START,
+	DISPLAY_OP_GROUP_END,
+	DISPLAY_OP_CONTENT,
+	DISPLAY_OP_IFRAME
+};
+
+/**
+ * A recorded operation.
+ *
+ * Coordinates are relative to the document origin, in target pixels.
+ * Variable sized arguments are held in the data of the band, by offset.
+ */
+struct display_op {
+	enum display_op_type type;
+
+	/** Plot style of the operation */
+	union {
+		plot_style_t plot;
+		plot_font_style_t font;
+	} style;
+
+	/** Arguments of the operation */
+	union {
+		struct rect rect;
+		struct {
+			int x, y;
+			int radius;
+			int angle1, angle2;
+		} arc;
+		struct {
+			size_t offset;
+			unsigned int n;
+			float transform[6];
+		} points;
+		struct {
+			struct bitmap *bitmap;
+			int x, y;
+			int width, height;
+			colour bg;
+			bitmap_flags_t flags;
+		} bitmap;
+		struct {
+			int x, y;
+			size_t offset;
+			size_t length;
+			size_t families;
+		} text;
+		size_t name;
+		struct {
+			struct hlcache_handle *h;
+			struct content_redraw_data data;
+			struct rect clip;
+			bool unscaled;
+			unsigned int fallback;
+		} content;
+		struct {
+			struct browser_window *bw;
+			int x, y;
+			struct rect clip;
+		} iframe;
+	} u;
+};
+
+/**
+ * A horizontal band of the document.
+ */
+struct display_band {
+	bool recorded; /**< operations have been recorded */
+	bool failed; /**< recording ran out of memory */
+	bool live; /**< band must always be drawn from the box tree */
+	int x0; /**< left of the recorded area */
+	int x1; /**< right of the recorded area */
+
+	struct display_op *op; /**< recorded operations */
+	unsigned int count; /**< number of recorded operations */
+	unsigned int alloc; /**< number of operations allocated */
+
+	char *data; /**< data of the recorded operations */
+	size_t used; /**< bytes of data used */
+	size_t size; /**< bytes of data allocated */
+
+	/** Object operation whose fallback is being recorded */
+	unsigned int fallback;
+};
+
+/**
+ * A display list.
+ */
+struct display_list {
+	float scale; /**< scale the bands are recorded at */
+	colour background; /**< background colour they are recorded over */
+	bool background_images; /**< whether they have background images */
+
+	struct display_band *band; /**< bands, from the top of the document */
+	unsigned int band_count; /**< number of bands */
+
+	size_t size; /**< bytes held by the recorded bands */
+
+	int *points; /**< scratch space for translated polygons */
+	unsigned int points_size; /**< number of coordinates in points */
+};
+
+
+static const struct plotter_table display_list_plotters;
+
+
+/**
+ * Get the size of the memory held by a band.
+ */
+static inline size_t display_band_size(const struct display_band *band)
+{
+	return band->alloc * sizeof(struct display_op) + band->size;
+}
+
+
+/**
+ * Drop the recorded operations of a band.
+ *
+ * \param list  display list the band belongs to
+ * \param band  band to clear
+ */
+static void display_band_clear(struct display_list *list,
+		struct display_band *band)
+{
+	unsigned int i;
+
+	for (i = 0; i != band->count; i++) {
+		const struct display_op *op = &band->op[i];
+		lwc_string **families;
+
+		if (op->type != DISPLAY_OP_TEXT ||
+				op->u.text.families == DISPLAY_LIST_NONE)
+			continue;
+
+		families = (lwc_string **)(void *)
+				(band->data + op->u.text.families);
+		for (; *families != NULL; families++) {
+			lwc_string_unref(*families);
+		}
+	}
+
+	list->size -= display_band_size(band);
+
+	free(band->op);
+	free(band->data);
+	memset(band, 0, sizeof(*band));
+}
+
+
+/**
+ * Add an operation to the band being recorded.
+ *
+ * \param ctx   recording redraw context
+ * \param type  type of the operation
+ * \return the operation, or NULL on memory exhaustion
+ */
+static struct display_op *
+display_band_add(const struct redraw_context *ctx, enum display_op_type type)
+{
+	struct display_band *band = ctx->priv;
+	struct display_op *op;
+
+	if (band->failed) {
+		return NULL;
+	}
+
+	if (band->count == band->alloc) {
+		unsigned int alloc = band->alloc ? band->alloc * 2 : 64;
+
+		op = realloc(band->op, alloc * sizeof(*op));
+		if (op == NULL) {
+			band->failed = true;
+			return NULL;
+		}
+		band->op = op;
+		band->alloc = alloc;
+	}
+
+	op = &band->op[band->count++];
+	op->type = type;
+
+	return op;
+}
+
+
+/**
+ * Store data for an operation in the band being recorded.
+ *
+ * \param ctx     recording redraw context
+ * \param data    data to store
+ * \param size    size of the data
+ * \param offset  updated to the offset of the data in the band
+ * \return true on success, false on memory exhaustion
+ */
+static bool display_band_store(const struct redraw_context *ctx,
+		const void *data, size_t size, size_t *offset)
+{
+	struct display_band *band = ctx->priv;
+	size_t used;
+
+	used = (band->used + DISPLAY_LIST_ALIGN - 1) &
+			~((size_t)DISPLAY_LIST_ALIGN - 1);
+
+	if (used + size > band->size) {
+		size_t new_size = band->size ? band->size * 2 : 4096;
+		char *new_data;
+
+		while (used + size > new_size)
+			new_size *= 2;
+
+		new_data = realloc(band->data, new_size);
+		if (new_data == NULL) {
+			band->failed = true;
+			return false;
+		}
+		band->data = new_data;
+		band->size = new_size;
+	}
+
+	memcpy(band->data + used, data, size);
+	band->used = used + size;
+	*offset = used;
+
+	return true;
+}
+
+
+/* recording plotters */
+
+static nserror
+display_list_clip(const struct redraw_context *ctx, const struct rect *clip)
+{
+	struct display_op *op = display_band_add(ctx, DISPLAY_OP_CLIP);
+
+	if (op == NULL)
+		return NSERROR_NOMEM;
+	op->u.rect = *clip;
+
+	return NSERROR_OK;
+}
+
+
+static nserror
+display_list_arc(const struct redraw_context *ctx,
+		const plot_style_t *pstyle,
+		int x, int y, int radius, int angle1, int angle2)
+{
+	struct display_op *op = display_band_add(ctx, DISPLAY_OP_ARC);
+
+	if (op == NULL)
+		return NSERROR_NOMEM;
+	op->style.plot = *pstyle;
+	op->u.arc.x = x;
+	op->u.arc.y = y;
+	op->u.arc.radius = radius;
+	op->u.arc.angle1 = angle1;
+	op->u.arc.angle2 = angle2;
+
+	return NSERROR_OK;
+}
+
+
+static nserror
+display_list_disc(const struct redraw_context *ctx,
+		const plot_style_t *pstyle, int x, int y, int radius)
+{
+	struct display_op *op = display_band_add(ctx, DISPLAY_OP_DISC);
+
+	if (op == NULL)
+		return NSERROR_NOMEM;
+	op->style.plot = *pstyle;
+	op->u.arc.x = x;
+	op->u.arc.y = y;
+	op->u.arc.radius = radius;
+
+	return NSERROR_OK;
+}
+
+
+static nserror
+display_list_line(const struct redraw_context *ctx,
+		const plot_style_t *pstyle, const struct rect *line)
+{
+	struct display_op *op = display_band_add(ctx, DISPLAY_OP_LINE);
+
+	if (op == NULL)
+		return NSERROR_NOMEM;
+	op->style.plot = *pstyle;
+	op->u.rect = *line;
+
+	return NSERROR_OK;
+}
+
+
+static nserror
+display_list_rectangle(const struct redraw_context *ctx,
+		const plot_style_t *pstyle, const struct rect *rectangle)
+{
+	struct display_op *op = display_band_add(ctx, DISPLAY_OP_RECTANGLE);
+
+	if (op == NULL)
+		return NSERROR_NOMEM;
+	op->style.plot = *pstyle;
+	op->u.rect = *rectangle;
+
+	return NSERROR_OK;
+}
+
+
+static nserror
+display_list_polygon(const struct redraw_context *ctx,
+		const plot_style_t *pstyle, const int *p, unsigned int n)
+{
+	struct display_op *op = display_band_add(ctx, DISPLAY_OP_POLYGON);
+
+	if (op == NULL)
+		return NSERROR_NOMEM;
+	op->style.plot = *pstyle;
+	op->u.points.n = n;
+	if (!display_band_store(ctx, p, 2 * n * sizeof(*p),
+			&op->u.points.offset))
+		return NSERROR_NOMEM;
+
+	return NSERROR_OK;
+}
+
+
+static nserror
+display_list_path(const struct redraw_context *ctx,
+		const plot_style_t *pstyle,
+		const float *p, unsigned int n, const float transform[6])
+{
+	struct display_op *op = display_band_add(ctx, DISPLAY_OP_PATH);
+
+	if (op == NULL)
+		return NSERROR_NOMEM;
+	op->style.plot = *pstyle;
+	op->u.points.n = n;
+	memcpy(op->u.points.transform, transform,
+			sizeof(op->u.points.transform));
+	if (!display_band_store(ctx, p, n * sizeof(*p),
+			&op->u.points.offset))
+		return NSERROR_NOMEM;
+
+	return NSERROR_OK;
+}
+
+
+static nserror
+display_list_bitmap(const struct redraw_context *ctx,
+		struct bitmap *bitmap, int x, int y, int width, int height,
+		colour bg, bitmap_flags_t flags)
+{
+	struct display_op *op = display_band_add(ctx, DISPLAY_OP_BITMAP);
+
+	if (op == NULL)
+		return NSERROR_NOMEM;
+	op->u.bitmap.bitmap = bitmap;
+	op->u.bitmap.x = x;
+	op->u.bitmap.y = y;
+	op->u.bitmap.width = width;
+	op->u.bitmap.height = height;
+	op->u.bitmap.bg = bg;
+	op->u.bitmap.flags = flags;
+
+	return NSERROR_OK;
+}
+
+
+static nserror
+display_list_text(const struct redraw_context *ctx,
+		const plot_font_style_t *fstyle,
+		int x, int y, const char *text, size_t length)
+{
+	struct display_op *op = display_band_add(ctx, DISPLAY_OP_TEXT);
+	struct display_band *band = ctx->priv;
+	size_t count = 0;
+
+	if (op == NULL)
+		return NSERROR_NOMEM;
+	op->style.font = *fstyle;
+	op->style.font.families = NULL;
+	op->u.text.x = x;
+	op->u.text.y = y;
+	op->u.text.length = length;
+	op->u.text.families = DISPLAY_LIST_NONE;
+	if (!display_band_store(ctx, text, length, &op->u.text.offset))
+		return NSERROR_NOMEM;
+
+	/* the families belong to a computed style, which may be freed
+	 * before the band is next replayed, so keep a copy of them */
+	if (fstyle->families != NULL) {
+		lwc_string **families;
+		size_t offset;
+
+		while (fstyle->families[count] != NULL)
+			count++;
+		if (!display_band_store(ctx, fstyle->families,
+				(count + 1) * sizeof(lwc_string *), &offset))
+			return NSERROR_NOMEM;
+
+		families = (lwc_string **)(void *)(band->data + offset);
+		for (; *families != NULL; families++) {
+			lwc_string_ref(*families);
+		}
+		op->u.text.families = offset;
+	}
+
+	return NSERROR_OK;
+}
+
+
+static nserror
+display_list_group_start(const struct redraw_context *ctx, const char *name)
+{
+	struct display_op *op = display_band_add(ctx, DISPLAY_OP_GROUP_START);
+
+	if (op == NULL)
+		return NSERROR_NOMEM;
+	if (!display_band_store(ctx, name, strlen(name) + 1, &op->u.name))
+		return NSERROR_NOMEM;
+
+	return NSERROR_OK;
+}
+
+
+static nserror display_list_group_end(const struct redraw_context *ctx)
+{
+	if (display_band_add(ctx, DISPLAY_OP_GROUP_END) == NULL)
+		return NSERROR_NOMEM;
+
+	return NSERROR_OK;
+}
+
+
+/** Plotters recording into the band in the redraw context's private word */
+static const struct plotter_table display_list_plotters = {
+	.clip = display_list_clip,
+	.arc = display_list_arc,
+	.disc = display_list_disc,
+	.line = display_list_line,
+	.rectangle = display_list_rectangle,
+	.polygon = display_list_polygon,
+	.path = display_list_path,
+	.bitmap = display_list_bitmap,
+	.text = display_list_text,
+	.group_start = display_list_group_start,
+	.group_end = display_list_group_end,
+	.flush = NULL,
+	.option_knockout = false
+};
+
+
+/* exported interface documented in html/display_list.h */
+bool display_list_recording(const struct redraw_context *ctx)
+{
+	return ctx->plot == &display_list_plotters;
+}
+
+
+/* exported interface documented in html/display_list.h */
+nserror display_list_record_content(const struct redraw_context *ctx,
+		struct hlcache_handle *h,
+		const struct content_redraw_data *data,
+		const struct rect *clip)
+{
+	struct display_band *band = ctx->priv;
+	struct display_op *op;
+
+	op = display_band_add(ctx, DISPLAY_OP_CONTENT);
+	if (op == NULL)
+		return NSERROR_NOMEM;
+	op->u.content.h = h;
+	op->u.content.data = *data;
+	op->u.content.clip = *clip;
+	/* HTML objects are given their position unscaled */
+	op->u.content.unscaled = (content_get_type(h) == CONTENT_HTML);
+	op->u.content.fallback = 0;
+
+	band->fallback = band->count - 1;
+
+	return NSERROR_OK;
+}
+
+
+/* exported interface documented in html/display_list.h */
+void display_list_record_fallback_end(const struct redraw_context *ctx)
+{
+	struct display_band *band = ctx->priv;
+
+	if (!display_list_recording(ctx) || band->failed || band->fallback == DISPLAY_LIST_NO_FALLBACK)
+		return;
+
+	band->op[band->fallback].u.content.fallback =
+			band->count - band->fallback - 1;
+	band->fallback = DISPLAY_LIST_NO_FALLBACK;
+}
+
+
+/* exported interface documented in html/display_list.h */
+void display_list_record_live(const struct redraw_context *ctx)
+{
+	struct display_band *band = ctx->priv;
+
+	band->live = true;
+}
+
+
+/* exported interface documented in html/display_list.h */
+nserror display_list_record_iframe(const struct redraw_context *ctx,
+		struct browser_window *bw, int x, int y,
+		const struct rect *clip)
+{
+	struct display_op *op = display_band_add(ctx, DISPLAY_OP_IFRAME);
+
+	if (op == NULL)
+		return NSERROR_NOMEM;
+	op->u.iframe.bw = bw;
+	op->u.iframe.x = x;
+	op->u.iframe.y = y;
+	op->u.iframe.clip = *clip;
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Translate a rectangle and intersect it with a clip rectangle.
+ *
+ * \param r     rectangle to translate
+ * \param dx    horizontal translation
+ * \param dy    vertical translation
+ * \param clip  clip rectangle
+ * \param out   updated to the result
+ * \return true if the result is not empty
+ */
+static inline bool display_list_clip_rect(const struct rect *r, int dx,
+		int dy, const struct rect *clip, struct rect *out)
+{
+	out->x0 = r->x0 + dx;
+	out->y0 = r->y0 + dy;
+	out->x1 = r->x1 + dx;
+	out->y1 = r->y1 + dy;
+	if (out->x0 < clip->x0) out->x0 = clip->x0;
+	if (out->y0 < clip->y0) out->y0 = clip->y0;
+	if (clip->x1 < out->x1) out->x1 = clip->x1;
+	if (clip->y1 < out->y1) out->y1 = clip->y1;
+
+	return out->x0 < out->x1 && out->y0 < out->y1;
+}
+
+
+/**
+ * Replay the operations of a band.
+ *
+ * \param list  display list
+ * \param band  band to replay
+ * \param data  redraw data of the document
+ * \param dx    horizontal translation, in target pixels
+ * \param dy    vertical translation, in target pixels
+ * \param clip  clip rectangle, within the band
+ * \param ctx   redraw context to replay to
+ * \return NSERROR_OK on success, or the first error of a plotter
+ */
+static nserror display_band_replay(struct display_list *list,
+		const struct display_band *band,
+		const struct content_redraw_data *data, int dx, int dy,
+		const struct rect *clip, const struct redraw_context *ctx)
+{
+	const struct plotter_table *plot = ctx->plot;
+	const struct display_op *op;
+	struct content_redraw_data content_data;
+	plot_font_style_t fstyle;
+	float transform[6];
+	struct rect r;
+	bool visible = true;
+	unsigned int i, j;
+	nserror res = plot->clip(ctx, clip);
+
+	for (i = 0; i != band->count && res == NSERROR_OK; i++) {
+		op = &band->op[i];
+
+		if (op->type == DISPLAY_OP_CLIP) {
+			/* recorded clips stay within the one replayed */
+			visible = display_list_clip_rect(&op->u.rect,
+					dx, dy, clip, &r);
+			if (visible)
+				res = plot->clip(ctx, &r);
+			continue;
+		}
+
+		if (op->type == DISPLAY_OP_GROUP_START) {
+			if (plot->group_start != NULL)
+				res = plot->group_start(ctx,
+						band->data + op->u.name);
+			continue;
+		}
+
+		if (op->type == DISPLAY_OP_GROUP_END) {
+			if (plot->group_end != NULL)
+				res = plot->group_end(ctx);
+			continue;
+		}
+
+		if (!visible)
+			continue;
+
+		switch (op->type) {
+		case DISPLAY_OP_ARC:
+			res = plot->arc(ctx, &op->style.plot,
+					op->u.arc.x + dx, op->u.arc.y + dy,
+					op->u.arc.radius,
+					op->u.arc.angle1, op->u.arc.angle2);
+			break;
+
+		case DISPLAY_OP_DISC:
+			res = plot->disc(ctx, &op->style.plot,
+					op->u.arc.x + dx, op->u.arc.y + dy,
+					op->u.arc.radius);
+			break;
+
+		case DISPLAY_OP_LINE:
+			r.x0 = op->u.rect.x0 + dx;
+			r.y0 = op->u.rect.y0 + dy;
+			r.x1 = op->u.rect.x1 + dx;
+			r.y1 = op->u.rect.y1 + dy;
+			res = plot->line(ctx, &op->style.plot, &r);
+			break;
+
+		case DISPLAY_OP_RECTANGLE:
+			r.x0 = op->u.rect.x0 + dx;
+			r.y0 = op->u.rect.y0 + dy;
+			r.x1 = op->u.rect.x1 + dx;
+			r.y1 = op->u.rect.y1 + dy;
+			res = plot->rectangle(ctx, &op->style.plot, &r);
+			break;
+
+		case DISPLAY_OP_POLYGON:
+			if (list->points_size < 2 * op->u.points.n) {
+				int *points = realloc(list->points,
+						2 * op->u.points.n *
+						sizeof(*points));
+				if (points == NULL) {
+					res = NSERROR_NOMEM;
+					break;
+				}
+				list->points = points;
+				list->points_size = 2 * op->u.points.n;
+			}
+			memcpy(list->points, band->data + op->u.points.offset,
+					2 * op->u.points.n * sizeof(int));
+			for (j = 0; j != 2 * op->u.points.n; j += 2) {
+				list->points[j] += dx;
+				list->points[j + 1] += dy;
+			}
+			res = plot->polygon(ctx, &op->style.plot,
+					list->points, op->u.points.n);
+			break;
+
+		case DISPLAY_OP_PATH:
+			memcpy(transform, op->u.points.transform,
+					sizeof(transform));
+			transform[4] += dx;
+			transform[5] += dy;
+			res = plot->path(ctx, &op->style.plot,
+					(const float *)(const void *)
+					(band->data + op->u.points.offset),
+					op->u.points.n, transform);
+			break;
+
+		case DISPLAY_OP_BITMAP:
+			res = plot->bitmap(ctx, op->u.bitmap.bitmap,
+					op->u.bitmap.x + dx,
+					op->u.bitmap.y + dy,
+					op->u.bitmap.width,
+					op->u.bitmap.height,
+					op->u.bitmap.bg, op->u.bitmap.flags);
+			break;
+
+		case DISPLAY_OP_TEXT:
+			fstyle = op->style.font;
+			if (op->u.text.families != DISPLAY_LIST_NONE)
+				fstyle.families = (lwc_string * const *)
+						(const void *)(band->data +
+						op->u.text.families);
+			res = plot->text(ctx, &fstyle,
+					op->u.text.x + dx, op->u.text.y + dy,
+					band->data + op->u.text.offset,
+					op->u.text.length);
+			break;
+
+		case DISPLAY_OP_CONTENT:
+			if (!display_list_clip_rect(&op->u.content.clip,
+					dx, dy, clip, &r))
+				break;
+			content_data = op->u.content.data;
+			if (op->u.content.unscaled) {
+				content_data.x += data->x;
+				content_data.y += data->y;
+			} else {
+				content_data.x += dx;
+				content_data.y += dy;
+			}
+			if (content_redraw(op->u.content.h, &content_data,
+					&r, ctx)) {
+				/* skip the fallback for a failed redraw */
+				i += op->u.content.fallback;
+			}
+			break;
+
+		case DISPLAY_OP_IFRAME:
+			if (!display_list_clip_rect(&op->u.iframe.clip,
+					dx, dy, clip, &r))
+				break;
+			browser_window_redraw(op->u.iframe.bw,
+					op->u.iframe.x + dx,
+					op->u.iframe.y + dy, &r, ctx);
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	return res;
+}
+
+
+/**
+ * Record the operations of a band.
+ *
+ * \param list  display list
+ * \param k     index of the band
+ * \param x0    left of the area to record
+ * \param x1    right of the area to record
+ * \param ctx   redraw context the band is for
+ * \param draw  function drawing the document
+ * \param pw    private word passed to draw
+ * \return NSERROR_OK on success, or an error code
+ */
+static nserror display_band_record(struct display_list *list,
+		unsigned int k, int x0, int x1,
+		const struct redraw_context *ctx,
+		display_list_draw_fn draw, void *pw)
+{
+	struct display_band *band = &list->band[k];
+	struct redraw_context record_ctx = {
+		.interactive = ctx->interactive,
+		.background_images = ctx->background_images,
+		.plot = &display_list_plotters,
+		.priv = band,
+	};
+	struct rect r;
+	bool ok;
+
+	/* widen a band recorded before to the new area */
+	if (band->recorded) {
+		if (band->x0 < x0)
+			x0 = band->x0;
+		if (band->x1 > x1)
+			x1 = band->x1;
+		display_band_clear(list, band);
+	}
+
+	band->fallback = DISPLAY_LIST_NO_FALLBACK;
+
+	r.x0 = x0;
+	r.y0 = k * DISPLAY_LIST_BAND_HEIGHT;
+	r.x1 = x1;
+	r.y1 = r.y0 + DISPLAY_LIST_BAND_HEIGHT;
+
+	ok = draw(0, 0, &r, &record_ctx, pw);
+
+	list->size += display_band_size(band);
+
+	if (!ok || band->failed) {
+		nserror res = band->failed ? NSERROR_NOMEM : NSERROR_INVALID;
+		display_band_clear(list, band);
+		return res;
+	}
+
+	if (band->live) {
+		/* nothing recorded will be replayed */
+		display_band_clear(list, band);
+		band->live = true;
+	}
+
+	band->recorded = true;
+	band->x0 = x0;
+	band->x1 = x1;
+
+	return NSERROR_OK;
+}
+
+
+/* exported interface documented in html/display_list.h */
+nserror display_list_create(struct display_list **list_out)
+{
+	struct display_list *list;
+
+	list = calloc(1, sizeof(*list));
+	if (list == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	*list_out = list;
+
+	return NSERROR_OK;
+}
+
+
+/* exported interface documented in html/display_list.h */
+void display_list_destroy(struct display_list *list)
+{
+	if (list == NULL) {
+		return;
+	}
+
+	display_list_invalidate_all(list);
+	free(list->band);
+	free(list->points);
+	free(list);
+}
+
+
+/* exported interface documented in html/display_list.h */
+void display_list_invalidate(struct display_list *list,
+		int x, int y, int width, int height)
+{
+	int y0, y1;
+	unsigned int k, last;
+
+	if (list == NULL || list->band_count == 0) {
+		return;
+	}
+
+	/* bands are in target pixels; round outwards */
+	y0 = (int)(y * list->scale) - 1;
+	y1 = (int)((y + height) * list->scale) + 1;
+	if (y1 < 0) {
+		return;
+	}
+	if (y0 < 0) {
+		y0 = 0;
+	}
+
+	last = y1 / DISPLAY_LIST_BAND_HEIGHT;
+	if (last >= list->band_count) {
+		last = list->band_count - 1;
+	}
+
+	for (k = y0 / DISPLAY_LIST_BAND_HEIGHT; k <= last; k++) {
+		if (list->band[k].recorded) {
+			display_band_clear(list, &list->band[k]);
+		}
+	}
+}
+
+
+/* exported interface documented in html/display_list.h */
+void display_list_invalidate_all(struct display_list *list)
+{
+	unsigned int k;
+
+	if (list == NULL) {
+		return;
+	}
+
+	for (k = 0; k != list->band_count; k++) {
+		if (list->band[k].recorded) {
+			display_band_clear(list, &list->band[k]);
+		}
+	}
+}
+
+
+/* exported interface documented in html/display_list.h */
+nserror display_list_redraw(struct display_list *list,
+		const struct content_redraw_data *data,
+		const struct rect *clip,
+		const struct redraw_context *ctx,
+		display_list_draw_fn draw, void *pw)
+{
+	struct rect area;
+	struct rect r;
+	unsigned int first, last, k;
+	int dx, dy;
+	nserror res;
+
+	/* bands are replayed a whole number of target pixels away from
+	 * where they were recorded */
+	dx = data->x * data->scale;
+	dy = data->y * data->scale;
+	if (dx != data->x * data->scale || dy != data->y * data->scale) {
+		return NSERROR_NOT_IMPLEMENTED;
+	}
+
+	if (list->scale != data->scale ||
+			list->background != data->background_colour ||
+			list->background_images != ctx->background_images) {
+		display_list_invalidate_all(list);
+		list->scale = data->scale;
+		list->background = data->background_colour;
+		list->background_images = ctx->background_images;
+	}
+
+	/* clip rectangle relative to the document origin */
+	area.x0 = clip->x0 - dx;
+	area.y0 = clip->y0 - dy;
+	area.x1 = clip->x1 - dx;
+	area.y1 = clip->y1 - dy;
+	if (area.y0 < 0 || area.x1 <= area.x0 || area.y1 <= area.y0) {
+		return NSERROR_NOT_IMPLEMENTED;
+	}
+
+	first = area.y0 / DISPLAY_LIST_BAND_HEIGHT;
+	last = (area.y1 - 1) / DISPLAY_LIST_BAND_HEIGHT;
+
+	if (last >= list->band_count) {
+		struct display_band *band;
+
+		band = realloc(list->band, (last + 1) * sizeof(*band));
+		if (band == NULL) {
+			return NSERROR_NOMEM;
+		}
+		memset(band + list->band_count, 0,
+				(last + 1 - list->band_count) * sizeof(*band));
+		list->band = band;
+		list->band_count = last + 1;
+	}
+
+	for (k = first; k <= last; k++) {
+		const struct display_band *band = &list->band[k];
+
+		if (band->recorded && band->x0 <= area.x0 &&
+				area.x1 <= band->x1)
+			continue;
+
+		res = display_band_record(list, k, area.x0, area.x1,
+				ctx, draw, pw);
+		if (res != NSERROR_OK) {
+			return res;
+		}
+	}
+
+	for (k = first; k <= last; k++) {
+		if (list->band[k].live) {
+			return NSERROR_NOT_IMPLEMENTED;
+		}
+	}
+
+	for (k = first; k <= last; k++) {
+		r = *clip;
+		if (r.y0 < (int)(k * DISPLAY_LIST_BAND_HEIGHT) + dy)
+			r.y0 = k * DISPLAY_LIST_BAND_HEIGHT + dy;
+		if (r.y1 > (int)((k + 1) * DISPLAY_LIST_BAND_HEIGHT) + dy)
+			r.y1 = (k + 1) * DISPLAY_LIST_BAND_HEIGHT + dy;
+
+		res = display_band_replay(list, &list->band[k], data,
+				dx, dy, &r, ctx);
+		if (res != NSERROR_OK) {
+			return res;
+		}
+	}
+
+	res = ctx->plot->clip(ctx, clip);
+
+	/* keep the memory held in check by dropping bands out of view */
+	if (list->size > DISPLAY_LIST_MAX_SIZE) {
+		for (k = 0; k != list->band_count; k++) {
+			if ((k < first || k > last) && list->band[k].recorded)
+				display_band_clear(list, &list->band[k]);
+		}
+	}
+
+	return res;
+}
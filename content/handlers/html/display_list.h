@@ -0,0 +1,184 @@
+/*
+ * Copyright 2026 NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Display list of the plot operations of a laid out HTML document.
+ *
+ * The document is split into horizontal bands. The first redraw of a
+ * band walks the box tree with plotters which record the operations,
+ * and later redraws replay them, translated to the redraw origin and
+ * clipped to the redraw clip rectangle. Bands are recorded at one scale
+ * and are dropped when the scale changes.
+ *
+ * Objects and iframes are recorded as references and redrawn live when
+ * replayed, so their own changes, such as animation frames, do not
+ * require recording again. Anything else changing the appearance of the
+ * document must invalidate the bands it covers.
+ */
+
+#ifndef NETSURF_HTML_DISPLAY_LIST_H
+#define NETSURF_HTML_DISPLAY_LIST_H
+
+#include <stdbool.h>
+
+#include "utils/errors.h"
+
+struct browser_window;
+struct content_redraw_data;
+struct display_list;
+struct hlcache_handle;
+struct rect;
+struct redraw_context;
+
+/**
+ * Draw part of a document by walking its box tree.
+ *
+ * \param x     x origin of the document, unscaled
+ * \param y     y origin of the document, unscaled
+ * \param clip  clip rectangle, in target coordinates
+ * \param ctx   redraw context
+ * \param pw    private word
+ * \return true on success, false otherwise
+ */
+typedef bool (*display_list_draw_fn)(int x, int y, const struct rect *clip,
+		const struct redraw_context *ctx, void *pw);
+
+/**
+ * Create an empty display list.
+ *
+ * \param list_out  updated to the new display list
+ * \return NSERROR_OK on success, or NSERROR_NOMEM
+ */
+nserror display_list_create(struct display_list **list_out);
+
+/**
+ * Destroy a display list.
+ *
+ * \param list  display list to destroy, or NULL
+ */
+void display_list_destroy(struct display_list *list);
+
+/**
+ * Drop the recorded bands meeting an area of the document.
+ *
+ * \param list    display list, or NULL
+ * \param x       left of the area, in document coordinates
+ * \param y       top of the area, in document coordinates
+ * \param width   width of the area
+ * \param height  height of the area
+ */
+void display_list_invalidate(struct display_list *list,
+		int x, int y, int width, int height);
+
+/**
+ * Drop every recorded band.
+ *
+ * \param list  display list, or NULL
+ */
+void display_list_invalidate_all(struct display_list *list);
+
+/**
+ * Redraw part of a document from its display list.
+ *
+ * Bands the clip rectangle meets are recorded first if they have not
+ * been, or were recorded over a narrower area.
+ *
+ * \param list  display list
+ * \param data  redraw data of the document
+ * \param clip  clip rectangle, in target coordinates
+ * \param ctx   redraw context to replay to
+ * \param draw  function drawing the document, used to record bands
+ * \param pw    private word passed to draw
+ * \return NSERROR_OK on success, NSERROR_NOT_IMPLEMENTED if the redraw
+ *         cannot be served from a display list, or another error code;
+ *         on failure the caller must draw the clip rectangle itself
+ */
+nserror display_list_redraw(struct display_list *list,
+		const struct content_redraw_data *data,
+		const struct rect *clip,
+		const struct redraw_context *ctx,
+		display_list_draw_fn draw, void *pw);
+
+/**
+ * Determine if a redraw context is recording into a display list.
+ *
+ * \param ctx  redraw context
+ * \return true if ctx records into a display list
+ */
+bool display_list_recording(const struct redraw_context *ctx);
+
+/**
+ * Record the redraw of an object.
+ *
+ * The object is redrawn with content_redraw() when the list is
+ * replayed. If the caller draws a fallback for an object which fails
+ * to redraw, it must record the fallback after this, as though the
+ * redraw had failed, and then call display_list_record_fallback_end().
+ *
+ * \param ctx   recording redraw context
+ * \param h     object to redraw
+ * \param data  redraw data for the object
+ * \param clip  clip rectangle for the object
+ * \return NSERROR_OK on success, or NSERROR_NOMEM
+ */
+nserror display_list_record_content(const struct redraw_context *ctx,
+		struct hlcache_handle *h,
+		const struct content_redraw_data *data,
+		const struct rect *clip);
+
+/**
+ * End the fallback of the object last recorded.
+ *
+ * The operations recorded since display_list_record_content() are
+ * only replayed if redrawing the object fails. Does nothing unless ctx
+ * is recording.
+ *
+ * \param ctx  redraw context
+ */
+void display_list_record_fallback_end(const struct redraw_context *ctx);
+
+/**
+ * Mark the band being recorded as one to draw from the box tree.
+ *
+ * This is for bands showing something which may change without the
+ * display list being invalidated. They are drawn by walking the box
+ * tree until they are invalidated.
+ *
+ * \param ctx  recording redraw context
+ */
+void display_list_record_live(const struct redraw_context *ctx);
+
+/**
+ * Record the redraw of an iframe.
+ *
+ * The iframe is redrawn with browser_window_redraw() when the list is
+ * replayed.
+ *
+ * \param ctx   recording redraw context
+ * \param bw    browser window of the iframe
+ * \param x     x coordinate passed to browser_window_redraw()
+ * \param y     y coordinate passed to browser_window_redraw()
+ * \param clip  clip rectangle for the iframe
+ * \return NSERROR_OK on success, or NSERROR_NOMEM
+ */
+nserror display_list_record_iframe(const struct redraw_context *ctx,
+		struct browser_window *bw, int x, int y,
+		const struct rect *clip);
+
+#endif
@@ -568,10 +568,10 @@ static void html_texty_element_update(html_content *htmlc, dom_node *node)
 	if (box == NULL) {
 		return; /* No Box (yet?) so no gadget to update */
 	}
-	if (box->gadget == NULL) {
+	if (box_gadget(box) == NULL) {
 		return; /* No gadget yet (under construction perhaps?) */
 	}
-	form_gadget_sync_with_dom(box->gadget);
+	form_gadget_sync_with_dom(box_gadget(box));
 	/* And schedule a redraw for the box */
 	html__redraw_a_box(htmlc, box);
 }
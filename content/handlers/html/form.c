@@ -36,7 +36,7 @@
 #include "utils/corestrings.h"
 #include "utils/log.h"
 #include "utils/messages.h"
-#include "utils/talloc.h"
+#include "utils/arena.h"
 #include "utils/url.h"
 #include "utils/utf8.h"
 #include "utils/ascii.h"
@@ -1361,17 +1361,19 @@ form__select_process_selection(html_content *html,
 		}
 	}
 
-	talloc_free(inline_box->text);
+	if (inline_box->text != NULL)
+		arena_free(html->text_arena, inline_box->text,
+				strlen(inline_box->text) + 1);
 	inline_box->text = 0;
 
 	if (control->data.select.num_selected == 0) {
-		inline_box->text = talloc_strdup(html->bctx,
+		inline_box->text = arena_strdup(html->text_arena,
 				messages_get("Form_None"));
 	} else if (control->data.select.num_selected == 1) {
-		inline_box->text = talloc_strdup(html->bctx,
+		inline_box->text = arena_strdup(html->text_arena,
 				control->data.select.current->text);
 	} else {
-		inline_box->text = talloc_strdup(html->bctx,
+		inline_box->text = arena_strdup(html->text_arena,
 				messages_get("Form_Many"));
 	}
 
@@ -1984,8 +1986,7 @@ void form_select_menu_callback(void *client_data,
 	menu_y += box->height + box->border[BOTTOM].width +
 			box->padding[BOTTOM] +
 			box->padding[TOP];
-	content__request_redraw((struct content *)html, menu_x + x, menu_y + y,
-			width, height);
+	html__request_redraw(html, menu_x + x, menu_y + y, width, height);
 }
 
 
@@ -37,6 +37,7 @@
 #include "utils/log.h"
 #include "utils/messages.h"
 #include "utils/talloc.h"
+#include "utils/arena.h"
 #include "utils/utf8.h"
 #include "utils/nsoption.h"
 #include "utils/string.h"
@@ -66,11 +67,13 @@
 #include "html/interaction.h"
 #include "html/box.h"
 #include "html/box_construct.h"
+#include "html/box_manipulate.h"
 #include "html/box_inspect.h"
 #include "html/form_internal.h"
 #include "html/imagemap.h"
 #include "html/layout.h"
 #include "html/textselection.h"
+#include "html/display_list.h"
 
 #define CHUNK 4096
 
@@ -470,9 +473,18 @@ html_create_html_data(html_content *c, const http_parameter *params)
 	c->aborted = false;
 	c->refresh = false;
 	c->reflowing = false;
+	c->reflow_incremental = false;
+	c->layout_reuse = false;
+	c->minmax_viewport_units = true;
 	c->title = NULL;
 	c->bctx = NULL;
+	c->box_arena = NULL;
+	c->text_arena = NULL;
+	c->extra_arena = NULL;
+	c->spare_clones = NULL;
 	c->layout = NULL;
+	c->display_list = NULL;
+	memset(&c->hit_path, 0, sizeof(c->hit_path));
 	c->background_colour = NS_TRANSPARENT;
 	c->stylesheet_count = 0;
 	c->stylesheets = NULL;
@@ -1042,19 +1054,32 @@ static void html_reformat(struct content *c, int width, int height)
 	uint64_t ms_before;
 	uint64_t ms_after;
 	uint64_t ms_interval;
+	bool incremental;
 
 	nsu_getmonotonic_ms(&ms_before);
 
 	htmlc->reflowing = true;
 
+	/* Only a reflow for changed objects at an unchanged viewport
+	 * size can reuse the layout of the boxes it leaves alone. */
+	incremental = htmlc->reflow_incremental &&
+			htmlc->had_initial_layout &&
+			htmlc->reflow_width == width &&
+			htmlc->reflow_height == height;
+	htmlc->reflow_incremental = false;
+
 	htmlc->unit_len_ctx.viewport_width = css_unit_device2css_px(
 			INTTOFIX(width), htmlc->unit_len_ctx.device_dpi);
 	htmlc->unit_len_ctx.viewport_height = css_unit_device2css_px(
 			INTTOFIX(height), htmlc->unit_len_ctx.device_dpi);
 	htmlc->unit_len_ctx.root_style = htmlc->layout->style;
 
-	layout_document(htmlc, width, height);
+	layout_document(htmlc, width, height, incremental);
 	layout = htmlc->layout;
+	display_list_invalidate_all(htmlc->display_list);
+	htmlc->hit_path.valid = false;
+	htmlc->reflow_width = width;
+	htmlc->reflow_height = height;
 
 	/* width and height are at least margin box of document */
 	c->width = layout->x + layout->padding[LEFT] + layout->width +
@@ -1095,13 +1120,7 @@ static void html_reformat(struct content *c, int width, int height)
 
 void html_redraw_a_box(hlcache_handle *h, struct box *box)
 {
-	int x, y;
-
-	box_coords(box, &x, &y);
-
-	content_request_redraw(h, x, y,
-			box->padding[LEFT] + box->width + box->padding[RIGHT],
-			box->padding[TOP] + box->height + box->padding[BOTTOM]);
+	html__redraw_a_box((html_content *)hlcache_handle_get_content(h), box);
 }
 
 
@@ -1118,11 +1137,21 @@ void html__redraw_a_box(struct html_content *html, struct box *box)
 
 	box_coords(box, &x, &y);
 
-	content__request_redraw((struct content *)html, x, y,
+	html__request_redraw(html, x, y,
 			box->padding[LEFT] + box->width + box->padding[RIGHT],
 			box->padding[TOP] + box->height + box->padding[BOTTOM]);
 }
 
+
+/* exported function documented in html/private.h */
+void html__request_redraw(html_content *htmlc,
+		int x, int y, int width, int height)
+{
+	display_list_invalidate(htmlc->display_list, x, y, width, height);
+
+	content__request_redraw((struct content *)htmlc, x, y, width, height);
+}
+
 static void html_destroy_frameset(struct content_html_frames *frameset)
 {
 	int i;
@@ -1172,9 +1201,22 @@ static void html_destroy_iframe(struct content_html_iframe *iframe)
 
 static void html_free_layout(html_content *htmlc)
 {
+	display_list_destroy(htmlc->display_list);
+	htmlc->display_list = NULL;
+
+	free(htmlc->hit_path.hit);
+	memset(&htmlc->hit_path, 0, sizeof(htmlc->hit_path));
+
+	/* destroying the box arena releases every box in the tree
+	 * at once
+	 */
+	box_arena_destroy(htmlc->box_arena);
+	arena_destroy(htmlc->text_arena);
+	arena_destroy(htmlc->extra_arena);
+
 	if (htmlc->bctx != NULL) {
-		/* freeing talloc context should let the entire box
-		 * set be destroyed
+		/* freeing talloc context should let everything else
+		 * belonging to the box set be destroyed
 		 */
 		talloc_free(htmlc->bctx);
 	}
@@ -1466,20 +1508,20 @@ html_get_contextual_content(struct content *c, int x, int y,
 		if (box->object)
 			data->object = box->object;
 
-		if (box->href)
-			data->link = box->href;
+		if (box_href(box))
+			data->link = box_href(box);
 
-		if (box->usemap) {
+		if (box_usemap(box)) {
 			const char *target = NULL;
-			nsurl *url = imagemap_get(html, box->usemap, box_x,
+			nsurl *url = imagemap_get(html, box_usemap(box), box_x,
 					box_y, x, y, &target);
 			/* Box might have imagemap, but no actual link area
 			 * at point */
 			if (url != NULL)
 				data->link = url;
 		}
-		if (box->gadget) {
-			switch (box->gadget->type) {
+		if (box_gadget(box)) {
+			switch (box_gadget(box)->type) {
 			case GADGET_TEXTBOX:
 			case GADGET_TEXTAREA:
 			case GADGET_PASSWORD:
@@ -1524,6 +1566,8 @@ html_scroll_at_point(struct content *c, int x, int y, int scrx, int scry)
 
 	while ((next = box_at_point(&html->unit_len_ctx, box, x, y,
 			&box_x, &box_y)) != NULL) {
+		struct form_control *gadget;
+
 		box = next;
 
 		if (box->style && css_computed_visibility(box->style) ==
@@ -1542,10 +1586,11 @@ html_scroll_at_point(struct content *c, int x, int y, int scrx, int scry)
 		}
 
 		/* Pass into textarea widget */
-		if (box->gadget && (box->gadget->type == GADGET_TEXTAREA ||
-				box->gadget->type == GADGET_PASSWORD ||
-				box->gadget->type == GADGET_TEXTBOX) &&
-				textarea_scroll(box->gadget->data.text.ta,
+		gadget = box_gadget(box);
+		if (gadget && (gadget->type == GADGET_TEXTAREA ||
+				gadget->type == GADGET_PASSWORD ||
+				gadget->type == GADGET_TEXTBOX) &&
+				textarea_scroll(gadget->data.text.ta,
 						scrx, scry) == true)
 			return true;
 
@@ -1631,7 +1676,7 @@ static void html__set_file_gadget_filename(struct content *c,
 	form_gadget_update_value(gadget, utf8_fn);
 
 	/* corestring_dom___ns_key_file_name_node_data */
-	if (dom_node_set_user_data((dom_node *)file_box->gadget->node,
+	if (dom_node_set_user_data((dom_node *)box_gadget(file_box)->node,
 				   corestring_dom___ns_key_file_name_node_data,
 				   strdup(fn), html__dom_user_data_handler,
 				   &oldfile) == DOM_NO_ERR) {
@@ -1693,8 +1738,8 @@ static bool html_drop_file_at_point(struct content *c, int x, int y, char *file)
 					x - box_x, y - box_y, file) == true)
 			return true;
 
-		if (box->gadget) {
-			switch (box->gadget->type) {
+		if (box_gadget(box)) {
+			switch (box_gadget(box)->type) {
 				case GADGET_FILE:
 					file_box = box;
 				break;
@@ -1722,7 +1767,7 @@ static bool html_drop_file_at_point(struct content *c, int x, int y, char *file)
 	/* Handle the drop */
 	if (file_box) {
 		/* File dropped on file input */
-		html__set_file_gadget_filename(c, file_box->gadget, file);
+		html__set_file_gadget_filename(c, box_gadget(file_box), file);
 
 	} else {
 		/* File dropped on text input */
@@ -1797,11 +1842,11 @@ static bool html_drop_file_at_point(struct content *c, int x, int y, char *file)
 
 		/* Simulate a click over the input box, to place caret */
 		box_coords(text_box, &bx, &by);
-		textarea_mouse_action(text_box->gadget->data.text.ta,
+		textarea_mouse_action(box_gadget(text_box)->data.text.ta,
 				BROWSER_MOUSE_PRESS_1, x - bx, y - by);
 
 		/* Paste the file as text */
-		textarea_drop_text(text_box->gadget->data.text.ta,
+		textarea_drop_text(box_gadget(text_box)->data.text.ta,
 				utf8_buff, size);
 
 		free(utf8_buff);
@@ -25,7 +25,9 @@
  */
 
 #include <assert.h>
+#include <limits.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <dom/dom.h>
@@ -72,6 +74,7 @@ static browser_pointer_shape get_pointer_shape(struct box *box, bool imagemap)
 	css_computed_style *style;
 	enum css_cursor_e cursor;
 	lwc_string **cursor_uris;
+	struct form_control *gadget = box_gadget(box);
 
 	if (box->type == BOX_FLOAT_LEFT || box->type == BOX_FLOAT_RIGHT)
 		style = box->children->style;
@@ -85,16 +88,16 @@ static browser_pointer_shape get_pointer_shape(struct box *box, bool imagemap)
 
 	switch (cursor) {
 	case CSS_CURSOR_AUTO:
-		if (box->href || (box->gadget &&
-				(box->gadget->type == GADGET_IMAGE ||
-				box->gadget->type == GADGET_SUBMIT)) ||
+		if (box_href(box) || (gadget &&
+				(gadget->type == GADGET_IMAGE ||
+				gadget->type == GADGET_SUBMIT)) ||
 				imagemap) {
 			/* link */
 			pointer = BROWSER_POINTER_POINT;
-		} else if (box->gadget &&
-				(box->gadget->type == GADGET_TEXTBOX ||
-				box->gadget->type == GADGET_PASSWORD ||
-				box->gadget->type == GADGET_TEXTAREA)) {
+		} else if (gadget &&
+				(gadget->type == GADGET_TEXTBOX ||
+				gadget->type == GADGET_PASSWORD ||
+				gadget->type == GADGET_TEXTAREA)) {
 			/* text input */
 			pointer = BROWSER_POINTER_CARET;
 		} else {
@@ -516,18 +519,20 @@ mouse_action_drag_textarea(html_content *html,
 			    int x, int y)
 {
 	struct box *box;
+	struct form_control *gadget;
 	int box_x = 0;
 	int box_y = 0;
 
 	box = html->drag_owner.textarea;
+	gadget = box_gadget(box);
 
-	assert(box->gadget != NULL);
-	assert(box->gadget->type == GADGET_TEXTAREA ||
-	       box->gadget->type == GADGET_PASSWORD ||
-	       box->gadget->type == GADGET_TEXTBOX);
+	assert(gadget != NULL);
+	assert(gadget->type == GADGET_TEXTAREA ||
+	       gadget->type == GADGET_PASSWORD ||
+	       gadget->type == GADGET_TEXTBOX);
 
 	box_coords(box, &box_x, &box_y);
-	textarea_mouse_action(box->gadget->data.text.ta,
+	textarea_mouse_action(gadget->data.text.ta,
 			      mouse,
 			      x - box_x,
 			      y - box_y);
@@ -589,7 +594,11 @@ struct mouse_action_state {
 	} html_object;
 
 	/** non html object */
-	hlcache_handle *object;
+	struct {
+		hlcache_handle *content;
+		int pos_x;
+		int pos_y;
+	} object;
 
 	/** iframe */
 	struct browser_window *iframe;
@@ -632,6 +641,74 @@ struct mouse_action_state {
 };
 
 
+/**
+ * Find the boxes at a point, reusing the last path found where it applies.
+ *
+ * Consecutive pointer positions usually fall in the area the last path
+ * was found throughout, so the box tree is only searched when the
+ * pointer leaves that area or the layout changes.
+ *
+ * \param html  html content
+ * \param x     x coordinate of the point
+ * \param y     y coordinate of the point
+ * \return NSERROR_OK and html->hit_path updated on success, or
+ *         NSERROR_NOMEM
+ */
+static nserror html_hit_path_find(html_content *html, int x, int y)
+{
+	struct html_hit_path *path = &html->hit_path;
+	struct box *box;
+	int box_x, box_y;
+
+	if (path->valid &&
+	    x >= path->area.x0 && x < path->area.x1 &&
+	    y >= path->area.y0 && y < path->area.y1) {
+		return NSERROR_OK;
+	}
+
+	path->valid = false;
+	path->count = 0;
+
+	/* the whole document, with room to move it by box offsets */
+	path->area.x0 = INT_MIN / 4;
+	path->area.y0 = INT_MIN / 4;
+	path->area.x1 = INT_MAX / 4;
+	path->area.y1 = INT_MAX / 4;
+
+	box = html->layout;
+
+	/* Consider the margins of the html page now */
+	box_x = box->margin[LEFT];
+	box_y = box->margin[TOP];
+
+	do {
+		if (path->count == path->alloc) {
+			unsigned int alloc = path->alloc ? path->alloc * 2 : 32;
+			struct html_hit *hit;
+
+			hit = realloc(path->hit, alloc * sizeof(*hit));
+			if (hit == NULL) {
+				return NSERROR_NOMEM;
+			}
+			path->hit = hit;
+			path->alloc = alloc;
+		}
+
+		path->hit[path->count].box = box;
+		path->hit[path->count].x = box_x;
+		path->hit[path->count].y = box_y;
+		path->count++;
+
+		box = box_at_point_area(&html->unit_len_ctx, box, x, y,
+				&box_x, &box_y, &path->area);
+	} while (box != NULL);
+
+	path->valid = true;
+
+	return NSERROR_OK;
+}
+
+
 /**
  * iterate the box tree for deepest node at coordinates
  *
@@ -643,6 +720,8 @@ struct mouse_action_state {
  * html_object_pos_x - html object
  * html_object_pos_y - html object
  * object - non html object
+ * object_pos_x - non html object
+ * object_pos_y - non html object
  * iframe - iframe
  * url - href or imagemap
  * target - href or imagemap or gadget
@@ -673,8 +752,11 @@ get_mouse_action_node(html_content *html,
 		      struct mouse_action_state *man)
 {
 	struct box *box;
+	struct form_control *gadget;
 	int box_x = 0;
 	int box_y = 0;
+	unsigned int i;
+	nserror res;
 
 	/* initialise the mouse action state data */
 	memset(man, 0, sizeof(struct mouse_action_state));
@@ -684,18 +766,21 @@ get_mouse_action_node(html_content *html,
 	/* search the box tree for a link, imagemap, form control, or
 	 * box with scrollbars
 	 */
-	box = html->layout;
+	res = html_hit_path_find(html, x, y);
+	if (res != NSERROR_OK) {
+		return res;
+	}
 
-	/* Consider the margins of the html page now */
-	box_x = box->margin[LEFT];
-	box_y = box->margin[TOP];
+	for (i = 0; i != html->hit_path.count; i++) {
+		box = html->hit_path.hit[i].box;
+		box_x = html->hit_path.hit[i].x;
+		box_y = html->hit_path.hit[i].y;
 
-	do {
 		/* skip hidden boxes */
 		if ((box->style != NULL) &&
 		    (css_computed_visibility(box->style) ==
 		     CSS_VISIBILITY_HIDDEN)) {
-			goto next_box;
+			continue;
 		}
 
 		if (box->node != NULL) {
@@ -708,7 +793,9 @@ get_mouse_action_node(html_content *html,
 				man->html_object.pos_x = box_x;
 				man->html_object.pos_y = box_y;
 			} else {
-				man->object = box->object;
+				man->object.content = box->object;
+				man->object.pos_x = box_x;
+				man->object.pos_y = box_y;
 			}
 		}
 
@@ -716,16 +803,16 @@ get_mouse_action_node(html_content *html,
 			man->iframe = box->iframe;
 		}
 
-		if (box->href) {
-			man->link.url = box->href;
-			man->link.target = box->target;
+		if (box_href(box)) {
+			man->link.url = box_href(box);
+			man->link.target = box_target(box);
 			man->link.box = box;
 			man->link.is_imagemap = false;
 		}
 
-		if (box->usemap) {
+		if (box_usemap(box)) {
 			man->link.url = imagemap_get(html,
-						     box->usemap,
+						     box_usemap(box),
 						     box_x,
 						     box_y,
 						     x, y,
@@ -734,18 +821,19 @@ get_mouse_action_node(html_content *html,
 			man->link.is_imagemap = true;
 		}
 
-		if (box->gadget) {
-			man->gadget.control = box->gadget;
+		gadget = box_gadget(box);
+		if (gadget) {
+			man->gadget.control = gadget;
 			man->gadget.box = box;
 			man->gadget.box_x = box_x;
 			man->gadget.box_y = box_y;
-			if (box->gadget->form) {
-				man->gadget.target = box->gadget->form->target;
+			if (gadget->form) {
+				man->gadget.target = gadget->form->target;
 			}
 		}
 
-		if (box->title) {
-			man->title = box->title;
+		if (box_title(box)) {
+			man->title = box_title(box);
 		}
 
 		man->result.pointer = get_pointer_shape(box, false);
@@ -802,14 +890,10 @@ get_mouse_action_node(html_content *html,
 			man->text.box = box;
 			man->text.box_x = box_x;
 		}
-
-	next_box:
-		/* iterate to next box */
-		box = box_at_point(&html->unit_len_ctx, box, x, y, &box_x, &box_y);
-	} while (box != NULL);
+	}
 
 	/* use of box_x, box_y, or content below this point is probably a
-	 * mistake; they will refer to the last box returned by box_at_point */
+	 * mistake; they will refer to the last box on the hit path */
 
 	assert(man->node != NULL);
 
@@ -1355,16 +1439,17 @@ mouse_action_drag_none(html_content *html,
 	} else if (mas.gadget.control) {
 		res = gadget_mouse_action(html, mouse, x, y, &mas);
 
-	} else if ((mas.object != NULL) && (mouse & BROWSER_MOUSE_MOD_2)) {
+	} else if ((mas.object.content != NULL) &&
+		   (mouse & BROWSER_MOUSE_MOD_2)) {
 
 		if (mouse & BROWSER_MOUSE_DRAG_2) {
 			msg_data.dragsave.type = CONTENT_SAVE_NATIVE;
-			msg_data.dragsave.content = mas.object;
+			msg_data.dragsave.content = mas.object.content;
 			content_broadcast(c, CONTENT_MSG_DRAGSAVE, &msg_data);
 
 		} else if (mouse & BROWSER_MOUSE_DRAG_1) {
 			msg_data.dragsave.type = CONTENT_SAVE_ORIG;
-			msg_data.dragsave.content = mas.object;
+			msg_data.dragsave.content = mas.object.content;
 			content_broadcast(c, CONTENT_MSG_DRAGSAVE, &msg_data);
 		}
 
@@ -1382,6 +1467,17 @@ mouse_action_drag_none(html_content *html,
 	} else {
 		res = default_mouse_action(html, bw, mouse, x, y, &mas);
 
+		if ((res == NSERROR_OK) &&
+		    (mas.object.content != NULL) &&
+		    (mouse & BROWSER_MOUSE_CLICK_1)) {
+			/* objects may act on a click, e.g. to start an
+			 * animation which only plays on demand */
+			content_mouse_action(mas.object.content,
+					     bw,
+					     mouse,
+					     x - mas.object.pos_x,
+					     y - mas.object.pos_y);
+		}
 	}
 	if (res != NSERROR_OK) {
 		return res;
@@ -1610,6 +1706,8 @@ void html_overflow_scroll_callback(void *client_data,
 
 	switch(scrollbar_data->msg) {
 	case SCROLLBAR_MSG_MOVED:
+		/* boxes in the scrolled box have moved */
+		html->hit_path.valid = false;
 
 		if (html->reflowing == true) {
 			/* Can't redraw during layout, and it will
@@ -1771,7 +1869,7 @@ void html_set_selection(html_content *html, html_selection_type selection_type,
 					selection_owner.textarea)
 				break;
 			box = html->selection_owner.textarea;
-			textarea_clear_selection(box->gadget->data.text.ta);
+			textarea_clear_selection(box_gadget(box)->data.text.ta);
 			break;
 		case HTML_SELECTION_CONTENT:
 			if (same_type && html->selection_owner.content ==
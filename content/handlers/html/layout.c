@@ -45,6 +45,7 @@
 
 #include "utils/log.h"
 #include "utils/talloc.h"
+#include "utils/arena.h"
 #include "utils/utils.h"
 #include "utils/nsoption.h"
 #include "utils/corestrings.h"
@@ -64,6 +65,7 @@
 #include "html/private.h"
 #include "html/box.h"
 #include "html/box_inspect.h"
+#include "html/box_manipulate.h"
 #include "html/font.h"
 #include "html/form_internal.h"
 #include "html/layout.h"
@@ -331,6 +333,29 @@ calculate_mbp_width(const css_unit_ctx *unit_len_ctx,
 }
 
 
+/**
+ * Note a positioned child, or one with positioned descendants, on a box.
+ *
+ * Relative offsets are applied to the laid out boxes in place, and absolute
+ * boxes are positioned after the main layout, so the layout of a subtree
+ * containing either may not be kept. Marking boxes as their minimum and
+ * maximum widths are found saves searching the subtree at each layout.
+ *
+ * \param  box    box to mark
+ * \param  child  child of box, with its own minimum and maximum widths
+ *                already found
+ */
+static inline void layout_minmax_positioned(struct box *box,
+		const struct box *child)
+{
+	if ((child->flags & HAS_POSITIONED) ||
+			(child->style != NULL &&
+			css_computed_position(child->style) !=
+					CSS_POSITION_STATIC))
+		box->flags |= HAS_POSITIONED;
+}
+
+
 /**
  * Calculate minimum and maximum width of a table.
  *
@@ -359,6 +384,8 @@ static void layout_minmax_table(struct box *table,
 	if (table->max_width != UNKNOWN_MAX_WIDTH)
 		return;
 
+	table->flags &= ~HAS_POSITIONED;
+
 	if (table_calculate_column_types(&content->unit_len_ctx, table) == false) {
 		NSLOG(netsurf, WARNING,
 				"Could not establish table column types.");
@@ -500,6 +527,14 @@ static void layout_minmax_table(struct box *table,
 			table_max = width;
 	}
 
+	for (row_group = table->children; row_group; row_group =row_group->next)
+	for (row = row_group->children; row; row = row->next)
+	for (cell = row->children; cell; cell = cell->next) {
+		layout_minmax_positioned(table, row_group);
+		layout_minmax_positioned(table, row);
+		layout_minmax_positioned(table, cell);
+	}
+
 	/* add margins, border, padding to min, max widths */
 	calculate_mbp_width(&content->unit_len_ctx,
 			table->style, LEFT, true, true, true,
@@ -611,6 +646,8 @@ layout_minmax_line(struct box *first,
 						content);
 			b->min_width = b->children->min_width;
 			b->max_width = b->children->max_width;
+			b->flags &= ~HAS_POSITIONED;
+			layout_minmax_positioned(b, b->children);
 			if (min < b->min_width)
 				min = b->min_width;
 			max += b->max_width;
@@ -668,7 +705,7 @@ layout_minmax_line(struct box *first,
 			continue;
 		}
 
-		if (!b->object && !(b->flags & IFRAME) && !b->gadget &&
+		if (!b->object && !(b->flags & IFRAME) && !box_gadget(b) &&
 				!(b->flags & REPLACE_DIM)) {
 			/* inline non-replaced, 10.3.1 and 10.6.1 */
 			bool no_wrap_box;
@@ -681,18 +718,19 @@ layout_minmax_line(struct box *first,
 					CSS_WHITE_SPACE_PRE);
 
 			if (b->width == UNKNOWN_WIDTH) {
+				struct form_control *select =
+						box_gadget(b->parent->parent);
+
 				/** \todo handle errors */
 
 				/* If it's a select element, we must use the
 				 * width of the widest option text */
-				if (b->parent->parent->gadget &&
-						b->parent->parent->gadget->type
-						== GADGET_SELECT) {
+				if (select != NULL &&
+						select->type == GADGET_SELECT) {
 					int opt_maxwidth = 0;
 					struct form_option *o;
 
-					for (o = b->parent->parent->gadget->
-							data.select.items; o;
+					for (o = select->data.select.items; o;
 							o = o->next) {
 						int opt_width;
 						font_func->width(&fstyle,
@@ -926,8 +964,10 @@ layout_minmax_inline_container(struct box *inline_container,
 	assert(inline_container->type == BOX_INLINE_CONTAINER);
 
 	/* check if the widths have already been calculated */
-	if (inline_container->max_width != UNKNOWN_MAX_WIDTH)
+	if (inline_container->max_width != UNKNOWN_MAX_WIDTH) {
+		*has_height = (inline_container->flags & HAS_HEIGHT);
 		return;
+	}
 
 	*has_height = false;
 
@@ -943,8 +983,16 @@ layout_minmax_inline_container(struct box *inline_container,
 		*has_height |= line_has_height;
 	}
 
+	inline_container->flags &= ~HAS_POSITIONED;
+	for (child = inline_container->children; child; child = child->next)
+		layout_minmax_positioned(inline_container, child);
+
 	inline_container->min_width = min;
 	inline_container->max_width = max;
+	if (*has_height)
+		inline_container->flags |= HAS_HEIGHT;
+	else
+		inline_container->flags &= ~HAS_HEIGHT;
 
 	assert(0 <= inline_container->min_width &&
 			inline_container->min_width <=
@@ -978,6 +1026,7 @@ static void layout_minmax_block(
 	css_unit hunit = CSS_UNIT_PX;
 	enum css_box_sizing_e bs = CSS_BOX_SIZING_CONTENT_BOX;
 	bool child_has_height = false;
+	struct form_control *gadget = box_gadget(block);
 
 	assert(block->type == BOX_BLOCK ||
 			block->type == BOX_INLINE_BLOCK ||
@@ -987,6 +1036,8 @@ static void layout_minmax_block(
 	if (block->max_width != UNKNOWN_MAX_WIDTH)
 		return;
 
+	block->flags &= ~HAS_POSITIONED;
+
 	if (block->style != NULL) {
 		wtype = css_computed_width(block->style, &width, &wunit);
 		htype = css_computed_height(block->style, &height, &hunit);
@@ -1009,10 +1060,10 @@ static void layout_minmax_block(
 		block->flags |= NEED_MIN;
 	}
 
-	if (block->gadget && (block->gadget->type == GADGET_TEXTBOX ||
-			block->gadget->type == GADGET_PASSWORD ||
-			block->gadget->type == GADGET_FILE ||
-			block->gadget->type == GADGET_TEXTAREA) &&
+	if (gadget && (gadget->type == GADGET_TEXTBOX ||
+			gadget->type == GADGET_PASSWORD ||
+			gadget->type == GADGET_FILE ||
+			gadget->type == GADGET_TEXTAREA) &&
 			block->style && wtype == CSS_WIDTH_AUTO) {
 		css_fixed size = INTTOFIX(10);
 		css_unit unit = CSS_UNIT_EM;
@@ -1023,8 +1074,8 @@ static void layout_minmax_block(
 		block->flags |= HAS_HEIGHT;
 	}
 
-	if (block->gadget && (block->gadget->type == GADGET_RADIO ||
-			block->gadget->type == GADGET_CHECKBOX) &&
+	if (gadget && (gadget->type == GADGET_RADIO ||
+			gadget->type == GADGET_CHECKBOX) &&
 			block->style && wtype == CSS_WIDTH_AUTO) {
 		css_fixed size = INTTOFIX(1);
 		css_unit unit = CSS_UNIT_EM;
@@ -1087,6 +1138,8 @@ static void layout_minmax_block(
 			}
 			assert(child->max_width != UNKNOWN_MAX_WIDTH);
 
+			layout_minmax_positioned(block, child);
+
 			if (child->style &&
 					(css_computed_position(child->style) ==
 							CSS_POSITION_ABSOLUTE ||
@@ -2013,6 +2066,41 @@ static void layout_move_children(struct box *box, int x, int y)
 }
 
 
+/**
+ * Find whether the previous layout of a box may be kept.
+ *
+ * \param  box      inline container or table
+ * \param  width    width available to the box now
+ * \param  content  content being laid out
+ * \return  true if the box may be left as it is
+ */
+static bool layout_reusable(struct box *box, int width,
+		html_content *content)
+{
+	if (!content->layout_reuse ||
+			(box->flags & NEEDS_LAYOUT) ||
+			box->layout_width == UNKNOWN_WIDTH ||
+			box->layout_width != width)
+		return false;
+
+	/* set as the minimum and maximum widths were found */
+	return !(box->flags & HAS_POSITIONED);
+}
+
+
+/**
+ * Record the layout of a box as one that may be kept.
+ *
+ * \param  box    inline container or table that has been laid out
+ * \param  width  width available to the box
+ */
+static inline void layout_done(struct box *box, int width)
+{
+	box->layout_width = width;
+	box->flags &= ~NEEDS_LAYOUT;
+}
+
+
 /**
  * Layout a table.
  *
@@ -2057,6 +2145,13 @@ static bool layout_table(struct box *table, int available_width,
 	assert(table->children && table->children->children);
 	assert(columns);
 
+	/* A percentage height depends on the containing block, which may
+	 * have changed even though the table has not. */
+	htype = css_computed_height(style, &value, &unit);
+	if (!(htype == CSS_HEIGHT_SET && unit == CSS_UNIT_PCT) &&
+			layout_reusable(table, available_width, content))
+		return true;
+
 	/* allocate working buffers */
 	col = malloc(columns * sizeof col[0]);
 	excess_y = malloc(columns * sizeof excess_y[0]);
@@ -2583,6 +2678,8 @@ static bool layout_table(struct box *table, int available_width,
 	table->width = table_width;
 	table->height = table_height;
 
+	layout_done(table, available_width);
+
 	return true;
 }
 
@@ -2809,10 +2906,16 @@ layout_text_box_split(html_content *content,
 	if (!space)
 		space_width = 0;
 
-	/* Create clone of split_box, c2 */
-	c2 = talloc_memdup(content->bctx, split_box, sizeof *c2);
-	if (!c2)
-		return false;
+	/* Create clone of split_box, c2, reusing a spare one if possible */
+	if (content->spare_clones != NULL) {
+		c2 = content->spare_clones;
+		content->spare_clones = c2->next;
+	} else {
+		c2 = arena_alloc(content->box_arena, sizeof *c2);
+		if (!c2)
+			return false;
+	}
+	memcpy(c2, split_box, sizeof *c2);
 	c2->flags |= CLONE;
 
 	/* Set remaining text in c2 */
@@ -2877,6 +2980,7 @@ layout_float_find_dimensions(
 	int *margin = box->margin;
 	int *padding = box->padding;
 	struct box_border *border = box->border;
+	struct form_control *gadget = gadget;
 	enum css_overflow_e overflow_x = css_computed_overflow_x(style);
 	enum css_overflow_e overflow_y = css_computed_overflow_y(style);
 	int scrollbar_width_x =
@@ -2897,7 +3001,7 @@ layout_float_find_dimensions(
 	if (margin[RIGHT] == AUTO)
 		margin[RIGHT] = 0;
 
-	if (box->gadget == NULL) {
+	if (gadget == NULL) {
 		padding[RIGHT] += scrollbar_width_y;
 		padding[BOTTOM] += scrollbar_width_x;
 	}
@@ -2908,10 +3012,10 @@ layout_float_find_dimensions(
 		 * See 10.3.6 and 10.6.2 */
 		layout_get_object_dimensions(box, &width, &height,
 				min_width, max_width, min_height, max_height);
-	} else if (box->gadget && (box->gadget->type == GADGET_TEXTBOX ||
-			box->gadget->type == GADGET_PASSWORD ||
-			box->gadget->type == GADGET_FILE ||
-			box->gadget->type == GADGET_TEXTAREA)) {
+	} else if (gadget && (gadget->type == GADGET_TEXTBOX ||
+			gadget->type == GADGET_PASSWORD ||
+			gadget->type == GADGET_FILE ||
+			gadget->type == GADGET_TEXTAREA)) {
 		css_fixed size = 0;
 		css_unit unit = CSS_UNIT_EM;
 
@@ -2919,16 +3023,16 @@ layout_float_find_dimensions(
 		 * that don't shrink to fit contained text. */
 		assert(box->style);
 
-		if (box->gadget->type == GADGET_TEXTBOX ||
-				box->gadget->type == GADGET_PASSWORD ||
-				box->gadget->type == GADGET_FILE) {
+		if (gadget->type == GADGET_TEXTBOX ||
+				gadget->type == GADGET_PASSWORD ||
+				gadget->type == GADGET_FILE) {
 			if (width == AUTO) {
 				size = INTTOFIX(10);
 				width = FIXTOINT(css_unit_len2device_px(
 						box->style, unit_len_ctx,
 						size, unit));
 			}
-			if (box->gadget->type == GADGET_FILE &&
+			if (gadget->type == GADGET_FILE &&
 					height == AUTO) {
 				size = FLTTOFIX(1.5);
 				height = FIXTOINT(css_unit_len2device_px(
@@ -2936,7 +3040,7 @@ layout_float_find_dimensions(
 						size, unit));
 			}
 		}
-		if (box->gadget->type == GADGET_TEXTAREA) {
+		if (gadget->type == GADGET_TEXTAREA) {
 			if (width == AUTO) {
 				size = INTTOFIX(10);
 				width = FIXTOINT(css_unit_len2device_px(
@@ -3191,7 +3295,7 @@ layout_line(struct box *first,
 	/* get minimum line height from containing block.
 	 * this is the line-height if there are text children and also in the
 	 * case of an initially empty text input */
-	if (has_text_children || first->parent->parent->gadget)
+	if (has_text_children || box_gadget(first->parent->parent))
 		used_height = height = line_height(&content->unit_len_ctx,
 				first->parent->parent->style);
 	else
@@ -3288,7 +3392,7 @@ layout_line(struct box *first,
 			continue;
 		}
 
-		if (!b->object && !(b->flags & IFRAME) && !b->gadget &&
+		if (!b->object && !(b->flags & IFRAME) && !box_gadget(b) &&
 				!(b->flags & REPLACE_DIM)) {
 			/* inline non-replaced, 10.3.1 and 10.6.1 */
 			b->height = line_height(&content->unit_len_ctx,
@@ -3304,18 +3408,19 @@ layout_line(struct box *first,
 			}
 
 			if (b->width == UNKNOWN_WIDTH) {
+				struct form_control *select =
+						box_gadget(b->parent->parent);
+
 				/** \todo handle errors */
 
 				/* If it's a select element, we must use the
 				 * width of the widest option text */
-				if (b->parent->parent->gadget &&
-						b->parent->parent->gadget->type
-						== GADGET_SELECT) {
+				if (select != NULL &&
+						select->type == GADGET_SELECT) {
 					int opt_maxwidth = 0;
 					struct form_option *o;
 
-					for (o = b->parent->parent->gadget->
-							data.select.items; o;
+					for (o = select->data.select.items; o;
 							o = o->next) {
 						int opt_width;
 						font_func->width(&fstyle,
@@ -3637,7 +3742,7 @@ layout_line(struct box *first,
 		    !split_box->object &&
 		    !(split_box->flags & REPLACE_DIM) &&
 		    !(split_box->flags & IFRAME) &&
-		    !split_box->gadget && split_box->text) {
+		    !box_gadget(split_box) && split_box->text) {
 
 			font_plot_style_from_css(&content->unit_len_ctx,
 					split_box->style, &fstyle);
@@ -3791,7 +3896,7 @@ layout_line(struct box *first,
 			d->y = *y;
 			continue;
 		} else if ((d->type == BOX_INLINE &&
-				((d->object || d->gadget) == false) &&
+				((d->object || box_gadget(d)) == false) &&
 				!(d->flags & IFRAME) &&
 				!(d->flags & REPLACE_DIM)) ||
 				d->type == BOX_BR ||
@@ -3869,6 +3974,47 @@ layout_line(struct box *first,
 }
 
 
+/**
+ * Join text boxes split by a previous layout back together.
+ *
+ * Each clone made by layout_text_box_split() is merged back into the box
+ * it was split from and kept for reuse, so the lines of the inline
+ * container can be laid out again without the box list growing.
+ *
+ * \param  inline_container  box of type INLINE_CONTAINER
+ * \param  content	      content being laid out
+ */
+static void
+layout_inline_container_unsplit(struct box *inline_container,
+		html_content *content)
+{
+	struct box *b, *c;
+
+	for (b = inline_container->children; b != NULL; b = b->next) {
+		if (b->text == NULL || b->object != NULL)
+			continue;
+
+		while ((c = b->next) != NULL && (c->flags & CLONE) &&
+				c->text >= b->text + b->length &&
+				c->text <= b->text + b->length + 1) {
+			b->length = c->text + c->length - b->text;
+			b->space = c->space;
+			b->width = UNKNOWN_WIDTH;
+			b->flags &= ~MEASURED;
+
+			b->next = c->next;
+			if (c->next != NULL)
+				c->next->prev = b;
+			else
+				inline_container->last = b;
+
+			c->next = content->spare_clones;
+			content->spare_clones = c;
+		}
+	}
+}
+
+
 /**
  * Layout lines of text or inline boxes with floats.
  *
@@ -3899,6 +4045,7 @@ static bool layout_inline_container(struct box *inline_container, int width,
 	      cx,
 	      cy);
 
+	layout_inline_container_unsplit(inline_container, content);
 
 	has_text_children = false;
 	for (c = inline_container->children; c; c = c->next) {
@@ -3969,6 +4116,7 @@ layout_block_context(struct box *block,
 	int lm, rm;
 	struct box *margin_collapse = NULL;
 	bool in_margin = false;
+	struct form_control *gadget = box_gadget(block);
 	css_fixed gadget_size;
 	css_unit gadget_unit; /* Checkbox / radio buttons */
 
@@ -3981,6 +4129,7 @@ layout_block_context(struct box *block,
 	block->float_children = NULL;
 	block->cached_place_below_level = 0;
 	block->clear_level = 0;
+	block->flags &= ~NEEDS_LAYOUT;
 
 	/* special case if the block contains an object */
 	if (block->object) {
@@ -3996,8 +4145,8 @@ layout_block_context(struct box *block,
 	}
 
 	/* special case if the block contains an radio button or checkbox */
-	if (block->gadget && (block->gadget->type == GADGET_RADIO ||
-			block->gadget->type == GADGET_CHECKBOX)) {
+	if (gadget && (gadget->type == GADGET_RADIO ||
+			gadget->type == GADGET_CHECKBOX)) {
 		/* form checkbox or radio button
 		 * if width or height is AUTO, set it to 1em */
 		gadget_unit = CSS_UNIT_EM;
@@ -4238,10 +4387,21 @@ layout_block_context(struct box *block,
 				return false;
 
 		} else if (box->type == BOX_INLINE_CONTAINER) {
-			box->width = box->parent->width;
-			if (!layout_inline_container(box, box->width, block,
-					cx, cy, content))
-				return false;
+			/* Without floats in this block context, the lines of
+			 * an unchanged inline container depend only on its
+			 * width. */
+			if (block->float_children == NULL &&
+					layout_reusable(box, box->parent->width,
+							content)) {
+				NSLOG(layout, DEEPDEBUG, "reusing %p", box);
+			} else {
+				box->width = box->parent->width;
+				if (!layout_inline_container(box, box->width,
+						block, cx, cy, content))
+					return false;
+				layout_done(box, block->float_children == NULL ?
+						box->width : UNKNOWN_WIDTH);
+			}
 
 		} else if (box->type == BOX_TABLE) {
 			/* Move down to avoid floats if necessary. */
@@ -4422,10 +4582,10 @@ layout_block_context(struct box *block,
 		layout_apply_minmax_height(&content->unit_len_ctx, block, NULL);
 	}
 
-	if (block->gadget &&
-			(block->gadget->type == GADGET_TEXTAREA ||
-			block->gadget->type == GADGET_PASSWORD ||
-			block->gadget->type == GADGET_TEXTBOX)) {
+	if (gadget &&
+			(gadget->type == GADGET_TEXTAREA ||
+			gadget->type == GADGET_PASSWORD ||
+			gadget->type == GADGET_TEXTBOX)) {
 		plot_font_style_t fstyle;
 		int ta_width = block->padding[LEFT] + block->width +
 				block->padding[RIGHT];
@@ -4434,7 +4594,7 @@ layout_block_context(struct box *block,
 		font_plot_style_from_css(&content->unit_len_ctx,
 				block->style, &fstyle);
 		fstyle.background = NS_TRANSPARENT;
-		textarea_set_layout(block->gadget->data.text.ta,
+		textarea_set_layout(gadget->data.text.ta,
 				&fstyle, ta_width, ta_height,
 				block->padding[TOP], block->padding[RIGHT],
 				block->padding[BOTTOM], block->padding[LEFT]);
@@ -4647,7 +4807,7 @@ layout__get_list_item_count(
 			}
 
 			if (child_box != NULL &&
-			    child_box->list_marker != NULL) {
+			    box_list_marker(child_box) != NULL) {
 				count++;
 			}
 		}
@@ -4728,9 +4888,9 @@ layout__ordered_list_count(
 			}
 
 			if (child_box != NULL &&
-			    child_box->list_marker != NULL) {
+			    box_list_marker(child_box) != NULL) {
 				dom_long value;
-				struct box *marker = child_box->list_marker;
+				struct box *marker = box_list_marker(child_box);
 				if (layout__get_li_value(child, &value)) {
 					marker->list_value = value;
 					next = marker->list_value;
@@ -4762,7 +4922,7 @@ layout__set_numerical_marker_text(
 		const html_content *content,
 		struct box *box)
 {
-	struct box *marker = box->list_marker;
+	struct box *marker = box_list_marker(box);
 	size_t counter_len;
 	css_error css_res;
 	enum {
@@ -4836,8 +4996,8 @@ layout_lists(const html_content *content, struct box *box)
 	layout__ordered_list_count(box);
 
 	for (child = box->children; child; child = child->next) {
-		if (child->list_marker) {
-			struct box *marker = child->list_marker;
+		if (box_list_marker(child)) {
+			struct box *marker = box_list_marker(child);
 
 			if (layout__list_item_is_numerical(child)) {
 				if (marker->text == NULL) {
@@ -5737,6 +5897,9 @@ static void layout_calculate_descendant_bboxes(
 	assert(box->height != AUTO);
 	/* assert((box->width >= 0) && (box->height >= 0)); */
 
+	/* Children may have moved; any index of them is rebuilt below */
+	box_index_free(box);
+
 	/* Initialise box's descendant box to border edge box */
 	layout_get_box_bbox(unit_len_ctx, box,
 			&box->descendant_x0, &box->descendant_y0,
@@ -5810,26 +5973,108 @@ static void layout_calculate_descendant_bboxes(
 		layout_update_descendant_bbox(unit_len_ctx, box, child, 0, 0);
 	}
 
-	if (box->list_marker) {
-		child = box->list_marker;
+	if (box_list_marker(box)) {
+		child = box_list_marker(box);
 		layout_calculate_descendant_bboxes(unit_len_ctx, child);
 
 		layout_update_descendant_bbox(unit_len_ctx, box, child, 0, 0);
 	}
+
+	/* Without an index redraw visits every child, so failure is fine */
+	if (box_index_children(box) != NSERROR_OK) {
+		NSLOG(netsurf, INFO, "Unable to index children of box %p",
+				box);
+	}
+}
+
+
+/** Computed style lengths that can affect minimum and maximum widths. */
+static const css_len_func minmax_len_funcs[] = {
+	css_computed_width,
+	css_computed_min_width,
+	css_computed_max_width,
+	css_computed_margin_left,
+	css_computed_margin_right,
+	css_computed_padding_left,
+	css_computed_padding_right,
+	css_computed_border_left_width,
+	css_computed_border_right_width,
+	css_computed_text_indent,
+	css_computed_letter_spacing,
+	css_computed_word_spacing,
+	css_computed_font_size,
+};
+
+
+/**
+ * Invalidate minimum and maximum widths that depend on the viewport size.
+ *
+ * \param  box  top of tree of boxes
+ * \return  true if any box in the tree uses viewport-relative lengths
+ */
+static bool layout_minmax_invalidate_viewport(struct box *box)
+{
+	bool found = false;
+	struct box *c;
+	size_t i;
+
+	if (box->style != NULL) {
+		for (i = 0; i < sizeof(minmax_len_funcs) /
+				sizeof(minmax_len_funcs[0]); i++) {
+			css_fixed value = 0;
+			css_unit unit = CSS_UNIT_PX;
+
+			minmax_len_funcs[i](box->style, &value, &unit);
+			if (unit == CSS_UNIT_VW || unit == CSS_UNIT_VH ||
+					unit == CSS_UNIT_VMIN ||
+					unit == CSS_UNIT_VMAX) {
+				found = true;
+				break;
+			}
+		}
+	}
+
+	for (c = box->children; c != NULL; c = c->next) {
+		if (layout_minmax_invalidate_viewport(c))
+			found = true;
+	}
+
+	if (found)
+		box->max_width = UNKNOWN_MAX_WIDTH;
+
+	return found;
 }
 
 
 /* exported function documented in html/layout.h */
-bool layout_document(html_content *content, int width, int height)
+bool layout_document(html_content *content, int width, int height,
+		bool incremental)
 {
 	bool ret;
 	struct box *doc = content->layout;
 	const struct gui_layout_table *font_func = content->font_func;
 
-	NSLOG(layout, DEBUG, "Doing layout to %ix%i of %s",
+	NSLOG(layout, DEBUG, "Doing %s layout to %ix%i of %s",
+			incremental ? "incremental" : "full",
 			width, height, nsurl_access(content_get_url(
 					&content->base)));
 
+	content->layout_reuse = incremental;
+
+	/* The minimum and maximum widths are kept from previous layouts
+	 * unless the viewport size they were found with has changed and
+	 * the document has lengths relative to it. */
+	if (content->minmax_viewport_units &&
+			(content->minmax_viewport_width !=
+				content->unit_len_ctx.viewport_width ||
+			 content->minmax_viewport_height !=
+				content->unit_len_ctx.viewport_height)) {
+		content->minmax_viewport_units =
+				layout_minmax_invalidate_viewport(doc);
+	}
+	content->minmax_viewport_width = content->unit_len_ctx.viewport_width;
+	content->minmax_viewport_height = content->unit_len_ctx.viewport_height;
+
 	layout_minmax_block(doc, font_func, content);
 
 	layout_block_find_dimensions(&content->unit_len_ctx,
@@ -5870,5 +6115,17 @@ bool layout_document(html_content *content, int width, int height)
 
 	layout_calculate_descendant_bboxes(&content->unit_len_ctx, doc);
 
+	content->layout_reuse = false;
+
 	return ret;
 }
+
+
+/* exported function documented in html/layout.h */
+void layout_invalidate(struct box *box)
+{
+	for (; box != NULL; box = box->parent) {
+		box->flags |= NEEDS_LAYOUT;
+		box->max_width = UNKNOWN_MAX_WIDTH;
+	}
+}
@@ -23,6 +23,11 @@
  * The main interface to the layout code is layout_document(), which takes a
  * normalized box tree and assigns coordinates and dimensions to the boxes, and
  * also adds boxes to the tree (eg. when formatting lines of text).
+ *
+ * Boxes whose size may have changed since the last layout are marked with
+ * layout_invalidate(). An incremental layout then lays out those boxes
+ * again and repositions the boxes around them, but keeps the lines of
+ * unchanged inline containers and the cells of unchanged tables.
  */
 
 #ifndef NETSURF_HTML_LAYOUT_H
@@ -35,11 +40,28 @@ struct gui_layout_table;
 /**
  * Calculate positions of boxes in a document.
  *
+ * An incremental layout must be to the same width and height as the
+ * previous layout of the document, with nothing but the boxes passed to
+ * layout_invalidate() changed since.
+ *
  * \param content content of type CONTENT_HTML
  * \param width available width
  * \param height available height
+ * \param incremental whether the layout of unchanged boxes may be reused
  * \return true on success, false on memory exhaustion
  */
-bool layout_document(struct html_content *content, int width, int height);
+bool layout_document(struct html_content *content, int width, int height,
+		bool incremental);
+
+/**
+ * Mark a box as needing layout.
+ *
+ * The box and all its ancestors will be laid out again by the next
+ * layout of the document, and their minimum and maximum widths found
+ * again.
+ *
+ * \param box box whose size or content has changed
+ */
+void layout_invalidate(struct box *box);
 
 #endif
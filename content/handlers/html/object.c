@@ -45,7 +45,10 @@
 #include "html/interaction.h"
 #include "html/box.h"
 #include "html/box_inspect.h"
+#include "html/box_manipulate.h"
 #include "html/object.h"
+#include "html/layout.h"
+#include "html/display_list.h"
 
 /* break reference loop */
 static void html_object_refresh(void *p);
@@ -89,12 +92,11 @@ html_object_failed(struct box *box, html_content *content, bool background)
  */
 
 static void
-html_object_done(struct box *box,
+html_object_done(html_content *c,
+		 struct box *box,
 		 hlcache_handle *object,
 		 bool background)
 {
-	struct box *b;
-
 	if (background) {
 		box->background = object;
 		return;
@@ -113,15 +115,17 @@ html_object_done(struct box *box,
 	}
 
 	if (!(box->flags & REPLACE_DIM)) {
-		/* invalidate parent min, max widths */
-		for (b = box; b; b = b->parent)
-			b->max_width = UNKNOWN_MAX_WIDTH;
+		/* invalidate layout and min, max widths */
+		layout_invalidate(box);
 
 		/* delete any clones of this box */
 		while (box->next && (box->next->flags & CLONE)) {
 			/* box_free_box(box->next); */
 			box->next = box->next->next;
 		}
+		if (box->parent)
+			box_index_free(box->parent);
+		c->hit_path.valid = false;
 	}
 }
 
@@ -163,6 +167,7 @@ html_object_callback(hlcache_handle *object,
 	html_content *c = (html_content *) o->parent;
 	int x, y;
 	struct box *box;
+	bool partial = false;
 
 	box = o->box;
 
@@ -171,7 +176,7 @@ html_object_callback(hlcache_handle *object,
 		if (c->base.status != CONTENT_STATUS_LOADING && c->bw != NULL)
 			content_open(object,
 					c->bw, &c->base,
-					box->object_params);
+					box_object_params(box));
 		break;
 
 	case CONTENT_MSG_READY:
@@ -184,12 +189,14 @@ html_object_callback(hlcache_handle *object,
 							box->height : 0);
 
 			/* Adjust parent content for new object size */
-			html_object_done(box, object, o->background);
+			html_object_done(c, box, object, o->background);
 			if (c->base.status == CONTENT_STATUS_READY ||
-					c->base.status == CONTENT_STATUS_DONE)
+					c->base.status == CONTENT_STATUS_DONE) {
+				c->reflow_incremental = true;
 				content__reformat(&c->base, false,
 						c->base.available_width,
 						c->base.available_height);
+			}
 		}
 		break;
 
@@ -197,7 +204,7 @@ html_object_callback(hlcache_handle *object,
 		c->base.active--;
 		NSLOG(netsurf, INFO, "%d fetches active", c->base.active);
 
-		html_object_done(box, object, o->background);
+		html_object_done(c, box, object, o->background);
 
 		if (c->base.status != CONTENT_STATUS_LOADING &&
 				box->flags & REPLACE_DIM) {
@@ -217,11 +224,27 @@ html_object_callback(hlcache_handle *object,
 			data.redraw.width = box->width;
 			data.redraw.height = box->height;
 
+			display_list_invalidate(c->display_list,
+					data.redraw.x, data.redraw.y,
+					data.redraw.width, data.redraw.height);
+
 			content_broadcast(&c->base, CONTENT_MSG_REDRAW, &data);
 		}
 		break;
 
 	case CONTENT_MSG_ERROR:
+		/* detach an object which was displayed while loading */
+		if (box != NULL) {
+			if (o->background && box->background == object) {
+				box->background = NULL;
+			} else if (!o->background && box->object == object) {
+				box->object = NULL;
+				layout_invalidate(box);
+			}
+		}
+
+		/* recorded redraws may refer to the object */
+		display_list_invalidate_all(c->display_list);
 		hlcache_handle_release(object);
 
 		o->content = NULL;
@@ -234,6 +257,16 @@ html_object_callback(hlcache_handle *object,
 		break;
 
 	case CONTENT_MSG_REDRAW:
+		if ((box != NULL) &&
+		    (content_get_status(object) == CONTENT_STATUS_LOADING) &&
+		    ((o->background ? box->background : box->object) == NULL)) {
+			/* object is displayable before it has finished
+			 * loading, such as a progressively decoded image
+			 */
+			html_object_done(c, box, object, o->background);
+			partial = true;
+		}
+
 		if (c->base.status != CONTENT_STATUS_LOADING) {
 			union content_msg_data data = event->data;
 
@@ -246,6 +279,17 @@ html_object_callback(hlcache_handle *object,
 
 			box_coords(box, &x, &y);
 
+			if (partial) {
+				/* the box was recorded without the object */
+				display_list_invalidate(c->display_list, x, y,
+						box->padding[LEFT] +
+						box->width +
+						box->padding[RIGHT],
+						box->padding[TOP] +
+						box->height +
+						box->padding[BOTTOM]);
+			}
+
 			if (object == box->background) {
 				/* Redraw request is for background */
 				css_fixed hpos = 0, vpos = 0;
@@ -324,23 +368,30 @@ html_object_callback(hlcache_handle *object,
 				if (w != 0 && box->width != w) {
 					/* Not showing image at intrinsic
 					 * width; need to scale the redraw
-					 * request area. */
+					 * request area, rounding outwards
+					 * so no changed pixel is missed. */
+					int x1 = data.redraw.x +
+							data.redraw.width;
+
 					data.redraw.x = data.redraw.x *
 							box->width / w;
-					data.redraw.width =
-							data.redraw.width *
-							box->width / w;
+					data.redraw.width = (x1 * box->width +
+							w - 1) / w -
+							data.redraw.x;
 				}
 
-				if (h != 0 && box->height != w) {
+				if (h != 0 && box->height != h) {
 					/* Not showing image at intrinsic
 					 * height; need to scale the redraw
 					 * request area. */
+					int y1 = data.redraw.y +
+							data.redraw.height;
+
 					data.redraw.y = data.redraw.y *
 							box->height / h;
-					data.redraw.height =
-							data.redraw.height *
-							box->height / h;
+					data.redraw.height = (y1 * box->height +
+							h - 1) / h -
+							data.redraw.y;
 				}
 
 				data.redraw.x += x + box->padding[LEFT];
@@ -479,18 +530,20 @@ html_object_callback(hlcache_handle *object,
 	     event->type == CONTENT_MSG_DONE ||
 	     event->type == CONTENT_MSG_ERROR)) {
 		/* all objects have arrived */
+		c->reflow_incremental = true;
 		content__reformat(&c->base, false, c->base.available_width,
 				c->base.available_height);
 		content_set_done(&c->base);
 	} else if (nsoption_bool(incremental_reflow) &&
-		   event->type == CONTENT_MSG_DONE &&
+		   (event->type == CONTENT_MSG_DONE || partial) &&
 		   box != NULL &&
 		   !(box->flags & REPLACE_DIM) &&
 		   (c->base.status == CONTENT_STATUS_READY ||
 		    c->base.status == CONTENT_STATUS_DONE)) {
 		/* 1) the configuration option to reflow pages while
 		 *      objects are fetched is set
-		 * 2) an object is newly fetched & converted,
+		 * 2) an object is newly fetched & converted, or has
+		 *      become displayable while loading,
 		 * 3) the box's dimensions need to change due to being replaced
 		 * 4) the object's parent HTML is ready for reformat,
 		 */
@@ -502,6 +555,7 @@ html_object_callback(hlcache_handle *object,
 			 *  between reformats so reformat the page to
 			 *  display newly fetched objects
 			 */
+			c->reflow_incremental = true;
 			content__reformat(&c->base,
 					  false,
 					  c->base.available_width,
@@ -543,6 +597,7 @@ static bool html_replace_object(struct content_html_object *object, nsurl *url)
 			      c->base.active);
 		}
 
+		display_list_invalidate_all(c->display_list);
 		hlcache_handle_release(object->content);
 		object->content = NULL;
 
@@ -611,7 +666,7 @@ nserror html_object_open_objects(html_content *html, struct browser_window *bw)
 		content_open(object->content,
 			     bw,
 			     &html->base,
-			     object->box->object_params);
+			     box_object_params(object->box));
 	}
 	return NSERROR_OK;
 }
@@ -643,6 +698,7 @@ nserror html_object_abort_objects(html_content *htmlc)
 
 		default:
 			hlcache_handle_abort(object->content);
+			display_list_invalidate_all(htmlc->display_list);
 			hlcache_handle_release(object->content);
 			object->content = NULL;
 			if (object->box != NULL) {
@@ -686,6 +742,8 @@ nserror html_object_close_objects(html_content *html)
 /* exported interface documented in html/object.h */
 nserror html_object_free_objects(html_content *html)
 {
+	display_list_invalidate_all(html->display_list);
+
 	while (html->object_list != NULL) {
 		struct content_html_object *victim = html->object_list;
 
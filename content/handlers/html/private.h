@@ -35,6 +35,8 @@ struct gui_layout_table;
 struct scrollbar_msg_data;
 struct content_redraw_data;
 struct selection;
+struct arena;
+struct display_list;
 
 typedef enum {
 	HTML_DRAG_NONE,			/** No drag */
@@ -87,6 +89,26 @@ union html_focus_owner {
 	struct box *content;
 };
 
+/**
+ * Boxes found at a point, in the order box_at_point() finds them.
+ */
+struct html_hit_path {
+	/** Whether the path is for the current layout and scroll offsets */
+	bool valid;
+	/** Area of the document throughout which the same boxes are found */
+	struct rect area;
+	/** Number of boxes on the path */
+	unsigned int count;
+	/** Number of boxes there is space for */
+	unsigned int alloc;
+	/** Boxes on the path, with their global document coordinates */
+	struct html_hit {
+		struct box *box;
+		int x;
+		int y;
+	} *hit;
+};
+
 /**
  * Data specific to CONTENT_HTML.
  */
@@ -124,6 +146,27 @@ typedef struct html_content {
 	/** Whether an initial layout has been done */
 	bool had_initial_layout;
 
+	/** Whether the next reflow only follows changes to object boxes */
+	bool reflow_incremental;
+
+	/** Whether the layout in progress may reuse unchanged boxes */
+	bool layout_reuse;
+
+	/** Viewport width of the previous layout */
+	int reflow_width;
+
+	/** Viewport height of the previous layout */
+	int reflow_height;
+
+	/** Whether the document may have viewport-relative lengths */
+	bool minmax_viewport_units;
+
+	/** Viewport width the cached minimum and maximum widths used */
+	css_fixed minmax_viewport_width;
+
+	/** Viewport height the cached minimum and maximum widths used */
+	css_fixed minmax_viewport_height;
+
 	/** Whether scripts are enabled for this content */
 	bool enable_scripting;
 
@@ -132,12 +175,24 @@ typedef struct html_content {
 
 	/** A talloc context purely for the render box tree */
 	int *bctx;
+	/** Arena the boxes of the render box tree are allocated from */
+	struct arena *box_arena;
+	/** Arena the text of the render box tree is allocated from */
+	struct arena *text_arena;
+	/** Arena the rarely used data of boxes is allocated from */
+	struct arena *extra_arena;
+	/** Text box clones left over from previous layouts, for reuse */
+	struct box *spare_clones;
 	/** A context pointer for the box conversion, NULL if no conversion
 	 * is in progress.
 	 */
 	void *box_conversion_context;
 	/** Box tree, or NULL. */
 	struct box *layout;
+	/** Display list of the box tree, or NULL */
+	struct display_list *display_list;
+	/** Boxes at the pointer found by the last mouse action */
+	struct html_hit_path hit_path;
 	/** Document background colour. */
 	colour background_colour;
 
@@ -228,6 +283,20 @@ extern bool html_redraw_debug;
  */
 void html__redraw_a_box(html_content *htmlc, struct box *box);
 
+/**
+ * Request a redraw of an area of the document.
+ *
+ * Any display list of the area is invalidated first.
+ *
+ * \param htmlc   HTML content
+ * \param x       left of the area, in document coordinates
+ * \param y       top of the area, in document coordinates
+ * \param width   width of the area
+ * \param height  height of the area
+ */
+void html__request_redraw(html_content *htmlc,
+		int x, int y, int width, int height);
+
 
 /**
  * Complete conversion of an HTML document
@@ -63,10 +63,37 @@
 #include "html/form_internal.h"
 #include "html/private.h"
 #include "html/layout.h"
+#include "html/display_list.h"
 
 
 bool html_redraw_debug = false;
 
+/**
+ * Redraw an object, or record its redraw in a display list.
+ *
+ * A recorded object is redrawn when the display list is replayed, so
+ * recording always reports failure; anything drawn in its place must
+ * be followed by display_list_record_fallback_end().
+ *
+ * \param h     object to redraw
+ * \param data  redraw data for the object
+ * \param clip  clip rectangle for the object
+ * \param ctx   current redraw context
+ * \return true if the object was redrawn, false otherwise
+ */
+static bool html_redraw_content(struct hlcache_handle *h,
+		const struct content_redraw_data *data,
+		const struct rect *clip,
+		const struct redraw_context *ctx)
+{
+	if (display_list_recording(ctx)) {
+		display_list_record_content(ctx, h, data, clip);
+		return false;
+	}
+
+	return content_redraw(h, data, clip, ctx);
+}
+
 /**
  * Determine if a box has a background that needs drawing
  *
@@ -547,8 +574,8 @@ static bool html_redraw_file(int x, int y, int width, int height,
 	font_plot_style_from_css(unit_len_ctx, box->style, &fstyle);
 	fstyle.background = background_colour;
 
-	if (box->gadget->value) {
-		text = box->gadget->value;
+	if (box_gadget(box)->value) {
+		text = box_gadget(box)->value;
 	} else {
 		text = messages_get("Form_Drop");
 	}
@@ -791,7 +818,7 @@ static bool html_redraw_background(int x, int y, struct box *box, float scale,
 				bg_data.repeat_y = repeat_y;
 
 				/* We just continue if redraw fails */
-				content_redraw(background->background,
+				html_redraw_content(background->background,
 						&bg_data, &r, ctx);
 			}
 		}
@@ -951,7 +978,7 @@ static bool html_redraw_inline_background(int x, int y, struct box *box,
 			bg_data.repeat_y = repeat_y;
 
 			/* We just continue if redraw fails */
-			content_redraw(box->background, &bg_data, &r, ctx);
+			html_redraw_content(box->background, &bg_data, &r, ctx);
 		}
 	}
 
@@ -1185,26 +1212,46 @@ static bool html_redraw_box_children(const html_content *html, struct box *box,
 		colour current_background_color,
 		const struct redraw_context *ctx)
 {
+	const struct box_index *index = box->child_index;
 	struct box *c;
+	int x = x_parent + box->x - scrollbar_get_offset(box->scroll_x);
+	int y = y_parent + box->y - scrollbar_get_offset(box->scroll_y);
 
-	for (c = box->children; c; c = c->next) {
+	if (index != NULL) {
+		unsigned int first, end, i;
+		int y0, y1;
 
-		if (c->type != BOX_FLOAT_LEFT && c->type != BOX_FLOAT_RIGHT)
-			if (!html_redraw_box(html, c,
-					x_parent + box->x -
-					scrollbar_get_offset(box->scroll_x),
-					y_parent + box->y -
-					scrollbar_get_offset(box->scroll_y),
+		/* only visit the children level with the clip rectangle */
+		if (scale == 1.0) {
+			y0 = clip->y0 - y;
+			y1 = clip->y1 - y;
+		} else {
+			/* widened to cover rounding of scaled coordinates */
+			int slack = 2 + (int)(2 / scale);
+			y0 = clip->y0 / scale - y - slack;
+			y1 = clip->y1 / scale - y + slack;
+		}
+
+		box_index_range(index, y0, y1, &first, &end);
+		for (i = first; i != end; i++) {
+			if (!html_redraw_box(html, index->entry[i].box, x, y,
 					clip, scale, current_background_color,
 					ctx))
 				return false;
+		}
+	} else {
+		for (c = box->children; c; c = c->next) {
+			if (c->type != BOX_FLOAT_LEFT &&
+					c->type != BOX_FLOAT_RIGHT)
+				if (!html_redraw_box(html, c, x, y,
+						clip, scale,
+						current_background_color,
+						ctx))
+					return false;
+		}
 	}
 	for (c = box->float_children; c; c = c->next_float)
-		if (!html_redraw_box(html, c,
-				x_parent + box->x -
-				scrollbar_get_offset(box->scroll_x),
-				y_parent + box->y -
-				scrollbar_get_offset(box->scroll_y),
+		if (!html_redraw_box(html, c, x, y,
 				clip, scale, current_background_color,
 				ctx))
 			return false;
@@ -1243,6 +1290,7 @@ bool html_redraw_box(const html_content *html, struct box *box,
 	struct rect rect;
 	int x_scrolled, y_scrolled;
 	struct box *bg_box = NULL;
+	struct form_control *gadget = box_gadget(box);
 	css_computed_clip_rect css_rect;
 	enum css_overflow_e overflow_x = CSS_OVERFLOW_VISIBLE;
 	enum css_overflow_e overflow_y = CSS_OVERFLOW_VISIBLE;
@@ -1374,7 +1422,7 @@ bool html_redraw_box(const html_content *html, struct box *box,
 			if (r.y1 - r.y0 <= html_redraw_printing_border &&
 					(box->type == BOX_TEXT ||
 					box->type == BOX_TABLE_CELL
-					|| box->object || box->gadget)) {
+					|| box->object || gadget)) {
 				/*remember the highest of all points from the
 				not printed elements*/
 				if (r.y0 < html_redraw_printing_top_cropped)
@@ -1478,10 +1526,10 @@ bool html_redraw_box(const html_content *html, struct box *box,
 			bg_box->type != BOX_INLINE_END &&
 			(bg_box->type != BOX_INLINE || bg_box->object ||
 			bg_box->flags & IFRAME || box->flags & REPLACE_DIM ||
-			(bg_box->gadget != NULL &&
-			(bg_box->gadget->type == GADGET_TEXTAREA ||
-			bg_box->gadget->type == GADGET_TEXTBOX ||
-			bg_box->gadget->type == GADGET_PASSWORD)))) {
+			(box_gadget(bg_box) != NULL &&
+			(box_gadget(bg_box)->type == GADGET_TEXTAREA ||
+			box_gadget(bg_box)->type == GADGET_TEXTBOX ||
+			box_gadget(bg_box)->type == GADGET_PASSWORD)))) {
 		/* find intersection of clip box and border edge */
 		struct rect p;
 		p.x0 = x - border_left < r.x0 ? r.x0 : x - border_left;
@@ -1529,10 +1577,10 @@ bool html_redraw_box(const html_content *html, struct box *box,
 	    box->type != BOX_INLINE_END &&
 	    (box->type != BOX_INLINE || box->object ||
 	     box->flags & IFRAME || box->flags & REPLACE_DIM ||
-	     (box->gadget != NULL &&
-	      (box->gadget->type == GADGET_TEXTAREA ||
-	       box->gadget->type == GADGET_TEXTBOX ||
-	       box->gadget->type == GADGET_PASSWORD))) &&
+	     (gadget != NULL &&
+	      (gadget->type == GADGET_TEXTAREA ||
+	       gadget->type == GADGET_TEXTBOX ||
+	       gadget->type == GADGET_PASSWORD))) &&
 	    (border_top || border_right || border_bottom || border_left)) {
 		if (!html_redraw_borders(box, x_parent, y_parent,
 				padding_width, padding_height, &r,
@@ -1775,7 +1823,7 @@ bool html_redraw_box(const html_content *html, struct box *box,
 			obj_data.y /= scale;
 		}
 
-		if (!content_redraw(box->object, &obj_data, &r, ctx)) {
+		if (!html_redraw_content(box->object, &obj_data, &r, ctx)) {
 			/* Show image fail */
 			/* Unicode (U+FFFC) 'OBJECT REPLACEMENT CHARACTER' */
 			const char *obj = "\xef\xbf\xbc";
@@ -1808,11 +1856,19 @@ bool html_redraw_box(const html_content *html, struct box *box,
 					    obj, sizeof(obj) - 1) != NSERROR_OK)
 				return false;
 		}
+		display_list_record_fallback_end(ctx);
 	} else if (tag_type == DOM_HTML_ELEMENT_TYPE_CANVAS &&
 		   box->node != NULL &&
 		   box->flags & REPLACE_DIM) {
 		/* Canvas to draw */
 		struct bitmap *bitmap = NULL;
+
+		if (display_list_recording(ctx)) {
+			/* the canvas bitmap is replaced without a redraw
+			 * request, so it cannot be recorded */
+			display_list_record_live(ctx);
+		}
+
 		exc = dom_node_get_user_data(box->node,
 					     corestring_dom___ns_key_canvas_node_data,
 					     &bitmap);
@@ -1826,31 +1882,37 @@ bool html_redraw_box(const html_content *html, struct box *box,
 			return false;
 	} else if (box->iframe) {
 		/* Offset is passed to browser window redraw unscaled */
-		browser_window_redraw(box->iframe,
-				x + padding_left,
-				y + padding_top, &r, ctx);
+		if (display_list_recording(ctx)) {
+			display_list_record_iframe(ctx, box->iframe,
+					x + padding_left,
+					y + padding_top, &r);
+		} else {
+			browser_window_redraw(box->iframe,
+					x + padding_left,
+					y + padding_top, &r, ctx);
+		}
 
-	} else if (box->gadget && box->gadget->type == GADGET_CHECKBOX) {
+	} else if (gadget && gadget->type == GADGET_CHECKBOX) {
 		if (!html_redraw_checkbox(x + padding_left, y + padding_top,
-				width, height, box->gadget->selected, ctx))
+				width, height, gadget->selected, ctx))
 			return false;
 
-	} else if (box->gadget && box->gadget->type == GADGET_RADIO) {
+	} else if (gadget && gadget->type == GADGET_RADIO) {
 		if (!html_redraw_radio(x + padding_left, y + padding_top,
-				width, height, box->gadget->selected, ctx))
+				width, height, gadget->selected, ctx))
 			return false;
 
-	} else if (box->gadget && box->gadget->type == GADGET_FILE) {
+	} else if (gadget && gadget->type == GADGET_FILE) {
 		if (!html_redraw_file(x + padding_left, y + padding_top,
 				width, height, box, scale,
 				current_background_color, &html->unit_len_ctx, ctx))
 			return false;
 
-	} else if (box->gadget &&
-			(box->gadget->type == GADGET_TEXTAREA ||
-			box->gadget->type == GADGET_PASSWORD ||
-			box->gadget->type == GADGET_TEXTBOX)) {
-		textarea_redraw(box->gadget->data.text.ta, x, y,
+	} else if (gadget &&
+			(gadget->type == GADGET_TEXTAREA ||
+			gadget->type == GADGET_PASSWORD ||
+			gadget->type == GADGET_TEXTBOX)) {
+		textarea_redraw(gadget->data.text.ta, x, y,
 				current_background_color, scale, &r, ctx);
 
 	} else if (box->text) {
@@ -1870,8 +1932,8 @@ bool html_redraw_box(const html_content *html, struct box *box,
 			return false;
 
 	/* list marker */
-	if (box->list_marker) {
-		if (!html_redraw_box(html, box->list_marker,
+	if (box_list_marker(box)) {
+		if (!html_redraw_box(html, box_list_marker(box),
 				x_parent + box->x -
 				scrollbar_get_offset(box->scroll_x),
 				y_parent + box->y -
@@ -1883,7 +1945,7 @@ bool html_redraw_box(const html_content *html, struct box *box,
 	/* scrollbars */
 	if (((box->style && box->type != BOX_BR &&
 	      box->type != BOX_TABLE && box->type != BOX_INLINE &&
-	      (box->gadget == NULL || box->gadget->type != GADGET_TEXTAREA) &&
+	      (gadget == NULL || gadget->type != GADGET_TEXTAREA) &&
 	      (overflow_x == CSS_OVERFLOW_SCROLL ||
 	       overflow_x == CSS_OVERFLOW_AUTO ||
 	       overflow_y == CSS_OVERFLOW_SCROLL ||
@@ -1929,6 +1991,49 @@ bool html_redraw_box(const html_content *html, struct box *box,
 	return ((!plot->group_end) || (ctx->plot->group_end(ctx) == NSERROR_OK));
 }
 
+/**
+ * Context of a document redraw, for html_redraw_document().
+ */
+struct html_redraw_document_ctx {
+	const html_content *html; /**< document to draw */
+	float scale; /**< scale to draw at */
+	colour background; /**< background colour of the document */
+};
+
+
+/**
+ * Draw the box tree of a document, over its background colour.
+ *
+ * This is a display_list_draw_fn, used to record display lists.
+ *
+ * \param x     x origin of the document, unscaled
+ * \param y     y origin of the document, unscaled
+ * \param clip  clip rectangle, in target coordinates
+ * \param ctx   redraw context
+ * \param pw    redraw document context
+ * \return true if successful, false otherwise
+ */
+static bool html_redraw_document(int x, int y, const struct rect *clip,
+		const struct redraw_context *ctx, void *pw)
+{
+	struct html_redraw_document_ctx *doc = pw;
+	plot_style_t pstyle_fill_bg = {
+		.fill_type = PLOT_OP_TYPE_SOLID,
+		.fill_colour = doc->background,
+	};
+	bool result;
+
+	result = (ctx->plot->clip(ctx, clip) == NSERROR_OK);
+
+	result &= (ctx->plot->rectangle(ctx, &pstyle_fill_bg, clip) == NSERROR_OK);
+
+	result &= html_redraw_box(doc->html, doc->html->layout, x, y, clip,
+			doc->scale, doc->background, ctx);
+
+	return result;
+}
+
+
 /**
  * Draw a CONTENT_HTML using the current set of plotters (plot).
  *
@@ -1948,9 +2053,10 @@ bool html_redraw(struct content *c, struct content_redraw_data *data,
 	struct box *box;
 	bool result = true;
 	bool select, select_only;
-	plot_style_t pstyle_fill_bg = {
-		.fill_type = PLOT_OP_TYPE_SOLID,
-		.fill_colour = data->background_colour,
+	struct html_redraw_document_ctx doc = {
+		.html = html,
+		.scale = data->scale,
+		.background = data->background_colour,
 	};
 
 	box = html->layout;
@@ -1971,16 +2077,30 @@ bool html_redraw(struct content *c, struct content_redraw_data *data,
 	}
 
 	if (!select_only) {
-		/* clear to background colour */
-		result = (ctx->plot->clip(ctx, clip) == NSERROR_OK);
+		nserror res = NSERROR_NOT_IMPLEMENTED;
 
 		if (html->background_colour != NS_TRANSPARENT)
-			pstyle_fill_bg.fill_colour = html->background_colour;
-
-		result &= (ctx->plot->rectangle(ctx, &pstyle_fill_bg, clip) == NSERROR_OK);
+			doc.background = html->background_colour;
+
+		/* interactive redraws are replayed from the display list,
+		 * which is recorded the first time each part is drawn */
+		if (ctx->interactive && !html_redraw_printing &&
+				!html_redraw_debug) {
+			res = NSERROR_OK;
+			if (html->display_list == NULL) {
+				res = display_list_create(&html->display_list);
+			}
+			if (res == NSERROR_OK) {
+				res = display_list_redraw(html->display_list,
+						data, clip, ctx,
+						html_redraw_document, &doc);
+			}
+		}
 
-		result &= html_redraw_box(html, box, data->x, data->y, clip,
-				data->scale, pstyle_fill_bg.fill_colour, ctx);
+		if (res != NSERROR_OK) {
+			result = html_redraw_document(data->x, data->y, clip,
+					ctx, &doc);
+		}
 	}
 
 	if (select) {
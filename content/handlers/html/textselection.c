@@ -124,17 +124,17 @@ coords_from_range(struct box *box,
 
 	/* If selection starts inside marker */
 	if (box->parent &&
-	    box->parent->list_marker == box &&
+	    box_list_marker(box->parent) == box &&
 	    !do_marker) {
 		/* set box to main list element */
 		box = box->parent;
 	}
 
 	/* If box has a list marker */
-	if (box->list_marker) {
+	if (box_list_marker(box)) {
 		/* do the marker box before continuing with the rest of the
 		 * list element */
-		res = coords_from_range(box->list_marker,
+		res = coords_from_range(box_list_marker(box),
 					start_idx,
 					end_idx,
 					rdwi,
@@ -329,17 +329,17 @@ selection_copy(struct box *box,
 
 	/* If selection starts inside marker */
 	if (box->parent &&
-	    box->parent->list_marker == box &&
+	    box_list_marker(box->parent) == box &&
 	    !do_marker) {
 		/* set box to main list element */
 		box = box->parent;
 	}
 
 	/* If box has a list marker */
-	if (box->list_marker) {
+	if (box_list_marker(box)) {
 		/* do the marker box before continuing with the rest of the
 		 * list element */
-		res = selection_copy(box->list_marker,
+		res = selection_copy(box_list_marker(box),
 				     unit_len_ctx,
 				     start_idx,
 				     end_idx,
@@ -457,8 +457,10 @@ static unsigned selection_label_subtree(struct box *box, unsigned idx)
 	}
 
 	while (child) {
-		if (child->list_marker) {
-			idx = selection_label_subtree(child->list_marker, idx);
+		struct box *marker = box_list_marker(child);
+
+		if (marker) {
+			idx = selection_label_subtree(marker, idx);
 		}
 
 		idx = selection_label_subtree(child, idx);
@@ -491,7 +493,7 @@ html_textselection_redraw(struct content *c,
 	}
 
 	if (rdw.inited) {
-		content__request_redraw(c,
+		html__request_redraw(html,
 					rdw.r.x0,
 					rdw.r.y0,
 					rdw.r.x1 - rdw.r.x0,
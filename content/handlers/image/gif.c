@@ -56,6 +56,8 @@ typedef struct nsgif_content {
 
 	struct gif_animation *gif; /**< GIF animation data */
 	int current_frame;   /**< current frame to display [0...(max-1)] */
+	int loop_count;      /**< loop count the animation started with */
+	bool playing;        /**< animation was started by a click */
 } nsgif_content;
 
 
@@ -125,95 +127,155 @@ static nserror nsgif_create(const content_handler *handler,
 	return NSERROR_OK;
 }
 
+/**
+ * Get the time a frame is displayed for.
+ *
+ * \param gif The gif content.
+ * \param frame The frame index.
+ * \return The frame delay in cs.
+ */
+static int nsgif_frame_delay(nsgif_content *gif, int frame)
+{
+	int delay = gif->gif->frames[frame].frame_delay;
+
+	if (delay <= 1) {
+		/* Assuming too fast to be intended, set default. */
+		delay = 10;
+	}
+
+	return delay;
+}
+
+/**
+ * Extend a redraw area to cover the area a frame changes.
+ *
+ * \param area The redraw area, empty if x1 is not greater than x0.
+ * \param frame The frame to cover.
+ */
+static void nsgif_redraw_add(struct rect *area, const gif_frame *frame)
+{
+	int x0 = frame->redraw_x;
+	int y0 = frame->redraw_y;
+	int x1 = x0 + frame->redraw_width;
+	int y1 = y0 + frame->redraw_height;
+
+	if (area->x1 <= area->x0) {
+		area->x0 = x0;
+		area->y0 = y0;
+		area->x1 = x1;
+		area->y1 = y1;
+		return;
+	}
+
+	if (x0 < area->x0) area->x0 = x0;
+	if (y0 < area->y0) area->y0 = y0;
+	if (x1 > area->x1) area->x1 = x1;
+	if (y1 > area->y1) area->y1 = y1;
+}
+
+/**
+ * Find whether the animation should currently be running.
+ *
+ * \param gif The gif content.
+ * \return true if frames should advance, else false.
+ */
+static bool nsgif_playing(nsgif_content *gif)
+{
+	if (gif->gif->frame_count_partial <= 1 ||
+	    gif->gif->loop_count < 0) {
+		return false;
+	}
+
+	return gif->playing || !nsoption_bool(animate_images_on_click);
+}
+
 /**
  * Performs any necessary animation.
  *
+ * Frames are advanced until at least the configured minimum delay
+ * has passed, so slow displays are redrawn less often without the
+ * animation playing any slower. Only the area the skipped and shown
+ * frames change is redrawn.
+ *
  * \param p  The content to animate
 */
 static void nsgif_animate(void *p)
 {
 	nsgif_content *gif = p;
 	union content_msg_data data;
-	int delay;
+	struct rect area = { 0, 0, 0, 0 };
+	int min_delay = nsoption_int(animate_images_min_delay);
+	int delay = 0;
+	int prev;
 	int f;
 
-	/* Advance by a frame, updating the loop count accordingly */
-	gif->current_frame++;
-	if (gif->current_frame == (int)gif->gif->frame_count_partial) {
-		gif->current_frame = 0;
+	do {
+		prev = gif->current_frame;
+
+		/* Advance by a frame, updating the loop count accordingly */
+		gif->current_frame++;
+		if (gif->current_frame == (int)gif->gif->frame_count_partial) {
+			gif->current_frame = 0;
+
+			/* A loop count of 0 has a special meaning of infinite */
+			if (gif->gif->loop_count != 0) {
+				gif->gif->loop_count--;
+				if (gif->gif->loop_count == 0) {
+					gif->current_frame =
+						gif->gif->frame_count_partial - 1;
+					gif->gif->loop_count = -1;
+					gif->playing = false;
+				}
+			}
+		}
+
+		f = gif->current_frame;
+		if (gif->gif->frames[f].display) {
+			nsgif_redraw_add(&area, &gif->gif->frames[f]);
 
-		/* A loop count of 0 has a special meaning of infinite */
-		if (gif->gif->loop_count != 0) {
-			gif->gif->loop_count--;
-			if (gif->gif->loop_count == 0) {
-				gif->current_frame =
-					gif->gif->frame_count_partial - 1;
-				gif->gif->loop_count = -1;
+			/* previous frame needed clearing: expand the
+			 * redraw area to cover it */
+			if (gif->gif->frames[prev].redraw_required) {
+				nsgif_redraw_add(&area,
+						&gif->gif->frames[prev]);
 			}
 		}
-	}
+
+		delay += nsgif_frame_delay(gif, f);
+	} while ((gif->gif->loop_count >= 0) && (delay < min_delay));
 
 	/* Continue animating if we should */
-	if (gif->gif->loop_count >= 0) {
-		delay = gif->gif->frames[gif->current_frame].frame_delay;
-		if (delay <= 1) {
-			/* Assuming too fast to be intended, set default. */
-			delay = 10;
-		}
+	if (nsgif_playing(gif)) {
 		guit->misc->schedule(delay * 10, nsgif_animate, gif);
 	}
 
-	if ((!nsoption_bool(animate_images)) ||
-	    (!gif->gif->frames[gif->current_frame].display)) {
+	if ((!nsoption_bool(animate_images)) || (area.x1 <= area.x0)) {
 		return;
 	}
 
 	/* area within gif to redraw */
-	f = gif->current_frame;
-	data.redraw.x = gif->gif->frames[f].redraw_x;
-	data.redraw.y = gif->gif->frames[f].redraw_y;
-	data.redraw.width = gif->gif->frames[f].redraw_width;
-	data.redraw.height = gif->gif->frames[f].redraw_height;
-
-	/* redraw background (true) or plot on top (false) */
-	if (gif->current_frame > 0) {
-		/* previous frame needed clearing: expand the redraw area to
-		 * cover it */
-		if (gif->gif->frames[f - 1].redraw_required) {
-			if (data.redraw.x >
-					(int)(gif->gif->frames[f - 1].redraw_x)) {
-				data.redraw.width += data.redraw.x -
-					gif->gif->frames[f - 1].redraw_x;
-				data.redraw.x = 
-					gif->gif->frames[f - 1].redraw_x;
-			}
-			if (data.redraw.y >
-					(int)(gif->gif->frames[f - 1].redraw_y)) {
-				data.redraw.height += (data.redraw.y -
-					gif->gif->frames[f - 1].redraw_y);
-				data.redraw.y = 
-					gif->gif->frames[f - 1].redraw_y;
-			}
-			if ((int)(gif->gif->frames[f - 1].redraw_x +
-					gif->gif->frames[f - 1].redraw_width) >
-					(data.redraw.x + data.redraw.width))
-				data.redraw.width =
-					gif->gif->frames[f - 1].redraw_x -
-					data.redraw.x +
-					gif->gif->frames[f - 1].redraw_width;
-			if ((int)(gif->gif->frames[f - 1].redraw_y +
-					gif->gif->frames[f - 1].redraw_height) >
-					(data.redraw.y + data.redraw.height))
-				data.redraw.height =
-					gif->gif->frames[f - 1].redraw_y -
-					data.redraw.y +
-					gif->gif->frames[f - 1].redraw_height;
-		}
-	}
+	data.redraw.x = area.x0;
+	data.redraw.y = area.y0;
+	data.redraw.width = area.x1 - area.x0;
+	data.redraw.height = area.y1 - area.y0;
 
 	content_broadcast(&gif->base, CONTENT_MSG_REDRAW, &data);
 }
 
+/**
+ * Start the animation if it should be running.
+ *
+ * \param gif The gif content.
+ */
+static void nsgif_start(nsgif_content *gif)
+{
+	if (nsgif_playing(gif)) {
+		guit->misc->schedule(
+				nsgif_frame_delay(gif, gif->current_frame) * 10,
+				nsgif_animate, gif);
+	}
+}
+
 static bool nsgif_convert(struct content *c)
 {
 	nsgif_content *gif = (nsgif_content *) c;
@@ -269,10 +331,8 @@ static bool nsgif_convert(struct content *c)
 
 	/* Schedule the animation if we have one */
 	gif->current_frame = 0;
-	if (gif->gif->frame_count_partial > 1)
-		guit->misc->schedule(gif->gif->frames[0].frame_delay * 10,
-					nsgif_animate,
-					c);
+	gif->loop_count = gif->gif->loop_count;
+	nsgif_start(gif);
 
 	/* Exit as a success */
 	content_set_ready(c);
@@ -384,10 +444,7 @@ static void nsgif_add_user(struct content *c)
 
 	if (content_count_users(c) == 1) {
 		/* First user, and content already converted, so start the animation. */
-		if (gif->gif->frame_count_partial > 1) {
-			guit->misc->schedule(gif->gif->frames[0].frame_delay * 10,
-				nsgif_animate, c);
-		}
+		nsgif_start(gif);
 	}
 }
 
@@ -399,6 +456,46 @@ static void nsgif_remove_user(struct content *c)
 	}
 }
 
+/**
+ * Start or stop an animation which only plays when clicked.
+ */
+static nserror nsgif_mouse_action(struct content *c,
+		struct browser_window *bw, browser_mouse_state mouse,
+		int x, int y)
+{
+	nsgif_content *gif = (nsgif_content *) c;
+	union content_msg_data data;
+
+	if (((mouse & BROWSER_MOUSE_CLICK_1) == 0) ||
+	    (!nsoption_bool(animate_images_on_click)) ||
+	    (gif->gif->frame_count_partial <= 1)) {
+		return NSERROR_OK;
+	}
+
+	if (gif->playing) {
+		/* Stop on the current frame */
+		gif->playing = false;
+		guit->misc->schedule(-1, nsgif_animate, c);
+		return NSERROR_OK;
+	}
+
+	gif->playing = true;
+	if (gif->gif->loop_count < 0) {
+		/* Finished playing; replay from the first frame */
+		gif->gif->loop_count = gif->loop_count;
+		gif->current_frame = 0;
+
+		data.redraw.x = 0;
+		data.redraw.y = 0;
+		data.redraw.width = c->width;
+		data.redraw.height = c->height;
+		content_broadcast(c, CONTENT_MSG_REDRAW, &data);
+	}
+	nsgif_start(gif);
+
+	return NSERROR_OK;
+}
+
 static void *nsgif_get_internal(const struct content *c, void *context)
 {
 	nsgif_content *gif = (nsgif_content *) c;
@@ -437,6 +534,7 @@ static const content_handler nsgif_content_handler = {
 	.clone = nsgif_clone,
 	.add_user = nsgif_add_user,
 	.remove_user = nsgif_remove_user,
+	.mouse_action = nsgif_mouse_action,
 	.get_internal = nsgif_get_internal,
 	.type = nsgif_content_type,
 	.is_opaque = nsgif_content_is_opaque,
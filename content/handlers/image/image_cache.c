@@ -26,14 +26,24 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
+#ifdef WITH_IMAGE_THREAD
+#include <pthread.h>
+#endif
+#include <zlib.h>
+#include <nsutils/time.h>
 
 #include "netsurf/inttypes.h"
 #include "utils/utils.h"
 #include "utils/log.h"
+#include "utils/hashmap.h"
 #include "netsurf/misc.h"
 #include "netsurf/bitmap.h"
+#include "netsurf/plotters.h"
+#include "netsurf/content.h"
 #include "content/llcache.h"
+#include "content/content.h"
 #include "content/content_protected.h"
+#include "content/backing_store.h"
 #include "desktop/gui_internal.h"
 
 #include "image/image_cache.h"
@@ -47,6 +57,37 @@
  */
 typedef unsigned int cache_age;
 
+#ifdef WITH_IMAGE_THREAD
+/** Upper bound on the number of decode worker threads */
+#define IMAGE_CACHE_MAX_THREADS 8
+
+/** How often finished decodes are collected (ms) */
+#define IMAGE_CACHE_POLL_TIME 10
+#endif
+
+/** Minimum time between redraws of a partially decoded image (ms) */
+#define IMAGE_CACHE_PROGRESS_TIME 250
+
+/** Identifies a bitmap held in the backing store ("NSBM") */
+#define IMAGE_CACHE_PERSIST_MAGIC 0x4d42534e
+
+/**
+ * Header of a bitmap held in the backing store.
+ *
+ * The header is followed by the bitmap rows at four bytes per pixel
+ * without padding.
+ */
+struct image_cache_persist_header {
+	uint32_t magic; /**< IMAGE_CACHE_PERSIST_MAGIC */
+	uint32_t validator; /**< validator of the source data */
+	uint32_t source_size; /**< length of the source data */
+	uint32_t width; /**< width of the bitmap */
+	uint32_t height; /**< height of the bitmap */
+	uint32_t opaque; /**< non zero if the bitmap is opaque */
+};
+
+struct image_cache_job;
+
 /**
  * Image cache entry
  */
@@ -60,6 +101,12 @@ struct image_cache_entry_s {
 	struct bitmap *bitmap;
 	/** routine to convert content into bitmap */
 	image_cache_convert_fn *convert;
+	/** decoder of source data which may run on a worker */
+	const struct image_cache_decoder *decoder;
+	/** routine to render content at an exact size */
+	image_cache_render_fn *render;
+	/** outstanding worker decode or NULL */
+	struct image_cache_job *job;
 
 	/* Statistics for replacement algorithm */
 
@@ -69,6 +116,19 @@ struct image_cache_entry_s {
 	cache_age bitmap_age; /**< Age of last conversion to a bitmap by cache*/
 
 	int conversion_count; /**< Number of times image has been converted */
+	uint64_t conversion_time; /**< Total time spent converting (ms) */
+
+	/* Progressive display while the source is arriving */
+
+	bool partial; /**< bitmap is still being decoded into */
+	bool progressive; /**< bitmap was decoded at the image size */
+	bool progress_scheduled; /**< a redraw of changed rows is pending */
+	int progress_y0; /**< first changed row not yet redrawn */
+	int progress_y1; /**< row after last changed row not yet redrawn */
+	uint64_t progress_time; /**< time of last progress redraw (ms) */
+
+	/** the bitmap is held in the backing store */
+	bool persisted;
 };
 
 /**
@@ -89,6 +149,9 @@ struct image_cache_s {
 	/* The objects the cache holds */
 	struct image_cache_entry_s *entries;
 
+	/** The cache entries indexed by content */
+	hashmap_t *index;
+
 
 	/* Statistics for management algorithm */
 
@@ -134,11 +197,127 @@ struct image_cache_s {
 	int peak_conversions;
 	/** Size of bitmap with most conversions */
 	unsigned int peak_conversions_size;
+
+	/** Number of bitmaps put in the backing store */
+	int persist_count;
+	/** Number of bitmaps retrieved from the backing store */
+	int restore_count;
 };
 
 /** image cache state */
 static struct image_cache_s *image_cache = NULL;
 
+#ifdef WITH_IMAGE_THREAD
+/**
+ * Decode performed by a worker thread.
+ *
+ * The job owns a private copy of the source data so the content may
+ * go away while it is being decoded.
+ */
+struct image_cache_job {
+	struct image_cache_job *next; /**< next job in queue or done list */
+
+	/** entry the result is for, NULL once cancelled */
+	struct image_cache_entry_s *centry;
+	const struct image_cache_decoder *decoder; /**< decoder to run */
+	uint8_t *data; /**< copy of the source data */
+	size_t size; /**< length of source data */
+	struct image_cache_decode_params params; /**< from the measure */
+
+	/** bitmap created on the main thread to decode into */
+	struct bitmap *bitmap;
+	uint8_t *pixels; /**< pixel buffer of the bitmap */
+	size_t rowstride; /**< row stride of the pixel buffer */
+
+	bool ok; /**< the decode succeeded */
+	uint64_t time; /**< time taken to decode (ms) */
+};
+
+/**
+ * Decode worker pool.
+ *
+ * The queue, done list and quit flag are protected by the mutex. The
+ * remaining fields are only used from the main thread.
+ */
+struct image_cache_pool {
+	pthread_mutex_t lock;
+	pthread_cond_t cond; /**< signalled when work is queued */
+
+	struct image_cache_job *queue; /**< jobs waiting for a worker */
+	struct image_cache_job *queue_tail; /**< last job in queue */
+	struct image_cache_job *done; /**< jobs finished by a worker */
+	bool quit; /**< workers should exit */
+
+	pthread_t threads[IMAGE_CACHE_MAX_THREADS];
+	unsigned int thread_count;
+
+	unsigned int pending; /**< jobs not yet collected */
+};
+
+/** decode worker pool or NULL if images are converted synchronously */
+static struct image_cache_pool *image_cache_pool = NULL;
+#endif
+
+/** Style used to plot an image which is still being decoded */
+static const plot_style_t image_cache_placeholder_style = {
+	.fill_type = PLOT_OP_TYPE_SOLID,
+	.fill_colour = 0x00eeeeee,
+};
+
+
+/* Entry index hashmap parameters
+ *
+ * The index has content pointer keys and the cache entries as values.
+ */
+
+static void *image_cache__key_clone(void *key)
+{
+	return key;
+}
+
+static void image_cache__key_destroy(void *key)
+{
+}
+
+static uint32_t image_cache__key_hash(void *key)
+{
+	uintptr_t ptr = (uintptr_t)key;
+
+	/* contents are heap allocated so the low bits carry no entropy */
+	ptr = (ptr >> 4) ^ (ptr >> 16);
+	return (uint32_t)(ptr * 0x9e3779b1u);
+}
+
+static bool image_cache__key_eq(void *key1, void *key2)
+{
+	return key1 == key2;
+}
+
+static void *image_cache__value_alloc(void *key)
+{
+	struct image_cache_entry_s *centry;
+
+	centry = calloc(1, sizeof(struct image_cache_entry_s));
+	if (centry != NULL) {
+		centry->content = key;
+	}
+	return centry;
+}
+
+static void image_cache__value_destroy(void *value)
+{
+	free(value);
+}
+
+static hashmap_parameters_t image_cache_index_parameters = {
+	.key_clone = image_cache__key_clone,
+	.key_destroy = image_cache__key_destroy,
+	.key_hash = image_cache__key_hash,
+	.key_eq = image_cache__key_eq,
+	.value_alloc = image_cache__value_alloc,
+	.value_destroy = image_cache__value_destroy,
+};
+
 
 /**
  * Find a cache entry by index.
@@ -167,13 +346,7 @@ static struct image_cache_entry_s *image_cache__findn(int entryn)
  */
 static struct image_cache_entry_s *image_cache__find(const struct content *c)
 {
-	struct image_cache_entry_s *found;
-
-	found = image_cache->entries;
-	while ((found != NULL) && (found->content != c)) {
-		found = found->next;
-	}
-	return found;
+	return hashmap_lookup(image_cache->index, (void *)c);
 }
 
 /**
@@ -216,6 +389,121 @@ static void image_cache_stats_bitmap_add(struct image_cache_entry_s *centry)
 	}
 }
 
+/**
+ * Attach a newly converted bitmap to an entry.
+ *
+ * Any bitmap the entry already has is destroyed. The entry size is
+ * taken from the bitmap as it may be smaller than the image.
+ *
+ * \param centry The image cache entry to update.
+ * \param bitmap The converted bitmap.
+ */
+static void
+image_cache__set_bitmap(struct image_cache_entry_s *centry,
+			struct bitmap *bitmap)
+{
+	if (centry->bitmap != NULL) {
+		guit->bitmap->destroy(centry->bitmap);
+		image_cache->total_bitmap_size -= centry->bitmap_size;
+		image_cache->bitmap_count--;
+	}
+
+	centry->bitmap = bitmap;
+	centry->bitmap_size = guit->bitmap->get_width(bitmap) *
+		guit->bitmap->get_height(bitmap) * 4;
+	centry->persisted = false;
+	centry->progressive = false;
+
+	image_cache_stats_bitmap_add(centry);
+}
+
+/**
+ * Check if a bitmap size is suitable to plot an entry at a size.
+ *
+ * A rendered bitmap is only suitable at the size it is plotted at, a
+ * decoded bitmap if it is no smaller than the plot or the image and
+ * any other bitmap only at the image size.
+ *
+ * \param centry The image cache entry.
+ * \param bitmap_width The width of the bitmap.
+ * \param bitmap_height The height of the bitmap.
+ * \param width The width to be plotted at or zero for the image width.
+ * \param height The height to be plotted at or zero for the image height.
+ * \return true if the bitmap size is suitable.
+ */
+static bool
+image_cache__fits(struct image_cache_entry_s *centry,
+		  int bitmap_width,
+		  int bitmap_height,
+		  int width,
+		  int height)
+{
+	if (centry->render != NULL) {
+		if ((width <= 0) || (height <= 0)) {
+			width = centry->content->width;
+			height = centry->content->height;
+		}
+		return (bitmap_width == width) && (bitmap_height == height);
+	}
+
+	if (centry->decoder == NULL) {
+		return (bitmap_width == centry->content->width) &&
+			(bitmap_height == centry->content->height);
+	}
+
+	if ((width <= 0) || (width > centry->content->width)) {
+		width = centry->content->width;
+	}
+	if ((height <= 0) || (height > centry->content->height)) {
+		height = centry->content->height;
+	}
+
+	return (bitmap_width >= width) && (bitmap_height >= height);
+}
+
+/**
+ * Check if an entry's bitmap needs converting again to be plotted at a size.
+ *
+ * Only entries with a decoder can have a bitmap decoded smaller than
+ * the image, and only entries with a renderer have a bitmap which is
+ * used solely at the size it was rendered at.
+ *
+ * \param centry The image cache entry to check.
+ * \param width The width to be plotted at or zero for the image width.
+ * \param height The height to be plotted at or zero for the image height.
+ * \return true if a bitmap of another size should be converted.
+ */
+static bool
+image_cache__resize_needed(struct image_cache_entry_s *centry,
+			   int width,
+			   int height)
+{
+	if ((centry->bitmap == NULL) ||
+	    ((centry->decoder == NULL) && (centry->render == NULL))) {
+		return false;
+	}
+
+	/* a bitmap decoded while the source arrived is at the image
+	 * size and is only kept if it is plotted at that size.
+	 */
+	if (centry->progressive && (centry->decoder != NULL)) {
+		if ((width <= 0) || (width > centry->content->width)) {
+			width = centry->content->width;
+		}
+		if ((height <= 0) || (height > centry->content->height)) {
+			height = centry->content->height;
+		}
+		return (width != centry->content->width) ||
+			(height != centry->content->height);
+	}
+
+	return !image_cache__fits(centry,
+				  guit->bitmap->get_width(centry->bitmap),
+				  guit->bitmap->get_height(centry->bitmap),
+				  width,
+				  height);
+}
+
 static void image_cache__link(struct image_cache_entry_s *centry)
 {
 	centry->next = image_cache->entries;
@@ -247,6 +535,665 @@ static void image_cache__unlink(struct image_cache_entry_s *centry)
 	}
 }
 
+/**
+ * Create the bitmap a decoder will decode some source data into.
+ *
+ * The decoder measures the source data and the bitmap is created, on
+ * the main thread, from the result.
+ *
+ * \param decoder The decoder to use.
+ * \param data The image source data.
+ * \param size The length of the source data.
+ * \param params The plot size, updated by the decoder's measure.
+ * \param pixels Updated with the bitmap's pixel buffer.
+ * \param rowstride Updated with the row stride of the pixel buffer.
+ * \return The new bitmap or NULL on failure.
+ */
+static struct bitmap *
+image_cache__decode_create(const struct image_cache_decoder *decoder,
+			   const uint8_t *data,
+			   size_t size,
+			   struct image_cache_decode_params *params,
+			   uint8_t **pixels,
+			   size_t *rowstride)
+{
+	struct bitmap *bitmap;
+
+	if ((data == NULL) || (size == 0)) {
+		return NULL;
+	}
+
+	params->flags = BITMAP_NEW;
+	params->option = 0;
+	if (decoder->measure(data, size, params) == false) {
+		return NULL;
+	}
+
+	bitmap = guit->bitmap->create(params->width,
+				      params->height,
+				      params->flags);
+	if (bitmap == NULL) {
+		return NULL;
+	}
+
+	*pixels = guit->bitmap->get_buffer(bitmap);
+	if (*pixels == NULL) {
+		guit->bitmap->destroy(bitmap);
+		return NULL;
+	}
+	*rowstride = guit->bitmap->get_rowstride(bitmap);
+
+	return bitmap;
+}
+
+#ifdef WITH_IMAGE_THREAD
+/**
+ * Decode worker thread.
+ *
+ * Takes jobs from the head of the queue, decodes them and places them
+ * on the done list for the main thread to collect.
+ *
+ * \param p The worker pool.
+ */
+static void *image_cache__worker(void *p)
+{
+	struct image_cache_pool *pool = p;
+	struct image_cache_job *job;
+	uint64_t start;
+	uint64_t end;
+
+	pthread_mutex_lock(&pool->lock);
+	while (true) {
+		while ((pool->quit == false) && (pool->queue == NULL)) {
+			pthread_cond_wait(&pool->cond, &pool->lock);
+		}
+		if (pool->quit) {
+			break;
+		}
+
+		job = pool->queue;
+		pool->queue = job->next;
+		if (pool->queue == NULL) {
+			pool->queue_tail = NULL;
+		}
+		pthread_mutex_unlock(&pool->lock);
+
+		nsu_getmonotonic_ms(&start);
+		job->ok = job->decoder->decode(job->data,
+					       job->size,
+					       &job->params,
+					       job->pixels,
+					       job->rowstride);
+		nsu_getmonotonic_ms(&end);
+		job->time = end - start;
+
+		free(job->data);
+		job->data = NULL;
+
+		pthread_mutex_lock(&pool->lock);
+		job->next = pool->done;
+		pool->done = job;
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+/**
+ * Collect decodes finished by the workers.
+ *
+ * Each bitmap is finished, attached to its cache entry and the content
+ * is asked to redraw. Results for cancelled jobs, and for entries
+ * which were converted as large synchronously in the meantime, are
+ * discarded.
+ *
+ * \param p The worker pool.
+ */
+static void image_cache__pool_poll(void *p)
+{
+	struct image_cache_pool *pool = p;
+	struct image_cache_entry_s *centry;
+	struct image_cache_job *job;
+	struct image_cache_job *done;
+	union content_msg_data msg_data;
+
+	pthread_mutex_lock(&pool->lock);
+	done = pool->done;
+	pool->done = NULL;
+	pthread_mutex_unlock(&pool->lock);
+
+	while (done != NULL) {
+		job = done;
+		done = job->next;
+		pool->pending--;
+
+		centry = job->centry;
+		if (centry == NULL) {
+			/* cancelled while being decoded */
+			guit->bitmap->destroy(job->bitmap);
+			free(job);
+			continue;
+		}
+
+		centry->job = NULL;
+		centry->conversion_time += job->time;
+
+		if (job->ok == false) {
+			/* do not queue this content again, the redraw
+			 * path will convert it synchronously instead.
+			 */
+			NSLOG(netsurf, INFO, "decode of %p failed",
+			      centry->content);
+			guit->bitmap->destroy(job->bitmap);
+			centry->decoder = NULL;
+			image_cache->fail_count++;
+			image_cache->fail_size += centry->bitmap_size;
+		} else if ((centry->bitmap != NULL) &&
+			   (guit->bitmap->get_width(centry->bitmap) >=
+			    job->params.width)) {
+			/* converted at least as large in the meantime */
+			guit->bitmap->destroy(job->bitmap);
+		} else {
+			guit->bitmap->modified(job->bitmap);
+			image_cache__set_bitmap(centry, job->bitmap);
+			image_cache->miss_count++;
+			image_cache->miss_size += centry->bitmap_size;
+
+			msg_data.redraw.x = 0;
+			msg_data.redraw.y = 0;
+			msg_data.redraw.width = centry->content->width;
+			msg_data.redraw.height = centry->content->height;
+			content_broadcast(centry->content,
+					  CONTENT_MSG_REDRAW,
+					  &msg_data);
+		}
+		free(job);
+	}
+
+	if (pool->pending > 0) {
+		guit->misc->schedule(IMAGE_CACHE_POLL_TIME,
+				     image_cache__pool_poll,
+				     pool);
+	}
+}
+
+/**
+ * Queue an entry to be decoded by a worker.
+ *
+ * \param centry The image cache entry to decode.
+ * \param width The width the image will be plotted at.
+ * \param height The height the image will be plotted at.
+ * \return true if a decode is outstanding for the entry.
+ */
+static bool
+image_cache__queue(struct image_cache_entry_s *centry, int width, int height)
+{
+	struct image_cache_pool *pool = image_cache_pool;
+	struct image_cache_job *job;
+	const uint8_t *data;
+	size_t size;
+
+	if ((pool == NULL) || (centry->decoder == NULL)) {
+		return false;
+	}
+
+	if (centry->job != NULL) {
+		return true;
+	}
+
+	data = content__get_source_data(centry->content, &size);
+	if ((data == NULL) || (size == 0)) {
+		return false;
+	}
+
+	job = calloc(1, sizeof(struct image_cache_job));
+	if (job == NULL) {
+		return false;
+	}
+
+	job->params.target_width = width;
+	job->params.target_height = height;
+	job->bitmap = image_cache__decode_create(centry->decoder,
+						 data,
+						 size,
+						 &job->params,
+						 &job->pixels,
+						 &job->rowstride);
+	if (job->bitmap == NULL) {
+		free(job);
+		return false;
+	}
+
+	job->data = malloc(size);
+	if (job->data == NULL) {
+		guit->bitmap->destroy(job->bitmap);
+		free(job);
+		return false;
+	}
+	memcpy(job->data, data, size);
+	job->size = size;
+	job->decoder = centry->decoder;
+	job->centry = centry;
+
+	pthread_mutex_lock(&pool->lock);
+	if (pool->queue_tail == NULL) {
+		pool->queue = job;
+	} else {
+		pool->queue_tail->next = job;
+	}
+	pool->queue_tail = job;
+	pthread_cond_signal(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	centry->job = job;
+
+	if (pool->pending++ == 0) {
+		guit->misc->schedule(IMAGE_CACHE_POLL_TIME,
+				     image_cache__pool_poll,
+				     pool);
+	}
+
+	return true;
+}
+
+/**
+ * Cancel any outstanding decode of an entry.
+ *
+ * A job still waiting in the queue is freed straight away, one which
+ * a worker has already started is disowned and its result discarded
+ * when it is collected.
+ *
+ * \param centry The image cache entry to cancel the decode of.
+ */
+static void image_cache__cancel(struct image_cache_entry_s *centry)
+{
+	struct image_cache_pool *pool = image_cache_pool;
+	struct image_cache_job *job = centry->job;
+	struct image_cache_job **prev;
+	struct image_cache_job *last = NULL;
+	bool queued = false;
+
+	if (job == NULL) {
+		return;
+	}
+	centry->job = NULL;
+
+	pthread_mutex_lock(&pool->lock);
+	for (prev = &pool->queue; *prev != NULL; prev = &(*prev)->next) {
+		if (*prev == job) {
+			*prev = job->next;
+			if (pool->queue_tail == job) {
+				pool->queue_tail = last;
+			}
+			queued = true;
+			break;
+		}
+		last = *prev;
+	}
+	if (queued == false) {
+		job->centry = NULL;
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	if (queued) {
+		guit->bitmap->destroy(job->bitmap);
+		free(job->data);
+		free(job);
+		pool->pending--;
+	}
+}
+
+/**
+ * Start the decode worker pool.
+ *
+ * \param threads The number of worker threads to start.
+ */
+static void image_cache__pool_init(unsigned int threads)
+{
+	struct image_cache_pool *pool;
+
+	if (threads > IMAGE_CACHE_MAX_THREADS) {
+		threads = IMAGE_CACHE_MAX_THREADS;
+	}
+	if (threads == 0) {
+		return;
+	}
+
+	pool = calloc(1, sizeof(struct image_cache_pool));
+	if (pool == NULL) {
+		return;
+	}
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->cond, NULL);
+
+	while (pool->thread_count < threads) {
+		if (pthread_create(&pool->threads[pool->thread_count],
+				   NULL,
+				   image_cache__worker,
+				   pool) != 0) {
+			break;
+		}
+		pool->thread_count++;
+	}
+
+	if (pool->thread_count == 0) {
+		NSLOG(netsurf, WARNING, "Unable to start image decode workers");
+		pthread_cond_destroy(&pool->cond);
+		pthread_mutex_destroy(&pool->lock);
+		free(pool);
+		return;
+	}
+
+	NSLOG(netsurf, INFO, "Started %u image decode workers",
+	      pool->thread_count);
+
+	image_cache_pool = pool;
+}
+
+/**
+ * Stop the decode worker pool.
+ *
+ * All entries must have been freed, and so their jobs cancelled,
+ * before the pool is stopped.
+ */
+static void image_cache__pool_fini(void)
+{
+	struct image_cache_pool *pool = image_cache_pool;
+	struct image_cache_job *job;
+	unsigned int idx;
+
+	if (pool == NULL) {
+		return;
+	}
+	image_cache_pool = NULL;
+
+	guit->misc->schedule(-1, image_cache__pool_poll, pool);
+
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = true;
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (idx = 0; idx < pool->thread_count; idx++) {
+		pthread_join(pool->threads[idx], NULL);
+	}
+
+	while (pool->done != NULL) {
+		job = pool->done;
+		pool->done = job->next;
+		guit->bitmap->destroy(job->bitmap);
+		free(job);
+	}
+
+	pthread_cond_destroy(&pool->cond);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool);
+}
+#else
+static inline bool
+image_cache__queue(struct image_cache_entry_s *centry, int width, int height)
+{
+	return false;
+}
+
+static inline void image_cache__cancel(struct image_cache_entry_s *centry)
+{
+}
+#endif
+
+/**
+ * Plot a placeholder for an image which is being decoded.
+ *
+ * \param data The content redraw data.
+ * \param clip The current clip rectangle.
+ * \param ctx The current redraw context.
+ * \return true on success else false.
+ */
+static bool
+image_cache__plot_placeholder(struct content_redraw_data *data,
+			      const struct rect *clip,
+			      const struct redraw_context *ctx)
+{
+	struct rect area = *clip;
+
+	if (data->repeat_x != true) {
+		area.x0 = max(area.x0, data->x);
+		area.x1 = min(area.x1, data->x + data->width);
+	}
+
+	if (data->repeat_y != true) {
+		area.y0 = max(area.y0, data->y);
+		area.y1 = min(area.y1, data->y + data->height);
+	}
+
+	if ((area.x0 >= area.x1) || (area.y0 >= area.y1)) {
+		return true;
+	}
+
+	return (ctx->plot->rectangle(ctx,
+				     &image_cache_placeholder_style,
+				     &area) == NSERROR_OK);
+}
+
+/**
+ * Compute the validator of an entry's source data.
+ *
+ * The HTTP validators are used where the source had them, otherwise
+ * the source data itself is checked.
+ *
+ * \param centry The image cache entry.
+ * \return The validator.
+ */
+static uint32_t image_cache__validator(struct image_cache_entry_s *centry)
+{
+	const char *tag;
+	const uint8_t *data;
+	size_t size;
+
+	tag = llcache_handle_get_header(centry->content->llcache, "ETag");
+	if (tag == NULL) {
+		tag = llcache_handle_get_header(centry->content->llcache,
+						"Last-Modified");
+	}
+	if (tag != NULL) {
+		return crc32(0, (const Bytef *)tag, strlen(tag));
+	}
+
+	data = content__get_source_data(centry->content, &size);
+	return crc32(0, data, size);
+}
+
+/**
+ * Check if an entry's bitmap can be kept in the backing store.
+ *
+ * Rendered bitmaps are cheap to produce again at the size they are
+ * next needed and bitmaps which were never plotted are not worth the
+ * disc space.
+ *
+ * \param centry The image cache entry.
+ * \return true if the entry bitmap can be persisted.
+ */
+static bool image_cache__persistable(struct image_cache_entry_s *centry)
+{
+	return image_cache->params.persist &&
+		(centry->render == NULL) &&
+		(centry->partial == false) &&
+		(centry->content->llcache != NULL);
+}
+
+/**
+ * Put an entry's bitmap in the backing store.
+ *
+ * The bitmap is stored with the source object so it is discarded
+ * along with it, and only if the source is itself stored.
+ *
+ * \param centry The image cache entry to persist the bitmap of.
+ */
+static void image_cache__persist(struct image_cache_entry_s *centry)
+{
+	struct image_cache_persist_header header;
+	const uint8_t *buffer;
+	size_t rowstride;
+	size_t rowlen;
+	size_t datalen;
+	size_t size;
+	uint8_t *data;
+	nsurl *url;
+	int y;
+
+	if ((centry->bitmap == NULL) ||
+	    (centry->persisted) ||
+	    (centry->redraw_count == 0) ||
+	    (image_cache__persistable(centry) == false)) {
+		return;
+	}
+
+	buffer = guit->bitmap->get_buffer(centry->bitmap);
+	if (buffer == NULL) {
+		return;
+	}
+	rowstride = guit->bitmap->get_rowstride(centry->bitmap);
+
+	header.magic = IMAGE_CACHE_PERSIST_MAGIC;
+	header.validator = image_cache__validator(centry);
+	content__get_source_data(centry->content, &size);
+	header.source_size = size;
+	header.width = guit->bitmap->get_width(centry->bitmap);
+	header.height = guit->bitmap->get_height(centry->bitmap);
+	header.opaque = guit->bitmap->get_opaque(centry->bitmap) ? 1 : 0;
+
+	rowlen = (size_t)header.width * 4;
+	datalen = sizeof(header) + rowlen * header.height;
+	data = malloc(datalen);
+	if (data == NULL) {
+		return;
+	}
+
+	memcpy(data, &header, sizeof(header));
+	for (y = 0; y < (int)header.height; y++) {
+		memcpy(data + sizeof(header) + rowlen * y,
+		       buffer + rowstride * y,
+		       rowlen);
+	}
+
+	url = llcache_handle_get_url(centry->content->llcache);
+	if (guit->llcache->store(url,
+				 BACKING_STORE_BITMAP,
+				 data,
+				 datalen) != NSERROR_OK) {
+		free(data);
+		return;
+	}
+	guit->llcache->release(url, BACKING_STORE_BITMAP);
+
+	centry->persisted = true;
+	image_cache->persist_count++;
+}
+
+/**
+ * Retrieve an entry's bitmap from the backing store.
+ *
+ * The stored bitmap is only used if it was produced from the same
+ * source data and is suitable for the plotted size.
+ *
+ * \param centry The image cache entry to retrieve the bitmap of.
+ * \param width The width to be plotted at or zero for the image width.
+ * \param height The height to be plotted at or zero for the image height.
+ * \return The bitmap or NULL if none was suitable.
+ */
+static struct bitmap *
+image_cache__restore(struct image_cache_entry_s *centry, int width, int height)
+{
+	struct image_cache_persist_header header;
+	struct bitmap *bitmap = NULL;
+	uint8_t *buffer;
+	size_t rowstride;
+	size_t rowlen;
+	uint8_t *data;
+	size_t datalen;
+	size_t size;
+	uint64_t start;
+	uint64_t end;
+	nsurl *url;
+	int y;
+
+	if (image_cache__persistable(centry) == false) {
+		return NULL;
+	}
+
+	nsu_getmonotonic_ms(&start);
+
+	url = llcache_handle_get_url(centry->content->llcache);
+	if (guit->llcache->fetch(url,
+				 BACKING_STORE_BITMAP,
+				 &data,
+				 &datalen) != NSERROR_OK) {
+		return NULL;
+	}
+
+	if (datalen < sizeof(header)) {
+		goto restore_done;
+	}
+	memcpy(&header, data, sizeof(header));
+
+	content__get_source_data(centry->content, &size);
+	if ((header.magic != IMAGE_CACHE_PERSIST_MAGIC) ||
+	    (header.source_size != size) ||
+	    (header.width == 0) ||
+	    (header.height == 0) ||
+	    (header.width > (uint32_t)centry->content->width) ||
+	    (header.height > (uint32_t)centry->content->height)) {
+		goto restore_done;
+	}
+
+	rowlen = (size_t)header.width * 4;
+	if ((datalen != sizeof(header) + rowlen * header.height) ||
+	    (image_cache__fits(centry,
+			       header.width,
+			       header.height,
+			       width,
+			       height) == false) ||
+	    (header.validator != image_cache__validator(centry))) {
+		goto restore_done;
+	}
+
+	bitmap = guit->bitmap->create(header.width, header.height, BITMAP_NEW);
+	if (bitmap == NULL) {
+		goto restore_done;
+	}
+
+	buffer = guit->bitmap->get_buffer(bitmap);
+	if (buffer == NULL) {
+		guit->bitmap->destroy(bitmap);
+		bitmap = NULL;
+		goto restore_done;
+	}
+	rowstride = guit->bitmap->get_rowstride(bitmap);
+
+	for (y = 0; y < (int)header.height; y++) {
+		memcpy(buffer + rowstride * y,
+		       data + sizeof(header) + rowlen * y,
+		       rowlen);
+	}
+	guit->bitmap->set_opaque(bitmap, header.opaque != 0);
+	guit->bitmap->modified(bitmap);
+
+restore_done:
+	guit->llcache->release(url, BACKING_STORE_BITMAP);
+
+	if (bitmap != NULL) {
+		nsu_getmonotonic_ms(&end);
+		centry->conversion_time += end - start;
+
+		image_cache__set_bitmap(centry, bitmap);
+		centry->persisted = true;
+		image_cache->restore_count++;
+	}
+
+	return bitmap;
+}
+
 /**
  * free bitmap from an image cache entry
  *
@@ -254,6 +1201,9 @@ static void image_cache__unlink(struct image_cache_entry_s *centry)
  */
 static void image_cache__free_bitmap(struct image_cache_entry_s *centry)
 {
+	/* keep the bitmap to avoid decoding it again */
+	image_cache__persist(centry);
+
 	if (centry->bitmap != NULL) {
 #ifdef IMAGE_CACHE_VERBOSE
 		NSLOG(netsurf, INFO,
@@ -265,6 +1215,7 @@ static void image_cache__free_bitmap(struct image_cache_entry_s *centry)
 #endif
 		guit->bitmap->destroy(centry->bitmap);
 		centry->bitmap = NULL;
+		centry->progressive = false;
 		image_cache->total_bitmap_size -= centry->bitmap_size;
 		image_cache->bitmap_count--;
 		if (centry->redraw_count == 0) {
@@ -274,6 +1225,48 @@ static void image_cache__free_bitmap(struct image_cache_entry_s *centry)
 
 }
 
+/**
+ * Redraw the rows of a partially decoded image changed since last time.
+ *
+ * \param p The image cache entry.
+ */
+static void image_cache__progress_flush(void *p)
+{
+	struct image_cache_entry_s *centry = p;
+	union content_msg_data msg_data;
+
+	centry->progress_scheduled = false;
+	nsu_getmonotonic_ms(&centry->progress_time);
+
+	if (centry->progress_y1 <= centry->progress_y0) {
+		return;
+	}
+
+	msg_data.redraw.x = 0;
+	msg_data.redraw.y = centry->progress_y0;
+	msg_data.redraw.width = centry->content->width;
+	msg_data.redraw.height = centry->progress_y1 - centry->progress_y0;
+
+	centry->progress_y0 = 0;
+	centry->progress_y1 = 0;
+
+	content_broadcast(centry->content, CONTENT_MSG_REDRAW, &msg_data);
+}
+
+/**
+ * Stop progressive display of an entry.
+ *
+ * \param centry The image cache entry.
+ */
+static void image_cache__progress_end(struct image_cache_entry_s *centry)
+{
+	if (centry->progress_scheduled) {
+		guit->misc->schedule(-1, image_cache__progress_flush, centry);
+		centry->progress_scheduled = false;
+	}
+	centry->partial = false;
+}
+
 /**
  * free image cache entry
  *
@@ -289,34 +1282,178 @@ static void image_cache__free_entry(struct image_cache_entry_s *centry)
 		image_cache->total_unrendered++;
 	}
 
+	image_cache__cancel(centry);
+
+	/* a partially decoded bitmap must not be persisted */
 	image_cache__free_bitmap(centry);
 
+	image_cache__progress_end(centry);
+
 	image_cache__unlink(centry);
 
-	free(centry);
+	/* removing the entry from the index frees it */
+	hashmap_remove(image_cache->index, centry->content);
+}
+
+/**
+ * Convert an entry's content into a bitmap.
+ *
+ * The time taken is recorded so the cleaner can estimate what it
+ * would cost to convert the content again. If the entry has a
+ * renderer it is rendered at the plotted size, if it has a decoder it
+ * is asked for a bitmap no smaller than the plotted size, otherwise
+ * the content is converted at full size.
+ *
+ * Any existing bitmap is only replaced if the conversion succeeds.
+ *
+ * \param centry The image cache entry to convert.
+ * \param width The width to be plotted at or zero for the image width.
+ * \param height The height to be plotted at or zero for the image height.
+ * \return The new bitmap or NULL if conversion failed.
+ */
+static struct bitmap *
+image_cache__convert(struct image_cache_entry_s *centry, int width, int height)
+{
+	struct bitmap *bitmap;
+	const uint8_t *data;
+	size_t size;
+	uint64_t start;
+	uint64_t end;
+
+	nsu_getmonotonic_ms(&start);
+	if (centry->render != NULL) {
+		bitmap = centry->render(centry->content, width, height);
+	} else if (centry->decoder != NULL) {
+		data = content__get_source_data(centry->content, &size);
+		bitmap = image_cache_decode(centry->decoder,
+					    data, size, width, height);
+		if (bitmap == NULL) {
+			/* stop trying to decode at other sizes */
+			centry->decoder = NULL;
+		}
+	} else if (centry->convert != NULL) {
+		bitmap = centry->convert(centry->content);
+	} else {
+		return NULL;
+	}
+	nsu_getmonotonic_ms(&end);
+
+	centry->conversion_time += end - start;
+
+	if (bitmap != NULL) {
+		image_cache__set_bitmap(centry, bitmap);
+	}
+
+	return bitmap;
+}
+
+/**
+ * Eviction candidate for the cleaner.
+ */
+struct image_cache_victim {
+	struct image_cache_entry_s *centry; /**< candidate entry */
+	double score; /**< higher scores are evicted first */
+};
+
+/**
+ * Compute the eviction score of an entry.
+ *
+ * The score is the bitmap size and time since last redraw weighed
+ * against the cost of converting it again. The cost is the mean
+ * conversion time scaled by how often the image has had to be
+ * reconverted, so a large bitmap which is cheap to decode goes before
+ * a small one which is expensive to decode.
+ *
+ * \param icache The image cache context.
+ * \param centry The image cache entry to score.
+ * \return The eviction score.
+ */
+static double
+image_cache__score(struct image_cache_s *icache,
+		   struct image_cache_entry_s *centry)
+{
+	double cost;
+	double idle;
+
+	cost = 1.0;
+	if (centry->conversion_count > 0) {
+		cost += (double)centry->conversion_time /
+			centry->conversion_count;
+		cost *= centry->conversion_count;
+	}
+
+	idle = icache->current_age - centry->redraw_age;
+
+	return idle * centry->bitmap_size / cost;
+}
+
+/**
+ * Sort comparison placing the highest eviction score first.
+ */
+static int image_cache__victim_cmp(const void *a, const void *b)
+{
+	const struct image_cache_victim *va = a;
+	const struct image_cache_victim *vb = b;
+
+	if (va->score > vb->score) {
+		return -1;
+	}
+	if (va->score < vb->score) {
+		return 1;
+	}
+	return 0;
 }
 
 /**
  * Image cache cleaner
  *
+ * Frees bitmaps of entries not redrawn recently, in descending order
+ * of eviction score, until the cache is back below its target size.
+ *
  * \param icache The image cache context.
  */
 static void image_cache__clean(struct image_cache_s *icache)
 {
-	struct image_cache_entry_s *centry = icache->entries;
+	struct image_cache_entry_s *centry;
+	struct image_cache_victim *victims;
+	size_t target;
+	int count = 0;
+	int idx;
+
+	target = icache->params.limit - icache->params.hysteresis;
+	if ((icache->total_bitmap_size <= target) ||
+	    (icache->bitmap_count == 0)) {
+		return;
+	}
 
-	while (centry != NULL) {
-		if ((icache->current_age - centry->redraw_age) >
-		    icache->params.bg_clean_time) {
-			/* only consider older entries, avoids active entries */
-			if ((icache->total_bitmap_size >
-			     (icache->params.limit - icache->params.hysteresis)) &&
-			    (rand() > (RAND_MAX / 2))) {
-				image_cache__free_bitmap(centry);
-			}
+	victims = malloc(icache->bitmap_count * sizeof(*victims));
+	if (victims == NULL) {
+		return;
+	}
+
+	for (centry = icache->entries; centry != NULL; centry = centry->next) {
+		/* only consider older entries, avoids active entries */
+		if ((centry->bitmap != NULL) &&
+		    (centry->partial == false) &&
+		    (count < icache->bitmap_count) &&
+		    ((icache->current_age - centry->redraw_age) >
+		     icache->params.bg_clean_time)) {
+			victims[count].centry = centry;
+			victims[count].score = image_cache__score(icache, centry);
+			count++;
+		}
+	}
+
+	qsort(victims, count, sizeof(*victims), image_cache__victim_cmp);
+
+	for (idx = 0; idx < count; idx++) {
+		if (icache->total_bitmap_size <= target) {
+			break;
 		}
-		centry=centry->next;
+		image_cache__free_bitmap(victims[idx].centry);
 	}
+
+	free(victims);
 }
 
 /**
@@ -353,12 +1490,8 @@ struct bitmap *image_cache_get_bitmap(const struct content *c)
 	}
 
 	if (centry->bitmap == NULL) {
-		if (centry->convert != NULL) {
-			centry->bitmap = centry->convert(centry->content);
-		}
-
-		if (centry->bitmap != NULL) {
-			image_cache_stats_bitmap_add(centry);
+		if ((image_cache__restore(centry, 0, 0) != NULL) ||
+		    (image_cache__convert(centry, 0, 0) != NULL)) {
 			image_cache->miss_count++;
 			image_cache->miss_size += centry->bitmap_size;
 		} else {
@@ -368,6 +1501,12 @@ struct bitmap *image_cache_get_bitmap(const struct content *c)
 	} else {
 		image_cache->hit_count++;
 		image_cache->hit_size += centry->bitmap_size;
+
+		/* callers expect the bitmap at the image size */
+		if (image_cache__resize_needed(centry, 0, 0) &&
+		    (image_cache__restore(centry, 0, 0) == NULL)) {
+			image_cache__convert(centry, 0, 0);
+		}
 	}
 
 	return centry->bitmap;
@@ -398,6 +1537,13 @@ bool image_cache_speculate(struct content *c)
 	return decision;
 }
 
+/* exported interface documented in image_cache.h */
+bool image_cache_progressive(struct content *c)
+{
+	return image_cache->total_bitmap_size + c->size <=
+		image_cache->params.limit;
+}
+
 /* exported interface documented in image_cache.h */
 struct bitmap *image_cache_find_bitmap(struct content *c)
 {
@@ -422,10 +1568,21 @@ image_cache_init(const struct image_cache_parameters *image_cache_parameters)
 
 	image_cache->params = *image_cache_parameters;
 
+	image_cache->index = hashmap_create(&image_cache_index_parameters);
+	if (image_cache->index == NULL) {
+		free(image_cache);
+		image_cache = NULL;
+		return NSERROR_NOMEM;
+	}
+
 	guit->misc->schedule(image_cache->params.bg_clean_time,
 				image_cache__background_update,
 				image_cache);
 
+#ifdef WITH_IMAGE_THREAD
+	image_cache__pool_init(image_cache->params.decode_threads);
+#endif
+
 	NSLOG(netsurf, INFO,
 	      "Image cache initialised with a limit of %"PRIsizet" hysteresis of %"PRIsizet,
 	      image_cache->params.limit,
@@ -441,6 +1598,9 @@ nserror image_cache_fini(void)
 
 	guit->misc->schedule(-1, image_cache__background_update, image_cache);
 
+	/* the backing store has already been finalised */
+	image_cache->params.persist = false;
+
 	NSLOG(netsurf, INFO, "Size at finish %"PRIsizet" (in %d)",
 	      image_cache->total_bitmap_size, image_cache->bitmap_count);
 
@@ -448,6 +1608,10 @@ nserror image_cache_fini(void)
 		image_cache__free_entry(image_cache->entries);
 	}
 
+#ifdef WITH_IMAGE_THREAD
+	image_cache__pool_fini();
+#endif
+
 	op_count = image_cache->hit_count +
 		image_cache->miss_count +
 		image_cache->fail_count;
@@ -501,6 +1665,11 @@ nserror image_cache_fini(void)
 	      image_cache->peak_conversions_size,
 	      image_cache->peak_conversions);
 
+	NSLOG(netsurf, INFO, "Bitmaps persisted/restored %d/%d",
+	      image_cache->persist_count,
+	      image_cache->restore_count);
+
+	hashmap_destroy(image_cache->index);
 	free(image_cache);
 
 	return NSERROR_OK;
@@ -521,12 +1690,11 @@ nserror image_cache_add(struct content *content,
 	centry = image_cache__find(content);
 	if (centry == NULL) {
 		/* new cache entry, content not previously added */
-		centry = calloc(1, sizeof(struct image_cache_entry_s));
+		centry = hashmap_insert(image_cache->index, content);
 		if (centry == NULL) {
 			return NSERROR_NOMEM;
 		}
 		image_cache__link(centry);
-		centry->content = content;
 
 		centry->bitmap_size = content->width * content->height * 4;
 	}
@@ -536,23 +1704,25 @@ nserror image_cache_add(struct content *content,
 
 	centry->convert = convert;
 
+	/* any progressive display is complete, the final redraw comes
+	 * from the content becoming done.
+	 */
+	image_cache__progress_end(centry);
+
 	/* set bitmap entry if one is passed, free extant one if present */
-	if (bitmap != NULL) {
-		if (centry->bitmap != NULL) {
-			guit->bitmap->destroy(centry->bitmap);
-		} else {
-			image_cache_stats_bitmap_add(centry);
-		}
-		centry->bitmap = bitmap;
+	if ((bitmap != NULL) && (bitmap == centry->bitmap)) {
+		/* progressively decoded bitmap is already in place, it
+		 * is replaced by one decoded at the plot size when it is
+		 * next redrawn smaller than the image.
+		 */
+	} else if (bitmap != NULL) {
+		image_cache__set_bitmap(centry, bitmap);
 	} else {
 		/* no bitmap, check to see if we should speculatively convert */
 		if ((centry->convert != NULL) &&
 		    (image_cache_speculate(content) == true)) {
-			centry->bitmap = centry->convert(centry->content);
-
-			if (centry->bitmap != NULL) {
-				image_cache_stats_bitmap_add(centry);
-			} else {
+			if ((image_cache__restore(centry, 0, 0) == NULL) &&
+			    (image_cache__convert(centry, 0, 0) == NULL)) {
 				image_cache->fail_count++;
 			}
 		}
@@ -563,6 +1733,117 @@ nserror image_cache_add(struct content *content,
 	return NSERROR_OK;
 }
 
+/* exported interface documented in image_cache.h */
+nserror image_cache_progress(struct content *content,
+			     struct bitmap *bitmap,
+			     int y0,
+			     int y1)
+{
+	struct image_cache_entry_s *centry;
+	uint64_t now;
+	int delay;
+
+	centry = image_cache__find(content);
+	if (centry == NULL) {
+		centry = hashmap_insert(image_cache->index, content);
+		if (centry == NULL) {
+			return NSERROR_NOMEM;
+		}
+		image_cache__link(centry);
+	}
+
+	if (centry->bitmap != bitmap) {
+		image_cache__set_bitmap(centry, bitmap);
+		centry->progressive = true;
+	}
+	centry->partial = true;
+
+	/* accumulate the changed rows */
+	if (centry->progress_y1 <= centry->progress_y0) {
+		centry->progress_y0 = y0;
+		centry->progress_y1 = y1;
+	} else {
+		centry->progress_y0 = min(centry->progress_y0, y0);
+		centry->progress_y1 = max(centry->progress_y1, y1);
+	}
+
+	if (centry->progress_scheduled == false) {
+		nsu_getmonotonic_ms(&now);
+		delay = 0;
+		if (now < centry->progress_time + IMAGE_CACHE_PROGRESS_TIME) {
+			delay = centry->progress_time +
+				IMAGE_CACHE_PROGRESS_TIME - now;
+		}
+		centry->progress_scheduled = true;
+		guit->misc->schedule(delay, image_cache__progress_flush, centry);
+	}
+
+	return NSERROR_OK;
+}
+
+/* exported interface documented in image_cache.h */
+nserror image_cache_set_decoder(struct content *content,
+				const struct image_cache_decoder *decoder)
+{
+	struct image_cache_entry_s *centry;
+
+	centry = image_cache__find(content);
+	if (centry == NULL) {
+		return NSERROR_NOT_FOUND;
+	}
+
+	centry->decoder = decoder;
+
+	return NSERROR_OK;
+}
+
+/* exported interface documented in image_cache.h */
+struct bitmap *image_cache_decode(const struct image_cache_decoder *decoder,
+				  const uint8_t *data,
+				  size_t size,
+				  int width,
+				  int height)
+{
+	struct image_cache_decode_params params;
+	struct bitmap *bitmap;
+	uint8_t *pixels;
+	size_t rowstride;
+
+	params.target_width = width;
+	params.target_height = height;
+	bitmap = image_cache__decode_create(decoder, data, size,
+					    &params, &pixels, &rowstride);
+	if (bitmap == NULL) {
+		return NULL;
+	}
+
+	if (decoder->decode(data, size, &params, pixels, rowstride) == false) {
+		guit->bitmap->destroy(bitmap);
+		return NULL;
+	}
+
+	guit->bitmap->modified(bitmap);
+
+	return bitmap;
+}
+
+/* exported interface documented in image_cache.h */
+nserror image_cache_set_renderer(struct content *content,
+				 image_cache_render_fn *render)
+{
+	struct image_cache_entry_s *centry;
+
+	centry = image_cache__find(content);
+	if (centry == NULL) {
+		return NSERROR_NOT_FOUND;
+	}
+
+	image_cache__free_bitmap(centry);
+	centry->render = render;
+
+	return NSERROR_OK;
+}
+
 /* exported interface documented in image_cache.h */
 nserror image_cache_remove(struct content *content)
 {
@@ -811,12 +2092,19 @@ bool image_cache_redraw(struct content *c,
 	}
 
 	if (centry->bitmap == NULL) {
-		if (centry->convert != NULL) {
-			centry->bitmap = centry->convert(centry->content);
+		if ((image_cache__restore(centry,
+					  data->width,
+					  data->height) == NULL) &&
+		    image_cache__queue(centry, data->width, data->height)) {
+			/* plot a placeholder until the worker is done */
+			centry->redraw_age = image_cache->current_age;
+			return image_cache__plot_placeholder(data, clip, ctx);
 		}
 
-		if (centry->bitmap != NULL) {
-			image_cache_stats_bitmap_add(centry);
+		if ((centry->bitmap != NULL) ||
+		    (image_cache__convert(centry,
+					  data->width,
+					  data->height) != NULL)) {
 			image_cache->miss_count++;
 			image_cache->miss_size += centry->bitmap_size;
 		} else {
@@ -827,6 +2115,20 @@ bool image_cache_redraw(struct content *c,
 	} else {
 		image_cache->hit_count++;
 		image_cache->hit_size += centry->bitmap_size;
+
+		/* the bitmap was decoded for a smaller plot, the current
+		 * one is scaled up until a larger one is available. A
+		 * rendered bitmap is replaced by one of the plotted size.
+		 */
+		if (image_cache__resize_needed(centry,
+					       data->width,
+					       data->height) &&
+		    (image_cache__restore(centry,
+					  data->width,
+					  data->height) == NULL) &&
+		    !image_cache__queue(centry, data->width, data->height)) {
+			image_cache__convert(centry, data->width, data->height);
+		}
 	}
 
 
@@ -861,7 +2163,23 @@ void *image_cache_get_internal(const struct content *c, void *context)
 /* exported interface documented in image_cache.h */
 bool image_cache_is_opaque(struct content *c)
 {
+	struct image_cache_entry_s *centry;
 	struct bitmap *bmp;
+
+	/* an image being decoded is drawn as a placeholder, so do not
+	 * stall converting it just to answer this
+	 */
+	centry = image_cache__find(c);
+	if (centry != NULL) {
+		if (centry->bitmap != NULL) {
+			return guit->bitmap->get_opaque(centry->bitmap);
+		}
+		if ((image_cache__restore(centry, 0, 0) == NULL) &&
+		    image_cache__queue(centry, 0, 0)) {
+			return false;
+		}
+	}
+
 	bmp = image_cache_get_bitmap(c);
 	if (bmp != NULL) {
 		return guit->bitmap->get_opaque(bmp);
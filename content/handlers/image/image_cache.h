@@ -37,6 +37,9 @@
 #ifndef NETSURF_IMAGE_IMAGE_CACHE_H_
 #define NETSURF_IMAGE_IMAGE_CACHE_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "utils/errors.h"
 #include "netsurf/content_type.h"
 
@@ -46,6 +49,73 @@ struct redraw_context;
 
 typedef struct bitmap * (image_cache_convert_fn) (struct content *content);
 
+/**
+ * Bitmap a decoder produces from some image source data.
+ *
+ * The plot size is set by the cache, the rest is filled in by the
+ * decoder's measure routine on the main thread. The bitmap is created
+ * there from these parameters and its pixel buffer handed to the
+ * decode routine along with them.
+ */
+struct image_cache_decode_params {
+	int target_width; /**< width to be plotted at, zero for full size */
+	int target_height; /**< height to be plotted at, zero for full size */
+
+	int width; /**< width of the bitmap to decode into */
+	int height; /**< height of the bitmap to decode into */
+	unsigned int flags; /**< bitmap creation flags */
+	int option; /**< decoder setting read from the options */
+};
+
+/**
+ * Read the header of image source data to size its bitmap.
+ *
+ * Always called on the main thread. The decoded bitmap may be smaller
+ * than the image as long as it is no smaller than the plot size in
+ * either dimension.
+ *
+ * \param data The image source data.
+ * \param size The length of the source data.
+ * \param params The plot size, updated with the bitmap to create.
+ * eturn true on success or false if the data cannot be decoded.
+ */
+typedef bool (image_cache_measure_fn) (const uint8_t *data,
+		size_t size, struct image_cache_decode_params *params);
+
+/**
+ * Decode image source data into a bitmap's pixel buffer.
+ *
+ * Decoders of this type may be run on a worker thread. They must only
+ * use the source data and buffer they are given, never the content it
+ * came from, the frontend bitmap table, the log or the options.
+ *
+ * \param data The image source data.
+ * \param size The length of the source data.
+ * \param params The parameters filled in by the measure routine.
+ * \param pixels The pixel buffer of a bitmap created from params.
+ * \param rowstride The row stride of the pixel buffer.
+ * eturn true on success or false if decoding failed.
+ */
+typedef bool (image_cache_decode_fn) (const uint8_t *data,
+		size_t size, const struct image_cache_decode_params *params,
+		uint8_t *pixels, size_t rowstride);
+
+/** Image handler decoder which works only on the source data. */
+struct image_cache_decoder {
+	image_cache_measure_fn *measure; /**< size the bitmap */
+	image_cache_decode_fn *decode; /**< decode into the bitmap */
+};
+
+/**
+ * Render a content into a bitmap of exactly the given size.
+ *
+ * Renderers are always run on the main thread and may use the
+ * content they are given. Zero width or height asks for the content
+ * at its own size.
+ */
+typedef struct bitmap * (image_cache_render_fn) (struct content *content,
+		int width, int height);
+
 struct image_cache_parameters {
 	/** How frequently the background cache clean process is run (ms) */
 	unsigned int bg_clean_time;
@@ -58,6 +128,22 @@ struct image_cache_parameters {
 
 	/** The speculative conversion "small" size */
 	size_t speculative_small;
+
+	/**
+	 * Number of worker threads used to decode images off the
+	 * redraw path. Zero decodes synchronously. Ignored unless
+	 * built with WITH_IMAGE_THREAD. Bitmaps are created and
+	 * finished on the main thread, the workers only write into
+	 * their pixel buffers.
+	 */
+	unsigned int decode_threads;
+
+	/**
+	 * Whether bitmaps are kept in the low level cache backing
+	 * store when they are freed, and retrieved from there in
+	 * preference to converting the image again.
+	 */
+	bool persist;
 };
 
 /** Initialise the image cache 
@@ -80,6 +166,83 @@ nserror image_cache_add(struct content *content,
 
 nserror image_cache_remove(struct content *content);
 
+/**
+ * Publish a partially decoded image.
+ *
+ * Image handlers which decode while the source is still arriving call
+ * this with the rows decoded so far so the image can be displayed
+ * before it is complete. The bitmap is held by the cache, and never
+ * evicted, until the content is added with image_cache_add(), which
+ * should pass the same bitmap once decoding is finished. Redraws of
+ * the changed rows are requested at a limited rate.
+ *
+ * \param content The content being decoded.
+ * \param bitmap The bitmap being decoded into.
+ * \param y0 The first changed row.
+ * \param y1 The row after the last changed row.
+ * \return NSERROR_OK on success or NSERROR_NOMEM.
+ */
+nserror image_cache_progress(struct content *content,
+			     struct bitmap *bitmap,
+			     int y0,
+			     int y1);
+
+/**
+ * Set the decoder used to convert a cached content off the redraw path.
+ *
+ * When a redraw finds no bitmap for a content with a decoder, a copy
+ * of its source data is queued to a decode worker and a placeholder
+ * is plotted. The content is asked to redraw once the bitmap is
+ * ready. Removing the content from the cache cancels any outstanding
+ * decode.
+ *
+ * Bitmaps are decoded at the size they are plotted at, and decoded
+ * again at a larger size only when plotted larger.
+ * image_cache_get_bitmap() always returns the image at full size.
+ *
+ * \param content The content handle used as a key
+ * \param decoder The decoder or NULL to always convert synchronously.
+ * \return NSERROR_OK on success or NSERROR_NOT_FOUND if the content
+ *         has not been added to the cache.
+ */
+nserror image_cache_set_decoder(struct content *content,
+				const struct image_cache_decoder *decoder);
+
+/**
+ * Decode image source data into a new bitmap on the main thread.
+ *
+ * \param decoder The decoder to use.
+ * \param data The image source data.
+ * \param size The length of the source data.
+ * \param width The width to be plotted at or zero for full size.
+ * \param height The height to be plotted at or zero for full size.
+ * \return The decoded bitmap or NULL on failure.
+ */
+struct bitmap *image_cache_decode(const struct image_cache_decoder *decoder,
+				  const uint8_t *data,
+				  size_t size,
+				  int width,
+				  int height);
+
+/**
+ * Set the renderer used to draw a cached content at its plotted size.
+ *
+ * This suits contents which can be drawn at any size, such as vector
+ * images. The cache holds one bitmap rendered at the size the content
+ * was last plotted at and serves redraws at that size from it, so the
+ * content is only rendered again when the plotted size changes.
+ *
+ * Any bitmap already held is discarded, so this should be called
+ * again whenever the content changes.
+ *
+ * \param content The content handle used as a key
+ * \param render The renderer or NULL to stop rendering by size.
+ * \return NSERROR_OK on success or NSERROR_NOT_FOUND if the content
+ *         has not been added to the cache.
+ */
+nserror image_cache_set_renderer(struct content *content,
+				 image_cache_render_fn *render);
+
 
 /** Obtain a bitmap from a content converting from source if neccessary. */
 struct bitmap *image_cache_get_bitmap(const struct content *c);
@@ -99,6 +262,18 @@ struct bitmap *image_cache_find_bitmap(struct content *c);
  */
 bool image_cache_speculate(struct content *c);
 
+/**
+ * Decide if a content should be decoded while it downloads.
+ *
+ * A partially decoded bitmap is held at the image size and cannot be
+ * evicted until the content is added, so one is only started while
+ * it fits in the cache below its target usage.
+ *
+ * \param c The content to be considered.
+ * \return true if a progressive decode should be started.
+ */
+bool image_cache_progressive(struct content *c);
+
 /**
  * Fill a buffer with information about a cache entry using a format.
  *
@@ -25,12 +25,15 @@
  */
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <setjmp.h>
 
 #include "utils/utils.h"
 #include "utils/log.h"
 #include "utils/messages.h"
+#include "utils/nsoption.h"
+#include "utils/pixels.h"
 #include "netsurf/bitmap.h"
 #include "content/llcache.h"
 #include "content/content.h"
@@ -49,6 +52,9 @@
  */
 #define MIN_JPEG_SIZE 20
 
+/** maximum number of scanlines read by one call to the library */
+#define NSJPEG_SCANLINES 8
+
 #ifdef riscos
 /* We prefer the library to be configured with these options to save
  * copying data during decoding. */
@@ -58,6 +64,34 @@
 /* but we don't care if we're not on RISC OS */
 #endif
 
+/** State of decoding a jpeg while it is downloading */
+enum nsjpeg_state {
+	NSJPEG_NONE = 0, /**< not decoding progressively */
+	NSJPEG_HEADER, /**< waiting for the header */
+	NSJPEG_START, /**< starting decompression */
+	NSJPEG_SCAN, /**< starting output of a scan */
+	NSJPEG_ROWS, /**< reading scanlines */
+	NSJPEG_FINISH_OUTPUT, /**< finishing output of a scan */
+	NSJPEG_FINISH, /**< finishing decompression */
+	NSJPEG_DONE, /**< bitmap is complete */
+};
+
+typedef struct nsjpeg_content {
+	struct content base; /**< base content type */
+
+	/* Progressive decode state, only used while downloading */
+
+	enum nsjpeg_state state;
+	struct jpeg_decompress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+	struct jpeg_source_mgr source_mgr;
+	jmp_buf setjmp_buffer;
+	size_t offset; /**< source data consumed by the decompressor */
+	size_t skip; /**< bytes to skip once they have arrived */
+	int output_scan; /**< last scan output in buffered image mode */
+	struct bitmap *bitmap; /**< bitmap being decoded into */
+} nsjpeg_content;
+
 static char nsjpeg_error_buffer[JMSG_LENGTH_MAX];
 
 static unsigned char nsjpeg_eoi[] = { 0xff, JPEG_EOI };
@@ -70,21 +104,25 @@ static nserror nsjpeg_create(const content_handler *handler,
 		llcache_handle *llcache, const char *fallback_charset,
 		bool quirks, struct content **c)
 {
-	struct content *jpeg;
+	nsjpeg_content *jpeg;
 	nserror error;
 
-	jpeg = calloc(1, sizeof(struct content));
+	jpeg = calloc(1, sizeof(nsjpeg_content));
 	if (jpeg == NULL)
 		return NSERROR_NOMEM;
 
-	error = content__init(jpeg, handler, imime_type, params,
+	error = content__init(&jpeg->base, handler, imime_type, params,
 			      llcache, fallback_charset, quirks);
 	if (error != NSERROR_OK) {
 		free(jpeg);
 		return error;
 	}
 
-	*c = jpeg;
+	if (nsoption_bool(progressive_images)) {
+		jpeg->state = NSJPEG_HEADER;
+	}
+
+	*c = &jpeg->base;
 
 	return NSERROR_OK;
 }
@@ -135,6 +173,35 @@ static void nsjpeg_term_source(j_decompress_ptr cinfo)
 }
 
 
+/**
+ * JPEG data source manager: suspend until more data arrives.
+ */
+static boolean nsjpeg_fill_input_suspend(j_decompress_ptr cinfo)
+{
+	return FALSE;
+}
+
+
+/**
+ * JPEG data source manager: skip data which may not have arrived yet.
+ */
+static void nsjpeg_skip_input_suspend(j_decompress_ptr cinfo, long num_bytes)
+{
+	nsjpeg_content *jpeg_c;
+
+	if ((long) cinfo->src->bytes_in_buffer < num_bytes) {
+		jpeg_c = (nsjpeg_content *)((char *)cinfo -
+				offsetof(nsjpeg_content, cinfo));
+		jpeg_c->skip = num_bytes - cinfo->src->bytes_in_buffer;
+		cinfo->src->next_input_byte += cinfo->src->bytes_in_buffer;
+		cinfo->src->bytes_in_buffer = 0;
+	} else if (num_bytes > 0) {
+		cinfo->src->next_input_byte += num_bytes;
+		cinfo->src->bytes_in_buffer -= num_bytes;
+	}
+}
+
+
 /**
  * Error output handler for JPEG library.
  *
@@ -144,8 +211,10 @@ static void nsjpeg_term_source(j_decompress_ptr cinfo)
  */
 static void nsjpeg_error_log(j_common_ptr cinfo)
 {
-	cinfo->err->format_message(cinfo, nsjpeg_error_buffer);
-	NSLOG(netsurf, INFO, "%s", nsjpeg_error_buffer);
+	char message[JMSG_LENGTH_MAX];
+
+	cinfo->err->format_message(cinfo, message);
+	NSLOG(netsurf, INFO, "%s", message);
 }
 
 
@@ -157,29 +226,185 @@ static void nsjpeg_error_log(j_common_ptr cinfo)
 static void nsjpeg_error_exit(j_common_ptr cinfo)
 {
 	jmp_buf *setjmp_buffer = (jmp_buf *) cinfo->client_data;
+	char message[JMSG_LENGTH_MAX];
 
-	cinfo->err->format_message(cinfo, nsjpeg_error_buffer);
-	NSLOG(netsurf, INFO, "%s", nsjpeg_error_buffer);
+	cinfo->err->format_message(cinfo, message);
+	NSLOG(netsurf, INFO, "%s", message);
 
 	longjmp(*setjmp_buffer, 1);
 }
 
 /**
- * create a bitmap from jpeg content.
+ * Convert a decoded scanline to the NetSurf pixel format in place.
+ *
+ * \param cinfo The decompressor the scanline was read from.
+ * \param row The scanline, with room for four bytes per pixel.
  */
-static struct bitmap *
-jpeg_cache_convert(struct content *c)
+static void nsjpeg_convert_scanline(j_decompress_ptr cinfo, JSAMPROW row)
+{
+	int width = cinfo->output_width;
+
+	if (cinfo->out_color_space == JCS_GRAYSCALE) {
+		pixels_grey_to_rgba(row, row, width);
+	} else if (cinfo->out_color_space == JCS_CMYK) {
+		/* Trivial inverse CMYK -> RGBA */
+		pixels_cmyk_to_rgba(row, row, width);
+	} else {
+#if RGB_RED == 0 && RGB_GREEN == 1 && RGB_BLUE == 2 && RGB_PIXELSIZE == 3
+		pixels_rgb_to_rgba(row, row, width);
+#elif RGB_RED != 0 || RGB_GREEN != 1 || RGB_BLUE != 2 || RGB_PIXELSIZE != 4
+		/* Missmatch between configured libjpeg pixel format and
+		 * NetSurf pixel format.  Convert to RGBA */
+		int i;
+		for (i = width - 1; 0 <= i; i--) {
+			int r = row[i * RGB_PIXELSIZE + RGB_RED];
+			int g = row[i * RGB_PIXELSIZE + RGB_GREEN];
+			int b = row[i * RGB_PIXELSIZE + RGB_BLUE];
+			row[i * 4 + 0] = r;
+			row[i * 4 + 1] = g;
+			row[i * 4 + 2] = b;
+			row[i * 4 + 3] = 0xff;
+		}
+#endif
+	}
+}
+
+/**
+ * Set the output colour space and decode method for a jpeg.
+ *
+ * The profile, a jpeg_decode_profile option value, selects between
+ * accurate decoding and the faster integer DCT without fancy chroma
+ * upsampling. The greyscale profile has the library produce luminance
+ * only, which skips chroma upsampling and colour conversion entirely.
+ * Greyscale jpegs are always decoded to greyscale as the result is
+ * identical.
+ */
+static void nsjpeg_set_colour_space(j_decompress_ptr cinfo, int profile)
+{
+	if (cinfo->jpeg_color_space == JCS_CMYK ||
+			cinfo->jpeg_color_space == JCS_YCCK) {
+		/* the library cannot convert these to greyscale */
+		cinfo->out_color_space = JCS_CMYK;
+	} else if ((cinfo->jpeg_color_space == JCS_GRAYSCALE) ||
+		   (profile == NSJPEG_PROFILE_GREY)) {
+		cinfo->out_color_space = JCS_GRAYSCALE;
+	} else {
+		cinfo->out_color_space = JCS_RGB;
+	}
+
+	if (profile == NSJPEG_PROFILE_ACCURATE) {
+		cinfo->dct_method = JDCT_ISLOW;
+	} else {
+		cinfo->dct_method = JDCT_IFAST;
+		cinfo->do_fancy_upsampling = FALSE;
+	}
+}
+
+/**
+ * Read and convert the next scanlines of the current output pass.
+ *
+ * \param cinfo The decompressor to read from.
+ * \param pixels The bitmap buffer being decoded into.
+ * \param rowstride The bitmap row stride.
+ * \return The number of scanlines read, zero if the source suspended.
+ */
+static JDIMENSION
+nsjpeg_read_scanlines(j_decompress_ptr cinfo, uint8_t *pixels, size_t rowstride)
+{
+	JSAMPROW scanlines[NSJPEG_SCANLINES];
+	JDIMENSION count;
+	JDIMENSION row;
+
+	count = min(cinfo->output_height - cinfo->output_scanline,
+		    (JDIMENSION)NSJPEG_SCANLINES);
+	for (row = 0; row < count; row++) {
+		scanlines[row] = (JSAMPROW) (pixels + rowstride *
+					     (cinfo->output_scanline + row));
+	}
+
+	count = jpeg_read_scanlines(cinfo, scanlines, count);
+	for (row = 0; row < count; row++) {
+		nsjpeg_convert_scanline(cinfo, scanlines[row]);
+	}
+
+	return count;
+}
+
+/**
+ * Select the DCT scaling used to decode a jpeg for a plot size.
+ *
+ * The smallest scale whose output is at least the plotted size is
+ * used, so libjpeg skips the work of producing pixels which would
+ * only be thrown away when the bitmap is plotted. Libraries before
+ * version 7 only support scaling by powers of two.
+ *
+ * \param cinfo The decompressor, with the header read.
+ * \param width The width to be plotted at or zero for full size.
+ * \param height The height to be plotted at or zero for full size.
+ */
+static void
+nsjpeg_set_scale(j_decompress_ptr cinfo, int width, int height)
+{
+	unsigned int num;
+
+	cinfo->scale_num = 8;
+	cinfo->scale_denom = 8;
+
+	if ((width <= 0) || (height <= 0)) {
+		return;
+	}
+
+	for (num = 1; num < 8; num++) {
+#if JPEG_LIB_VERSION < 70
+		if ((num & (num - 1)) != 0) {
+			continue;
+		}
+#endif
+		if (((cinfo->image_width * num + 7) / 8 >= (unsigned int)width) &&
+		    ((cinfo->image_height * num + 7) / 8 >= (unsigned int)height)) {
+			cinfo->scale_num = num;
+			break;
+		}
+	}
+}
+
+/**
+ * Warning handler for decodes which may run on a worker thread.
+ *
+ * The log may only be used from the main thread so warnings are
+ * discarded.
+ */
+static void nsjpeg_error_discard(j_common_ptr cinfo)
+{
+}
+
+
+/**
+ * Fatal error handler for decodes which may run on a worker thread.
+ *
+ * As nsjpeg_error_exit without logging the error.
+ */
+static void nsjpeg_error_unwind(j_common_ptr cinfo)
+{
+	jmp_buf *setjmp_buffer = (jmp_buf *) cinfo->client_data;
+
+	longjmp(*setjmp_buffer, 1);
+}
+
+/**
+ * Size the bitmap a jpeg is decoded into for a plot size.
+ *
+ * Called on the main thread, which reads the decode profile option
+ * for the decode.
+ */
+static bool
+jpeg_cache_measure(const uint8_t *source_data,
+		   size_t source_size,
+		   struct image_cache_decode_params *params)
 {
-	const uint8_t *source_data; /* Jpeg source data */
-	size_t source_size; /* length of Jpeg source data */
 	struct jpeg_decompress_struct cinfo;
 	struct jpeg_error_mgr jerr;
 	jmp_buf setjmp_buffer;
-	unsigned int height;
-	unsigned int width;
-	struct bitmap * volatile bitmap = NULL;
-	uint8_t * volatile pixels = NULL;
-	size_t rowstride;
 	struct jpeg_source_mgr source_mgr = {
 		0,
 		0,
@@ -189,12 +414,10 @@ jpeg_cache_convert(struct content *c)
 		jpeg_resync_to_restart,
 		nsjpeg_term_source };
 
-	/* obtain jpeg source data and perfom minimal sanity checks */
-	source_data = content__get_source_data(c, &source_size);
-
+	/* perfom minimal sanity checks on the source data */
 	if ((source_data == NULL) ||
 	    (source_size < MIN_JPEG_SIZE)) {
-		return NULL;
+		return false;
 	}
 
 	/* setup a JPEG library error handler */
@@ -202,10 +425,10 @@ jpeg_cache_convert(struct content *c)
 	jerr.error_exit = nsjpeg_error_exit;
 	jerr.output_message = nsjpeg_error_log;
 
-	/* handler for fatal errors during decompression */
+	/* handler for fatal errors reading the header */
 	if (setjmp(setjmp_buffer)) {
 		jpeg_destroy_decompress(&cinfo);
-		return bitmap;
+		return false;
 	}
 
 	cinfo.client_data = &setjmp_buffer;
@@ -219,89 +442,361 @@ jpeg_cache_convert(struct content *c)
 	/* read JPEG header information */
 	jpeg_read_header(&cinfo, TRUE);
 
-	/* set output processing parameters */
-	if (cinfo.jpeg_color_space == JCS_CMYK ||
-			cinfo.jpeg_color_space == JCS_YCCK) {
-		cinfo.out_color_space = JCS_CMYK;
-	} else {
-		cinfo.out_color_space = JCS_RGB;
-	}
-	cinfo.dct_method = JDCT_ISLOW;
+	/* set output processing parameters and compute the output size */
+	params->option = nsoption_int(jpeg_decode_profile);
+	nsjpeg_set_colour_space(&cinfo, params->option);
+	nsjpeg_set_scale(&cinfo, params->target_width, params->target_height);
+	jpeg_calc_output_dimensions(&cinfo);
 
-	/* commence the decompression, output parameters now valid */
-	jpeg_start_decompress(&cinfo);
+	params->width = cinfo.output_width;
+	params->height = cinfo.output_height;
+	/* jpegs cannot be transparent */
+	params->flags = BITMAP_NEW | BITMAP_OPAQUE;
+
+	jpeg_destroy_decompress(&cinfo);
 
-	width = cinfo.output_width;
-	height = cinfo.output_height;
+	return true;
+}
 
-	/* create opaque bitmap (jpegs cannot be transparent) */
-	bitmap = guit->bitmap->create(width, height, BITMAP_NEW | BITMAP_OPAQUE);
-	if (bitmap == NULL) {
-		/* empty bitmap could not be created */
+/**
+ * decode jpeg source data into a bitmap buffer.
+ *
+ * Only uses the data passed so may be called from a decode worker.
+ */
+static bool
+jpeg_cache_decode(const uint8_t *source_data,
+		  size_t source_size,
+		  const struct image_cache_decode_params *params,
+		  uint8_t *pixels,
+		  size_t rowstride)
+{
+	struct jpeg_decompress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+	jmp_buf setjmp_buffer;
+	struct jpeg_source_mgr source_mgr = {
+		0,
+		0,
+		nsjpeg_init_source,
+		nsjpeg_fill_input_buffer,
+		nsjpeg_skip_input_data,
+		jpeg_resync_to_restart,
+		nsjpeg_term_source };
+
+	/* setup a JPEG library error handler which does not log */
+	cinfo.err = jpeg_std_error(&jerr);
+	jerr.error_exit = nsjpeg_error_unwind;
+	jerr.output_message = nsjpeg_error_discard;
+
+	/* handler for fatal errors during decompression */
+	if (setjmp(setjmp_buffer)) {
 		jpeg_destroy_decompress(&cinfo);
-		return NULL;
+		return false;
 	}
 
-	pixels = guit->bitmap->get_buffer(bitmap);
-	if (pixels == NULL) {
-		/* bitmap with no buffer available */
-		guit->bitmap->destroy(bitmap);
+	cinfo.client_data = &setjmp_buffer;
+	jpeg_create_decompress(&cinfo);
+
+	/* setup data source */
+	source_mgr.next_input_byte = source_data;
+	source_mgr.bytes_in_buffer = source_size;
+	cinfo.src = &source_mgr;
+
+	/* read JPEG header information */
+	jpeg_read_header(&cinfo, TRUE);
+
+	/* set output processing parameters as they were measured */
+	nsjpeg_set_colour_space(&cinfo, params->option);
+	nsjpeg_set_scale(&cinfo, params->target_width, params->target_height);
+
+	/* commence the decompression, output parameters now valid */
+	jpeg_start_decompress(&cinfo);
+
+	if ((cinfo.output_width != (JDIMENSION)params->width) ||
+	    (cinfo.output_height != (JDIMENSION)params->height)) {
 		jpeg_destroy_decompress(&cinfo);
-		return NULL;
+		return false;
 	}
 
 	/* Convert scanlines from jpeg into bitmap */
-	rowstride = guit->bitmap->get_rowstride(bitmap);
 	do {
-		JSAMPROW scanlines[1];
-
-		scanlines[0] = (JSAMPROW) (pixels +
-					   rowstride * cinfo.output_scanline);
-		jpeg_read_scanlines(&cinfo, scanlines, 1);
-
-		if (cinfo.out_color_space == JCS_CMYK) {
-			int i;
-			for (i = width - 1; 0 <= i; i--) {
-				/* Trivial inverse CMYK -> RGBA */
-				const int c = scanlines[0][i * 4 + 0];
-				const int m = scanlines[0][i * 4 + 1];
-				const int y = scanlines[0][i * 4 + 2];
-				const int k = scanlines[0][i * 4 + 3];
-
-				const int ck = c * k;
-				const int mk = m * k;
-				const int yk = y * k;
-
-#define DIV255(x) ((x) + 1 + ((x) >> 8)) >> 8
-				scanlines[0][i * 4 + 0] = DIV255(ck);
-				scanlines[0][i * 4 + 1] = DIV255(mk);
-				scanlines[0][i * 4 + 2] = DIV255(yk);
-				scanlines[0][i * 4 + 3] = 0xff;
-#undef DIV255
-			}
-		} else {
-#if RGB_RED != 0 || RGB_GREEN != 1 || RGB_BLUE != 2 || RGB_PIXELSIZE != 4
-			/* Missmatch between configured libjpeg pixel format and
-			 * NetSurf pixel format.  Convert to RGBA */
-			int i;
-			for (i = width - 1; 0 <= i; i--) {
-				int r = scanlines[0][i * RGB_PIXELSIZE + RGB_RED];
-				int g = scanlines[0][i * RGB_PIXELSIZE + RGB_GREEN];
-				int b = scanlines[0][i * RGB_PIXELSIZE + RGB_BLUE];
-				scanlines[0][i * 4 + 0] = r;
-				scanlines[0][i * 4 + 1] = g;
-				scanlines[0][i * 4 + 2] = b;
-				scanlines[0][i * 4 + 3] = 0xff;
-			}
-#endif
-		}
+		nsjpeg_read_scanlines(&cinfo, pixels, rowstride);
 	} while (cinfo.output_scanline != cinfo.output_height);
-	guit->bitmap->modified(bitmap);
 
 	jpeg_finish_decompress(&cinfo);
 	jpeg_destroy_decompress(&cinfo);
 
-	return bitmap;
+	return true;
+}
+
+/** jpeg decoder which may be run off the redraw path */
+static const struct image_cache_decoder jpeg_cache_decoder = {
+	.measure = jpeg_cache_measure,
+	.decode = jpeg_cache_decode,
+};
+
+/**
+ * create a bitmap from jpeg content.
+ */
+static struct bitmap *
+jpeg_cache_convert(struct content *c)
+{
+	const uint8_t *source_data; /* Jpeg source data */
+	size_t source_size; /* length of Jpeg source data */
+
+	source_data = content__get_source_data(c, &source_size);
+
+	return image_cache_decode(&jpeg_cache_decoder,
+				  source_data, source_size, 0, 0);
+}
+
+/**
+ * Stop decoding a jpeg while it downloads.
+ *
+ * Any bitmap is kept with the rows decoded so far.
+ */
+static void nsjpeg_progressive_abandon(nsjpeg_content *jpeg_c)
+{
+	if ((jpeg_c->state != NSJPEG_NONE) &&
+	    (jpeg_c->state != NSJPEG_DONE)) {
+		jpeg_destroy_decompress(&jpeg_c->cinfo);
+	}
+	jpeg_c->state = NSJPEG_NONE;
+}
+
+/**
+ * Read the scanlines available for the current output pass.
+ *
+ * The rows read are published to the image cache for display.
+ *
+ * \param jpeg_c The jpeg content being decoded.
+ * \return true once every scanline of the pass has been read.
+ */
+static bool nsjpeg_progressive_rows(nsjpeg_content *jpeg_c)
+{
+	j_decompress_ptr cinfo = &jpeg_c->cinfo;
+	uint8_t *pixels;
+	size_t rowstride;
+	JDIMENSION first;
+
+	pixels = guit->bitmap->get_buffer(jpeg_c->bitmap);
+	if (pixels == NULL) {
+		nsjpeg_progressive_abandon(jpeg_c);
+		return false;
+	}
+	rowstride = guit->bitmap->get_rowstride(jpeg_c->bitmap);
+
+	first = cinfo->output_scanline;
+	while (cinfo->output_scanline < cinfo->output_height) {
+		if (nsjpeg_read_scanlines(cinfo, pixels, rowstride) == 0) {
+			break;
+		}
+	}
+
+	if (cinfo->output_scanline > first) {
+		guit->bitmap->modified(jpeg_c->bitmap);
+		image_cache_progress(&jpeg_c->base, jpeg_c->bitmap,
+				     first, cinfo->output_scanline);
+	}
+
+	return cinfo->output_scanline == cinfo->output_height;
+}
+
+/**
+ * Advance the decode of a jpeg as far as the data received allows.
+ *
+ * Baseline jpegs are decoded top to bottom as their rows arrive.
+ * Jpegs with several scans use buffered image mode and display each
+ * scan as it arrives, refining the whole image each time.
+ *
+ * \param jpeg_c The jpeg content being decoded.
+ */
+static void nsjpeg_progressive_step(nsjpeg_content *jpeg_c)
+{
+	j_decompress_ptr cinfo = &jpeg_c->cinfo;
+	struct content *c = &jpeg_c->base;
+	int ret;
+
+	while (true) {
+		switch (jpeg_c->state) {
+		case NSJPEG_HEADER:
+			if (jpeg_read_header(cinfo, TRUE) == JPEG_SUSPENDED) {
+				return;
+			}
+
+			c->width = cinfo->image_width;
+			c->height = cinfo->image_height;
+			c->size = c->width * c->height * 4;
+
+			/* the bitmap must fit the image cache budget */
+			if (image_cache_progressive(c) == false) {
+				nsjpeg_progressive_abandon(jpeg_c);
+				return;
+			}
+
+			nsjpeg_set_colour_space(cinfo,
+					nsoption_int(jpeg_decode_profile));
+			cinfo->buffered_image = jpeg_has_multiple_scans(cinfo);
+			jpeg_c->state = NSJPEG_START;
+			break;
+
+		case NSJPEG_START:
+			if (jpeg_start_decompress(cinfo) == FALSE) {
+				return;
+			}
+
+			jpeg_c->bitmap = guit->bitmap->create(
+					cinfo->output_width,
+					cinfo->output_height,
+					BITMAP_NEW | BITMAP_OPAQUE);
+			if (jpeg_c->bitmap == NULL) {
+				nsjpeg_progressive_abandon(jpeg_c);
+				return;
+			}
+
+			if (cinfo->buffered_image) {
+				jpeg_c->state = NSJPEG_SCAN;
+			} else {
+				jpeg_c->state = NSJPEG_ROWS;
+			}
+			break;
+
+		case NSJPEG_SCAN:
+			/* absorb waiting input so the most complete
+			 * scan is shown
+			 */
+			do {
+				ret = jpeg_consume_input(cinfo);
+			} while ((ret != JPEG_SUSPENDED) &&
+				 (ret != JPEG_REACHED_EOI));
+
+			/* only output each scan once it has started */
+			if ((cinfo->input_scan_number == jpeg_c->output_scan) &&
+			    (jpeg_input_complete(cinfo) == FALSE)) {
+				return;
+			}
+
+			if (jpeg_start_output(cinfo,
+					      cinfo->input_scan_number) == FALSE) {
+				return;
+			}
+			jpeg_c->output_scan = cinfo->output_scan_number;
+			jpeg_c->state = NSJPEG_ROWS;
+			break;
+
+		case NSJPEG_ROWS:
+			if (nsjpeg_progressive_rows(jpeg_c) == false) {
+				return;
+			}
+
+			if (cinfo->buffered_image) {
+				jpeg_c->state = NSJPEG_FINISH_OUTPUT;
+			} else {
+				jpeg_c->state = NSJPEG_FINISH;
+			}
+			break;
+
+		case NSJPEG_FINISH_OUTPUT:
+			if (jpeg_finish_output(cinfo) == FALSE) {
+				return;
+			}
+
+			if (jpeg_input_complete(cinfo)) {
+				jpeg_c->state = NSJPEG_FINISH;
+			} else {
+				jpeg_c->state = NSJPEG_SCAN;
+			}
+			break;
+
+		case NSJPEG_FINISH:
+			if (jpeg_finish_decompress(cinfo) == FALSE) {
+				return;
+			}
+			jpeg_destroy_decompress(cinfo);
+			jpeg_c->state = NSJPEG_DONE;
+			return;
+
+		default:
+			return;
+		}
+	}
+}
+
+/**
+ * Feed the source data received so far to the progressive decode.
+ *
+ * \param jpeg_c The jpeg content being decoded.
+ */
+static void nsjpeg_progressive_feed(nsjpeg_content *jpeg_c)
+{
+	const uint8_t *source_data;
+	size_t source_size;
+	size_t offset;
+	size_t skip;
+
+	source_data = content__get_source_data(&jpeg_c->base, &source_size);
+	if (source_data == NULL) {
+		return;
+	}
+
+	/* resume from where the decompressor stopped, the source
+	 * buffer may have moved since the last call
+	 */
+	offset = jpeg_c->offset;
+	skip = min(jpeg_c->skip, source_size - offset);
+	offset += skip;
+	jpeg_c->skip -= skip;
+
+	jpeg_c->source_mgr.next_input_byte = source_data + offset;
+	jpeg_c->source_mgr.bytes_in_buffer = source_size - offset;
+
+	if (setjmp(jpeg_c->setjmp_buffer)) {
+		/* leave the data to the conversion of the complete
+		 * source
+		 */
+		nsjpeg_progressive_abandon(jpeg_c);
+		return;
+	}
+
+	nsjpeg_progressive_step(jpeg_c);
+
+	jpeg_c->offset = jpeg_c->source_mgr.next_input_byte - source_data;
+}
+
+/**
+ * Process data for a jpeg as it arrives.
+ */
+static bool
+nsjpeg_process_data(struct content *c, const char *data, unsigned int size)
+{
+	nsjpeg_content *jpeg_c = (nsjpeg_content *)c;
+
+	if (jpeg_c->state == NSJPEG_HEADER &&
+	    jpeg_c->cinfo.err == NULL) {
+		/* first data, set up the decompressor */
+		jpeg_c->cinfo.err = jpeg_std_error(&jpeg_c->jerr);
+		jpeg_c->jerr.error_exit = nsjpeg_error_exit;
+		jpeg_c->jerr.output_message = nsjpeg_error_log;
+		jpeg_c->cinfo.client_data = &jpeg_c->setjmp_buffer;
+		if (setjmp(jpeg_c->setjmp_buffer)) {
+			jpeg_c->state = NSJPEG_NONE;
+			return true;
+		}
+		jpeg_create_decompress(&jpeg_c->cinfo);
+
+		jpeg_c->source_mgr.init_source = nsjpeg_init_source;
+		jpeg_c->source_mgr.fill_input_buffer = nsjpeg_fill_input_suspend;
+		jpeg_c->source_mgr.skip_input_data = nsjpeg_skip_input_suspend;
+		jpeg_c->source_mgr.resync_to_restart = jpeg_resync_to_restart;
+		jpeg_c->source_mgr.term_source = nsjpeg_term_source;
+		jpeg_c->cinfo.src = &jpeg_c->source_mgr;
+	}
+
+	if ((jpeg_c->state != NSJPEG_NONE) &&
+	    (jpeg_c->state != NSJPEG_DONE)) {
+		nsjpeg_progressive_feed(jpeg_c);
+	}
+
+	return true;
 }
 
 /**
@@ -309,6 +804,7 @@ jpeg_cache_convert(struct content *c)
  */
 static bool nsjpeg_convert(struct content *c)
 {
+	nsjpeg_content *jpeg_c = (nsjpeg_content *)c;
 	struct jpeg_decompress_struct cinfo;
 	struct jpeg_error_mgr jerr;
 	jmp_buf setjmp_buffer;
@@ -329,6 +825,8 @@ static bool nsjpeg_convert(struct content *c)
 	jerr.output_message = nsjpeg_error_log;
 
 	if (setjmp(setjmp_buffer)) {
+		cinfo.err->format_message((j_common_ptr) &cinfo,
+					  nsjpeg_error_buffer);
 		jpeg_destroy_decompress(&cinfo);
 
 		msg_data.errordata.errorcode = NSERROR_UNKNOWN;
@@ -354,7 +852,24 @@ static bool nsjpeg_convert(struct content *c)
 
 	jpeg_destroy_decompress(&cinfo);
 
-	image_cache_add(c, NULL, jpeg_cache_convert);
+	/* finish any progressive decode, padding a truncated jpeg with
+	 * an end of image marker as the cache conversion does
+	 */
+	if ((jpeg_c->state != NSJPEG_NONE) &&
+	    (jpeg_c->state != NSJPEG_HEADER) &&
+	    (jpeg_c->state != NSJPEG_DONE)) {
+		jpeg_c->source_mgr.fill_input_buffer = nsjpeg_fill_input_buffer;
+		nsjpeg_progressive_feed(jpeg_c);
+	}
+	if (jpeg_c->state != NSJPEG_DONE) {
+		nsjpeg_progressive_abandon(jpeg_c);
+	}
+
+	image_cache_add(c, jpeg_c->bitmap, jpeg_cache_convert);
+	image_cache_set_decoder(c, &jpeg_cache_decoder);
+
+	/* the bitmap now belongs to the image cache */
+	jpeg_c->bitmap = NULL;
 
 	/* set title text */
 	title = messages_get_buff("JPEGTitle",
@@ -374,42 +889,61 @@ static bool nsjpeg_convert(struct content *c)
 
 
 
+/**
+ * Destroy a CONTENT_JPEG.
+ */
+static void nsjpeg_destroy(struct content *c)
+{
+	nsjpeg_content *jpeg_c = (nsjpeg_content *)c;
+
+	/* content destroyed while it was still being decoded */
+	nsjpeg_progressive_abandon(jpeg_c);
+
+	if ((jpeg_c->bitmap != NULL) &&
+	    (image_cache_find_bitmap(c) != jpeg_c->bitmap)) {
+		guit->bitmap->destroy(jpeg_c->bitmap);
+	}
+
+	image_cache_destroy(c);
+}
+
 /**
  * Clone content.
  */
 static nserror nsjpeg_clone(const struct content *old, struct content **newc)
 {
-	struct content *jpeg_c;
+	nsjpeg_content *jpeg_c;
 	nserror error;
 
-	jpeg_c = calloc(1, sizeof(struct content));
+	jpeg_c = calloc(1, sizeof(nsjpeg_content));
 	if (jpeg_c == NULL)
 		return NSERROR_NOMEM;
 
-	error = content__clone(old, jpeg_c);
+	error = content__clone(old, &jpeg_c->base);
 	if (error != NSERROR_OK) {
-		content_destroy(jpeg_c);
+		content_destroy(&jpeg_c->base);
 		return error;
 	}
 
 	/* re-convert if the content is ready */
 	if ((old->status == CONTENT_STATUS_READY) ||
 	    (old->status == CONTENT_STATUS_DONE)) {
-		if (nsjpeg_convert(jpeg_c) == false) {
-			content_destroy(jpeg_c);
+		if (nsjpeg_convert(&jpeg_c->base) == false) {
+			content_destroy(&jpeg_c->base);
 			return NSERROR_CLONE_FAILED;
 		}
 	}
 
-	*newc = jpeg_c;
+	*newc = &jpeg_c->base;
 
 	return NSERROR_OK;
 }
 
 static const content_handler nsjpeg_content_handler = {
 	.create = nsjpeg_create,
+	.process_data = nsjpeg_process_data,
 	.data_complete = nsjpeg_convert,
-	.destroy = image_cache_destroy,
+	.destroy = nsjpeg_destroy,
 	.redraw = image_cache_redraw,
 	.clone = nsjpeg_clone,
 	.get_internal = image_cache_get_internal,
@@ -23,6 +23,15 @@
 #ifndef _NETSURF_IMAGE_JPEG_H_
 #define _NETSURF_IMAGE_JPEG_H_
 
+/**
+ * Jpeg decode profiles selected by the jpeg_decode_profile option.
+ */
+enum nsjpeg_profile {
+	NSJPEG_PROFILE_ACCURATE = 0, /**< slow integer DCT, smooth chroma */
+	NSJPEG_PROFILE_FAST = 1, /**< fast integer DCT, plain chroma */
+	NSJPEG_PROFILE_GREY = 2, /**< fast integer DCT, luminance only */
+};
+
 nserror nsjpeg_init(void);
 
 #endif
@@ -27,6 +27,8 @@
 #include "utils/utils.h"
 #include "utils/log.h"
 #include "utils/messages.h"
+#include "utils/nsoption.h"
+#include "utils/pixels.h"
 #include "netsurf/bitmap.h"
 #include "content/llcache.h"
 #include "content/content_protected.h"
@@ -59,6 +61,9 @@ typedef struct nspng_content {
 	size_t rowbytes; /**< Number of bytes per row */
 } nspng_content;
 
+/** Largest factor a PNG is downsampled by while decoding */
+#define PNG_CACHE_MAX_SCALE 128
+
 static unsigned int interlace_start[8] = {0, 16, 0, 8, 0, 4, 0};
 static unsigned int interlace_step[8] = {28, 28, 12, 12, 4, 4, 0};
 static unsigned int interlace_row_start[8] = {0, 0, 4, 0, 2, 0, 1};
@@ -158,7 +163,9 @@ static void info_callback(png_structp png_s, png_infop info)
 	png_c->base.size += width * height * 4;
 
 	/* see if progressive-conversion should continue */
-	if (image_cache_speculate((struct content *)png_c) == false) {
+	if ((nsoption_bool(progressive_images) ?
+	     image_cache_progressive((struct content *)png_c) :
+	     image_cache_speculate((struct content *)png_c)) == false) {
 		longjmp(png_jmpbuf(png_s), CBERR_NOPRE);
 	}
 
@@ -208,12 +215,10 @@ static void row_callback(png_structp png_s, png_bytep new_row,
 
 	/* Handle interlaced sprites using the Adam7 algorithm */
 	if (png_c->interlace) {
-		unsigned long dst_off;
-		unsigned long src_off = 0;
 		unsigned int start, step;
 
 		start = interlace_start[pass];
-		step = interlace_step[pass];
+		step = interlace_step[pass] + 4;
 		row_num = interlace_row_start[pass] +
 			interlace_row_step[pass] * row_num;
 
@@ -221,16 +226,21 @@ static void row_callback(png_structp png_s, png_bytep new_row,
 		 * into consideration */
 		row = buffer + (png_c->rowstride * row_num);
 
-		for (dst_off = start; dst_off < rowbytes; dst_off += step) {
-			row[dst_off++] = new_row[src_off++];
-			row[dst_off++] = new_row[src_off++];
-			row[dst_off++] = new_row[src_off++];
-			row[dst_off++] = new_row[src_off++];
+		if (start < rowbytes) {
+			pixels_scatter(row + start, new_row,
+				       (rowbytes - start + step - 1) / step,
+				       step / 4);
 		}
 	} else {
 		/* Do a fast memcpy of the row data */
 		memcpy(row, new_row, rowbytes);
 	}
+
+	/* make the row visible while the rest is downloading */
+	if (nsoption_bool(progressive_images)) {
+		image_cache_progress(&png_c->base, png_c->bitmap,
+				     row_num, row_num + 1);
+	}
 }
 
 
@@ -397,21 +407,12 @@ png_cache_read_fn(png_structp png_ptr, png_bytep data, png_size_t length)
 
 /** calculate an array of row pointers into a bitmap data area
  */
-static png_bytep *calc_row_pointers(struct bitmap *bitmap)
+static png_bytep *
+calc_row_pointers(uint8_t *buffer, int height, size_t rowstride)
 {
-	int height = guit->bitmap->get_height(bitmap);
-	unsigned char *buffer= guit->bitmap->get_buffer(bitmap);
-	size_t rowstride = guit->bitmap->get_rowstride(bitmap);
 	png_bytep *row_ptrs;
 	int hloop;
 
-	/* The buffer allocation may occour when the buffer is aquired
-	 * and therefore may fail.
-	 */
-	if (buffer == NULL) {
-		return NULL;
-	}
-
 	row_ptrs = malloc(sizeof(png_bytep) * height);
 
 	if (row_ptrs != NULL) {
@@ -423,50 +424,234 @@ static png_bytep *calc_row_pointers(struct bitmap *bitmap)
 	return row_ptrs;
 }
 
-/** PNG content to bitmap conversion.
+/** Select the downsampling factor used to decode a PNG for a plot size.
  *
- * This routine generates a bitmap object from a PNG image content
+ * The largest whole factor which keeps the bitmap at least as large as
+ * the plot is used. Interlaced images are always decoded at full size
+ * as their rows do not arrive in order.
  */
-static struct bitmap *
-png_cache_convert(struct content *c)
+static unsigned int
+png_cache_scale(png_uint_32 width,
+		png_uint_32 height,
+		bool interlaced,
+		int target_width,
+		int target_height)
+{
+	png_uint_32 scale;
+
+	if (interlaced || (target_width <= 0) || (target_height <= 0)) {
+		return 1;
+	}
+
+	scale = min(width / target_width, height / target_height);
+	if (scale < 1) {
+		scale = 1;
+	} else if (scale > PNG_CACHE_MAX_SCALE) {
+		scale = PNG_CACHE_MAX_SCALE;
+	}
+
+	return scale;
+}
+
+/** Read a PNG into a bitmap downsampling each block of rows.
+ *
+ * Each output pixel is the alpha weighted mean of a scale by scale
+ * block of image pixels, so only one image row is held at a time.
+ *
+ * \param png_ptr The png read structure with transforms set up.
+ * \param buffer The bitmap buffer to fill, sized for the scaled image.
+ * \param rowstride The row stride of the bitmap buffer.
+ * \param width The image width in pixels.
+ * \param height The image height in pixels.
+ * \param scale The downsampling factor.
+ * \param row Buffer for one transformed image row.
+ * \param acc Accumulator of four values for each bitmap column.
+ */
+static void
+png_cache_read_scaled(png_structp png_ptr,
+		      uint8_t *buffer,
+		      size_t rowstride,
+		      png_uint_32 width,
+		      png_uint_32 height,
+		      unsigned int scale,
+		      png_bytep row,
+		      uint32_t *acc)
+{
+	png_uint_32 out_width = (width + scale - 1) / scale;
+	png_uint_32 x, y;
+
+	for (y = 0; y < height; y++) {
+		png_read_row(png_ptr, row, NULL);
+
+		for (x = 0; x < width; x++) {
+			const png_byte *px = row + (x * 4);
+			uint32_t *a = acc + ((x / scale) * 4);
+
+			a[0] += px[0] * px[3];
+			a[1] += px[1] * px[3];
+			a[2] += px[2] * px[3];
+			a[3] += px[3];
+		}
+
+		if ((((y + 1) % scale) == 0) || ((y + 1) == height)) {
+			unsigned char *out = buffer + (rowstride * (y / scale));
+			unsigned int rows = (y % scale) + 1;
+
+			for (x = 0; x < out_width; x++) {
+				uint32_t *a = acc + (x * 4);
+				uint32_t alpha = a[3];
+				unsigned int count;
+
+				count = rows * min(scale, width - (x * scale));
+
+				if (alpha == 0) {
+					out[0] = out[1] = out[2] = out[3] = 0;
+				} else {
+					out[0] = (a[0] + alpha / 2) / alpha;
+					out[1] = (a[1] + alpha / 2) / alpha;
+					out[2] = (a[2] + alpha / 2) / alpha;
+					out[3] = (alpha + count / 2) / count;
+				}
+				out += 4;
+			}
+
+			memset(acc, 0, out_width * 4 * sizeof(uint32_t));
+		}
+	}
+}
+
+/**
+ * nspng_warning_discard -- libpng warnings on a decode worker
+ *
+ * The log may only be used from the main thread.
+ */
+static void
+nspng_warning_discard(png_structp png_ptr, png_const_charp warning_message)
+{
+}
+
+/**
+ * nspng_error_unwind -- libpng errors on a decode worker
+ */
+static void
+nspng_error_unwind(png_structp png_ptr, png_const_charp error_message)
+{
+	longjmp(png_jmpbuf(png_ptr), CBERR_LIBPNG);
+}
+
+/** Size the bitmap PNG source data is decoded into for a plot size.
+ *
+ * Called on the main thread so libpng problems are logged.
+ */
+static bool
+png_cache_measure(const uint8_t *data,
+		  size_t size,
+		  struct image_cache_decode_params *params)
 {
 	png_structp png_ptr;
 	png_infop info_ptr;
-	png_infop end_info_ptr;
-	volatile struct bitmap * volatile bitmap = NULL;
 	struct png_cache_read_data_s png_cache_read_data;
 	png_uint_32 width, height;
-	volatile png_bytep * volatile row_pointers = NULL;
+	unsigned int scale;
 
-	png_cache_read_data.data = 
-		content__get_source_data(c, &png_cache_read_data.size);
+	png_cache_read_data.data = data;
+	png_cache_read_data.size = size;
 
-	if ((png_cache_read_data.data == NULL) || 
+	if ((png_cache_read_data.data == NULL) ||
 	    (png_cache_read_data.size <= 8)) {
-		return NULL;
+		return false;
 	}
 
 	png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL,
 			nspng_error, nspng_warning);
 	if (png_ptr == NULL) {
-		return NULL;
+		return false;
 	}
 
 	info_ptr = png_create_info_struct(png_ptr);
 	if (info_ptr == NULL) {
 		png_destroy_read_struct(&png_ptr, NULL, NULL);
-		return NULL;
+		return false;
+	}
+
+	/* setup error exit path */
+	if (setjmp(png_jmpbuf(png_ptr))) {
+		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+		return false;
+	}
+
+	/* read from a buffer instead of stdio */
+	png_set_read_fn(png_ptr, &png_cache_read_data, png_cache_read_fn);
+
+	/* ensure the png info structure is populated */
+	png_read_info(png_ptr, info_ptr);
+
+	width = png_get_image_width(png_ptr, info_ptr);
+	height = png_get_image_height(png_ptr, info_ptr);
+
+	scale = png_cache_scale(width, height,
+			png_get_interlace_type(png_ptr, info_ptr) ==
+				PNG_INTERLACE_ADAM7,
+			params->target_width, params->target_height);
+
+	params->width = (width + scale - 1) / scale;
+	params->height = (height + scale - 1) / scale;
+	params->flags = BITMAP_NEW;
+
+	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+
+	return true;
+}
+
+/** PNG source data to bitmap buffer conversion.
+ *
+ * This routine decodes PNG source data into a bitmap buffer. Only the
+ * data passed is used so it may be called from a decode worker. When
+ * a plot size is given the image is downsampled as it is read.
+ */
+static bool
+png_cache_decode(const uint8_t *data,
+		 size_t size,
+		 const struct image_cache_decode_params *params,
+		 uint8_t *pixels,
+		 size_t rowstride)
+{
+	png_structp png_ptr;
+	png_infop info_ptr;
+	png_infop end_info_ptr;
+	volatile bool ok = false;
+	struct png_cache_read_data_s png_cache_read_data;
+	png_uint_32 width, height;
+	unsigned int scale;
+	volatile png_bytep * volatile row_pointers = NULL;
+	png_byte * volatile row = NULL;
+	uint32_t * volatile acc = NULL;
+
+	png_cache_read_data.data = data;
+	png_cache_read_data.size = size;
+
+	png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL,
+			nspng_error_unwind, nspng_warning_discard);
+	if (png_ptr == NULL) {
+		return false;
+	}
+
+	info_ptr = png_create_info_struct(png_ptr);
+	if (info_ptr == NULL) {
+		png_destroy_read_struct(&png_ptr, NULL, NULL);
+		return false;
 	}
 
 	end_info_ptr = png_create_info_struct(png_ptr);
 	if (end_info_ptr == NULL) {
 		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-		return NULL;
+		return false;
 	}
 
 	/* setup error exit path */
 	if (setjmp(png_jmpbuf(png_ptr))) {
 		/* cleanup and bail */
+		ok = false;
 		goto png_cache_convert_error;
 	}
 
@@ -482,20 +667,35 @@ png_cache_convert(struct content *c)
 	width = png_get_image_width(png_ptr, info_ptr);
 	height = png_get_image_height(png_ptr, info_ptr);
 
-	/* Claim the required memory for the converted PNG */
-	bitmap = guit->bitmap->create(width, height, BITMAP_NEW);
-	if (bitmap == NULL) {
-		/* cleanup and bail */
+	scale = png_cache_scale(width, height,
+			png_get_interlace_type(png_ptr, info_ptr) ==
+				PNG_INTERLACE_ADAM7,
+			params->target_width, params->target_height);
+
+	/* the bitmap was created for the measured size */
+	if (((width + scale - 1) / scale != (png_uint_32)params->width) ||
+	    ((height + scale - 1) / scale != (png_uint_32)params->height)) {
 		goto png_cache_convert_error;
 	}
 
-	row_pointers = calc_row_pointers((struct bitmap *) bitmap);
+	if (scale > 1) {
+		row = malloc(png_get_rowbytes(png_ptr, info_ptr));
+		acc = calloc((width + scale - 1) / scale,
+			     4 * sizeof(uint32_t));
+		if ((row == NULL) || (acc == NULL)) {
+			goto png_cache_convert_error;
+		}
 
-	if (row_pointers != NULL) {
-		png_read_image(png_ptr, (png_bytep *) row_pointers);
+		png_cache_read_scaled(png_ptr, pixels, rowstride,
+				      width, height, scale, row, acc);
+		ok = true;
 	} else {
-		guit->bitmap->destroy((struct bitmap *)bitmap);
-		bitmap = NULL;
+		row_pointers = calc_row_pointers(pixels, height, rowstride);
+
+		if (row_pointers != NULL) {
+			png_read_image(png_ptr, (png_bytep *) row_pointers);
+			ok = true;
+		}
 	}
 
 png_cache_convert_error:
@@ -507,11 +707,31 @@ png_cache_convert_error:
 		free((png_bytep *) row_pointers);
 	}
 
-	if (bitmap != NULL) {
-		guit->bitmap->modified((struct bitmap *)bitmap);
-	}
+	free(row);
+	free(acc);
+
+	return ok;
+}
+
+/** PNG decoder which may be run off the redraw path */
+static const struct image_cache_decoder png_cache_decoder = {
+	.measure = png_cache_measure,
+	.decode = png_cache_decode,
+};
+
+/** PNG content to bitmap conversion.
+ *
+ * This routine generates a bitmap object from a PNG image content
+ */
+static struct bitmap *
+png_cache_convert(struct content *c)
+{
+	const uint8_t *data;
+	size_t size;
 
-	return (struct bitmap *)bitmap;
+	data = content__get_source_data(c, &size);
+
+	return image_cache_decode(&png_cache_decoder, data, size, 0, 0);
 }
 
 static bool nspng_convert(struct content *c)
@@ -540,6 +760,10 @@ static bool nspng_convert(struct content *c)
 	}
 
 	image_cache_add(c, png_c->bitmap, png_cache_convert);
+	image_cache_set_decoder(c, &png_cache_decoder);
+
+	/* the bitmap now belongs to the image cache */
+	png_c->bitmap = NULL;
 
 	content_set_ready(c);
 	content_set_done(c);
@@ -549,6 +773,23 @@ static bool nspng_convert(struct content *c)
 }
 
 
+static void nspng_destroy(struct content *c)
+{
+	nspng_content *png_c = (nspng_content *) c;
+
+	/* content destroyed while it was still being decoded */
+	if (png_c->png != NULL) {
+		png_destroy_read_struct(&png_c->png, &png_c->info, 0);
+	}
+
+	if ((png_c->bitmap != NULL) &&
+	    (image_cache_find_bitmap(c) != png_c->bitmap)) {
+		guit->bitmap->destroy(png_c->bitmap);
+	}
+
+	image_cache_destroy(c);
+}
+
 static nserror nspng_clone(const struct content *old_c, struct content **new_c)
 {
 	nspng_content *clone_png_c;
@@ -599,7 +840,7 @@ static const content_handler nspng_content_handler = {
 	.process_data = nspng_process_data,
 	.data_complete = nspng_convert,
 	.clone = nspng_clone,
-	.destroy = image_cache_destroy,
+	.destroy = nspng_destroy,
 	.redraw = image_cache_redraw,
 	.get_internal = image_cache_get_internal,
 	.type = image_cache_content_type,
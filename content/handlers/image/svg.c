@@ -23,6 +23,7 @@
 
 #include <assert.h>
 #include <limits.h>
+#include <math.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -32,12 +33,23 @@
 #include "utils/utils.h"
 #include "utils/nsurl.h"
 #include "netsurf/plotters.h"
+#include "netsurf/bitmap.h"
 #include "netsurf/content.h"
 #include "content/content_protected.h"
 #include "content/content_factory.h"
+#include "desktop/gui_internal.h"
 
+#include "image/image_cache.h"
 #include "image/svg.h"
 
+/**
+ * Largest plotted area, in pixels, which is rendered to a bitmap.
+ *
+ * Bigger plots, such as a page sized background, draw their paths
+ * directly rather than hold a bitmap of that size.
+ */
+#define SVG_RENDER_MAX_AREA (2048 * 2048)
+
 typedef struct svg_content {
 	struct content base;
 
@@ -45,8 +57,42 @@ typedef struct svg_content {
 
 	int current_width;
 	int current_height;
+
+	bool has_text; /**< diagram has text, which is never rendered */
 } svg_content;
 
+/**
+ * A run of points in a flattened path.
+ */
+struct svg_subpath {
+	unsigned int first; /**< index of first point */
+	unsigned int count; /**< number of points */
+	bool closed; /**< last point joins back to the first */
+};
+
+/**
+ * Anti-aliased coverage raster.
+ *
+ * Each edge adds its signed area to the cells it crosses and the
+ * coverage of a pixel is the sum of the cells up to it, following the
+ * approach of font-rs. Summing the winding of every edge gives the
+ * nonzero fill rule, and lets overlapping stroke pieces merge.
+ */
+struct svg_raster {
+	float *cell; /**< accumulated area, stride cells per row */
+	int width; /**< width in pixels */
+	int height; /**< height in pixels */
+	int stride; /**< cells per row, two more than the width */
+	int x0, y0, x1, y1; /**< cells touched since last composite */
+
+	float *point; /**< x and y of each flattened point */
+	unsigned int points; /**< number of flattened points */
+	unsigned int point_alloc; /**< points allocated */
+	struct svg_subpath *subpath; /**< subpaths of the flattened shape */
+	unsigned int subpaths; /**< number of subpaths */
+	unsigned int subpath_alloc; /**< subpaths allocated */
+};
+
 
 
 static nserror svg_create_svg_data(svg_content *c)
@@ -101,6 +147,592 @@ static nserror svg_create(const content_handler *handler,
 }
 
 
+/**
+ * Add an edge lying within the raster's width to a coverage raster.
+ *
+ * \param r The raster.
+ * \param x0 The edge start x coordinate.
+ * \param y0 The edge start y coordinate.
+ * \param x1 The edge end x coordinate.
+ * \param y1 The edge end y coordinate.
+ */
+static void
+svg_raster_line(struct svg_raster *r, float x0, float y0, float x1, float y1)
+{
+	float dir = 1.0f;
+	float dxdy;
+	float x;
+	int y;
+	int ystart;
+	int yend;
+
+	if (y0 == y1) {
+		return;
+	}
+	if (y0 > y1) {
+		float t;
+		t = x0; x0 = x1; x1 = t;
+		t = y0; y0 = y1; y1 = t;
+		dir = -1.0f;
+	}
+	if ((y1 <= 0) || (y0 >= r->height)) {
+		return;
+	}
+
+	dxdy = (x1 - x0) / (y1 - y0);
+	x = x0;
+	if (y0 < 0) {
+		x -= y0 * dxdy;
+		y0 = 0;
+	}
+	if (y1 > r->height) {
+		y1 = r->height;
+	}
+
+	ystart = (int)y0;
+	yend = (int)ceilf(y1);
+	if (ystart < r->y0) r->y0 = ystart;
+	if (yend > r->y1) r->y1 = yend;
+
+	for (y = ystart; y < yend; y++) {
+		float *cell = r->cell + y * r->stride;
+		float dy = min(y + 1.0f, y1) - max((float)y, y0);
+		float xnext = x + dxdy * dy;
+		float d = dy * dir;
+		float xa = min(x, xnext);
+		float xb = max(x, xnext);
+		int xai;
+		int xbi;
+
+		x = xnext;
+
+		/* only rounding can take the edge outside the raster */
+		xa = min(max(xa, 0.0f), (float)r->width);
+		xb = min(max(xb, 0.0f), (float)r->width);
+		xai = (int)xa;
+		xbi = (int)ceilf(xb);
+
+		if (xai < r->x0) r->x0 = xai;
+		if (xbi + 1 > r->x1) r->x1 = xbi + 1;
+
+		if (xbi <= xai + 1) {
+			/* edge stays within one pixel of this row */
+			float xmf = 0.5f * (xa + xb) - xai;
+			cell[xai] += d - d * xmf;
+			cell[xai + 1] += d * xmf;
+		} else {
+			float s = 1.0f / (xb - xa);
+			float xaf = xa - xai;
+			float a0 = 0.5f * s * (1.0f - xaf) * (1.0f - xaf);
+			float xbf = xb - xbi + 1.0f;
+			float am = 0.5f * s * xbf * xbf;
+			int xi;
+
+			cell[xai] += d * a0;
+			if (xbi == xai + 2) {
+				cell[xai + 1] += d * (1.0f - a0 - am);
+			} else {
+				float a1 = s * (1.5f - xaf);
+				cell[xai + 1] += d * (a1 - a0);
+				for (xi = xai + 2; xi < xbi - 1; xi++) {
+					cell[xi] += d * s;
+				}
+				cell[xbi - 1] += d *
+					(1.0f - a1 - (xbi - xai - 3) * s - am);
+			}
+			cell[xbi] += d * am;
+		}
+	}
+}
+
+/**
+ * Add an edge to a coverage raster.
+ *
+ * Parts of the edge left of the raster are moved onto its left side,
+ * which keeps their winding for the pixels to the right, and parts
+ * right of the raster are dropped as they cover no pixels. Coverage
+ * therefore continues past the last touched cell to the raster edge.
+ *
+ * \param r The raster.
+ * \param x0 The edge start x coordinate.
+ * \param y0 The edge start y coordinate.
+ * \param x1 The edge end x coordinate.
+ * \param y1 The edge end y coordinate.
+ */
+static void
+svg_raster_edge(struct svg_raster *r, float x0, float y0, float x1, float y1)
+{
+	float w = r->width;
+	float ym;
+
+	if ((x0 >= w) && (x1 >= w)) {
+		return;
+	}
+	if (x0 > w) {
+		y0 += (y1 - y0) * (x0 - w) / (x0 - x1);
+		x0 = w;
+	} else if (x1 > w) {
+		y1 = y0 + (y1 - y0) * (w - x0) / (x1 - x0);
+		x1 = w;
+	}
+
+	if ((x0 <= 0) && (x1 <= 0)) {
+		svg_raster_line(r, 0, y0, 0, y1);
+	} else if (x0 < 0) {
+		ym = y0 + (y1 - y0) * (0 - x0) / (x1 - x0);
+		svg_raster_line(r, 0, y0, 0, ym);
+		svg_raster_line(r, 0, ym, x1, y1);
+	} else if (x1 < 0) {
+		ym = y0 + (y1 - y0) * (0 - x0) / (x1 - x0);
+		svg_raster_line(r, x0, y0, 0, ym);
+		svg_raster_line(r, 0, ym, 0, y1);
+	} else {
+		svg_raster_line(r, x0, y0, x1, y1);
+	}
+}
+
+/**
+ * Add a closed polygon to a coverage raster.
+ *
+ * \param r The raster.
+ * \param point The x and y of each polygon vertex.
+ * \param count The number of vertices.
+ */
+static void
+svg_raster_polygon(struct svg_raster *r, const float *point, unsigned int count)
+{
+	unsigned int i;
+	unsigned int j = count - 1;
+
+	for (i = 0; i < count; i++) {
+		svg_raster_edge(r,
+				point[j * 2], point[j * 2 + 1],
+				point[i * 2], point[i * 2 + 1]);
+		j = i;
+	}
+}
+
+/**
+ * Add the outline of a stroke along a subpath to a coverage raster.
+ *
+ * Each segment becomes a rectangle and each join a disc, all wound
+ * the same way so the coverage of their union is accumulated. Ends of
+ * open subpaths are butt capped.
+ *
+ * \param r The raster.
+ * \param sub The subpath to stroke.
+ * \param hw Half the stroke width.
+ */
+static void
+svg_raster_stroke(struct svg_raster *r,
+		  const struct svg_subpath *sub,
+		  float hw)
+{
+	const float *p = r->point + sub->first * 2;
+	unsigned int segments = sub->closed ? sub->count : sub->count - 1;
+	unsigned int steps = (hw < 2.0f) ? 8 : 16;
+	float quad[8];
+	float disc[32];
+	unsigned int i;
+	unsigned int k;
+
+	for (k = 0; k < steps; k++) {
+		float a = -2.0f * (float)M_PI * k / steps;
+		disc[k * 2] = hw * cosf(a);
+		disc[k * 2 + 1] = hw * sinf(a);
+	}
+
+	for (i = 0; i < segments; i++) {
+		const float *a = p + i * 2;
+		const float *b = p + ((i + 1) % sub->count) * 2;
+		float dx = b[0] - a[0];
+		float dy = b[1] - a[1];
+		float len = sqrtf(dx * dx + dy * dy);
+		float nx, ny;
+
+		if (len <= 0) {
+			continue;
+		}
+		nx = -dy * hw / len;
+		ny = dx * hw / len;
+
+		quad[0] = a[0] + nx; quad[1] = a[1] + ny;
+		quad[2] = b[0] + nx; quad[3] = b[1] + ny;
+		quad[4] = b[0] - nx; quad[5] = b[1] - ny;
+		quad[6] = a[0] - nx; quad[7] = a[1] - ny;
+		svg_raster_polygon(r, quad, 4);
+
+		if ((i + 1 < sub->count - 1) || sub->closed) {
+			/* round join with the next segment */
+			float join[32];
+			for (k = 0; k < steps; k++) {
+				join[k * 2] = b[0] + disc[k * 2];
+				join[k * 2 + 1] = b[1] + disc[k * 2 + 1];
+			}
+			svg_raster_polygon(r, join, steps);
+		}
+	}
+}
+
+/**
+ * Composite the coverage in a raster onto pixels and clear it.
+ *
+ * \param r The raster.
+ * \param pixels The RGBA pixels, the same size as the raster.
+ * \param rowstride The length of a row of pixels in bytes.
+ * \param colour The colour to composite in svgtiny format.
+ */
+static void
+svg_raster_composite(struct svg_raster *r,
+		     uint8_t *pixels,
+		     size_t rowstride,
+		     svgtiny_colour colour)
+{
+	unsigned int cr = svgtiny_RED(colour);
+	unsigned int cg = svgtiny_GREEN(colour);
+	unsigned int cb = svgtiny_BLUE(colour);
+	int x;
+	int y;
+
+	for (y = r->y0; y < r->y1; y++) {
+		float *cell = r->cell + y * r->stride;
+		uint8_t *px = pixels + y * rowstride + r->x0 * 4;
+		float acc = 0;
+
+		for (x = r->x0; x < r->width; x++, px += 4) {
+			unsigned int a;
+			unsigned int da;
+
+			acc += cell[x];
+			if ((x >= r->x1) && (fabsf(acc) < 0.001f)) {
+				/* no more edges and outside the shape */
+				break;
+			}
+			a = (unsigned int)(min(fabsf(acc), 1.0f) * 255.0f + 0.5f);
+			if (a == 0) {
+				continue;
+			}
+
+			da = px[3];
+			if ((a == 255) || (da == 0)) {
+				px[0] = cr;
+				px[1] = cg;
+				px[2] = cb;
+				px[3] = a;
+			} else {
+				/* source over destination */
+				unsigned int db = da * (255 - a);
+				unsigned int oa = a * 255 + db;
+
+				px[0] = (cr * a * 255 + px[0] * db + oa / 2) / oa;
+				px[1] = (cg * a * 255 + px[1] * db + oa / 2) / oa;
+				px[2] = (cb * a * 255 + px[2] * db + oa / 2) / oa;
+				px[3] = (oa + 127) / 255;
+			}
+		}
+
+		memset(cell + r->x0, 0, (r->x1 - r->x0) * sizeof(float));
+	}
+
+	r->x0 = r->stride;
+	r->y0 = r->height;
+	r->x1 = 0;
+	r->y1 = 0;
+}
+
+/**
+ * Append a point to the last subpath of the flattened shape.
+ *
+ * \param r The raster holding the flattened shape.
+ * \param x The point x coordinate.
+ * \param y The point y coordinate.
+ * \return NSERROR_OK on success or NSERROR_NOMEM.
+ */
+static nserror svg_raster_point(struct svg_raster *r, float x, float y)
+{
+	if (!isfinite(x) || !isfinite(y)) {
+		return NSERROR_OK;
+	}
+
+	if (r->points == r->point_alloc) {
+		unsigned int alloc = r->point_alloc * 2 + 64;
+		float *point = realloc(r->point, alloc * 2 * sizeof(float));
+		if (point == NULL) {
+			return NSERROR_NOMEM;
+		}
+		r->point = point;
+		r->point_alloc = alloc;
+	}
+
+	r->point[r->points * 2] = x;
+	r->point[r->points * 2 + 1] = y;
+	r->points++;
+	r->subpath[r->subpaths - 1].count++;
+
+	return NSERROR_OK;
+}
+
+/**
+ * Start a new subpath in the flattened shape.
+ *
+ * \param r The raster holding the flattened shape.
+ * \return NSERROR_OK on success or NSERROR_NOMEM.
+ */
+static nserror svg_raster_subpath(struct svg_raster *r)
+{
+	if ((r->subpaths > 0) && (r->subpath[r->subpaths - 1].count == 0)) {
+		/* reuse empty subpath */
+		return NSERROR_OK;
+	}
+
+	if (r->subpaths == r->subpath_alloc) {
+		unsigned int alloc = r->subpath_alloc * 2 + 8;
+		struct svg_subpath *subpath;
+		subpath = realloc(r->subpath, alloc * sizeof(*subpath));
+		if (subpath == NULL) {
+			return NSERROR_NOMEM;
+		}
+		r->subpath = subpath;
+		r->subpath_alloc = alloc;
+	}
+
+	r->subpath[r->subpaths].first = r->points;
+	r->subpath[r->subpaths].count = 0;
+	r->subpath[r->subpaths].closed = false;
+	r->subpaths++;
+
+	return NSERROR_OK;
+}
+
+/**
+ * Flatten an svgtiny path into scaled straight line subpaths.
+ *
+ * \param r The raster to hold the flattened shape.
+ * \param path The svgtiny path.
+ * \param length The number of elements in the path.
+ * \param sx The horizontal scale.
+ * \param sy The vertical scale.
+ * \return NSERROR_OK on success or NSERROR_NOMEM.
+ */
+static nserror
+svg_raster_flatten(struct svg_raster *r,
+		   const float *path,
+		   unsigned int length,
+		   float sx,
+		   float sy)
+{
+	float cx = 0, cy = 0; /* current point */
+	float mx = 0, my = 0; /* start of subpath */
+	unsigned int i = 0;
+	nserror res;
+
+	r->points = 0;
+	r->subpaths = 0;
+	res = svg_raster_subpath(r);
+
+	while ((res == NSERROR_OK) && (i < length)) {
+		switch ((int)path[i]) {
+		case svgtiny_PATH_MOVE:
+			if (i + 3 > length) {
+				return NSERROR_OK;
+			}
+			res = svg_raster_subpath(r);
+			if (res != NSERROR_OK) {
+				break;
+			}
+			cx = mx = path[i + 1] * sx;
+			cy = my = path[i + 2] * sy;
+			res = svg_raster_point(r, cx, cy);
+			i += 3;
+			break;
+
+		case svgtiny_PATH_CLOSE:
+			r->subpath[r->subpaths - 1].closed = true;
+			res = svg_raster_subpath(r);
+			if (res != NSERROR_OK) {
+				break;
+			}
+			cx = mx;
+			cy = my;
+			res = svg_raster_point(r, cx, cy);
+			i += 1;
+			break;
+
+		case svgtiny_PATH_LINE:
+			if (i + 3 > length) {
+				return NSERROR_OK;
+			}
+			cx = path[i + 1] * sx;
+			cy = path[i + 2] * sy;
+			res = svg_raster_point(r, cx, cy);
+			i += 3;
+			break;
+
+		case svgtiny_PATH_BEZIER:
+		{
+			float x1, y1, x2, y2, x3, y3;
+			float span;
+			int steps;
+			int k;
+
+			if (i + 7 > length) {
+				return NSERROR_OK;
+			}
+			x1 = path[i + 1] * sx; y1 = path[i + 2] * sy;
+			x2 = path[i + 3] * sx; y2 = path[i + 4] * sy;
+			x3 = path[i + 5] * sx; y3 = path[i + 6] * sy;
+
+			/* split so the chords stay within a tenth of a pixel
+			 * of the curve, by Wang's formula */
+			span = max(fabsf(cx - 2 * x1 + x2) + fabsf(cy - 2 * y1 + y2),
+				   fabsf(x1 - 2 * x2 + x3) + fabsf(y1 - 2 * y2 + y3));
+			steps = (span < 10000.0f) ?
+				(int)ceilf(sqrtf(span * 7.5f)) : 100;
+			steps = min(max(steps, 1), 100);
+
+			for (k = 1; (k <= steps) && (res == NSERROR_OK); k++) {
+				float t = (float)k / steps;
+				float u = 1.0f - t;
+				float b0 = u * u * u;
+				float b1 = 3 * u * u * t;
+				float b2 = 3 * u * t * t;
+				float b3 = t * t * t;
+
+				res = svg_raster_point(r,
+						b0 * cx + b1 * x1 + b2 * x2 + b3 * x3,
+						b0 * cy + b1 * y1 + b2 * y2 + b3 * y3);
+			}
+			cx = x3;
+			cy = y3;
+			i += 7;
+			break;
+		}
+
+		default:
+			/* malformed path */
+			return NSERROR_OK;
+		}
+	}
+
+	return res;
+}
+
+/**
+ * Render an SVG into a bitmap of the given size.
+ *
+ * Paths are rasterised with anti-aliasing. Text is not rendered, as
+ * the core has no fonts, and is plotted over the bitmap on redraw.
+ *
+ * \param c The svg content.
+ * \param width The width to render at or zero for the content width.
+ * \param height The height to render at or zero for the content height.
+ * \return The rendered bitmap or NULL on error.
+ */
+static struct bitmap *svg_render(struct content *c, int width, int height)
+{
+	svg_content *svg = (svg_content *) c;
+	struct svgtiny_diagram *diagram = svg->diagram;
+	struct svg_raster raster;
+	struct bitmap *bitmap;
+	uint8_t *pixels;
+	size_t rowstride;
+	float sx, sy;
+	unsigned int i;
+	unsigned int j;
+	nserror res = NSERROR_OK;
+	int y;
+
+	if ((width <= 0) || (height <= 0)) {
+		width = c->width;
+		height = c->height;
+	}
+	if ((width <= 0) || (height <= 0) ||
+	    (c->width <= 0) || (c->height <= 0)) {
+		return NULL;
+	}
+
+	memset(&raster, 0, sizeof(raster));
+	raster.width = width;
+	raster.height = height;
+	raster.stride = width + 2;
+	raster.x0 = raster.stride;
+	raster.y0 = height;
+	raster.cell = calloc((size_t)raster.stride * height, sizeof(float));
+	if (raster.cell == NULL) {
+		return NULL;
+	}
+
+	bitmap = guit->bitmap->create(width, height, BITMAP_CLEAR_MEMORY);
+	if (bitmap == NULL) {
+		free(raster.cell);
+		return NULL;
+	}
+	pixels = guit->bitmap->get_buffer(bitmap);
+	rowstride = guit->bitmap->get_rowstride(bitmap);
+	for (y = 0; y < height; y++) {
+		memset(pixels + y * rowstride, 0, width * 4);
+	}
+
+	sx = (float) width / (float) c->width;
+	sy = (float) height / (float) c->height;
+
+	for (i = 0; (i != diagram->shape_count) && (res == NSERROR_OK); i++) {
+		struct svgtiny_shape *shape = &diagram->shape[i];
+
+		if (shape->path == NULL) {
+			continue;
+		}
+
+		res = svg_raster_flatten(&raster, shape->path,
+				shape->path_length, sx, sy);
+		if (res != NSERROR_OK) {
+			break;
+		}
+
+		if (shape->fill != svgtiny_TRANSPARENT) {
+			for (j = 0; j != raster.subpaths; j++) {
+				struct svg_subpath *sub = &raster.subpath[j];
+				if (sub->count > 2) {
+					svg_raster_polygon(&raster,
+							raster.point + sub->first * 2,
+							sub->count);
+				}
+			}
+			svg_raster_composite(&raster, pixels, rowstride,
+					shape->fill);
+		}
+
+		if (shape->stroke != svgtiny_TRANSPARENT) {
+			float hw = shape->stroke_width * (sx + sy) / 4.0f;
+			if (hw < 0.5f) {
+				hw = 0.5f;
+			}
+			for (j = 0; j != raster.subpaths; j++) {
+				if (raster.subpath[j].count > 1) {
+					svg_raster_stroke(&raster,
+							&raster.subpath[j], hw);
+				}
+			}
+			svg_raster_composite(&raster, pixels, rowstride,
+					shape->stroke);
+		}
+	}
+
+	free(raster.cell);
+	free(raster.point);
+	free(raster.subpath);
+
+	if (res != NSERROR_OK) {
+		guit->bitmap->destroy(bitmap);
+		return NULL;
+	}
+
+	guit->bitmap->set_opaque(bitmap, guit->bitmap->test_opaque(bitmap));
+	guit->bitmap->modified(bitmap);
+
+	return bitmap;
+}
+
 
 /**
  * Convert a CONTENT_SVG for display.
@@ -113,6 +745,12 @@ static bool svg_convert(struct content *c)
 		snprintf(c->title, 100, messages_get("svgTitle"),
 				width, height, c->source_size);*/
 	//c->size += ?;
+
+	/* shapes are drawn from a bitmap rendered at the plotted size */
+	if (image_cache_add(c, NULL, NULL) == NSERROR_OK) {
+		image_cache_set_renderer(c, svg_render);
+	}
+
 	content_set_ready(c);
 	content_set_done(c);
 	/* Done: update status bar */
@@ -130,6 +768,7 @@ static void svg_reformat(struct content *c, int width, int height)
 	svg_content *svg = (svg_content *) c;
 	const uint8_t *source_data;
 	size_t source_size;
+	unsigned int i;
 
 	assert(svg->diagram);
 
@@ -146,6 +785,17 @@ static void svg_reformat(struct content *c, int width, int height)
 
 		svg->current_width = width;
 		svg->current_height = height;
+
+		svg->has_text = false;
+		for (i = 0; i != svg->diagram->shape_count; i++) {
+			if ((svg->diagram->shape[i].path == NULL) &&
+			    (svg->diagram->shape[i].text != NULL)) {
+				svg->has_text = true;
+			}
+		}
+
+		/* discard any bitmap of the previous diagram */
+		image_cache_set_renderer(c, svg_render);
 	}
 
 	c->width = svg->diagram->width;
@@ -155,6 +805,8 @@ static void svg_reformat(struct content *c, int width, int height)
 
 /**
  * Redraw a CONTENT_SVG.
+ *
+ * \param paths Whether to plot paths, or only the text.
  */
 
 static bool
@@ -166,7 +818,8 @@ svg_redraw_internal(struct content *c,
 		    const struct rect *clip,
 		    const struct redraw_context *ctx,
 		    float scale,
-		    colour background_colour)
+		    colour background_colour,
+		    bool paths)
 {
 	svg_content *svg = (svg_content *) c;
 	float transform[6];
@@ -193,6 +846,9 @@ svg_redraw_internal(struct content *c,
 
 	for (i = 0; i != diagram->shape_count; i++) {
 		if (diagram->shape[i].path) {
+			if (!paths) {
+				continue;
+			}
 			pstyle.stroke_width = plot_style_int_to_fixed(
 					diagram->shape[i].stroke_width);
 			pstyle.stroke_colour = BGR(diagram->shape[i].stroke);
@@ -242,8 +898,10 @@ svg_redraw_internal(struct content *c,
 static bool svg_redraw(struct content *c, struct content_redraw_data *data,
 		const struct rect *clip, const struct redraw_context *ctx)
 {
+	svg_content *svg = (svg_content *) c;
 	int x = data->x;
 	int y = data->y;
+	bool paths = true;
 
 	if ((data->width <= 0) && (data->height <= 0)) {
 		/* No point trying to plot SVG if it does not occupy a valid
@@ -251,12 +909,22 @@ static bool svg_redraw(struct content *c, struct content_redraw_data *data,
 		return true;
 	}
 
+	if ((data->width > 0) && (data->height > 0) &&
+	    ((size_t)data->width * data->height <= SVG_RENDER_MAX_AREA) &&
+	    image_cache_redraw(c, data, clip, ctx)) {
+		/* Paths were plotted from a bitmap rendered at this size */
+		if (svg->has_text == false) {
+			return true;
+		}
+		paths = false;
+	}
+
 	if ((data->repeat_x == false) && (data->repeat_y == false)) {
 		/* Simple case: SVG is not tiled */
 		return svg_redraw_internal(c, x, y,
 				data->width, data->height,
 				clip, ctx, data->scale,
-				data->background_colour);
+				data->background_colour, paths);
 	} else {
 		/* Tiled redraw required.  SVG repeats to extents of clip
 		 * rectangle, in x, y or both directions */
@@ -284,7 +952,8 @@ static bool svg_redraw(struct content *c, struct content_redraw_data *data,
 				if (!svg_redraw_internal(c, x, y,
 						data->width, data->height,
 						clip, ctx, data->scale,
-						data->background_colour)) {
+						data->background_colour,
+						paths)) {
 					return false;
 				}
 			}
@@ -303,6 +972,8 @@ static void svg_destroy(struct content *c)
 {
 	svg_content *svg = (svg_content *) c;
 
+	image_cache_destroy(c);
+
 	if (svg->diagram != NULL)
 		svgtiny_free(svg->diagram);
 }
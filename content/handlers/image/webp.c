@@ -83,67 +83,76 @@ webp_create(const content_handler *handler,
 }
 
 /**
- * create a bitmap from webp content.
+ * Size the bitmap webp source data is decoded into.
+ *
+ * The image is always decoded at full size.
  */
-static struct bitmap *
-webp_cache_convert(struct content *c)
+static bool
+webp_cache_measure(const uint8_t *source_data,
+		   size_t source_size,
+		   struct image_cache_decode_params *params)
 {
-	const uint8_t *source_data; /* webp source data */
-	size_t source_size; /* length of webp source data */
-	VP8StatusCode webpres;
 	WebPBitstreamFeatures webpfeatures;
-	unsigned int bmap_flags;
-	uint8_t *pixels = NULL;
-	uint8_t *decoded;
-	size_t rowstride;
-	struct bitmap *bitmap = NULL;
-
-	source_data = content__get_source_data(c, &source_size);
 
-	webpres = WebPGetFeatures(source_data, source_size, &webpfeatures);
-
-	if (webpres != VP8_STATUS_OK) {
-		return NULL;
+	if (WebPGetFeatures(source_data,
+			    source_size,
+			    &webpfeatures) != VP8_STATUS_OK) {
+		return false;
 	}
 
+	params->width = webpfeatures.width;
+	params->height = webpfeatures.height;
 	if (webpfeatures.has_alpha == 0) {
-		bmap_flags = BITMAP_NEW | BITMAP_OPAQUE;
+		params->flags = BITMAP_NEW | BITMAP_OPAQUE;
 	} else {
-		bmap_flags = BITMAP_NEW;
+		params->flags = BITMAP_NEW;
 	}
 
-	/* create bitmap */
-	bitmap = guit->bitmap->create(webpfeatures.width,
-				      webpfeatures.height,
-				      bmap_flags);
-	if (bitmap == NULL) {
-		/* empty bitmap could not be created */
-		return NULL;
-	}
-
-	pixels = guit->bitmap->get_buffer(bitmap);
-	if (pixels == NULL) {
-		/* bitmap with no buffer available */
-		guit->bitmap->destroy(bitmap);
-		return NULL;
-	}
+	return true;
+}
 
-	rowstride = guit->bitmap->get_rowstride(bitmap);
+/**
+ * decode webp source data into a bitmap buffer.
+ *
+ * Only uses the data passed so may be called from a decode worker.
+ */
+static bool
+webp_cache_decode(const uint8_t *source_data,
+		  size_t source_size,
+		  const struct image_cache_decode_params *params,
+		  uint8_t *pixels,
+		  size_t rowstride)
+{
+	uint8_t *decoded;
 
 	decoded = WebPDecodeRGBAInto(source_data,
 				     source_size,
 				     pixels,
-				     webpfeatures.width * webpfeatures.height * 4,
+				     rowstride * params->height,
 				     rowstride);
-	if (decoded == NULL) {
-		/* decode failed */
-		guit->bitmap->destroy(bitmap);
-		return NULL;
-	}
 
-	guit->bitmap->modified(bitmap);
+	return decoded != NULL;
+}
+
+/** webp decoder which may be run off the redraw path */
+static const struct image_cache_decoder webp_cache_decoder = {
+	.measure = webp_cache_measure,
+	.decode = webp_cache_decode,
+};
+
+/**
+ * create a bitmap from webp content.
+ */
+static struct bitmap *
+webp_cache_convert(struct content *c)
+{
+	const uint8_t *source_data; /* webp source data */
+	size_t source_size; /* length of webp source data */
+
+	source_data = content__get_source_data(c, &source_size);
 
-	return bitmap;
+	return image_cache_decode(&webp_cache_decoder,
+				  source_data, source_size, 0, 0);
 }
 
 /**
@@ -177,6 +186,7 @@ static bool webp_convert(struct content *c)
 	c->size = c->width * c->height * 4;
 
 	image_cache_add(c, NULL, webp_cache_convert);
+	image_cache_set_decoder(c, &webp_cache_decoder);
 
 	content_set_ready(c);
 	content_set_done(c);
@@ -121,6 +121,8 @@ struct llcache_store_parameters {
 
 	size_t limit; /**< The backing store upper bound target size */
 	size_t hysteresis; /**< The hysteresis around the target size */
+
+	bool compress; /**< Whether object data is compressed in the store */
 };
 
 /**
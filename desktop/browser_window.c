@@ -2230,6 +2230,9 @@ browser_window_mouse_click_internal(struct browser_window *bw,
 				    BROWSER_MOUSE_DRAG_2)) {
 			browser_window_page_drag_start(bw, x, y);
 			browser_window_set_pointer(bw, BROWSER_POINTER_MOVE);
+		} else if (mouse & BROWSER_MOUSE_CLICK_1) {
+			/* Let the content act on being clicked */
+			content_mouse_action(c, bw, mouse, x, y);
 		}
 		break;
 	}
@@ -19,21 +19,58 @@
 /**
  * \file desktop/download.c
  * \brief Core download context implementation
+ *
+ * Large downloads from servers which accept byte ranges may be split
+ * into segments fetched in parallel. The response headers of the
+ * initial fetch serve as the probe; once they show the length and
+ * range support the initial fetch is abandoned and each segment is
+ * requested with its own Range header. Segments are delivered to the
+ * frontend at their offset within the file and a segment map allows
+ * an interrupted download to be resumed.
  */
 
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
+#include "content/fetch.h"
 #include "content/llcache.h"
 #include "utils/corestrings.h"
 #include "utils/http.h"
+#include "utils/nsoption.h"
 #include "utils/utils.h"
 #include "utils/log.h"
 #include "desktop/download.h"
 #include "netsurf/download.h"
 #include "desktop/gui_internal.h"
 
+/** Maximum number of segments a download is split into */
+#define DOWNLOAD_SEGMENT_MAX 16
+
+/** Smallest segment a download is split into / bytes */
+#define DOWNLOAD_SEGMENT_MIN_LENGTH (256 * 1024)
+
+/** Number of times an interrupted segment is resumed before giving up */
+#define DOWNLOAD_SEGMENT_RETRIES 3
+
+/** First line of a serialised segment map */
+#define DOWNLOAD_SEGMENT_MAP_MAGIC "NetSurf segments 1"
+
+/**
+ * A ranged segment of a download
+ */
+struct download_segment {
+	download_context *ctx;			/**< Owning download */
+	struct fetch *fetch;			/**< Active fetch, or NULL */
+	unsigned long long int start;		/**< Offset of first byte */
+	unsigned long long int end;		/**< Offset after last byte */
+	unsigned long long int done;		/**< Bytes written so far */
+	unsigned int retries;			/**< Resumes attempted */
+	bool range_ok;				/**< Response is our range */
+};
+
 /**
  * A context for a download
  */
@@ -46,8 +83,15 @@ struct download_context {
 	char *filename;				/**< Suggested filename */
 
 	struct gui_download_window *window;	/**< GUI download window */
+
+	char *validator;			/**< ETag or Last-Modified */
+	struct download_segment *segments;	/**< Ranged segments, or NULL */
+	unsigned int segment_count;		/**< Number of segments */
+	bool segmented;				/**< Segment fetches started */
 };
 
+static nserror download_segment_fetch(struct download_segment *seg);
+
 /**
  * Parse a filename parameter value
  * 
@@ -83,6 +127,348 @@ static char *download_default_filename(nsurl *url)
 	return NULL;
 }
 
+/**
+ * Abort all active segment fetches of a download
+ *
+ * \param ctx  Context to abort segments of
+ */
+static void download_segments_abort(download_context *ctx)
+{
+	unsigned int idx;
+
+	for (idx = 0; idx < ctx->segment_count; idx++) {
+		if (ctx->segments[idx].fetch != NULL) {
+			fetch_abort(ctx->segments[idx].fetch);
+			ctx->segments[idx].fetch = NULL;
+		}
+	}
+}
+
+/**
+ * Handle a segment fetch which stopped before its range was complete
+ *
+ * The segment is resumed from the last byte written unless it has
+ * already been retried too often, in which case the whole download
+ * fails.
+ *
+ * \param seg    Segment which stopped
+ * \param error  Error message to report if the download fails
+ */
+static void
+download_segment_interrupted(struct download_segment *seg, const char *error)
+{
+	download_context *ctx = seg->ctx;
+
+	if (seg->retries < DOWNLOAD_SEGMENT_RETRIES) {
+		seg->retries++;
+		NSLOG(netsurf, INFO, "resuming segment %llu-%llu at %llu (%s)",
+		      seg->start, seg->end, seg->start + seg->done, error);
+		if (download_segment_fetch(seg) == NSERROR_OK) {
+			return;
+		}
+	}
+
+	download_segments_abort(ctx);
+	guit->download->error(ctx->window, error);
+}
+
+/**
+ * Check for completion of all the segments of a download
+ *
+ * \param ctx  Context to check
+ */
+static void download_segments_check_done(download_context *ctx)
+{
+	unsigned int idx;
+
+	for (idx = 0; idx < ctx->segment_count; idx++) {
+		struct download_segment *seg = &ctx->segments[idx];
+		if (seg->start + seg->done < seg->end) {
+			return;
+		}
+	}
+
+	guit->download->done(ctx->window);
+}
+
+/**
+ * Check a response header of a segment fetch
+ *
+ * A segment is only accepted if the server responds with the range
+ * that was requested.
+ *
+ * \param seg  Segment the header belongs to
+ * \param buf  Header line
+ * \param len  Length of \a buf
+ */
+static void
+download_segment_header(struct download_segment *seg,
+			const uint8_t *buf,
+			size_t len)
+{
+	char line[128];
+	unsigned long long int first;
+	unsigned long long int last;
+
+	if (len >= sizeof(line)) {
+		return;
+	}
+	memcpy(line, buf, len);
+	line[len] = '\0';
+
+	if (strncmp(line, "HTTP/", 5) == 0) {
+		/* a new response, such as after a 100 Continue */
+		seg->range_ok = false;
+	} else if (strncasecmp(line, "Content-Range:", 14) == 0) {
+		if ((sscanf(line + 14, " bytes %llu-%llu", &first, &last) == 2) &&
+		    (first == seg->start + seg->done) &&
+		    (last == seg->end - 1)) {
+			seg->range_ok = true;
+		}
+	}
+}
+
+/**
+ * Callback for segment fetch events
+ *
+ * \param msg  Fetch message
+ * \param p    The segment being fetched
+ */
+static void download_segment_callback(const fetch_msg *msg, void *p)
+{
+	struct download_segment *seg = p;
+	download_context *ctx = seg->ctx;
+	size_t len;
+	nserror error;
+
+	switch (msg->type) {
+	case FETCH_HEADER:
+		download_segment_header(seg,
+				msg->data.header_or_data.buf,
+				msg->data.header_or_data.len);
+		break;
+
+	case FETCH_DATA:
+		if (seg->range_ok == false) {
+			/* server ignored or changed the range */
+			fetch_abort(seg->fetch);
+			seg->fetch = NULL;
+			seg->retries = DOWNLOAD_SEGMENT_RETRIES;
+			download_segment_interrupted(seg,
+					"Server did not honour range request");
+			break;
+		}
+
+		len = msg->data.header_or_data.len;
+		if (len > seg->end - seg->start - seg->done) {
+			len = seg->end - seg->start - seg->done;
+		}
+
+		/** \todo Lose ugly cast */
+		error = guit->download->data_at(ctx->window,
+				seg->start + seg->done,
+				(const char *) msg->data.header_or_data.buf,
+				len);
+		if (error != NSERROR_OK) {
+			download_segments_abort(ctx);
+			break;
+		}
+		seg->done += len;
+		break;
+
+	case FETCH_FINISHED:
+		seg->fetch = NULL;
+		if (seg->start + seg->done < seg->end) {
+			download_segment_interrupted(seg,
+					"Connection closed early");
+		} else {
+			download_segments_check_done(ctx);
+		}
+		break;
+
+	case FETCH_ERROR:
+		seg->fetch = NULL;
+		download_segment_interrupted(seg, msg->data.error);
+		break;
+
+	case FETCH_TIMEDOUT:
+		seg->fetch = NULL;
+		download_segment_interrupted(seg, "Connection timed out");
+		break;
+
+	case FETCH_REDIRECT:
+	case FETCH_NOTMODIFIED:
+	case FETCH_AUTH:
+	case FETCH_CERT_ERR:
+	case FETCH_SSL_ERR:
+		/* the probe fetch already resolved all of these */
+		seg->fetch = NULL;
+		seg->retries = DOWNLOAD_SEGMENT_RETRIES;
+		download_segment_interrupted(seg, "Unexpected segment response");
+		break;
+
+	case FETCH_PROGRESS:
+	case FETCH_CERTS:
+		break;
+	}
+}
+
+/**
+ * Start fetching the outstanding range of a segment
+ *
+ * \param seg  Segment to fetch
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+static nserror download_segment_fetch(struct download_segment *seg)
+{
+	download_context *ctx = seg->ctx;
+	char range[64];
+	char *if_range = NULL;
+	const char *headers[4];
+	int header_idx = 0;
+	nserror error;
+
+	snprintf(range, sizeof(range), "Range: bytes=%llu-%llu",
+		 seg->start + seg->done, seg->end - 1);
+	headers[header_idx++] = range;
+
+	/* ranges of an encoded representation cannot be decoded apart */
+	headers[header_idx++] = "Accept-Encoding: identity";
+
+	/* have the server refuse the range if the resource changed */
+	if (ctx->validator != NULL) {
+		size_t len = SLEN("If-Range: ") + strlen(ctx->validator) + 1;
+		if_range = malloc(len);
+		if (if_range == NULL) {
+			return NSERROR_NOMEM;
+		}
+		snprintf(if_range, len, "If-Range: %s", ctx->validator);
+		headers[header_idx++] = if_range;
+	}
+	headers[header_idx] = NULL;
+
+	seg->range_ok = false;
+
+	error = fetch_start(llcache_handle_get_url(ctx->llcache),
+			    NULL,
+			    download_segment_callback,
+			    seg,
+			    true,
+			    NULL,
+			    NULL,
+			    true,
+			    false,
+			    headers,
+			    &seg->fetch);
+
+	free(if_range);
+
+	return error;
+}
+
+/**
+ * Split a download into evenly sized segments
+ *
+ * \param ctx  Context to split
+ * \return NSERROR_OK on success, NSERROR_NOT_FOUND if the download is
+ *         too small to split or NSERROR_NOMEM on memory exhaustion
+ */
+static nserror download_segments_create(download_context *ctx)
+{
+	unsigned long long int seglen;
+	unsigned int count;
+	unsigned int idx;
+
+	if ((ctx->total_length == 0) ||
+	    (ctx->total_length < nsoption_uint(download_segment_min_size)) ||
+	    (nsoption_int(download_segments) < 2)) {
+		return NSERROR_NOT_FOUND;
+	}
+
+	count = min(nsoption_int(download_segments), DOWNLOAD_SEGMENT_MAX);
+	if (ctx->total_length / count < DOWNLOAD_SEGMENT_MIN_LENGTH) {
+		count = ctx->total_length / DOWNLOAD_SEGMENT_MIN_LENGTH;
+	}
+	if (count < 2) {
+		return NSERROR_NOT_FOUND;
+	}
+
+	ctx->segments = calloc(count, sizeof(struct download_segment));
+	if (ctx->segments == NULL) {
+		return NSERROR_NOMEM;
+	}
+	ctx->segment_count = count;
+
+	seglen = ctx->total_length / count;
+	for (idx = 0; idx < count; idx++) {
+		ctx->segments[idx].ctx = ctx;
+		ctx->segments[idx].start = idx * seglen;
+		ctx->segments[idx].end = (idx + 1) * seglen;
+	}
+	ctx->segments[count - 1].end = ctx->total_length;
+
+	return NSERROR_OK;
+}
+
+/**
+ * Attempt to switch a download to segmented fetching
+ *
+ * Called once the response headers of the initial fetch are known.
+ *
+ * \param ctx  Context to segment
+ * \return true if the download is now fetched in segments
+ */
+static bool download_segments_start(download_context *ctx)
+{
+	const char *http_header;
+	unsigned int idx;
+
+	if (guit->download->data_at == NULL) {
+		goto sequential;
+	}
+
+	/* server must accept byte ranges of the unencoded resource */
+	http_header = llcache_handle_get_header(ctx->llcache, "Accept-Ranges");
+	if ((http_header == NULL) || (strstr(http_header, "bytes") == NULL)) {
+		goto sequential;
+	}
+	http_header = llcache_handle_get_header(ctx->llcache,
+			"Content-Encoding");
+	if ((http_header != NULL) && (strcasecmp(http_header, "identity") != 0)) {
+		goto sequential;
+	}
+
+	/* a segment map from the frontend is already set up to resume */
+	if ((ctx->segments == NULL) &&
+	    (download_segments_create(ctx) != NSERROR_OK)) {
+		goto sequential;
+	}
+
+	for (idx = 0; idx < ctx->segment_count; idx++) {
+		struct download_segment *seg = &ctx->segments[idx];
+		if (seg->start + seg->done >= seg->end) {
+			continue;
+		}
+		if (download_segment_fetch(seg) != NSERROR_OK) {
+			download_segments_abort(ctx);
+			goto sequential;
+		}
+	}
+
+	NSLOG(netsurf, INFO, "fetching %llu bytes in %u segments",
+	      ctx->total_length, ctx->segment_count);
+
+	ctx->segmented = true;
+	return true;
+
+sequential:
+	/* any resume map no longer applies */
+	free(ctx->segments);
+	ctx->segments = NULL;
+	ctx->segment_count = 0;
+	return false;
+}
+
 /**
  * Process fetch headers for a download context.
  * Extracts MIME type, total length, and creates gui_download_window
@@ -114,6 +500,16 @@ static nserror download_context_process_headers(download_context *ctx)
 		length = strtoull(http_header, NULL, 10);
 	}
 
+	/* Retrieve a strong validator for ranged requests */
+	http_header = llcache_handle_get_header(ctx->llcache, "ETag");
+	if ((http_header == NULL) || (strncmp(http_header, "W/", 2) == 0)) {
+		http_header = llcache_handle_get_header(ctx->llcache,
+				"Last-Modified");
+	}
+	if (http_header != NULL) {
+		ctx->validator = strdup(http_header);
+	}
+
 	/* Retrieve and parse Content-Disposition */
 	http_header = llcache_handle_get_header(ctx->llcache, 
 			"Content-Disposition");
@@ -181,6 +577,11 @@ static nserror download_callback(llcache_handle *handle,
 	download_context *ctx = pw;
 	nserror error = NSERROR_OK;
 
+	if (ctx->segmented) {
+		/* The initial fetch was abandoned for ranged segments */
+		return NSERROR_OK;
+	}
+
 	switch (event->type) {
 	case LLCACHE_EVENT_GOT_CERTS:
 		/* Nominally not interested in these */
@@ -190,6 +591,11 @@ static nserror download_callback(llcache_handle *handle,
 		if (error != NSERROR_OK) {
 			llcache_handle_abort(handle);
 			download_context_destroy(ctx);
+		} else if (download_segments_start(ctx)) {
+			llcache_handle_abort(handle);
+
+			/* a resumed download may have nothing left to fetch */
+			download_segments_check_done(ctx);
 		}
 
 		break;
@@ -260,6 +666,10 @@ nserror download_context_create(llcache_handle *llcache,
 	ctx->total_length = 0;
 	ctx->filename = NULL;
 	ctx->window = NULL;
+	ctx->validator = NULL;
+	ctx->segments = NULL;
+	ctx->segment_count = 0;
+	ctx->segmented = false;
 
 	llcache_handle_change_callback(llcache, download_callback, ctx);
 
@@ -269,12 +679,18 @@ nserror download_context_create(llcache_handle *llcache,
 /* See download.h for documentation */
 void download_context_destroy(download_context *ctx)
 {
+	if (ctx->segments != NULL) {
+		download_segments_abort(ctx);
+		free(ctx->segments);
+	}
+
 	llcache_handle_release(ctx->llcache);
 
 	if (ctx->mime_type != NULL)
 		lwc_string_unref(ctx->mime_type);
 
 	free(ctx->filename);
+	free(ctx->validator);
 
 	/* Window is not owned by us, so don't attempt to destroy it */
 
@@ -284,6 +700,10 @@ void download_context_destroy(download_context *ctx)
 /* See download.h for documentation */
 void download_context_abort(download_context *ctx)
 {
+	if (ctx->segments != NULL) {
+		download_segments_abort(ctx);
+	}
+
 	llcache_handle_abort(ctx->llcache);
 }
 
@@ -312,3 +732,134 @@ const char *download_context_get_filename(const download_context *ctx)
 	return ctx->filename;
 }
 
+/* See download.h for documentation */
+char *download_context_get_segment_map(const download_context *ctx)
+{
+	const char *url = nsurl_access(download_context_get_url(ctx));
+	size_t len;
+	size_t used;
+	char *map;
+	unsigned int idx;
+
+	if (ctx->segmented == false) {
+		return NULL;
+	}
+
+	/* header lines, then up to three 20 digit numbers per segment */
+	len = SLEN(DOWNLOAD_SEGMENT_MAP_MAGIC) + strlen(url) + 24 +
+		(ctx->validator != NULL ? strlen(ctx->validator) : 0) +
+		ctx->segment_count * 64 + 8;
+	map = malloc(len);
+	if (map == NULL) {
+		return NULL;
+	}
+
+	used = snprintf(map, len, DOWNLOAD_SEGMENT_MAP_MAGIC "\n%s\n%llu\n%s\n",
+			url, ctx->total_length,
+			ctx->validator != NULL ? ctx->validator : "");
+	for (idx = 0; idx < ctx->segment_count; idx++) {
+		const struct download_segment *seg = &ctx->segments[idx];
+		used += snprintf(map + used, len - used, "%llu %llu %llu\n",
+				 seg->start, seg->end, seg->done);
+	}
+
+	return map;
+}
+
+/**
+ * Extract the next line of a segment map
+ *
+ * \param map   Position in map, updated to the start of the next line
+ * \param line  Buffer to receive the line
+ * \param size  Size of \a line
+ * \return true if a line was extracted
+ */
+static bool
+download_segment_map_line(const char **map, char *line, size_t size)
+{
+	const char *eol = strchr(*map, '\n');
+	size_t len;
+
+	if (eol == NULL) {
+		return false;
+	}
+	len = eol - *map;
+	if (len >= size) {
+		return false;
+	}
+	memcpy(line, *map, len);
+	line[len] = '\0';
+	*map = eol + 1;
+
+	return true;
+}
+
+/* See download.h for documentation */
+nserror
+download_context_set_segment_map(download_context *ctx,
+				 const char *map,
+				 unsigned long long int *done_out)
+{
+	struct download_segment segments[DOWNLOAD_SEGMENT_MAX];
+	unsigned int count = 0;
+	unsigned long long int expected = 0;
+	unsigned long long int done = 0;
+	char line[2048];
+
+	if ((ctx->segmented) || (ctx->total_length == 0)) {
+		return NSERROR_BAD_PARAMETER;
+	}
+
+	/* the map must describe this version of this resource */
+	if (!download_segment_map_line(&map, line, sizeof(line)) ||
+	    (strcmp(line, DOWNLOAD_SEGMENT_MAP_MAGIC) != 0) ||
+	    !download_segment_map_line(&map, line, sizeof(line)) ||
+	    (strcmp(line, nsurl_access(download_context_get_url(ctx))) != 0) ||
+	    !download_segment_map_line(&map, line, sizeof(line)) ||
+	    (strtoull(line, NULL, 10) != ctx->total_length) ||
+	    !download_segment_map_line(&map, line, sizeof(line)) ||
+	    (ctx->validator == NULL) ||
+	    (strcmp(line, ctx->validator) != 0)) {
+		return NSERROR_INVALID;
+	}
+
+	/* the segments must exactly cover the resource */
+	while (download_segment_map_line(&map, line, sizeof(line))) {
+		struct download_segment *seg = &segments[count];
+
+		if ((count == DOWNLOAD_SEGMENT_MAX) ||
+		    (sscanf(line, "%llu %llu %llu",
+			    &seg->start, &seg->end, &seg->done) != 3) ||
+		    (seg->start != expected) ||
+		    (seg->end <= seg->start) ||
+		    (seg->done > seg->end - seg->start)) {
+			return NSERROR_INVALID;
+		}
+		expected = seg->end;
+		done += seg->done;
+		count++;
+	}
+	if ((count == 0) || (expected != ctx->total_length)) {
+		return NSERROR_INVALID;
+	}
+
+	free(ctx->segments);
+	ctx->segments = calloc(count, sizeof(struct download_segment));
+	if (ctx->segments == NULL) {
+		ctx->segment_count = 0;
+		return NSERROR_NOMEM;
+	}
+	ctx->segment_count = count;
+	while (count-- > 0) {
+		ctx->segments[count].ctx = ctx;
+		ctx->segments[count].start = segments[count].start;
+		ctx->segments[count].end = segments[count].end;
+		ctx->segments[count].done = segments[count].done;
+	}
+
+	if (done_out != NULL) {
+		*done_out = done;
+	}
+
+	return NSERROR_OK;
+}
@@ -101,4 +101,35 @@ unsigned long long int download_context_get_total_length(const download_context
  */
 const char *download_context_get_filename(const download_context *ctx);
 
+/**
+ * Retrieve the segment map of a download fetched in ranged segments
+ *
+ * The map records how much of each segment has been written. A
+ * frontend may keep it alongside a partial file so the download can
+ * be resumed later with download_context_set_segment_map().
+ *
+ * \param ctx  Context to retrieve segment map from
+ * \return Serialised map which the caller must free, or NULL if the
+ *         download is not segmented or on memory exhaustion
+ */
+char *download_context_get_segment_map(const download_context *ctx);
+
+/**
+ * Resume a download from a previously retrieved segment map
+ *
+ * May only be called from the frontend create entry, before any data
+ * has been delivered. The map is only accepted if it was produced for
+ * the same URL, length and validator. The download then only fetches
+ * the parts of each segment not yet written, though it may still fall
+ * back to fetching the whole resource through the data entry.
+ *
+ * \param ctx       Context to resume
+ * \param map       Segment map from download_context_get_segment_map()
+ * \param done_out  Updated with the number of bytes already written
+ * \return NSERROR_OK on success, NSERROR_INVALID if the map does not
+ *         apply to this download, appropriate error otherwise
+ */
+nserror download_context_set_segment_map(download_context *ctx,
+		const char *map, unsigned long long int *done_out);
+
 #endif
@@ -239,7 +239,7 @@ static nserror verify_download_register(struct gui_download_table *gdt)
 		return NSERROR_BAD_PARAMETER;
 	}
 
-	/* all enties are mandantory */
+	/* all enties except data_at are mandantory */
 	if (gdt->create == NULL) {
 		return NSERROR_BAD_PARAMETER;
 	}
@@ -160,6 +160,15 @@ nserror netsurf_init(const char *store_path)
 	/* image cache hysteresis is 20% of the image cache size */
 	image_cache_parameters.hysteresis = image_cache_parameters.limit / 5;
 
+	/* image decode worker threads */
+	if (nsoption_int(image_decode_threads) > 0) {
+		image_cache_parameters.decode_threads =
+			nsoption_int(image_decode_threads);
+	}
+
+	/* keep decoded images in the backing store */
+	image_cache_parameters.persist = nsoption_bool(disc_cache_bitmaps);
+
 	/* account for image cache use from total */
 	hlcache_parameters.llcache.limit -= image_cache_parameters.limit;
 
@@ -169,6 +178,9 @@ nserror netsurf_init(const char *store_path)
 	/* set backing store hysterissi to 20% */
 	hlcache_parameters.llcache.store.hysteresis = hlcache_parameters.llcache.store.limit / 5;
 
+	/* set whether object data is compressed in the backing store */
+	hlcache_parameters.llcache.store.compress = nsoption_bool(disc_cache_compress);
+
 	/* set the path to the backing store */
 	hlcache_parameters.llcache.store.path =
 		nsoption_charp(disc_cache_path) ?
@@ -101,6 +101,12 @@ NSOPTION_UINT(disc_cache_size, 1024 * 1024 * 1024)
 /** Preferred expiry age of disc cache / days. */
 NSOPTION_INTEGER(disc_cache_age, 28)
 
+/** Whether to deflate object data held in the disc cache. */
+NSOPTION_BOOL(disc_cache_compress, false)
+
+/** Whether to keep decoded images in the disc cache. */
+NSOPTION_BOOL(disc_cache_bitmaps, false)
+
 /** Whether to block advertisements */
 NSOPTION_BOOL(block_advertisements, false)
 
@@ -120,6 +126,22 @@ NSOPTION_BOOL(background_images, true)
 /** Whether to animate images */
 NSOPTION_BOOL(animate_images, true)
 
+/** Whether animations show their first frame until clicked */
+NSOPTION_BOOL(animate_images_on_click, false)
+
+/** Minimum time between animation frame redraws, in cs (0 for no limit) */
+NSOPTION_INTEGER(animate_images_min_delay, 0)
+
+/** Number of threads decoding images off the redraw path. */
+NSOPTION_INTEGER(image_decode_threads, 2)
+
+/** Whether to display images while they are downloading */
+NSOPTION_BOOL(progressive_images, true)
+
+/** How jpegs are decoded, trading quality for speed:
+ * 0 accurate colour, 1 fast colour, 2 fast greyscale */
+NSOPTION_INTEGER(jpeg_decode_profile, 0)
+
 /** Whether to execute javascript */
 NSOPTION_BOOL(enable_javascript, false)
 
@@ -209,6 +231,12 @@ NSOPTION_INTEGER(max_cached_fetch_handles, 6)
 /** Number of times to retry timed-out fetches before giving up. */
 NSOPTION_UINT(max_retried_fetches, 1)
 
+/** Number of parallel ranged fetches used for large downloads. */
+NSOPTION_INTEGER(download_segments, 4)
+
+/** Minimum size of a download before it is fetched in segments / bytes. */
+NSOPTION_UINT(download_segment_min_size, 4 * 1024 * 1024)
+
 /** Number of seconds to allow for a DNS-resolution+connect() before timing out
  * the cURL socket.
  */
@@ -217,6 +245,9 @@ NSOPTION_UINT(curl_fetch_timeout, 30)
 /** Suppress debug output from cURL. */
 NSOPTION_BOOL(suppress_curl_debug, true)
 
+/** File in which resumable TLS sessions are kept between runs. */
+NSOPTION_STRING(tls_session_file, NULL)
+
 /** Whether to allow target="_blank" */
 NSOPTION_BOOL(target_blank, true)
 
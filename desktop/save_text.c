@@ -126,6 +126,9 @@ void save_text_solve_whitespace(struct box *box, bool *first,
 		save_text_whitespace *before, const char **whitespace_text,
 		size_t *whitespace_length)
 {
+	/* whether this box is the list marker of its parent */
+	bool is_marker = box->parent && box_list_marker(box->parent) == box;
+
 	/* work out what whitespace should be placed before the next bit of
 	 * text */
 	if (*before < WHITESPACE_TWO_NEW_LINES &&
@@ -135,18 +138,16 @@ void save_text_solve_whitespace(struct box *box, bool *first,
 			 box->type == BOX_FLOAT_LEFT ||
 			 box->type == BOX_FLOAT_RIGHT) &&
 			/* and not a list element */
-			!box->list_marker &&
+			!box_list_marker(box) &&
 			/* and not a marker... */
-			(!(box->parent && box->parent->list_marker == box) ||
+			(!is_marker ||
 			 /* ...unless marker follows WHITESPACE_TAB */
-			 ((box->parent && box->parent->list_marker == box) &&
-			  *before == WHITESPACE_TAB))) {
+			 (is_marker && *before == WHITESPACE_TAB))) {
 		*before = WHITESPACE_TWO_NEW_LINES;
 	} else if (*before <= WHITESPACE_ONE_NEW_LINE &&
 			(box->type == BOX_TABLE_ROW ||
 			 box->type == BOX_BR ||
-			 (box->type != BOX_INLINE &&
-			 (box->parent && box->parent->list_marker == box)) ||
+			 (box->type != BOX_INLINE && is_marker) ||
 			 (box->parent && box->parent->style &&
 			  (css_computed_white_space(box->parent->style) ==
 			   CSS_WHITE_SPACE_PRE ||
@@ -160,7 +161,7 @@ void save_text_solve_whitespace(struct box *box, bool *first,
 	}
 	else if (*before < WHITESPACE_TAB &&
 			(box->type == BOX_TABLE_CELL ||
-			 box->list_marker)) {
+			 box_list_marker(box))) {
 		*before = WHITESPACE_TAB;
 	}
 
@@ -221,10 +222,10 @@ void extract_text(struct box *box, bool *first, save_text_whitespace *before,
 	assert(box);
 
 	/* If box has a list marker */
-	if (box->list_marker) {
+	if (box_list_marker(box)) {
 		/* do the marker box before continuing with the rest of the
 		 * list element */
-		extract_text(box->list_marker, first, before, save);
+		extract_text(box_list_marker(box), first, before, save);
 	}
 
 	/* read before calling the handler in case it modifies the tree */
@@ -30,6 +30,7 @@
 
 #include "utils/log.h"
 #include "utils/utils.h"
+#include "utils/pixels.h"
 #include "netsurf/bitmap.h"
 #include "netsurf/plotters.h"
 #include "netsurf/content.h"
@@ -182,7 +183,6 @@ static void bitmap_set_opaque(void *bitmap, bool opaque)
  */
 static bool bitmap_test_opaque(void *bitmap)
 {
-        int tst;
 	nsfb_t *bm = bitmap;
 	unsigned char *bmpptr;
 	int width;
@@ -194,15 +194,11 @@ static bool bitmap_test_opaque(void *bitmap)
 
 	nsfb_get_geometry(bm, &width, &height, NULL);
 
-        tst = width * height;
-
-        while (tst-- > 0) {
-                if (bmpptr[(tst << 2) + 3] != 0xff) {
-                        NSLOG(netsurf, INFO, "bitmap %p has transparency", bm);
-                        return false;
-                }
-        }
-        NSLOG(netsurf, INFO, "bitmap %p is opaque", bm);
+	if (!pixels_opaque(bmpptr, (size_t)width * height)) {
+		NSLOG(netsurf, INFO, "bitmap %p has transparency", bm);
+		return false;
+	}
+	NSLOG(netsurf, INFO, "bitmap %p is opaque", bm);
 	return true;
 }
 
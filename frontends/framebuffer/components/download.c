@@ -7,6 +7,7 @@
 #include <limits.h>
 #include <linux/limits.h>
 #include <time.h>
+#include <unistd.h>
 #include <sys/stat.h>
 
 #include "netsurf/browser_window.h"
@@ -30,6 +31,12 @@
 
 static const int TEXTS_MAX_LENGTH = 100;
 
+/** Suffix of the file holding the segment map of a partial download */
+static const char *SEGMENT_MAP_SUFFIX = ".segments";
+
+/** Seconds between saves of the segment map of a download */
+static const int SEGMENT_MAP_SAVE_INTERVAL = 2;
+
 struct gui_download_window {
 	download_context *ctx;
 	bool download_active;
@@ -53,6 +60,12 @@ struct gui_download_window {
 	char *full_path_name;
 	FILE *output_file;
 
+	/* segment map kept beside a partial segmented download */
+	char *segment_map_path;
+	time_t segment_map_last_save;
+	bool keep_partial;
+	bool resumed;
+
 	const char *mime_type;
 	char *filename;
 
@@ -77,10 +90,69 @@ static void download_window_destroy(struct gui_download_window *dw)
 	free(dw->destination_text);
 	free(dw->progress_text);
 	free(dw->full_path_name);
+	free(dw->segment_map_path);
 
 	free(dw);
 }
 
+/**
+ * Write the segment map of a download beside the output file, so an
+ * interrupted download can be resumed.
+ */
+static void save_segment_map(struct gui_download_window *dw)
+{
+	char *map;
+	FILE *fp;
+
+	map = download_context_get_segment_map(dw->ctx);
+	if (map == NULL) {
+		return;
+	}
+
+	fp = fopen(dw->segment_map_path, "w");
+	if (fp != NULL) {
+		fputs(map, fp);
+		fclose(fp);
+	}
+	free(map);
+
+	time(&dw->segment_map_last_save);
+}
+
+/**
+ * Read a segment map left by an interrupted download.
+ *
+ * Returns the map, which the caller must free, or NULL if there is none.
+ */
+static char *load_segment_map(const char *path)
+{
+	FILE *fp;
+	long len;
+	char *map = NULL;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		return NULL;
+	}
+
+	if ((fseek(fp, 0, SEEK_END) == 0) &&
+	    ((len = ftell(fp)) > 0) &&
+	    (fseek(fp, 0, SEEK_SET) == 0)) {
+		map = malloc(len + 1);
+		if (map != NULL) {
+			if (fread(map, 1, len, fp) == (size_t)len) {
+				map[len] = '\0';
+			} else {
+				free(map);
+				map = NULL;
+			}
+		}
+	}
+	fclose(fp);
+
+	return map;
+}
+
 static void download_window_recalculate_progress(struct gui_download_window *dw)
 {
 	time_t current_time;
@@ -135,7 +207,13 @@ static void handle_and_display_error(struct gui_download_window *dw,
 	if (dw->output_file != NULL) {
 		NSLOG(netsurf, INFO, "Closing output file");
 		fclose(dw->output_file);
-		remove(dw->full_path_name);
+		dw->output_file = NULL;
+		if (dw->keep_partial) {
+			NSLOG(netsurf, INFO, "Keeping partial file for resume");
+		} else {
+			remove(dw->full_path_name);
+			remove(dw->segment_map_path);
+		}
 	}
 
 	dw->download_active = false;
@@ -249,8 +327,25 @@ static int prepare_output_file(struct gui_download_window *dw)
 		 nsoption_charp(fb_download_directory),
 		 dw->filename);
 
+	/* resume an interrupted download of the same resource */
+	snprintf(dw->segment_map_path,
+		 PATH_MAX,
+		 "%s%s",
+		 dw->full_path_name,
+		 SEGMENT_MAP_SUFFIX);
+	char *segment_map = load_segment_map(dw->segment_map_path);
+	if (segment_map != NULL) {
+		if (download_context_set_segment_map(dw->ctx,
+						     segment_map,
+						     &dw->progress) == NSERROR_OK) {
+			dw->output_file = fopen(dw->full_path_name, "r+");
+			dw->resumed = (dw->output_file != NULL);
+		}
+		free(segment_map);
+	}
+
 	struct stat check_file;
-	int stat_result = stat(dw->full_path_name, &check_file);
+	int stat_result = dw->resumed ? -1 : stat(dw->full_path_name, &check_file);
 	int next_number = 1;
 	while (stat_result == 0) {
 		char *filename_without_extension = malloc(sizeof(char) *
@@ -271,8 +366,16 @@ static int prepare_output_file(struct gui_download_window *dw)
 		free(filename_without_extension);
 	}
 
+	snprintf(dw->segment_map_path,
+		 PATH_MAX,
+		 "%s%s",
+		 dw->full_path_name,
+		 SEGMENT_MAP_SUFFIX);
+
 	netsurf_mkdir_all(dw->full_path_name);
-	dw->output_file = fopen(dw->full_path_name, "w");
+	if (!dw->resumed) {
+		dw->output_file = fopen(dw->full_path_name, "w");
+	}
 	char error_text[TEXTS_MAX_LENGTH];
 	snprintf(error_text,
 		 TEXTS_MAX_LENGTH,
@@ -312,6 +415,9 @@ gui_download_create(download_context *ctx, struct gui_window *gui)
 	dw->total_length = download_context_get_total_length(ctx);
 	dw->mime_type = download_context_get_mime_type(ctx);
 	dw->output_file = NULL;
+	dw->segment_map_last_save = 0;
+	dw->keep_partial = false;
+	dw->resumed = false;
     dw->filename = malloc(strlen(download_context_get_filename(ctx) + 1));
 	strcpy(dw->filename, download_context_get_filename(ctx));
 	dw->gui = gui;
@@ -320,6 +426,7 @@ gui_download_create(download_context *ctx, struct gui_window *gui)
 	dw->progress_text = (char *)malloc(TEXTS_MAX_LENGTH * sizeof(char));
 	dw->destination_text = (char *)malloc(TEXTS_MAX_LENGTH * sizeof(char));
 	dw->full_path_name = malloc(PATH_MAX * sizeof(char));
+	dw->segment_map_path = malloc((PATH_MAX + 16) * sizeof(char));
 
 	const int DOWNLOAD_WIDGET_MAX_HEIGHT = 500;
 
@@ -471,6 +578,16 @@ static nserror gui_download_data(struct gui_download_window *dw,
 	      "Received download update with data of size %d",
 	      size);
 
+	if (dw->resumed) {
+		/* the resume was refused, so start the file over */
+		dw->resumed = false;
+		dw->progress = 0;
+		remove(dw->segment_map_path);
+		if (ftruncate(fileno(dw->output_file), 0) != 0) {
+			NSLOG(netsurf, WARN, "Could not truncate partial file");
+		}
+	}
+
 	if (fwrite(data, sizeof(char), size, dw->output_file) != size) {
 		char error_text[TEXTS_MAX_LENGTH];
 		snprintf(error_text,
@@ -487,10 +604,56 @@ static nserror gui_download_data(struct gui_download_window *dw,
 	return NSERROR_OK;
 }
 
+static nserror gui_download_data_at(struct gui_download_window *dw,
+				    unsigned long long offset,
+				    const char *data,
+				    unsigned int size)
+{
+	unsigned int written = 0;
+	ssize_t wr;
+
+	NSLOG(netsurf,
+	      DEBUG,
+	      "Received download update with data of size %d at %llu",
+	      size,
+	      offset);
+
+	while (written < size) {
+		wr = pwrite(fileno(dw->output_file),
+			    data + written,
+			    size - written,
+			    offset + written);
+		if (wr <= 0) {
+			char error_text[TEXTS_MAX_LENGTH];
+			snprintf(error_text,
+				 TEXTS_MAX_LENGTH,
+				 "Error writing file to disk: error code %d",
+				 errno);
+			handle_and_display_error(dw,
+						 error_text,
+						 "Download error");
+			return NSERROR_SAVE_FAILED;
+		}
+		written += wr;
+	}
+
+	dw->progress += size;
+	download_window_recalculate_progress(dw);
+
+	if (time(NULL) - dw->segment_map_last_save >=
+	    SEGMENT_MAP_SAVE_INTERVAL) {
+		save_segment_map(dw);
+	}
+
+	return NSERROR_OK;
+}
 
 static void
 gui_download_error(struct gui_download_window *dw, const char *error_msg)
 {
+	/* a segmented download can be resumed from where it stopped */
+	save_segment_map(dw);
+	dw->keep_partial = (dw->segment_map_last_save != 0);
 	handle_and_display_error(dw, error_msg, "Download error");
 	download_context_destroy(dw->ctx);
 }
@@ -505,6 +668,8 @@ static void gui_download_done(struct gui_download_window *dw)
 		fbtk_set_text(dw->title_widget, dw->title_text);
 
 		fclose(dw->output_file);
+		dw->output_file = NULL;
+		remove(dw->segment_map_path);
 		dw->download_active = false;
 		download_window_recalculate_progress(dw);
 		download_context_destroy(dw->ctx);
@@ -522,6 +687,7 @@ static struct gui_download_table download_table = {
 	.data = gui_download_data,
 	.error = gui_download_error,
 	.done = gui_download_done,
+	.data_at = gui_download_data_at,
 };
 
 struct gui_download_table *framebuffer_download_table = &download_table;
@@ -32,6 +32,7 @@
 #include "utils/utils.h"
 #include "utils/nsoption.h"
 #include "utils/filepath.h"
+#include "utils/file.h"
 #include "utils/log.h"
 #include "utils/messages.h"
 #include "netsurf/browser_window.h"
@@ -583,10 +584,23 @@ process_cmdline(int argc, char** argv)
  */
 static nserror set_defaults(struct nsoption_s *defaults)
 {
+	char *home;
+	char *fname;
+
 	/* Set defaults for absent option strings */
 	nsoption_setnull_charp(cookie_file, strdup("~/.netsurf/Cookies"));
 	nsoption_setnull_charp(cookie_jar, strdup("~/.netsurf/Cookies"));
 
+	/* TLS session store default, the path is not tilde expanded */
+	home = getenv("HOME");
+	if (home != NULL) {
+		fname = NULL;
+		netsurf_mkpath(&fname, NULL, 3, home, ".netsurf", "TLSSessions");
+		if (fname != NULL) {
+			nsoption_setnull_charp(tls_session_file, fname);
+		}
+	}
+
 	if (nsoption_charp(cookie_file) == NULL ||
 	    nsoption_charp(cookie_jar) == NULL) {
 		NSLOG(netsurf, INFO, "Failed initialising cookie options");
@@ -623,6 +637,9 @@ static nserror set_defaults(struct nsoption_s *defaults)
 	nsoption_set_colour(sys_colour_WindowFrame, 0x00000000);
 	nsoption_set_colour(sys_colour_WindowText, 0x00000000);
 
+	/* favour jpeg decode speed over accuracy on framebuffer targets */
+	nsoption_set_int(jpeg_decode_profile, 1);
+
 	return NSERROR_OK;
 }
 
@@ -513,6 +513,13 @@ static nserror set_defaults(struct nsoption_s *defaults)
 		nsoption_setnull_charp(hotlist_path, fname);
 	}
 
+	/* TLS session store default */
+	fname = NULL;
+	netsurf_mkpath(&fname, NULL, 2, nsgtk_config_home, "TLSSessions");
+	if (fname != NULL) {
+		nsoption_setnull_charp(tls_session_file, fname);
+	}
+
 	/* download directory default */
 	fname = getenv("HOME");
 	if (fname != NULL) {
@@ -43,6 +43,7 @@ struct gui_window *monkey_find_window_by_content(struct hlcache_handle *content)
 void monkey_window_process_reformats(void);
 
 void monkey_window_handle_command(int argc, char **argv);
+void monkey_download_handle_command(int argc, char **argv);
 void monkey_kill_browser_windows(void);
 
 nserror monkey_warn_user(const char *warning, const char *detail);
@@ -16,9 +16,11 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "utils/errors.h"
 #include "utils/ring.h"
@@ -41,6 +43,72 @@ struct gui_download_window {
 
 static struct gui_download_window *dw_ring = NULL;
 
+/** segment map file applied to the next download created */
+static char *resume_map_path = NULL;
+
+/**
+ * Read a segment map from a file.
+ *
+ * \param path The file to read.
+ * \return The map, which the caller must free, or NULL on error.
+ */
+static char *monkey_download_read_map(const char *path)
+{
+	FILE *fp;
+	long len;
+	char *map = NULL;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		return NULL;
+	}
+
+	if ((fseek(fp, 0, SEEK_END) == 0) &&
+	    ((len = ftell(fp)) > 0) &&
+	    (fseek(fp, 0, SEEK_SET) == 0)) {
+		map = malloc(len + 1);
+		if (map != NULL) {
+			if (fread(map, 1, len, fp) == (size_t)len) {
+				map[len] = '\0';
+			} else {
+				free(map);
+				map = NULL;
+			}
+		}
+	}
+	fclose(fp);
+
+	return map;
+}
+
+/**
+ * Resume a new download from the pending segment map file.
+ *
+ * \param dw The download window just created.
+ */
+static void monkey_download_resume(struct gui_download_window *dw)
+{
+	unsigned long long int done = 0;
+	char *map;
+	nserror res = NSERROR_NOT_FOUND;
+
+	map = monkey_download_read_map(resume_map_path);
+	if (map != NULL) {
+		res = download_context_set_segment_map(dw->dlctx, map, &done);
+		free(map);
+	}
+
+	if (res == NSERROR_OK) {
+		moutf(MOUT_DOWNLOAD, "RESUME DWIN %u DONE %llu",
+		      dw->dwin_num, done);
+	} else {
+		moutf(MOUT_DOWNLOAD, "RESUME DWIN %u FAILED", dw->dwin_num);
+	}
+
+	free(resume_map_path);
+	resume_map_path = NULL;
+}
+
 static struct gui_download_window *
 gui_download_window_create(download_context *ctx,
                            struct gui_window *parent)
@@ -56,6 +124,10 @@ gui_download_window_create(download_context *ctx,
   
 	moutf(MOUT_DOWNLOAD, "CREATE DWIN %u WIN %u",
 	      ret->dwin_num, parent->win_num);
+
+	if (resume_map_path != NULL) {
+		monkey_download_resume(ret);
+	}
   
 	return ret;
 }
@@ -69,6 +141,17 @@ gui_download_window_data(struct gui_download_window *dw,
 	return NSERROR_OK;
 }
 
+static nserror
+gui_download_window_data_at(struct gui_download_window *dw,
+			    unsigned long long offset,
+			    const char *data,
+			    unsigned int size)
+{
+	moutf(MOUT_DOWNLOAD, "DATA_AT DWIN %u OFFSET %llu SIZE %u",
+	      dw->dwin_num, offset, size);
+	return NSERROR_OK;
+}
+
 static void
 gui_download_window_error(struct gui_download_window *dw,
                           const char *error_msg)
@@ -90,6 +173,112 @@ static struct gui_download_table download_table = {
 	.data = gui_download_window_data,
 	.error = gui_download_window_error,
 	.done = gui_download_window_done,
+	.data_at = gui_download_window_data_at,
 };
 
 struct gui_download_table *monkey_download_table = &download_table;
+
+static struct gui_download_window *
+monkey_find_download_by_num(uint32_t dwin_num)
+{
+	struct gui_download_window *ret = NULL;
+
+	RING_ITERATE_START(struct gui_download_window, dw_ring, c_ring) {
+		if (c_ring->dwin_num == dwin_num) {
+			ret = c_ring;
+			RING_ITERATE_STOP(dw_ring, c_ring);
+		}
+	} RING_ITERATE_END(dw_ring, c_ring);
+
+	return ret;
+}
+
+static void
+monkey_download_handle_savemap(int argc, char **argv)
+{
+	struct gui_download_window *dw;
+	char *map;
+	FILE *fp;
+
+	if (argc != 4) {
+		moutf(MOUT_ERROR, "DOWNLOAD SAVEMAP ARGS BAD");
+		return;
+	}
+
+	dw = monkey_find_download_by_num(atoi(argv[2]));
+	if (dw == NULL) {
+		moutf(MOUT_ERROR, "DOWNLOAD NUM BAD");
+		return;
+	}
+
+	map = download_context_get_segment_map(dw->dlctx);
+	if (map == NULL) {
+		moutf(MOUT_DOWNLOAD, "SAVEMAP DWIN %u FAILED", dw->dwin_num);
+		return;
+	}
+
+	fp = fopen(argv[3], "w");
+	if (fp == NULL) {
+		free(map);
+		moutf(MOUT_DOWNLOAD, "SAVEMAP DWIN %u FAILED", dw->dwin_num);
+		return;
+	}
+	fputs(map, fp);
+	fclose(fp);
+	free(map);
+
+	moutf(MOUT_DOWNLOAD, "SAVEMAP DWIN %u OK", dw->dwin_num);
+}
+
+static void
+monkey_download_handle_abort(int argc, char **argv)
+{
+	struct gui_download_window *dw;
+
+	if (argc != 3) {
+		moutf(MOUT_ERROR, "DOWNLOAD ABORT ARGS BAD");
+		return;
+	}
+
+	dw = monkey_find_download_by_num(atoi(argv[2]));
+	if (dw == NULL) {
+		moutf(MOUT_ERROR, "DOWNLOAD NUM BAD");
+		return;
+	}
+
+	download_context_abort(dw->dlctx);
+
+	moutf(MOUT_DOWNLOAD, "DESTROY DWIN %u", dw->dwin_num);
+	RING_REMOVE(dw_ring, dw);
+	download_context_destroy(dw->dlctx);
+	free(dw);
+}
+
+static void
+monkey_download_handle_resumemap(int argc, char **argv)
+{
+	if (argc != 3) {
+		moutf(MOUT_ERROR, "DOWNLOAD RESUMEMAP ARGS BAD");
+		return;
+	}
+
+	free(resume_map_path);
+	resume_map_path = strdup(argv[2]);
+}
+
+void
+monkey_download_handle_command(int argc, char **argv)
+{
+	if (argc == 1)
+		return;
+
+	if (strcmp(argv[1], "SAVEMAP") == 0) {
+		monkey_download_handle_savemap(argc, argv);
+	} else if (strcmp(argv[1], "ABORT") == 0) {
+		monkey_download_handle_abort(argc, argv);
+	} else if (strcmp(argv[1], "RESUMEMAP") == 0) {
+		monkey_download_handle_resumemap(argc, argv);
+	} else {
+		moutf(MOUT_ERROR, "DOWNLOAD COMMAND UNKNOWN %s\n", argv[1]);
+	}
+}
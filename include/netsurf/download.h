@@ -39,6 +39,21 @@ struct gui_download_table {
 	void (*error)(struct gui_download_window *dw, const char *error_msg);
 
 	void (*done)(struct gui_download_window *dw);
+
+	/**
+	 * Write download data at an offset within the file.
+	 *
+	 * Optional. When provided the core may fetch large downloads
+	 * as several ranged segments in parallel, delivering the data
+	 * for each through this entry rather than the data entry.
+	 *
+	 * \param dw The download window.
+	 * \param offset The offset within the file of the data.
+	 * \param data The data.
+	 * \param size The length of \a data.
+	 * \return NSERROR_OK on success or error code.
+	 */
+	nserror (*data_at)(struct gui_download_window *dw, unsigned long long offset, const char *data, unsigned int size);
 };
 
 #endif
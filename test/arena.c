@@ -0,0 +1,234 @@
+/*
+ * Copyright 2026 NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Test arena allocator operations.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+
+#include "utils/arena.h"
+
+/** number of allocations made in the walk test */
+#define WALK_COUNT 1000
+
+/* Tests */
+
+/**
+ * Test allocations are aligned, distinct and writable
+ */
+START_TEST(arena_alloc_test)
+{
+	struct arena *arena;
+	char *a, *b, *c;
+
+	arena = arena_create(0);
+	ck_assert(arena != NULL);
+
+	a = arena_alloc(arena, 1);
+	b = arena_alloc(arena, 24);
+	c = arena_alloc(arena, 0);
+	ck_assert(a != NULL && b != NULL && c != NULL);
+	ck_assert(a != b && b != c && a != c);
+	ck_assert_uint_eq((uintptr_t)a % sizeof(double), 0);
+	ck_assert_uint_eq((uintptr_t)b % sizeof(double), 0);
+	ck_assert_uint_eq((uintptr_t)c % sizeof(double), 0);
+
+	memset(b, 0x55, 24);
+	*a = 1;
+	ck_assert_int_eq(b[0], 0x55);
+	ck_assert_int_eq(b[23], 0x55);
+
+	arena_destroy(arena);
+}
+END_TEST
+
+/**
+ * Test allocations larger than a block
+ */
+START_TEST(arena_large_test)
+{
+	struct arena *arena;
+	char *small1, *large, *small2;
+
+	arena = arena_create(256);
+	ck_assert(arena != NULL);
+
+	small1 = arena_alloc(arena, 16);
+	large = arena_alloc(arena, 4096);
+	small2 = arena_alloc(arena, 16);
+	ck_assert(small1 != NULL && large != NULL && small2 != NULL);
+
+	/* the small allocations continue in the same block */
+	ck_assert(small2 == small1 + 16);
+
+	memset(large, 0xaa, 4096);
+	ck_assert_int_eq((unsigned char)large[4095], 0xaa);
+
+	arena_destroy(arena);
+}
+END_TEST
+
+/**
+ * Test freed memory is reused by allocations of the same class only
+ */
+START_TEST(arena_free_test)
+{
+	struct arena *arena;
+	void *a, *b, *c;
+
+	arena = arena_create(0);
+	ck_assert(arena != NULL);
+
+	a = arena_alloc(arena, 100);
+	b = arena_alloc(arena, 40);
+	ck_assert(a != NULL && b != NULL);
+
+	arena_free(arena, a, 100);
+	arena_free(arena, NULL, 100);
+
+	/* a different class is not satisfied from the freed memory */
+	c = arena_alloc(arena, 40);
+	ck_assert(c != a);
+
+	/* the same class is */
+	c = arena_alloc(arena, 97);
+	ck_assert(c == a);
+
+	arena_destroy(arena);
+}
+END_TEST
+
+/**
+ * Test string copies
+ */
+START_TEST(arena_string_test)
+{
+	struct arena *arena;
+	char *s;
+
+	arena = arena_create(0);
+	ck_assert(arena != NULL);
+
+	s = arena_strdup(arena, "hello world");
+	ck_assert(s != NULL);
+	ck_assert_str_eq(s, "hello world");
+
+	s = arena_strndup(arena, "hello world", 5);
+	ck_assert(s != NULL);
+	ck_assert_str_eq(s, "hello");
+
+	s = arena_strdup(arena, "");
+	ck_assert(s != NULL);
+	ck_assert_str_eq(s, "");
+
+	arena_destroy(arena);
+}
+END_TEST
+
+
+static void arena_walk_count(void *ptr, void *pw)
+{
+	unsigned int *seen = pw;
+	unsigned int *value = ptr;
+
+	ck_assert(*value < WALK_COUNT);
+	seen[*value]++;
+}
+
+/**
+ * Test walking visits every allocation of a single size arena once
+ */
+START_TEST(arena_walk_test)
+{
+	struct arena *arena;
+	unsigned int *seen;
+	unsigned int *value;
+	unsigned int i;
+
+	seen = calloc(WALK_COUNT, sizeof(*seen));
+	ck_assert(seen != NULL);
+
+	/* small blocks so the walk crosses many of them */
+	arena = arena_create(1024);
+	ck_assert(arena != NULL);
+
+	for (i = 0; i < WALK_COUNT; i++) {
+		value = arena_alloc(arena, 40);
+		ck_assert(value != NULL);
+		*value = i;
+	}
+
+	arena_walk(arena, 40, arena_walk_count, seen);
+
+	for (i = 0; i < WALK_COUNT; i++) {
+		ck_assert_uint_eq(seen[i], 1);
+	}
+
+	arena_destroy(arena);
+	free(seen);
+}
+END_TEST
+
+
+static TCase *arena_api_case_create(void)
+{
+	TCase *tc;
+
+	tc = tcase_create("API");
+
+	tcase_add_test(tc, arena_alloc_test);
+	tcase_add_test(tc, arena_large_test);
+	tcase_add_test(tc, arena_free_test);
+	tcase_add_test(tc, arena_string_test);
+	tcase_add_test(tc, arena_walk_test);
+
+	return tc;
+}
+
+
+static Suite *arena_suite(void)
+{
+	Suite *s;
+	s = suite_create("Arena allocator");
+
+	suite_add_tcase(s, arena_api_case_create());
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = arena_suite();
+
+	sr = srunner_create(s);
+	srunner_run_all(sr, CK_ENV);
+
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
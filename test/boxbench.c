@@ -0,0 +1,2098 @@
+/*
+ * Copyright 2026 NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Box tree allocation benchmark.
+ *
+ * Builds and destroys box trees shaped like a long article, a block
+ * and inline container per paragraph holding runs of text and inline
+ * boxes, with each of the allocation schemes the HTML content handler
+ * has used for them:
+ *
+ *  - talloc, each box a talloc child of the tree context with a
+ *    destructor releasing its references, and text copied with
+ *    talloc_strdup().
+ *  - arena, boxes and text bump allocated from arenas and the
+ *    references released by walking the box arena before it is
+ *    destroyed in one operation.
+ *
+ * The boxes are the size of struct box, as html/box.h declares it,
+ * and own a reference each, so construction and teardown do the same
+ * work as the content handler less the style selection and layout.
+ *
+ * With -w the tree is instead laid out and walked the way redraw and
+ * hit testing walk it, once with the members of struct box in the order
+ * they had when every box carried its rarely used data, and once with
+ * the hot members first and that data split into a side record. For
+ * each layout the cache lines a redraw reads from a box, the time per
+ * box and, where the host allows access to the performance counters,
+ * the cache misses per box are reported. The split layout is checked
+ * against the size and member offsets of struct box in html/box.h,
+ * and its cache lines are counted from those offsets; the old layout
+ * is a reconstruction.
+ *
+ * With -p a synthetic pen hover trace is hit tested on the laid out
+ * tree, walking from the root for every event, skipping children with
+ * the child index, and reusing the last path found while the pointer
+ * stays in the area it was found throughout, and the events handled per
+ * second are reported for each. These figures are for a model: the
+ * walks are local copies of the box_at_point() and box_at_point_area()
+ * logic over the bench's own box records, as the real functions need
+ * the html content handler and its libraries, so they show how the
+ * three strategies compare rather than what the browser achieves.
+ *
+ * With -l the text of the tree is broken into lines at 20 widths in
+ * turn, as when a window is resized, splitting text boxes with clones
+ * as layout_text_box_split() does. One tree keeps the clones of each
+ * layout and the other joins them back and reuses them first, as
+ * layout_inline_container_unsplit() does. The boxes in each tree and the
+ * bytes of box arena are reported after every layout. The line breaking
+ * is simplified, but the boxes are struct box and the split and join
+ * follow layout.c.
+ *
+ * usage: boxbench [-c] [-w] [-p] [-l] [-n <paragraphs>] [-r <runs>]
+ */
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "utils/talloc.h"
+#include "utils/arena.h"
+#include "html/box.h"
+
+/** Paragraphs in the default tree */
+#define DEFAULT_PARAGRAPHS 20000
+
+/** Default number of timed runs of each scheme */
+#define DEFAULT_RUNS 5
+
+/** Text boxes in each paragraph */
+#define TEXT_PER_PARAGRAPH 12
+
+/** Size of the boxes built */
+#define BENCH_BOX_SIZE sizeof(struct box)
+
+/**
+ * Box stand in, with the linkage and owned data of a struct box.
+ */
+struct bench_box {
+	int type;
+	unsigned int flags;
+	unsigned int *ref; /**< owned reference, as to a style or node */
+	struct bench_box *next;
+	struct bench_box *prev;
+	struct bench_box *children;
+	struct bench_box *last;
+	struct bench_box *parent;
+	char *text;
+	size_t length;
+	/** remaining fields of a struct box */
+	char other[BENCH_BOX_SIZE - 2 * sizeof(int) - 7 * sizeof(void *) -
+		   sizeof(size_t)];
+};
+
+/**
+ * Allocation scheme under test.
+ */
+struct bench_scheme {
+	const char *name;
+	/** Start a tree */
+	bool (*begin)(void);
+	/** Allocate a box in the tree */
+	struct bench_box *(*box)(void);
+	/** Copy text into the tree */
+	char *(*text)(const char *s, size_t len);
+	/** Release the tree and everything in it */
+	void (*end)(void);
+};
+
+/** Reference count every box holds a reference to */
+static unsigned int bench_refs;
+
+/** Text the boxes copy from */
+static const char bench_words[] =
+	"Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do "
+	"eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut "
+	"enim ad minim veniam, quis nostrud exercitation ullamco laboris ";
+
+static void bench_release(struct bench_box *b)
+{
+	if (b->ref != NULL) {
+		(*b->ref)--;
+		b->ref = NULL;
+	}
+}
+
+
+/* talloc scheme */
+
+static void *bench_talloc_ctx;
+
+static int bench_talloc_destructor(struct bench_box *b)
+{
+	bench_release(b);
+	return 0;
+}
+
+static bool bench_talloc_begin(void)
+{
+	bench_talloc_ctx = talloc_zero(0, int);
+	return bench_talloc_ctx != NULL;
+}
+
+static struct bench_box *bench_talloc_box(void)
+{
+	struct bench_box *b;
+
+	b = talloc(bench_talloc_ctx, struct bench_box);
+	if (b != NULL) {
+		talloc_set_destructor(b, bench_talloc_destructor);
+	}
+	return b;
+}
+
+static char *bench_talloc_text(const char *s, size_t len)
+{
+	return talloc_strndup(bench_talloc_ctx, s, len);
+}
+
+static void bench_talloc_end(void)
+{
+	talloc_free(bench_talloc_ctx);
+	bench_talloc_ctx = NULL;
+}
+
+
+/* arena scheme */
+
+static struct arena *bench_box_arena;
+static struct arena *bench_text_arena;
+
+static void bench_arena_release(void *ptr, void *pw)
+{
+	bench_release(ptr);
+}
+
+static bool bench_arena_begin(void)
+{
+	bench_box_arena = arena_create(0);
+	bench_text_arena = arena_create(0);
+	return bench_box_arena != NULL && bench_text_arena != NULL;
+}
+
+static struct bench_box *bench_arena_box(void)
+{
+	return arena_alloc(bench_box_arena, sizeof(struct bench_box));
+}
+
+static char *bench_arena_text(const char *s, size_t len)
+{
+	return arena_strndup(bench_text_arena, s, len);
+}
+
+static void bench_arena_end(void)
+{
+	arena_walk(bench_box_arena, sizeof(struct bench_box),
+		   bench_arena_release, NULL);
+	arena_destroy(bench_box_arena);
+	arena_destroy(bench_text_arena);
+	bench_box_arena = NULL;
+	bench_text_arena = NULL;
+}
+
+
+static const struct bench_scheme bench_schemes[] = {
+	{ "talloc", bench_talloc_begin, bench_talloc_box,
+	  bench_talloc_text, bench_talloc_end },
+	{ "arena", bench_arena_begin, bench_arena_box,
+	  bench_arena_text, bench_arena_end },
+};
+
+
+/* tree construction */
+
+static struct bench_box *
+bench_add(const struct bench_scheme *scheme, struct bench_box *parent,
+	  int type)
+{
+	struct bench_box *b;
+
+	b = scheme->box();
+	if (b == NULL) {
+		return NULL;
+	}
+	memset(b, 0, sizeof(*b));
+	b->type = type;
+	b->ref = &bench_refs;
+	bench_refs++;
+
+	if (parent != NULL) {
+		b->parent = parent;
+		b->prev = parent->last;
+		if (parent->last != NULL) {
+			parent->last->next = b;
+		} else {
+			parent->children = b;
+		}
+		parent->last = b;
+	}
+
+	return b;
+}
+
+static bool
+bench_build(const struct bench_scheme *scheme, unsigned int paragraphs,
+	    size_t *boxes)
+{
+	struct bench_box *root, *block, *ic, *b;
+	size_t offset = 0;
+	unsigned int p, t;
+
+	root = bench_add(scheme, NULL, 0);
+	if (root == NULL) {
+		return false;
+	}
+	*boxes = 1;
+
+	for (p = 0; p < paragraphs; p++) {
+		block = bench_add(scheme, root, 0);
+		ic = block ? bench_add(scheme, block, 1) : NULL;
+		if (ic == NULL) {
+			return false;
+		}
+		*boxes += 2;
+
+		for (t = 0; t < TEXT_PER_PARAGRAPH; t++) {
+			size_t len = 20 + (p * 7 + t * 13) % 40;
+
+			if (t % 3 == 1) {
+				/* inline element around the text */
+				if (bench_add(scheme, ic, 2) == NULL) {
+					return false;
+				}
+				*boxes += 1;
+			}
+
+			b = bench_add(scheme, ic, 11);
+			if (b == NULL) {
+				return false;
+			}
+			offset = (offset + len) % (sizeof(bench_words) - 61);
+			b->text = scheme->text(bench_words + offset, len);
+			if (b->text == NULL) {
+				return false;
+			}
+			b->length = len;
+			*boxes += 1;
+
+			if (t % 3 == 1) {
+				if (bench_add(scheme, ic, 12) == NULL) {
+					return false;
+				}
+				*boxes += 1;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+/* measurement */
+
+static double now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static bool
+bench_scheme(const struct bench_scheme *scheme, unsigned int paragraphs,
+	     int runs, bool csv)
+{
+	double build_best = 0, free_best = 0;
+	double build_sum = 0, free_sum = 0;
+	size_t boxes = 0;
+	int run;
+
+	for (run = 0; run < runs; run++) {
+		double t0, t1, t2;
+		bool ok;
+
+		t0 = now_ms();
+		ok = scheme->begin() && bench_build(scheme, paragraphs, &boxes);
+		t1 = now_ms();
+		scheme->end();
+		t2 = now_ms();
+
+		if (!ok || bench_refs != 0) {
+			fprintf(stderr, "%s: tree construction failed\n",
+				scheme->name);
+			return false;
+		}
+
+		build_sum += t1 - t0;
+		free_sum += t2 - t1;
+		if (run == 0 || t1 - t0 < build_best) {
+			build_best = t1 - t0;
+		}
+		if (run == 0 || t2 - t1 < free_best) {
+			free_best = t2 - t1;
+		}
+	}
+
+	if (csv) {
+		printf("%s,%zu,%.3f,%.3f,%.3f,%.3f,%.1f,%.1f\n",
+		       scheme->name, boxes,
+		       build_best, build_sum / runs,
+		       free_best, free_sum / runs,
+		       build_best * 1e6 / boxes, free_best * 1e6 / boxes);
+	} else {
+		printf("%-8s %9zu %10.3f %10.3f %10.3f %10.3f %9.1f %9.1f\n",
+		       scheme->name, boxes,
+		       build_best, build_sum / runs,
+		       free_best, free_sum / runs,
+		       build_best * 1e6 / boxes, free_best * 1e6 / boxes);
+	}
+
+	return true;
+}
+
+
+/* traversal */
+
+/** Width the tree is laid out in */
+#define WALK_WIDTH 800
+
+/** Height of a line of text */
+#define WALK_LINE_HEIGHT 18
+
+/** Average advance of a character of text */
+#define WALK_CHAR_WIDTH 7
+
+/** Height of the viewport redrawn */
+#define WALK_VIEWPORT_HEIGHT 600
+
+/** Redraws, at evenly spaced scroll offsets, in each timed run */
+#define WALK_REDRAWS 64
+
+/** Hit tests, at pseudo random points, in each timed run */
+#define WALK_HITS 4096
+
+/** Size of the cache lines the lines read are counted in */
+#define WALK_CACHE_LINE 64
+
+/** Flag of boxes skipped by redraw, as PRINTED */
+#define WALK_PRINTED (1 << 2)
+
+/** Types of the boxes in the tree */
+enum walk_type {
+	WALK_BLOCK,
+	WALK_INLINE_CONTAINER,
+	WALK_INLINE,
+	WALK_FLOAT,
+	WALK_TEXT,
+	WALK_INLINE_END
+};
+
+/** Border of a box side, as struct box_border */
+struct walk_border {
+	int style;
+	unsigned int c;
+	int width;
+};
+
+/** Rectangle redrawn */
+struct walk_rect {
+	int x0, y0, x1, y1;
+};
+
+/**
+ * Box with the members of struct box in the order they had before its
+ * rarely used data was split out.
+ */
+struct walk_mixed {
+	int type;
+	unsigned int flags;
+	void *node;
+	void *styles;
+	const void *style;
+	void *id;
+	struct walk_mixed *next;
+	struct walk_mixed *prev;
+	struct walk_mixed *children;
+	struct walk_mixed *last;
+	struct walk_mixed *parent;
+	struct walk_mixed *inline_end;
+	struct walk_mixed *float_children;
+	struct walk_mixed *next_float;
+	struct walk_mixed *float_container;
+	int clear_level;
+	int cached_place_below_level;
+	int x, y;
+	int width, height;
+	int descendant_x0, descendant_y0, descendant_x1, descendant_y1;
+	int margin[4];
+	int padding[4];
+	struct walk_border border[4];
+	void *scroll_x;
+	void *scroll_y;
+	int min_width;
+	int max_width;
+	int layout_width;
+	const char *text;
+	size_t length;
+	int space;
+	size_t byte_offset;
+	void *href;
+	const char *target;
+	const char *title;
+	unsigned int columns;
+	unsigned int rows;
+	unsigned int start_column;
+	void *col;
+	int list_value;
+	struct walk_mixed *list_marker;
+	void *gadget;
+	char *usemap;
+	void *background;
+	void *object;
+	void *object_params;
+	void *iframe;
+};
+
+struct walk_split;
+struct walk_index;
+
+/** Rarely used box data, as struct box_extra */
+struct walk_extra {
+	void *id;
+	void *href;
+	const char *target;
+	const char *title;
+	struct walk_split *list_marker;
+	void *gadget;
+	char *usemap;
+	void *object_params;
+};
+
+/**
+ * Box with the members of struct box in their current order, the ones
+ * redraw and hit testing read first and the rarely used data apart.
+ */
+struct walk_split {
+	int type;
+	unsigned int flags;
+	const void *style;
+	struct walk_split *next;
+	struct walk_split *prev;
+	struct walk_split *children;
+	struct walk_split *last;
+	struct walk_split *parent;
+	struct walk_split *float_children;
+	struct walk_split *next_float;
+	int x, y;
+	int width, height;
+	int descendant_x0, descendant_y0, descendant_x1, descendant_y1;
+	int margin[4];
+	int padding[4];
+	struct walk_border border[4];
+	void *scroll_x;
+	void *scroll_y;
+	const char *text;
+	size_t length;
+	int space;
+	unsigned int index_position;
+	void *object;
+	void *background;
+	void *iframe;
+	struct walk_extra *extra;
+	struct walk_index *child_index;
+	void *node;
+	void *styles;
+	struct walk_split *inline_end;
+	struct walk_split *float_container;
+	int clear_level;
+	int cached_place_below_level;
+	int min_width;
+	int max_width;
+	int layout_width;
+	size_t byte_offset;
+	unsigned int columns;
+	unsigned int rows;
+	unsigned int start_column;
+	void *col;
+	int list_value;
+};
+
+/** Rarely used data of a mixed box, which is the box itself */
+#define WALK_MIXED_EXTRA(b, arena) (b)
+#define WALK_MIXED_MARKER(b) ((b)->list_marker)
+#define WALK_MIXED_GADGET(b) ((b)->gadget)
+
+/** Rarely used data of a split box, created when first needed */
+#define WALK_SPLIT_EXTRA(b, arena) walk_split_extra((b), (arena))
+#define WALK_SPLIT_MARKER(b) \
+	((b)->extra != NULL ? (b)->extra->list_marker : NULL)
+#define WALK_SPLIT_GADGET(b) \
+	((b)->extra != NULL ? (b)->extra->gadget : NULL)
+
+/** Style every box refers to */
+static const int walk_style;
+
+/** Link every link box refers to */
+static int walk_link;
+
+/** Walk results, kept so the walks are not optimised away */
+static volatile unsigned long walk_sink;
+
+static struct walk_extra *walk_split_extra(struct walk_split *b,
+		struct arena *arena)
+{
+	if (b->extra == NULL) {
+		b->extra = arena_alloc(arena, sizeof(struct walk_extra));
+		if (b->extra == NULL) {
+			abort();
+		}
+		memset(b->extra, 0, sizeof(struct walk_extra));
+	}
+	return b->extra;
+}
+
+/**
+ * Define the tree construction and walks for a box layout.
+ *
+ * The redraw and hit test walks read the members html_redraw_box() and
+ * box_at_point() read, so both layouts are compared doing the same work.
+ *
+ * \param T       box structure
+ * \param EXTRA   rarely used data of a box, created if necessary
+ * \param MARKER  list marker of a box
+ * \param GADGET  form control of a box
+ */
+#define WALK_DEFINE(T, EXTRA, MARKER, GADGET)				\
+static struct T *							\
+T##_add(struct arena *arena, struct T *parent, int type)		\
+{									\
+	struct T *b;							\
+									\
+	b = arena_alloc(arena, sizeof(struct T));			\
+	if (b == NULL) {						\
+		abort();						\
+	}								\
+	memset(b, 0, sizeof(struct T));					\
+	b->type = type;							\
+	b->style = &walk_style;						\
+	b->parent = parent;						\
+	if (parent != NULL) {						\
+		b->prev = parent->last;					\
+		if (parent->last != NULL) {				\
+			parent->last->next = b;				\
+		} else {						\
+			parent->children = b;				\
+		}							\
+		parent->last = b;					\
+	}								\
+	return b;							\
+}									\
+									\
+static struct T *							\
+T##_build(struct arena *arena, struct arena *extra_arena,		\
+	  unsigned int paragraphs, size_t *boxes, size_t *extras)	\
+{									\
+	struct T *root, *block, *ic, *b;				\
+	size_t offset = 0;						\
+	unsigned int p, t;						\
+	int y = 0;							\
+									\
+	root = T##_add(arena, NULL, WALK_BLOCK);			\
+	root->width = WALK_WIDTH;					\
+	*boxes = 1;							\
+	*extras = 0;							\
+									\
+	for (p = 0; p < paragraphs; p++) {				\
+		int lx = 0, ly = 0;					\
+		bool link = false;					\
+									\
+		block = T##_add(arena, root, WALK_BLOCK);		\
+		block->y = y;						\
+		block->width = WALK_WIDTH;				\
+		block->padding[TOP] = block->padding[BOTTOM] = 4;	\
+		ic = T##_add(arena, block, WALK_INLINE_CONTAINER);	\
+		ic->y = 4;						\
+		ic->width = WALK_WIDTH;					\
+		*boxes += 2;						\
+									\
+		if (p % 10 == 0) {					\
+			EXTRA(block, extra_arena)->id = &walk_link;	\
+			(*extras)++;					\
+		}							\
+		if (p % 8 == 0) {					\
+			b = T##_add(arena, NULL, WALK_INLINE);		\
+			b->parent = block;				\
+			b->x = -20;					\
+			b->y = 4;					\
+			b->width = 16;					\
+			b->height = WALK_LINE_HEIGHT;			\
+			b->text = bench_words;				\
+			b->length = 1;					\
+			if (p % 10 != 0) {				\
+				(*extras)++;				\
+			}						\
+			EXTRA(block, extra_arena)->list_marker = b;	\
+			*boxes += 1;					\
+		}							\
+									\
+		for (t = 0; t < TEXT_PER_PARAGRAPH; t++) {		\
+			size_t len = 20 + (p * 7 + t * 13) % 40;	\
+			int width = len * WALK_CHAR_WIDTH;		\
+									\
+			if (lx + width > WALK_WIDTH) {			\
+				lx = 0;					\
+				ly += WALK_LINE_HEIGHT;			\
+			}						\
+									\
+			if (t % 3 == 1) {				\
+				/* link around the text */		\
+				link = true;				\
+				b = T##_add(arena, ic, WALK_INLINE);	\
+				b->x = lx;				\
+				b->y = ly;				\
+				EXTRA(b, extra_arena)->href = &walk_link; \
+				*boxes += 1;				\
+				*extras += 1;				\
+			}						\
+									\
+			b = T##_add(arena, ic, WALK_TEXT);		\
+			offset = (offset + len) %			\
+				(sizeof(bench_words) - 61);		\
+			b->text = bench_words + offset;			\
+			b->length = len;				\
+			b->space = 4;					\
+			b->x = lx;					\
+			b->y = ly;					\
+			b->width = width;				\
+			b->height = WALK_LINE_HEIGHT;			\
+			*boxes += 1;					\
+			if (link) {					\
+				EXTRA(b, extra_arena)->href = &walk_link; \
+				*extras += 1;				\
+			}						\
+			lx += width + b->space;				\
+									\
+			if (link) {					\
+				b = T##_add(arena, ic,			\
+						WALK_INLINE_END);	\
+				b->x = lx;				\
+				b->y = ly;				\
+				EXTRA(b, extra_arena)->href = &walk_link; \
+				*boxes += 1;				\
+				*extras += 1;				\
+				link = false;				\
+			}						\
+		}							\
+									\
+		ic->height = ly + WALK_LINE_HEIGHT;			\
+		ic->descendant_x1 = WALK_WIDTH;				\
+		ic->descendant_y1 = ic->height;				\
+		block->height = ic->height;				\
+		block->descendant_x0 = -20;				\
+		block->descendant_x1 = WALK_WIDTH;			\
+		block->descendant_y1 = block->height + 8;		\
+		y += block->height + 8;					\
+	}								\
+									\
+	root->height = y;						\
+	root->descendant_x0 = -20;					\
+	root->descendant_x1 = WALK_WIDTH;				\
+	root->descendant_y1 = y;					\
+									\
+	return root;							\
+}									\
+									\
+static unsigned long							\
+T##_redraw(const struct T *b, int x_parent, int y_parent,		\
+	   const struct walk_rect *clip, unsigned long *visited)	\
+{									\
+	const struct T *c;						\
+	unsigned long sum;						\
+	int x, y, x0, y0, x1, y1;					\
+									\
+	(*visited)++;							\
+	if (b->flags & WALK_PRINTED) {					\
+		return 0;						\
+	}								\
+									\
+	/* border edge, extended to the descendants if visible */	\
+	x = x_parent + b->x;						\
+	y = y_parent + b->y;						\
+	x0 = x - b->border[LEFT].width;					\
+	y0 = y - b->border[TOP].width;					\
+	x1 = x + b->padding[LEFT] + b->width + b->padding[RIGHT] +	\
+		b->border[RIGHT].width;					\
+	y1 = y + b->padding[TOP] + b->height + b->padding[BOTTOM] +	\
+		b->border[BOTTOM].width;				\
+	if (b->style != NULL) {						\
+		if (x + b->descendant_x0 < x0)				\
+			x0 = x + b->descendant_x0;			\
+		if (y + b->descendant_y0 < y0)				\
+			y0 = y + b->descendant_y0;			\
+		if (x + b->descendant_x1 > x1)				\
+			x1 = x + b->descendant_x1;			\
+		if (y + b->descendant_y1 > y1)				\
+			y1 = y + b->descendant_y1;			\
+	}								\
+	if (x1 <= clip->x0 || x0 >= clip->x1 ||				\
+	    y1 <= clip->y0 || y0 >= clip->y1) {				\
+		return 0;						\
+	}								\
+									\
+	sum = b->type;							\
+	if (b->scroll_x != NULL || b->scroll_y != NULL) {		\
+		sum += 1;						\
+	}								\
+	if (b->background != NULL) {					\
+		sum += 2;						\
+	}								\
+	if (b->object != NULL || b->iframe != NULL) {			\
+		sum += 3;						\
+	} else if (GADGET(b) != NULL) {					\
+		sum += 5;						\
+	} else if (b->text != NULL) {					\
+		sum += b->length + b->space;				\
+	}								\
+									\
+	if (MARKER(b) != NULL) {					\
+		sum += T##_redraw(MARKER(b), x_parent, y_parent,	\
+				clip, visited);				\
+	}								\
+	for (c = b->children; c != NULL; c = c->next) {			\
+		if (c->type != WALK_FLOAT) {				\
+			sum += T##_redraw(c, x, y, clip, visited);	\
+		}							\
+	}								\
+	for (c = b->float_children; c != NULL; c = c->next_float) {	\
+		sum += T##_redraw(c, x, y, clip, visited);		\
+	}								\
+									\
+	return sum;							\
+}									\
+									\
+static bool								\
+T##_contains(const struct T *b, int x, int y)				\
+{									\
+	const struct T *m = MARKER(b);					\
+									\
+	if (x >= -b->border[LEFT].width &&				\
+	    x < b->padding[LEFT] + b->width + b->padding[RIGHT] +	\
+	    b->border[RIGHT].width &&					\
+	    y >= -b->border[TOP].width &&				\
+	    y < b->padding[TOP] + b->height + b->padding[BOTTOM] +	\
+	    b->border[BOTTOM].width) {					\
+		return true;						\
+	}								\
+	if (m != NULL && m->x - b->x <= x && x < m->x - b->x + m->width && \
+	    m->y - b->y <= y && y < m->y - b->y + m->height) {		\
+		return true;						\
+	}								\
+	return b->style != NULL &&					\
+		b->descendant_x0 <= x && x < b->descendant_x1 &&	\
+		b->descendant_y0 <= y && y < b->descendant_y1;		\
+}									\
+									\
+static unsigned long							\
+T##_hit(const struct T *root, int px, int py, unsigned long *visited)	\
+{									\
+	const struct T *b = root, *c;					\
+	unsigned long depth = 0;					\
+	int bx = 0, by = 0;						\
+									\
+	do {								\
+		for (c = b->float_children; c != NULL;			\
+				c = c->next_float) {			\
+			(*visited)++;					\
+			if (T##_contains(c, px - bx - c->x,		\
+					py - by - c->y)) {		\
+				break;					\
+			}						\
+		}							\
+		if (c == NULL) {					\
+			for (c = b->children; c != NULL; c = c->next) {	\
+				(*visited)++;				\
+				if (T##_contains(c, px - bx - c->x,	\
+						py - by - c->y)) {	\
+					break;				\
+				}					\
+			}						\
+		}							\
+		if (c != NULL) {					\
+			bx += c->x;					\
+			by += c->y;					\
+			b = c;						\
+			depth++;					\
+		}							\
+	} while (c != NULL);						\
+									\
+	return depth + b->type;						\
+}
+
+WALK_DEFINE(walk_mixed, WALK_MIXED_EXTRA, WALK_MIXED_MARKER,
+		WALK_MIXED_GADGET)
+WALK_DEFINE(walk_split, WALK_SPLIT_EXTRA, WALK_SPLIT_MARKER,
+		WALK_SPLIT_GADGET)
+
+
+/**
+ * Member of a box read by the walks.
+ */
+struct walk_field {
+	size_t offset;
+	size_t size;
+};
+
+#define WALK_FIELD(T, m) { offsetof(struct T, m), sizeof(((struct T *)0)->m) }
+
+/** Members of a mixed box a redraw reads */
+static const struct walk_field walk_mixed_fields[] = {
+	WALK_FIELD(walk_mixed, type), WALK_FIELD(walk_mixed, flags),
+	WALK_FIELD(walk_mixed, style), WALK_FIELD(walk_mixed, next),
+	WALK_FIELD(walk_mixed, children),
+	WALK_FIELD(walk_mixed, float_children),
+	WALK_FIELD(walk_mixed, next_float),
+	WALK_FIELD(walk_mixed, x), WALK_FIELD(walk_mixed, y),
+	WALK_FIELD(walk_mixed, width), WALK_FIELD(walk_mixed, height),
+	WALK_FIELD(walk_mixed, descendant_x0),
+	WALK_FIELD(walk_mixed, descendant_y1),
+	WALK_FIELD(walk_mixed, padding), WALK_FIELD(walk_mixed, border),
+	WALK_FIELD(walk_mixed, scroll_x), WALK_FIELD(walk_mixed, scroll_y),
+	WALK_FIELD(walk_mixed, text), WALK_FIELD(walk_mixed, length),
+	WALK_FIELD(walk_mixed, space), WALK_FIELD(walk_mixed, object),
+	WALK_FIELD(walk_mixed, background), WALK_FIELD(walk_mixed, iframe),
+	WALK_FIELD(walk_mixed, gadget), WALK_FIELD(walk_mixed, list_marker),
+};
+
+/** Members of struct box a redraw reads */
+static const struct walk_field walk_box_fields[] = {
+	WALK_FIELD(box, type), WALK_FIELD(box, flags),
+	WALK_FIELD(box, style), WALK_FIELD(box, next),
+	WALK_FIELD(box, children),
+	WALK_FIELD(box, float_children),
+	WALK_FIELD(box, next_float),
+	WALK_FIELD(box, x), WALK_FIELD(box, y),
+	WALK_FIELD(box, width), WALK_FIELD(box, height),
+	WALK_FIELD(box, descendant_x0),
+	WALK_FIELD(box, descendant_y1),
+	WALK_FIELD(box, padding), WALK_FIELD(box, border),
+	WALK_FIELD(box, scroll_x), WALK_FIELD(box, scroll_y),
+	WALK_FIELD(box, text), WALK_FIELD(box, length),
+	WALK_FIELD(box, space), WALK_FIELD(box, object),
+	WALK_FIELD(box, background), WALK_FIELD(box, iframe),
+	WALK_FIELD(box, extra),
+};
+
+/** The same members of a split box, which must be where struct box has them */
+static const struct walk_field walk_split_fields[] = {
+	WALK_FIELD(walk_split, type), WALK_FIELD(walk_split, flags),
+	WALK_FIELD(walk_split, style), WALK_FIELD(walk_split, next),
+	WALK_FIELD(walk_split, children),
+	WALK_FIELD(walk_split, float_children),
+	WALK_FIELD(walk_split, next_float),
+	WALK_FIELD(walk_split, x), WALK_FIELD(walk_split, y),
+	WALK_FIELD(walk_split, width), WALK_FIELD(walk_split, height),
+	WALK_FIELD(walk_split, descendant_x0),
+	WALK_FIELD(walk_split, descendant_y1),
+	WALK_FIELD(walk_split, padding), WALK_FIELD(walk_split, border),
+	WALK_FIELD(walk_split, scroll_x), WALK_FIELD(walk_split, scroll_y),
+	WALK_FIELD(walk_split, text), WALK_FIELD(walk_split, length),
+	WALK_FIELD(walk_split, space), WALK_FIELD(walk_split, object),
+	WALK_FIELD(walk_split, background), WALK_FIELD(walk_split, iframe),
+	WALK_FIELD(walk_split, extra),
+};
+
+/**
+ * Count the cache lines the members read from a box span.
+ *
+ * Boxes are 16 byte aligned, so the count is averaged over the four
+ * offsets a box can start at within a line.
+ */
+static double
+walk_lines(const struct walk_field *fields, size_t count)
+{
+	unsigned int total = 0;
+	size_t base, f, line;
+
+	for (base = 0; base < WALK_CACHE_LINE; base += 16) {
+		unsigned long long lines = 0;
+
+		for (f = 0; f < count; f++) {
+			size_t first = (base + fields[f].offset) /
+					WALK_CACHE_LINE;
+			size_t last = (base + fields[f].offset +
+					fields[f].size - 1) / WALK_CACHE_LINE;
+
+			for (line = first; line <= last; line++) {
+				lines |= 1ULL << line;
+			}
+		}
+		for (line = 0; line < 64; line++) {
+			total += (lines >> line) & 1;
+		}
+	}
+
+	return total / (double)(WALK_CACHE_LINE / 16);
+}
+
+
+/**
+ * Hardware cache miss counter, where the host provides one.
+ */
+struct walk_counter {
+	int fd;
+};
+
+static void walk_counter_open(struct walk_counter *counter, bool l1d)
+{
+	counter->fd = -1;
+#ifdef __linux__
+	{
+		struct perf_event_attr attr;
+
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		if (l1d) {
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = PERF_COUNT_HW_CACHE_L1D |
+				(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+				(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		} else {
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		}
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		counter->fd = syscall(__NR_perf_event_open, &attr,
+				0, -1, -1, 0);
+	}
+#endif
+}
+
+static void walk_counter_start(struct walk_counter *counter)
+{
+#ifdef __linux__
+	if (counter->fd >= 0) {
+		ioctl(counter->fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(counter->fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+/**
+ * Stop a counter.
+ *
+ * \return the events counted since it was started, or -1 if unavailable
+ */
+static double walk_counter_stop(struct walk_counter *counter)
+{
+#ifdef __linux__
+	unsigned long long count;
+
+	if (counter->fd >= 0) {
+		ioctl(counter->fd, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(counter->fd, &count, sizeof(count)) ==
+				sizeof(count)) {
+			return count;
+		}
+	}
+#endif
+	return -1;
+}
+
+static void walk_counter_close(struct walk_counter *counter)
+{
+#ifdef __linux__
+	if (counter->fd >= 0) {
+		close(counter->fd);
+	}
+#endif
+}
+
+
+/**
+ * Results of walking one layout.
+ */
+struct walk_result {
+	double redraw_ms; /**< best time for the redraws */
+	double hit_ms; /**< best time for the hit tests */
+	unsigned long redraw_visits; /**< boxes visited by the redraws */
+	unsigned long hit_visits; /**< boxes visited by the hit tests */
+	double redraw_l1d; /**< L1 data misses in the redraws, or -1 */
+	double hit_l1d; /**< L1 data misses in the hit tests, or -1 */
+	double redraw_llc; /**< last level misses in the redraws, or -1 */
+	double hit_llc; /**< last level misses in the hit tests, or -1 */
+};
+
+/**
+ * Time the redraws and hit tests of a tree in a box layout.
+ *
+ * \param REDRAW  redraw walk of the layout
+ * \param HIT     hit test walk of the layout
+ * \param root    root of the tree
+ * \param height  height of the tree
+ * \param runs    number of timed runs
+ * \param r       updated with the results
+ */
+#define WALK_TIME(REDRAW, HIT, root, height, runs, r)			\
+	do {								\
+		struct walk_counter l1d, llc;				\
+		int run, i;						\
+									\
+		walk_counter_open(&l1d, true);				\
+		walk_counter_open(&llc, false);				\
+		for (run = 0; run < (runs); run++) {			\
+			unsigned long sum = 0;				\
+			unsigned int seed = 12345;			\
+			double t0, t1, t2;				\
+			double l1d_redraw, llc_redraw;			\
+									\
+			(r)->redraw_visits = 0;				\
+			(r)->hit_visits = 0;				\
+									\
+			walk_counter_start(&l1d);			\
+			walk_counter_start(&llc);			\
+			t0 = now_ms();					\
+			for (i = 0; i < WALK_REDRAWS; i++) {		\
+				struct walk_rect clip;			\
+				clip.x0 = 0;				\
+				clip.x1 = WALK_WIDTH;			\
+				clip.y0 = ((height) -			\
+					WALK_VIEWPORT_HEIGHT) / 	\
+					(WALK_REDRAWS - 1) * i;		\
+				clip.y1 = clip.y0 +			\
+					WALK_VIEWPORT_HEIGHT;		\
+				sum += REDRAW((root), 0, 0, &clip,	\
+						&(r)->redraw_visits);	\
+			}						\
+			t1 = now_ms();					\
+			l1d_redraw = walk_counter_stop(&l1d);		\
+			llc_redraw = walk_counter_stop(&llc);		\
+									\
+			walk_counter_start(&l1d);			\
+			walk_counter_start(&llc);			\
+			for (i = 0; i < WALK_HITS; i++) {		\
+				int px, py;				\
+				seed = seed * 1103515245 + 12345;	\
+				px = (seed >> 8) % WALK_WIDTH;		\
+				seed = seed * 1103515245 + 12345;	\
+				py = (seed >> 8) % (height);		\
+				sum += HIT((root), px, py,		\
+						&(r)->hit_visits);	\
+			}						\
+			t2 = now_ms();					\
+									\
+			if (run == 0 || t1 - t0 < (r)->redraw_ms) {	\
+				(r)->redraw_ms = t1 - t0;		\
+				(r)->redraw_l1d = l1d_redraw;		\
+				(r)->redraw_llc = llc_redraw;		\
+			}						\
+			if (run == 0 || t2 - t1 < (r)->hit_ms) {	\
+				(r)->hit_ms = t2 - t1;			\
+				(r)->hit_l1d = walk_counter_stop(&l1d);	\
+				(r)->hit_llc = walk_counter_stop(&llc);	\
+			} else {					\
+				walk_counter_stop(&l1d);		\
+				walk_counter_stop(&llc);		\
+			}						\
+			walk_sink += sum;				\
+		}							\
+		walk_counter_close(&l1d);				\
+		walk_counter_close(&llc);				\
+	} while (0)
+
+static void
+walk_print(const char *name, size_t size, size_t boxes, size_t extras,
+	   double lines, const struct walk_result *r, bool csv)
+{
+	double l1d_redraw = -1, l1d_hit = -1, llc_redraw = -1, llc_hit = -1;
+
+	if (r->redraw_l1d >= 0 && r->hit_l1d >= 0) {
+		l1d_redraw = r->redraw_l1d / r->redraw_visits;
+		l1d_hit = r->hit_l1d / r->hit_visits;
+	}
+	if (r->redraw_llc >= 0 && r->hit_llc >= 0) {
+		llc_redraw = r->redraw_llc / r->redraw_visits;
+		llc_hit = r->hit_llc / r->hit_visits;
+	}
+
+	if (csv) {
+		printf("%s,%zu,%zu,%zu,%.2f,%.3f,%.2f,%.3f,%.2f,"
+		       "%.3f,%.3f,%.3f,%.3f\n",
+		       name, size, boxes, extras, lines,
+		       r->redraw_ms, r->redraw_ms * 1e6 / r->redraw_visits,
+		       r->hit_ms, r->hit_ms * 1e6 / r->hit_visits,
+		       l1d_redraw, l1d_hit, llc_redraw, llc_hit);
+		return;
+	}
+
+	printf("%-6s %5zu %8zu %7zu %6.2f %9.3f %7.2f %9.3f %7.2f",
+	       name, size, boxes, extras, lines,
+	       r->redraw_ms, r->redraw_ms * 1e6 / r->redraw_visits,
+	       r->hit_ms, r->hit_ms * 1e6 / r->hit_visits);
+	if (l1d_redraw >= 0) {
+		printf(" %8.3f %8.3f", l1d_redraw, l1d_hit);
+	} else {
+		printf(" %8s %8s", "-", "-");
+	}
+	if (llc_redraw >= 0) {
+		printf(" %8.3f %8.3f\n", llc_redraw, llc_hit);
+	} else {
+		printf(" %8s %8s\n", "-", "-");
+	}
+}
+
+/**
+ * Check the split box is laid out as struct box.
+ *
+ * The walks need a box of their own to build a tree without styles,
+ * nodes or urls, so it is only a fair stand in while it has the size
+ * and member offsets of the real one.
+ */
+static bool walk_split_check(void)
+{
+	size_t f;
+
+	if (sizeof(struct walk_split) != sizeof(struct box) ||
+	    sizeof(struct walk_extra) != sizeof(struct box_extra)) {
+		fprintf(stderr, "split box is %zu+%zu bytes, "
+			"struct box is %zu+%zu\n",
+			sizeof(struct walk_split), sizeof(struct walk_extra),
+			sizeof(struct box), sizeof(struct box_extra));
+		return false;
+	}
+	for (f = 0; f < sizeof(walk_box_fields) / sizeof(walk_box_fields[0]);
+			f++) {
+		if (walk_split_fields[f].offset != walk_box_fields[f].offset ||
+		    walk_split_fields[f].size != walk_box_fields[f].size) {
+			fprintf(stderr, "split box member %zu is at %zu, "
+				"in struct box at %zu\n", f,
+				walk_split_fields[f].offset,
+				walk_box_fields[f].offset);
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool walk_bench(unsigned int paragraphs, int runs, bool csv)
+{
+	struct arena *arena, *extra_arena;
+	struct walk_result result;
+	size_t boxes, extras;
+
+	if (!walk_split_check()) {
+		return false;
+	}
+
+	if (csv) {
+		printf("layout,box_size,boxes,extras,lines_per_box,"
+		       "redraw_ms,redraw_ns_per_box,hit_ms,hit_ns_per_box,"
+		       "redraw_l1d_miss_per_box,hit_l1d_miss_per_box,"
+		       "redraw_llc_miss_per_box,hit_llc_miss_per_box\n");
+	} else {
+		printf("%-6s %5s %8s %7s %6s %9s %7s %9s %7s %8s %8s "
+		       "%8s %8s\n",
+		       "layout", "size", "boxes", "extras", "lines",
+		       "redraw", "ns/box", "hit", "ns/box",
+		       "l1d/box", "l1d/box", "llc/box", "llc/box");
+	}
+
+	/* members in their old order, cold data in every box */
+	arena = arena_create(0);
+	if (arena == NULL) {
+		return false;
+	}
+	{
+		struct walk_mixed *root;
+
+		memset(&result, 0, sizeof(result));
+		root = walk_mixed_build(arena, NULL, paragraphs,
+				&boxes, &extras);
+		WALK_TIME(walk_mixed_redraw, walk_mixed_hit, root,
+				root->height, runs, &result);
+		walk_print("mixed", sizeof(struct walk_mixed), boxes, 0,
+				walk_lines(walk_mixed_fields,
+					sizeof(walk_mixed_fields) /
+					sizeof(walk_mixed_fields[0])),
+				&result, csv);
+	}
+	arena_destroy(arena);
+
+	/* hot members first, cold data in side records */
+	arena = arena_create(0);
+	extra_arena = arena_create(0);
+	if (arena == NULL || extra_arena == NULL) {
+		arena_destroy(arena);
+		arena_destroy(extra_arena);
+		return false;
+	}
+	{
+		struct walk_split *root;
+
+		memset(&result, 0, sizeof(result));
+		root = walk_split_build(arena, extra_arena, paragraphs,
+				&boxes, &extras);
+		WALK_TIME(walk_split_redraw, walk_split_hit, root,
+				root->height, runs, &result);
+		/* boxes with a side record read a line of it too */
+		walk_print("split", sizeof(struct box), boxes, extras,
+				walk_lines(walk_box_fields,
+					sizeof(walk_box_fields) /
+					sizeof(walk_box_fields[0])) +
+				extras / (double)boxes,
+				&result, csv);
+	}
+	arena_destroy(arena);
+	arena_destroy(extra_arena);
+
+	return true;
+}
+
+
+/* pointer hover */
+
+/** Pointer events in the synthetic hover trace */
+#define HOVER_EVENTS 20000
+
+/** Events in each stroke of the pen before it is lifted and moved */
+#define HOVER_STROKE 200
+
+/** Children a box needs to have them indexed, as BOX_INDEX_MIN_CHILDREN */
+#define HOVER_INDEX_MIN 32
+
+/** Deepest hit path the tree can give */
+#define HOVER_DEPTH 8
+
+/** Child index entry, as struct box_index_entry */
+struct walk_index_entry {
+	struct walk_split *box;
+	int top;
+	int bottom;
+};
+
+/** Index of children by vertical extent, as struct box_index */
+struct walk_index {
+	unsigned int count;
+	struct walk_index_entry entry[];
+};
+
+/** Position of the pointer */
+struct hover_point {
+	int x, y;
+};
+
+/** Boxes at a point, as struct html_hit_path */
+struct hover_path {
+	bool valid;
+	struct walk_rect area;
+	unsigned int count;
+	const struct walk_split *box[HOVER_DEPTH];
+};
+
+/** Ways of finding the boxes under the pointer */
+enum hover_mode {
+	HOVER_WALK, /**< walk from the root for every event */
+	HOVER_INDEX, /**< skip children with the child index */
+	HOVER_CACHE /**< reuse the last path, then as HOVER_INDEX */
+};
+
+/**
+ * Index the children of the boxes with many, as box_index_children().
+ */
+static void hover_index(struct walk_split *b)
+{
+	struct walk_index *index;
+	struct walk_split *c;
+	unsigned int count = 0, i = 0;
+	int top = INT_MAX, bottom = INT_MIN;
+
+	for (c = b->children; c != NULL; c = c->next) {
+		hover_index(c);
+		count++;
+	}
+	if (count < HOVER_INDEX_MIN) {
+		return;
+	}
+
+	index = malloc(sizeof(*index) + count * sizeof(index->entry[0]));
+	if (index == NULL) {
+		abort();
+	}
+	index->count = count;
+	for (c = b->children; c != NULL; c = c->next) {
+		if (c->y + c->descendant_y1 + 1 > bottom) {
+			bottom = c->y + c->descendant_y1 + 1;
+		}
+		index->entry[i].box = c;
+		index->entry[i].top = c->y + c->descendant_y0;
+		index->entry[i].bottom = bottom;
+		c->index_position = i++;
+	}
+	while (i-- > 0) {
+		if (index->entry[i].top < top) {
+			top = index->entry[i].top;
+		}
+		index->entry[i].top = top;
+	}
+	b->child_index = index;
+}
+
+static void hover_index_free(struct walk_split *b)
+{
+	struct walk_split *c;
+
+	for (c = b->children; c != NULL; c = c->next) {
+		hover_index_free(c);
+	}
+	free(b->child_index);
+	b->child_index = NULL;
+}
+
+/**
+ * Narrow an area around a point, as box_area_narrow().
+ */
+static void
+hover_narrow(struct walk_rect *area, int x, int y, const struct walk_rect *r)
+{
+	struct walk_rect cut[4];
+	unsigned int count = 0, best = 0, i;
+	double size, best_size = 0;
+
+	if (x >= r->x0 && x < r->x1 && y >= r->y0 && y < r->y1) {
+		if (area->x0 < r->x0)
+			area->x0 = r->x0;
+		if (area->y0 < r->y0)
+			area->y0 = r->y0;
+		if (area->x1 > r->x1)
+			area->x1 = r->x1;
+		if (area->y1 > r->y1)
+			area->y1 = r->y1;
+		return;
+	}
+	if (area->x1 <= r->x0 || r->x1 <= area->x0 ||
+	    area->y1 <= r->y0 || r->y1 <= area->y0) {
+		return;
+	}
+	if (x < r->x0) {
+		cut[count] = *area;
+		cut[count++].x1 = r->x0;
+	}
+	if (x >= r->x1) {
+		cut[count] = *area;
+		cut[count++].x0 = r->x1;
+	}
+	if (y < r->y0) {
+		cut[count] = *area;
+		cut[count++].y1 = r->y0;
+	}
+	if (y >= r->y1) {
+		cut[count] = *area;
+		cut[count++].y0 = r->y1;
+	}
+	for (i = 0; i != count; i++) {
+		size = (double)(cut[i].x1 - cut[i].x0) *
+				(cut[i].y1 - cut[i].y0);
+		if (i == 0 || size > best_size) {
+			best = i;
+			best_size = size;
+		}
+	}
+	*area = cut[best];
+}
+
+/**
+ * Test if a box at a position contains a point, as walk_split_contains(),
+ * narrowing an area to where the result is the same.
+ */
+static bool
+hover_contains(const struct walk_split *b, int bx, int by, int px, int py,
+	       struct walk_rect *area)
+{
+	const struct walk_split *m = WALK_SPLIT_MARKER(b);
+	struct walk_rect r;
+
+	r.x0 = bx - b->border[LEFT].width;
+	r.y0 = by - b->border[TOP].width;
+	r.x1 = bx + b->padding[LEFT] + b->width + b->padding[RIGHT] +
+		b->border[RIGHT].width;
+	r.y1 = by + b->padding[TOP] + b->height + b->padding[BOTTOM] +
+		b->border[BOTTOM].width;
+	if (area != NULL) {
+		hover_narrow(area, px, py, &r);
+	}
+	if (px >= r.x0 && px < r.x1 && py >= r.y0 && py < r.y1) {
+		return true;
+	}
+
+	if (m != NULL) {
+		r.x0 = bx + m->x - b->x;
+		r.y0 = by + m->y - b->y;
+		r.x1 = r.x0 + m->width;
+		r.y1 = r.y0 + m->height;
+		if (area != NULL) {
+			hover_narrow(area, px, py, &r);
+		}
+		if (px >= r.x0 && px < r.x1 && py >= r.y0 && py < r.y1) {
+			return true;
+		}
+	}
+
+	if (b->style == NULL) {
+		return false;
+	}
+	r.x0 = bx + b->descendant_x0;
+	r.y0 = by + b->descendant_y0;
+	r.x1 = bx + b->descendant_x1;
+	r.y1 = by + b->descendant_y1;
+	if (area != NULL) {
+		hover_narrow(area, px, py, &r);
+	}
+	return px >= r.x0 && px < r.x1 && py >= r.y0 && py < r.y1;
+}
+
+/**
+ * Find the boxes at a point, as walk_split_hit(), into a path.
+ *
+ * \param root     root of the tree
+ * \param px       point x coordinate
+ * \param py       point y coordinate
+ * \param indexed  whether to skip children with the child index
+ * \param path     updated with the boxes found, and the area they are
+ *                 found throughout if indexed
+ * \param visited  incremented by the boxes tested
+ */
+static void
+hover_find(const struct walk_split *root, int px, int py, bool indexed,
+	   struct hover_path *path, unsigned long *visited)
+{
+	const struct walk_split *b = root, *c;
+	struct walk_rect *area = indexed ? &path->area : NULL;
+	int bx = 0, by = 0;
+
+	path->area.x0 = INT_MIN / 4;
+	path->area.y0 = INT_MIN / 4;
+	path->area.x1 = INT_MAX / 4;
+	path->area.y1 = INT_MAX / 4;
+	path->box[0] = root;
+	path->count = 1;
+
+	do {
+		const struct walk_index *index = b->child_index;
+
+		for (c = b->float_children; c != NULL; c = c->next_float) {
+			(*visited)++;
+			if (hover_contains(c, bx + c->x, by + c->y,
+					px, py, area)) {
+				break;
+			}
+		}
+		if (c == NULL && indexed && index != NULL) {
+			unsigned int lo = 0, hi = index->count, mid, i;
+			unsigned int first;
+			int y = py - by;
+
+			/* as box_index_range() */
+			while (lo < hi) {
+				mid = lo + (hi - lo) / 2;
+				if (index->entry[mid].bottom < y)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+			first = lo;
+			hi = index->count;
+			while (lo < hi) {
+				mid = lo + (hi - lo) / 2;
+				if (index->entry[mid].top <= y)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+
+			/* as box_index_skip() */
+			if (first > 0 && area->y0 <
+					by + index->entry[first - 1].bottom - 1) {
+				area->y0 = by + index->entry[first - 1].bottom - 1;
+			}
+			for (i = first; i < lo; i++) {
+				c = index->entry[i].box;
+				(*visited)++;
+				if (hover_contains(c, bx + c->x, by + c->y,
+						px, py, area)) {
+					break;
+				}
+			}
+			if (i == lo) {
+				c = NULL;
+				if (lo < index->count && area->y1 >
+						by + index->entry[lo].top) {
+					area->y1 = by + index->entry[lo].top;
+				}
+			}
+		} else if (c == NULL) {
+			for (c = b->children; c != NULL; c = c->next) {
+				(*visited)++;
+				if (hover_contains(c, bx + c->x, by + c->y,
+						px, py, area)) {
+					break;
+				}
+			}
+		}
+		if (c != NULL) {
+			bx += c->x;
+			by += c->y;
+			b = c;
+			path->box[path->count++] = b;
+		}
+	} while (c != NULL && path->count < HOVER_DEPTH);
+
+	path->valid = indexed;
+}
+
+/**
+ * Generate a pen hover trace over a tree.
+ *
+ * The pen follows the lines of text with a little jitter, as when
+ * reading, and is lifted and moved elsewhere every stroke.
+ */
+static void
+hover_trace(struct hover_point *trace, unsigned int count, int height)
+{
+	unsigned int seed = 54321;
+	unsigned int i;
+	int x = 0, y = 0;
+
+	for (i = 0; i < count; i++) {
+		seed = seed * 1103515245 + 12345;
+		if (i % HOVER_STROKE == 0) {
+			x = (seed >> 8) % WALK_WIDTH;
+			seed = seed * 1103515245 + 12345;
+			y = (seed >> 8) % height;
+		} else {
+			x += 1 + (seed >> 8) % 3;
+			y += (int)((seed >> 12) % 3) - 1;
+			if (x >= WALK_WIDTH) {
+				x = 0;
+				y += WALK_LINE_HEIGHT;
+			}
+			if (y < 0) {
+				y = 0;
+			} else if (y >= height) {
+				y = height - 1;
+			}
+		}
+		trace[i].x = x;
+		trace[i].y = y;
+	}
+}
+
+/**
+ * Handle the events of a hover trace.
+ *
+ * \param root     root of the tree
+ * \param trace    pointer positions
+ * \param count    number of positions
+ * \param mode     way of finding the boxes under the pointer
+ * \param visited  updated with the boxes tested
+ * \param hits     updated with the events served from the last path
+ * \return sum of the paths found, to compare the modes
+ */
+static unsigned long
+hover_run(const struct walk_split *root, const struct hover_point *trace,
+	  unsigned int count, enum hover_mode mode,
+	  unsigned long *visited, unsigned long *hits)
+{
+	struct hover_path path;
+	unsigned long sum = 0;
+	unsigned int i, d;
+
+	path.valid = false;
+	*visited = 0;
+	*hits = 0;
+
+	for (i = 0; i < count; i++) {
+		int px = trace[i].x, py = trace[i].y;
+
+		if (mode == HOVER_CACHE && path.valid &&
+		    px >= path.area.x0 && px < path.area.x1 &&
+		    py >= path.area.y0 && py < path.area.y1) {
+			(*hits)++;
+		} else {
+			hover_find(root, px, py, mode != HOVER_WALK,
+					&path, visited);
+		}
+
+		/* stand in for the handling of each box on the path */
+		for (d = 0; d != path.count; d++) {
+			sum += (d + 1) * (path.box[d]->type + 1);
+			if (WALK_SPLIT_GADGET(path.box[d]) != NULL ||
+			    (path.box[d]->extra != NULL &&
+			     path.box[d]->extra->href != NULL)) {
+				sum += 7;
+			}
+		}
+	}
+
+	return sum;
+}
+
+static bool hover_bench(unsigned int paragraphs, int runs, bool csv)
+{
+	static const char *names[] = { "walk", "index", "cached" };
+	struct arena *arena, *extra_arena;
+	struct walk_split *root;
+	struct hover_point *trace;
+	unsigned long expect = 0;
+	size_t boxes, extras;
+	bool ok = true;
+	int mode, run;
+
+	arena = arena_create(0);
+	extra_arena = arena_create(0);
+	trace = malloc(HOVER_EVENTS * sizeof(*trace));
+	if (arena == NULL || extra_arena == NULL || trace == NULL) {
+		arena_destroy(arena);
+		arena_destroy(extra_arena);
+		free(trace);
+		return false;
+	}
+
+	root = walk_split_build(arena, extra_arena, paragraphs,
+			&boxes, &extras);
+	hover_index(root);
+	hover_trace(trace, HOVER_EVENTS, root->height);
+
+	if (csv) {
+		printf("mode,boxes,events,best_ms,events_per_s,"
+		       "boxes_per_event,path_hits\n");
+	} else {
+		printf("%-6s %8s %7s %9s %12s %9s %7s\n",
+		       "mode", "boxes", "events", "best(ms)", "events/s",
+		       "tests/ev", "hits");
+	}
+
+	for (mode = HOVER_WALK; mode <= HOVER_CACHE; mode++) {
+		unsigned long visited = 0, hits = 0, sum = 0;
+		double best = 0;
+
+		for (run = 0; run < runs; run++) {
+			double t0, t1;
+
+			t0 = now_ms();
+			sum = hover_run(root, trace, HOVER_EVENTS, mode,
+					&visited, &hits);
+			t1 = now_ms();
+			if (run == 0 || t1 - t0 < best) {
+				best = t1 - t0;
+			}
+		}
+		walk_sink += sum;
+
+		/* every mode must find the same boxes */
+		if (mode == HOVER_WALK) {
+			expect = sum;
+		} else if (sum != expect) {
+			fprintf(stderr, "%s: paths differ from walk\n",
+				names[mode]);
+			ok = false;
+		}
+
+		if (csv) {
+			printf("%s,%zu,%u,%.3f,%.0f,%.2f,%.3f\n",
+			       names[mode], boxes, HOVER_EVENTS, best,
+			       HOVER_EVENTS * 1000.0 / best,
+			       visited / (double)HOVER_EVENTS,
+			       hits / (double)HOVER_EVENTS);
+		} else {
+			printf("%-6s %8zu %7u %9.3f %12.0f %9.2f %6.1f%%\n",
+			       names[mode], boxes, HOVER_EVENTS, best,
+			       HOVER_EVENTS * 1000.0 / best,
+			       visited / (double)HOVER_EVENTS,
+			       hits * 100.0 / HOVER_EVENTS);
+		}
+	}
+
+	hover_index_free(root);
+	arena_destroy(arena);
+	arena_destroy(extra_arena);
+	free(trace);
+
+	return ok;
+}
+
+
+/* reflow */
+
+/** Reflows of the text, as a window is resized */
+#define REFLOW_COUNT 20
+
+/** Paragraphs reflowed unless given, as the kept clones grow quickly */
+#define REFLOW_PARAGRAPHS 2000
+
+/** Boxes kept for reuse, as html_content spare_clones */
+static struct box *reflow_spare;
+
+/**
+ * Build paragraphs of text boxes in inline containers for reflowing.
+ */
+static struct box *reflow_build(struct arena *arena, unsigned int paragraphs)
+{
+	struct box *root, *ic = NULL, *b;
+	size_t offset = 0;
+	unsigned int p, t;
+
+	root = arena_alloc(arena, sizeof(struct box));
+	if (root == NULL) {
+		return NULL;
+	}
+	memset(root, 0, sizeof(struct box));
+
+	for (p = 0; p < paragraphs; p++) {
+		ic = arena_alloc(arena, sizeof(struct box));
+		if (ic == NULL) {
+			return NULL;
+		}
+		memset(ic, 0, sizeof(struct box));
+		ic->type = BOX_INLINE_CONTAINER;
+		ic->parent = root;
+		ic->prev = root->last;
+		if (root->last != NULL) {
+			root->last->next = ic;
+		} else {
+			root->children = ic;
+		}
+		root->last = ic;
+
+		for (t = 0; t < TEXT_PER_PARAGRAPH; t++) {
+			size_t len = 40 + (p * 7 + t * 13) % 80;
+
+			b = arena_alloc(arena, sizeof(struct box));
+			if (b == NULL) {
+				return NULL;
+			}
+			memset(b, 0, sizeof(struct box));
+			b->type = BOX_TEXT;
+			offset = (offset + len) % (sizeof(bench_words) - 121);
+			b->text = (char *)bench_words + offset;
+			b->length = len;
+			b->space = 1;
+			b->parent = ic;
+			b->prev = ic->last;
+			if (ic->last != NULL) {
+				ic->last->next = b;
+			} else {
+				ic->children = b;
+			}
+			ic->last = b;
+		}
+	}
+
+	return root;
+}
+
+/**
+ * Split a text box at a space, as layout_text_box_split().
+ */
+static struct box *
+reflow_split(struct arena *arena, struct box *b, size_t split)
+{
+	struct box *c2;
+
+	if (reflow_spare != NULL) {
+		c2 = reflow_spare;
+		reflow_spare = c2->next;
+	} else {
+		c2 = arena_alloc(arena, sizeof(struct box));
+		if (c2 == NULL) {
+			return NULL;
+		}
+	}
+	memcpy(c2, b, sizeof(struct box));
+	c2->flags |= CLONE;
+	c2->text = b->text + split + 1;
+	c2->length = b->length - split - 1;
+	b->length = split;
+	b->space = 1;
+
+	c2->prev = b;
+	c2->next = b->next;
+	if (b->next != NULL) {
+		b->next->prev = c2;
+	} else {
+		b->parent->last = c2;
+	}
+	b->next = c2;
+
+	return c2;
+}
+
+/**
+ * Join the text boxes of a container split by a previous layout, as
+ * layout_inline_container_unsplit().
+ */
+static void reflow_unsplit(struct box *ic)
+{
+	struct box *b, *c;
+
+	for (b = ic->children; b != NULL; b = b->next) {
+		while ((c = b->next) != NULL && (c->flags & CLONE) &&
+				c->text >= b->text + b->length &&
+				c->text <= b->text + b->length + 1) {
+			b->length = c->text + c->length - b->text;
+			b->space = c->space;
+
+			b->next = c->next;
+			if (c->next != NULL) {
+				c->next->prev = b;
+			} else {
+				ic->last = b;
+			}
+
+			c->next = reflow_spare;
+			reflow_spare = c;
+		}
+	}
+}
+
+/**
+ * Break the text of a container into lines of a width, splitting boxes
+ * which do not fit at the last space that does.
+ */
+static bool reflow_lines(struct arena *arena, struct box *ic, int width)
+{
+	struct box *b = ic->children;
+	int x = 0;
+
+	while (b != NULL) {
+		int w = b->length * WALK_CHAR_WIDTH;
+		size_t split = 0;
+
+		if (x + w <= width) {
+			x += w + b->space * WALK_CHAR_WIDTH;
+			b = b->next;
+			continue;
+		}
+
+		/* last space before the end of the line */
+		if (x < width) {
+			split = (width - x) / WALK_CHAR_WIDTH;
+		}
+		if (split >= b->length) {
+			split = b->length - 1;
+		}
+		while (split > 0 && b->text[split] != ' ') {
+			split--;
+		}
+
+		if (split == 0 && x > 0) {
+			/* try again at the start of the next line */
+			x = 0;
+			continue;
+		}
+		if (split == 0) {
+			/* the first word does not fit, overflow with it */
+			while (split < b->length && b->text[split] != ' ') {
+				split++;
+			}
+			if (split >= b->length - 1) {
+				x = w + b->space * WALK_CHAR_WIDTH;
+				b = b->next;
+				continue;
+			}
+		}
+
+		if (reflow_split(arena, b, split) == NULL) {
+			return false;
+		}
+		x = 0;
+		b = b->next;
+	}
+
+	return true;
+}
+
+static void reflow_count(void *ptr, void *pw)
+{
+	(*(size_t *)pw)++;
+}
+
+/**
+ * Lay out the text at a run of widths and report the boxes in the tree
+ * and the bytes of box arena after each layout.
+ */
+static bool reflow_bench(unsigned int paragraphs, bool csv)
+{
+	struct arena *arena[2];
+	struct box *root[2], *spare[2] = { NULL, NULL }, *ic;
+	unsigned int reflow, mode;
+
+	if (csv) {
+		printf("reflow,width,keep_boxes,keep_bytes,"
+		       "rejoin_boxes,rejoin_bytes\n");
+	} else {
+		printf("%-6s %5s %10s %12s %10s %12s\n",
+		       "reflow", "width", "keep", "keep(B)",
+		       "rejoin", "rejoin(B)");
+	}
+
+	for (mode = 0; mode < 2; mode++) {
+		arena[mode] = arena_create(0);
+		root[mode] = arena[mode] ?
+			reflow_build(arena[mode], paragraphs) : NULL;
+		if (root[mode] == NULL) {
+			return false;
+		}
+	}
+
+	for (reflow = 0; reflow <= REFLOW_COUNT; reflow++) {
+		int width = 240 + (560 + reflow * 373) % 1000;
+		size_t boxes[2], slots[2];
+
+		for (mode = 0; mode < 2; mode++) {
+			struct box *b;
+
+			reflow_spare = spare[mode];
+			boxes[mode] = 1;
+			for (ic = root[mode]->children; ic != NULL;
+					ic = ic->next) {
+				if (mode == 1) {
+					reflow_unsplit(ic);
+				}
+				if (!reflow_lines(arena[mode], ic, width)) {
+					return false;
+				}
+				for (b = ic->children; b != NULL; b = b->next) {
+					boxes[mode]++;
+				}
+				boxes[mode]++;
+			}
+
+			spare[mode] = reflow_spare;
+
+			slots[mode] = 0;
+			arena_walk(arena[mode], sizeof(struct box),
+					reflow_count, &slots[mode]);
+		}
+
+		printf(csv ? "%u,%d,%zu,%zu,%zu,%zu\n" :
+		       "%-6u %5d %10zu %12zu %10zu %12zu\n",
+		       reflow, width,
+		       boxes[0], slots[0] * sizeof(struct box),
+		       boxes[1], slots[1] * sizeof(struct box));
+	}
+
+	arena_destroy(arena[0]);
+	arena_destroy(arena[1]);
+
+	return true;
+}
+
+
+int main(int argc, char **argv)
+{
+	unsigned int paragraphs = 0;
+	int runs = DEFAULT_RUNS;
+	bool csv = false;
+	bool walk = false;
+	bool hover = false;
+	bool reflow = false;
+	bool ok = true;
+	size_t s;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "cwpln:r:")) != -1) {
+		if (opt == 'c') {
+			csv = true;
+		} else if (opt == 'w') {
+			walk = true;
+		} else if (opt == 'p') {
+			hover = true;
+		} else if (opt == 'l') {
+			reflow = true;
+		} else if (opt == 'n') {
+			paragraphs = strtoul(optarg, NULL, 10);
+		} else if (opt == 'r') {
+			runs = atoi(optarg);
+		} else {
+			fprintf(stderr, "usage: %s [-c] [-w] [-p] [-l] "
+				"[-n paragraphs] [-r runs]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (runs < 1) {
+		runs = 1;
+	}
+
+	if (reflow) {
+		return reflow_bench(paragraphs ? paragraphs : REFLOW_PARAGRAPHS,
+				csv) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	if (paragraphs == 0) {
+		paragraphs = DEFAULT_PARAGRAPHS;
+	}
+
+	if (walk) {
+		return walk_bench(paragraphs, runs, csv) ?
+			EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (hover) {
+		return hover_bench(paragraphs, runs, csv) ?
+			EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (csv) {
+		printf("scheme,boxes,build_best_ms,build_mean_ms,"
+		       "free_best_ms,free_mean_ms,build_ns_per_box,"
+		       "free_ns_per_box\n");
+	} else {
+		printf("%-8s %9s %10s %10s %10s %10s %9s %9s\n",
+		       "scheme", "boxes", "build(ms)", "mean(ms)",
+		       "free(ms)", "mean(ms)", "build/box", "free/box");
+	}
+
+	for (s = 0; s < sizeof(bench_schemes) / sizeof(bench_schemes[0]); s++) {
+		ok &= bench_scheme(&bench_schemes[s], paragraphs, runs, csv);
+	}
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,719 @@
+/*
+ * Copyright 2026 NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Download context driver for the simulated network harness.
+ *
+ * Runs the core download context, desktop/download.c, over real HTTP
+ * without the rest of the browser. The fetch layer and the low level
+ * cache handle of the initial fetch are replaced by a small libcurl
+ * multi interface loop, and the frontend download table reports in
+ * the same form as nsmonkey:
+ *
+ *  - DOWNLOAD CREATE, DATA, DATA_AT, DONE and ERROR as the download
+ *    progresses.
+ *  - DOWNLOAD SAVEMAP, ABORT and RESUMEMAP commands to round trip a
+ *    segment map through a file.
+ *  - WINDOW NEW, GO and DESTROY and QUIT, enough for monkeyfarmer.
+ *
+ * This lets test/netsim.py -d check the segmenting code against its
+ * throttled ranged server without building a frontend.
+ *
+ * usage: downloadsim [--<option>=<value>...]
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <curl/curl.h>
+
+#include "utils/errors.h"
+#include "utils/log.h"
+#include "utils/nsoption.h"
+#include "utils/nsurl.h"
+#include "utils/corestrings.h"
+#include "content/fetch.h"
+#include "content/llcache.h"
+#include "netsurf/download.h"
+#include "desktop/download.h"
+#include "desktop/gui_table.h"
+#include "desktop/gui_internal.h"
+
+/** Most response headers kept for the initial fetch */
+#define SIM_MAX_HEADERS 32
+
+/**
+ * A transfer standing in for a fetch
+ */
+struct fetch {
+	struct fetch *next; /**< next transfer in list */
+	CURL *curl; /**< easy handle */
+	struct curl_slist *headers; /**< request headers */
+	fetch_callback callback; /**< owner callback */
+	void *p; /**< owner context */
+	bool added; /**< handle added to the multi handle */
+	bool aborted; /**< owner has abandoned the transfer */
+};
+
+/**
+ * The initial fetch of a download standing in for a low level cache handle
+ */
+struct llcache_handle {
+	nsurl *url; /**< URL fetched */
+	struct fetch *fetch; /**< transfer, NULL once finished */
+	llcache_handle_callback cb; /**< client callback */
+	void *pw; /**< client context */
+	char *headers[SIM_MAX_HEADERS]; /**< response header lines */
+	unsigned int header_count; /**< number of header lines */
+	bool had_headers; /**< headers event has been sent */
+};
+
+/**
+ * A download window
+ */
+struct gui_download_window {
+	struct gui_download_window *next; /**< next window in list */
+	download_context *ctx; /**< core download context */
+	unsigned int num; /**< window number */
+};
+
+struct netsurf_table *guit = NULL;
+
+static CURLM *sim_multi;
+static struct fetch *sim_fetches;
+static struct gui_download_window *sim_windows;
+static unsigned int sim_window_count;
+static char *sim_resume_map;
+static bool sim_quit;
+
+
+/* Stubs */
+nserror nslog_set_filter_by_options(void) { return NSERROR_OK; }
+
+const char *messages_get(const char *key)
+{
+	return key;
+}
+
+
+/* content/fetch.h */
+void fetch_abort(struct fetch *f)
+{
+	/* transfers are removed outside of the curl callbacks */
+	f->aborted = true;
+}
+
+/**
+ * Deliver a fetch message unless the transfer was abandoned.
+ */
+static void sim_send(struct fetch *f, fetch_msg *msg)
+{
+	if (!f->aborted) {
+		f->callback(msg, f->p);
+	}
+}
+
+static size_t sim_header(char *data, size_t size, size_t nmemb, void *p)
+{
+	struct fetch *f = p;
+	size_t len = size * nmemb;
+	fetch_msg msg;
+
+	while ((len > 0) &&
+	       ((data[len - 1] == '\r') || (data[len - 1] == '\n'))) {
+		len--;
+	}
+
+	msg.type = FETCH_HEADER;
+	msg.data.header_or_data.buf = (const uint8_t *)data;
+	msg.data.header_or_data.len = len;
+	sim_send(f, &msg);
+
+	return size * nmemb;
+}
+
+static size_t sim_data(char *data, size_t size, size_t nmemb, void *p)
+{
+	struct fetch *f = p;
+	fetch_msg msg;
+
+	msg.type = FETCH_DATA;
+	msg.data.header_or_data.buf = (const uint8_t *)data;
+	msg.data.header_or_data.len = size * nmemb;
+	sim_send(f, &msg);
+
+	/* stop the transfer as soon as it is abandoned */
+	return f->aborted ? 0 : size * nmemb;
+}
+
+/* content/fetch.h */
+nserror
+fetch_start(nsurl *url,
+	    nsurl *referer,
+	    fetch_callback callback,
+	    void *p,
+	    bool only_2xx,
+	    const char *post_urlenc,
+	    const struct fetch_multipart_data *post_multipart,
+	    bool verifiable,
+	    bool downgrade_tls,
+	    const char *headers[],
+	    struct fetch **fetch_out)
+{
+	struct fetch *f;
+	unsigned int idx;
+
+	f = calloc(1, sizeof(*f));
+	if (f == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	f->curl = curl_easy_init();
+	if (f->curl == NULL) {
+		free(f);
+		return NSERROR_NOMEM;
+	}
+
+	for (idx = 0; (headers != NULL) && (headers[idx] != NULL); idx++) {
+		f->headers = curl_slist_append(f->headers, headers[idx]);
+	}
+
+	curl_easy_setopt(f->curl, CURLOPT_URL, nsurl_access(url));
+	curl_easy_setopt(f->curl, CURLOPT_HTTPHEADER, f->headers);
+	curl_easy_setopt(f->curl, CURLOPT_HEADERFUNCTION, sim_header);
+	curl_easy_setopt(f->curl, CURLOPT_HEADERDATA, f);
+	curl_easy_setopt(f->curl, CURLOPT_WRITEFUNCTION, sim_data);
+	curl_easy_setopt(f->curl, CURLOPT_WRITEDATA, f);
+	curl_easy_setopt(f->curl, CURLOPT_PRIVATE, f);
+
+	f->callback = callback;
+	f->p = p;
+
+	/* handles are added outside of the curl callbacks */
+	f->next = sim_fetches;
+	sim_fetches = f;
+
+	*fetch_out = f;
+
+	return NSERROR_OK;
+}
+
+/**
+ * Report the end of a transfer.
+ */
+static void sim_finished(CURL *curl, CURLcode result)
+{
+	struct fetch *f;
+	fetch_msg msg;
+
+	curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char **)&f);
+
+	if (result == CURLE_OK) {
+		msg.type = FETCH_FINISHED;
+	} else {
+		msg.type = FETCH_ERROR;
+		msg.data.error = curl_easy_strerror(result);
+	}
+
+	/* the owner no longer holds the transfer once it has ended */
+	sim_send(f, &msg);
+	f->aborted = true;
+}
+
+/**
+ * Add new transfers and free abandoned ones.
+ */
+static void sim_update_fetches(void)
+{
+	struct fetch **link = &sim_fetches;
+	struct fetch *f;
+
+	while ((f = *link) != NULL) {
+		if (f->aborted) {
+			*link = f->next;
+			if (f->added) {
+				curl_multi_remove_handle(sim_multi, f->curl);
+			}
+			curl_easy_cleanup(f->curl);
+			curl_slist_free_all(f->headers);
+			free(f);
+			continue;
+		}
+		if (!f->added) {
+			curl_multi_add_handle(sim_multi, f->curl);
+			f->added = true;
+		}
+		link = &f->next;
+	}
+}
+
+
+/**
+ * Send an event to the client of a handle.
+ */
+static void
+sim_llcache_event(llcache_handle *handle, llcache_event_type type,
+		  const uint8_t *buf, size_t len, const char *error)
+{
+	llcache_event event;
+
+	event.type = type;
+	if (type == LLCACHE_EVENT_ERROR) {
+		event.data.error.code = NSERROR_NOT_FOUND;
+		event.data.error.msg = error;
+	} else {
+		event.data.data.buf = buf;
+		event.data.data.len = len;
+	}
+
+	handle->cb(handle, &event, handle->pw);
+}
+
+/**
+ * Callback for the initial fetch of a download.
+ */
+static void sim_llcache_callback(const fetch_msg *msg, void *p)
+{
+	llcache_handle *handle = p;
+	size_t len;
+
+	switch (msg->type) {
+	case FETCH_HEADER:
+		len = msg->data.header_or_data.len;
+		if (strncmp((const char *)msg->data.header_or_data.buf,
+			    "HTTP/", 5) == 0) {
+			/* a new response */
+			while (handle->header_count > 0) {
+				free(handle->headers[--handle->header_count]);
+			}
+		} else if (len == 0) {
+			/* the end of the headers */
+			if (!handle->had_headers) {
+				handle->had_headers = true;
+				sim_llcache_event(handle,
+						  LLCACHE_EVENT_HAD_HEADERS,
+						  NULL, 0, NULL);
+			}
+		} else if (handle->header_count < SIM_MAX_HEADERS) {
+			handle->headers[handle->header_count] = strndup(
+				(const char *)msg->data.header_or_data.buf, len);
+			if (handle->headers[handle->header_count] != NULL) {
+				handle->header_count++;
+			}
+		}
+		break;
+
+	case FETCH_DATA:
+		sim_llcache_event(handle, LLCACHE_EVENT_HAD_DATA,
+				  msg->data.header_or_data.buf,
+				  msg->data.header_or_data.len, NULL);
+		break;
+
+	case FETCH_FINISHED:
+		handle->fetch = NULL;
+		sim_llcache_event(handle, LLCACHE_EVENT_DONE, NULL, 0, NULL);
+		break;
+
+	case FETCH_ERROR:
+		handle->fetch = NULL;
+		sim_llcache_event(handle, LLCACHE_EVENT_ERROR, NULL, 0,
+				  msg->data.error);
+		break;
+
+	default:
+		break;
+	}
+}
+
+/* content/llcache.h */
+nserror
+llcache_handle_change_callback(llcache_handle *handle,
+			       llcache_handle_callback cb,
+			       void *pw)
+{
+	handle->cb = cb;
+	handle->pw = pw;
+	return NSERROR_OK;
+}
+
+/* content/llcache.h */
+nserror llcache_handle_abort(llcache_handle *handle)
+{
+	if (handle->fetch != NULL) {
+		fetch_abort(handle->fetch);
+		handle->fetch = NULL;
+	}
+	return NSERROR_OK;
+}
+
+/* content/llcache.h */
+nserror llcache_handle_release(llcache_handle *handle)
+{
+	llcache_handle_abort(handle);
+	while (handle->header_count > 0) {
+		free(handle->headers[--handle->header_count]);
+	}
+	nsurl_unref(handle->url);
+	free(handle);
+	return NSERROR_OK;
+}
+
+/* content/llcache.h */
+nsurl *llcache_handle_get_url(const llcache_handle *handle)
+{
+	return handle->url;
+}
+
+/* content/llcache.h */
+const char *
+llcache_handle_get_header(const llcache_handle *handle, const char *key)
+{
+	size_t keylen = strlen(key);
+	unsigned int idx;
+	const char *value;
+
+	for (idx = 0; idx < handle->header_count; idx++) {
+		if ((strncasecmp(handle->headers[idx], key, keylen) == 0) &&
+		    (handle->headers[idx][keylen] == ':')) {
+			value = handle->headers[idx] + keylen + 1;
+			while (*value == ' ') {
+				value++;
+			}
+			return value;
+		}
+	}
+
+	return NULL;
+}
+
+
+static struct gui_download_window *sim_find_window(const char *num)
+{
+	struct gui_download_window *dw;
+
+	for (dw = sim_windows; dw != NULL; dw = dw->next) {
+		if (dw->num == (unsigned int)atoi(num)) {
+			return dw;
+		}
+	}
+
+	printf("ERROR DOWNLOAD NUM BAD\n");
+	return NULL;
+}
+
+static void sim_free_window(struct gui_download_window *dw)
+{
+	struct gui_download_window **link = &sim_windows;
+
+	while (*link != dw) {
+		link = &(*link)->next;
+	}
+	*link = dw->next;
+
+	download_context_destroy(dw->ctx);
+	free(dw);
+}
+
+/**
+ * Read a whole file.
+ *
+ * \return The contents, which the caller must free, or NULL on error.
+ */
+static char *sim_read_file(const char *path)
+{
+	FILE *fp;
+	long len;
+	char *buf = NULL;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		return NULL;
+	}
+
+	if ((fseek(fp, 0, SEEK_END) == 0) &&
+	    ((len = ftell(fp)) > 0) &&
+	    (fseek(fp, 0, SEEK_SET) == 0)) {
+		buf = malloc(len + 1);
+		if ((buf != NULL) && (fread(buf, 1, len, fp) != (size_t)len)) {
+			free(buf);
+			buf = NULL;
+		} else if (buf != NULL) {
+			buf[len] = '\0';
+		}
+	}
+	fclose(fp);
+
+	return buf;
+}
+
+static struct gui_download_window *
+sim_download_create(download_context *ctx, struct gui_window *parent)
+{
+	struct gui_download_window *dw;
+	unsigned long long int done = 0;
+	char *map;
+
+	dw = calloc(1, sizeof(*dw));
+	if (dw == NULL) {
+		return NULL;
+	}
+	dw->ctx = ctx;
+	dw->num = sim_window_count++;
+	dw->next = sim_windows;
+	sim_windows = dw;
+
+	printf("DOWNLOAD CREATE DWIN %u WIN 0\n", dw->num);
+
+	if (sim_resume_map != NULL) {
+		map = sim_read_file(sim_resume_map);
+		if ((map != NULL) &&
+		    (download_context_set_segment_map(ctx, map, &done) ==
+		     NSERROR_OK)) {
+			printf("DOWNLOAD RESUME DWIN %u DONE %llu\n",
+			       dw->num, done);
+		} else {
+			printf("DOWNLOAD RESUME DWIN %u FAILED\n", dw->num);
+		}
+		free(map);
+		free(sim_resume_map);
+		sim_resume_map = NULL;
+	}
+
+	return dw;
+}
+
+static nserror
+sim_download_data(struct gui_download_window *dw,
+		  const char *data,
+		  unsigned int size)
+{
+	printf("DOWNLOAD DATA DWIN %u SIZE %u\n", dw->num, size);
+	return NSERROR_OK;
+}
+
+static nserror
+sim_download_data_at(struct gui_download_window *dw,
+		     unsigned long long offset,
+		     const char *data,
+		     unsigned int size)
+{
+	printf("DOWNLOAD DATA_AT DWIN %u OFFSET %llu SIZE %u\n",
+	       dw->num, offset, size);
+	return NSERROR_OK;
+}
+
+static void
+sim_download_error(struct gui_download_window *dw, const char *error_msg)
+{
+	printf("DOWNLOAD ERROR DWIN %u ERROR %s\n", dw->num, error_msg);
+}
+
+static void sim_download_done(struct gui_download_window *dw)
+{
+	printf("DOWNLOAD DONE DWIN %u\n", dw->num);
+	sim_free_window(dw);
+}
+
+static struct gui_download_table sim_download_table = {
+	.create = sim_download_create,
+	.data = sim_download_data,
+	.error = sim_download_error,
+	.done = sim_download_done,
+	.data_at = sim_download_data_at,
+};
+
+static struct netsurf_table sim_table = {
+	.download = &sim_download_table,
+};
+
+
+/**
+ * Start downloading a URL.
+ */
+static void sim_go(const char *url_str)
+{
+	llcache_handle *handle;
+	nsurl *url;
+
+	if (nsurl_create(url_str, &url) != NSERROR_OK) {
+		printf("ERROR WINDOW GO URL BAD\n");
+		return;
+	}
+
+	handle = calloc(1, sizeof(*handle));
+	if (handle == NULL) {
+		nsurl_unref(url);
+		return;
+	}
+	handle->url = url;
+
+	if ((download_context_create(handle, NULL) != NSERROR_OK) ||
+	    (fetch_start(url, NULL, sim_llcache_callback, handle, true,
+			 NULL, NULL, true, false, NULL,
+			 &handle->fetch) != NSERROR_OK)) {
+		printf("ERROR WINDOW GO FAILED\n");
+	}
+}
+
+static void sim_savemap(const char *num, const char *path)
+{
+	struct gui_download_window *dw = sim_find_window(num);
+	char *map;
+	FILE *fp;
+
+	if (dw == NULL) {
+		return;
+	}
+
+	map = download_context_get_segment_map(dw->ctx);
+	fp = (map != NULL) ? fopen(path, "w") : NULL;
+	if (fp == NULL) {
+		printf("DOWNLOAD SAVEMAP DWIN %u FAILED\n", dw->num);
+	} else {
+		fputs(map, fp);
+		fclose(fp);
+		printf("DOWNLOAD SAVEMAP DWIN %u OK\n", dw->num);
+	}
+	free(map);
+}
+
+static void sim_abort(const char *num)
+{
+	struct gui_download_window *dw = sim_find_window(num);
+
+	if (dw == NULL) {
+		return;
+	}
+
+	download_context_abort(dw->ctx);
+	printf("DOWNLOAD DESTROY DWIN %u\n", dw->num);
+	sim_free_window(dw);
+}
+
+/**
+ * Process a command line from the harness.
+ */
+static void sim_command(char *line)
+{
+	char *argv[8];
+	int argc = 0;
+	char *tok;
+
+	for (tok = strtok(line, " \r\n");
+	     (tok != NULL) && (argc < 8);
+	     tok = strtok(NULL, " \r\n")) {
+		argv[argc++] = tok;
+	}
+
+	if (argc == 0) {
+		return;
+	}
+
+	if (strcmp(argv[0], "QUIT") == 0) {
+		sim_quit = true;
+	} else if ((argc == 2) && (strcmp(argv[1], "NEW") == 0)) {
+		printf("WINDOW NEW WIN 0 FOR 0 EXISTING 0 "
+		       "NEWTAB FALSE CLONE FALSE\n");
+	} else if ((argc == 4) && (strcmp(argv[1], "GO") == 0)) {
+		sim_go(argv[3]);
+	} else if ((argc == 3) && (strcmp(argv[1], "DESTROY") == 0)) {
+		printf("WINDOW DESTROY WIN %s\n", argv[2]);
+	} else if ((argc == 4) && (strcmp(argv[1], "SAVEMAP") == 0)) {
+		sim_savemap(argv[2], argv[3]);
+	} else if ((argc == 3) && (strcmp(argv[1], "ABORT") == 0)) {
+		sim_abort(argv[2]);
+	} else if ((argc == 3) && (strcmp(argv[1], "RESUMEMAP") == 0)) {
+		free(sim_resume_map);
+		sim_resume_map = strdup(argv[2]);
+	} else {
+		printf("ERROR COMMAND UNKNOWN %s\n", argv[0]);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	struct curl_waitfd input = { .fd = STDIN_FILENO, .events = CURL_WAIT_POLLIN };
+	char line[4096];
+	size_t used = 0;
+	char *eol;
+	ssize_t got;
+	CURLMsg *msg;
+	int running;
+	int left;
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	guit = &sim_table;
+
+	if ((nsoption_init(NULL, &nsoptions, &nsoptions_default) != NSERROR_OK) ||
+	    (nsoption_commandline(&argc, argv, nsoptions) != NSERROR_OK) ||
+	    (corestrings_init() != NSERROR_OK) ||
+	    (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK)) {
+		fprintf(stderr, "initialisation failed\n");
+		return EXIT_FAILURE;
+	}
+	sim_multi = curl_multi_init();
+
+	printf("GENERIC STARTED\n");
+
+	while (!sim_quit) {
+		sim_update_fetches();
+		curl_multi_perform(sim_multi, &running);
+		while ((msg = curl_multi_info_read(sim_multi, &left)) != NULL) {
+			if (msg->msg == CURLMSG_DONE) {
+				sim_finished(msg->easy_handle, msg->data.result);
+			}
+		}
+		sim_update_fetches();
+
+		input.revents = 0;
+		curl_multi_wait(sim_multi, &input, 1, 100, NULL);
+		if ((input.revents & CURL_WAIT_POLLIN) == 0) {
+			continue;
+		}
+
+		got = read(STDIN_FILENO, line + used, sizeof(line) - used - 1);
+		if (got <= 0) {
+			break;
+		}
+		used += got;
+		line[used] = '\0';
+		while ((eol = strchr(line, '\n')) != NULL) {
+			*eol = '\0';
+			sim_command(line);
+			used -= eol + 1 - line;
+			memmove(line, eol + 1, used + 1);
+		}
+	}
+
+	while (sim_windows != NULL) {
+		download_context_abort(sim_windows->ctx);
+		sim_free_window(sim_windows);
+	}
+	sim_update_fetches();
+	curl_multi_cleanup(sim_multi);
+	corestrings_fini();
+
+	printf("GENERIC FINISHED\n");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,1719 @@
+/*
+ * Copyright 2026 NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Image decoder benchmark.
+ *
+ * Runs each image content handler built in (png, jpeg, gif, bmp, ico,
+ * webp and svg) over a corpus of images and reports the conversion
+ * time, throughput and peak heap use of each. The corpus is generated
+ * at startup and may be extended with files named on the command
+ * line, whose format is taken from their extension.
+ *
+ * Handlers are driven through their content handler tables with the
+ * content and image cache layers replaced by the minimal
+ * implementations below and bitmaps held by the monkey frontend
+ * bitmap table, so no display is needed. A conversion is timed from
+ * the source data being supplied until the first redraw at the
+ * intrinsic size has decoded every pixel, which is the point at which
+ * all the handlers have done comparable work.
+ *
+ * usage: imagebench [-c] [-r <runs>] [file ...]
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <getopt.h>
+
+#ifdef WITH_JPEG
+#include <jpeglib.h>
+#endif
+#ifdef WITH_PNG
+#include <png.h>
+#endif
+#ifdef WITH_WEBP
+#include <webp/encode.h>
+#endif
+
+#include "utils/errors.h"
+#include "utils/utils.h"
+#include "utils/log.h"
+#include "utils/nsoption.h"
+#include "utils/messages.h"
+#include "utils/nsurl.h"
+#include "netsurf/bitmap.h"
+#include "netsurf/content.h"
+#include "netsurf/misc.h"
+#include "netsurf/plotters.h"
+#include "content/llcache.h"
+#include "content/content_protected.h"
+#include "content/content_factory.h"
+#include "desktop/gui_internal.h"
+#include "desktop/gui_table.h"
+#include "monkey/bitmap.h"
+
+#include "image/image.h"
+#include "image/image_cache.h"
+#include "image/png.h"
+#include "image/jpeg.h"
+#include "image/gif.h"
+#include "image/bmp.h"
+#include "image/ico.h"
+#include "image/webp.h"
+#include "image/svg.h"
+
+/** number of timed conversions of each image and profile */
+#define DEFAULT_RUNS 5
+
+/** viewport used to lay out svg files named on the command line */
+#define DEFAULT_VIEWPORT_WIDTH 1024
+#define DEFAULT_VIEWPORT_HEIGHT 768
+
+/** maximum number of mime types the handlers may register */
+#define MAX_HANDLERS 64
+
+struct bench_corpus;
+
+/** an image format and the handler which converts it */
+struct bench_format {
+	const char *name; /**< short name of the format */
+	const char *mime_type; /**< type the handler is selected by */
+	const char *ext[3]; /**< file extensions, NULL terminated */
+	bool profiles; /**< converted with each jpeg decode profile */
+	nserror (*init)(void); /**< registers the handler */
+	bool (*generate)(struct bench_corpus *corpus,
+			 const struct bench_format *format);
+};
+
+/** an image of the corpus */
+struct bench_image {
+	const struct bench_format *format;
+	char *name;
+	uint8_t *data;
+	size_t size;
+	int width; /**< viewport width for formats laid out by size */
+	int height; /**< viewport height for formats laid out by size */
+};
+
+/** images to convert */
+struct bench_corpus {
+	struct bench_image *image;
+	size_t count;
+	size_t alloc;
+};
+
+/** growable memory buffer images are encoded into */
+struct bench_buffer {
+	uint8_t *data;
+	size_t size;
+	size_t alloc;
+	bool failed;
+};
+
+/** measurement of a single conversion */
+struct bench_result {
+	double ms; /**< conversion time in milliseconds */
+	int width;
+	int height;
+	size_t peak; /**< peak heap growth in bytes */
+};
+
+/** decode profiles measured, as the jpeg_decode_profile option */
+static const struct {
+	const char *name;
+	enum nsjpeg_profile profile;
+} bench_profiles[] = {
+	{ "accurate", NSJPEG_PROFILE_ACCURATE },
+	{ "fast", NSJPEG_PROFILE_FAST },
+	{ "grey", NSJPEG_PROFILE_GREY },
+};
+
+/** raster sizes generated for each format */
+static const struct {
+	int width, height;
+} bench_sizes[] = { { 320, 240 }, { 1024, 768 }, { 2592, 1944 } };
+
+static struct {
+	const char *mime_type;
+	const content_handler *handler;
+} bench_handlers[MAX_HANDLERS];
+static unsigned int bench_handler_count;
+
+static const uint8_t *bench_data;
+static size_t bench_size;
+
+/** state of the image cache for the content being converted */
+static struct {
+	struct bitmap *bitmap;
+	image_cache_convert_fn *convert;
+	image_cache_render_fn *render;
+} bench_cache;
+
+
+/* heap use, tracked by wrapping the C library allocator */
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+
+#include <malloc.h>
+
+#define BENCH_HEAP_TRACKING 1
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+/* only declared by the C library for C11 */
+void *aligned_alloc(size_t alignment, size_t size);
+
+/* the benchmark is single threaded so the counts need no locking */
+static size_t heap_current;
+static size_t heap_peak;
+
+static inline void heap_add(void *ptr)
+{
+	if (ptr != NULL) {
+		heap_current += malloc_usable_size(ptr);
+		if (heap_current > heap_peak) {
+			heap_peak = heap_current;
+		}
+	}
+}
+
+static inline void heap_remove(void *ptr)
+{
+	if (ptr != NULL) {
+		size_t size = malloc_usable_size(ptr);
+		heap_current = (size > heap_current) ? 0 : heap_current - size;
+	}
+}
+
+void *malloc(size_t size)
+{
+	void *ptr = __libc_malloc(size);
+	heap_add(ptr);
+	return ptr;
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	void *ptr = __libc_calloc(nmemb, size);
+	heap_add(ptr);
+	return ptr;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	size_t old = (ptr != NULL) ? malloc_usable_size(ptr) : 0;
+	void *nptr = __libc_realloc(ptr, size);
+
+	if ((nptr != NULL) || (size == 0)) {
+		heap_current = (old > heap_current) ? 0 : heap_current - old;
+		heap_add(nptr);
+	}
+	return nptr;
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+	void *ptr = __libc_memalign(alignment, size);
+	heap_add(ptr);
+	return ptr;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+	return memalign(alignment, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+	void *ptr = memalign(alignment, size);
+	if (ptr == NULL) {
+		return ENOMEM;
+	}
+	*memptr = ptr;
+	return 0;
+}
+
+void free(void *ptr)
+{
+	heap_remove(ptr);
+	__libc_free(ptr);
+}
+
+#endif
+
+
+/* stub for logging */
+nserror nslog_set_filter_by_options(void)
+{
+	return NSERROR_OK;
+}
+
+
+/* frontend operations used by the handlers */
+
+static nserror bench_schedule(int t, void (*callback)(void *p), void *p)
+{
+	/* animations are never advanced */
+	return NSERROR_OK;
+}
+
+static struct gui_misc_table bench_misc_table = {
+	.schedule = bench_schedule,
+};
+
+static struct netsurf_table bench_table = {
+	.misc = &bench_misc_table,
+};
+
+struct netsurf_table *guit = &bench_table;
+
+static nserror
+bench_plot_clip(const struct redraw_context *ctx, const struct rect *clip)
+{
+	return NSERROR_OK;
+}
+
+static nserror
+bench_plot_arc(const struct redraw_context *ctx, const plot_style_t *style,
+	       int x, int y, int radius, int angle1, int angle2)
+{
+	return NSERROR_OK;
+}
+
+static nserror
+bench_plot_disc(const struct redraw_context *ctx, const plot_style_t *style,
+		int x, int y, int radius)
+{
+	return NSERROR_OK;
+}
+
+static nserror
+bench_plot_line(const struct redraw_context *ctx, const plot_style_t *style,
+		const struct rect *line)
+{
+	return NSERROR_OK;
+}
+
+static nserror
+bench_plot_rectangle(const struct redraw_context *ctx,
+		     const plot_style_t *style, const struct rect *rect)
+{
+	return NSERROR_OK;
+}
+
+static nserror
+bench_plot_polygon(const struct redraw_context *ctx,
+		   const plot_style_t *style, const int *p, unsigned int n)
+{
+	return NSERROR_OK;
+}
+
+static nserror
+bench_plot_path(const struct redraw_context *ctx, const plot_style_t *style,
+		const float *p, unsigned int n, const float transform[6])
+{
+	return NSERROR_OK;
+}
+
+static nserror
+bench_plot_bitmap(const struct redraw_context *ctx, struct bitmap *bitmap,
+		  int x, int y, int width, int height, colour bg,
+		  bitmap_flags_t flags)
+{
+	return NSERROR_OK;
+}
+
+static nserror
+bench_plot_text(const struct redraw_context *ctx,
+		const plot_font_style_t *fstyle, int x, int y,
+		const char *text, size_t length)
+{
+	return NSERROR_OK;
+}
+
+/** plotters which discard everything, so only decoding is measured */
+static const struct plotter_table bench_plotters = {
+	.clip = bench_plot_clip,
+	.arc = bench_plot_arc,
+	.disc = bench_plot_disc,
+	.line = bench_plot_line,
+	.rectangle = bench_plot_rectangle,
+	.polygon = bench_plot_polygon,
+	.path = bench_plot_path,
+	.bitmap = bench_plot_bitmap,
+	.text = bench_plot_text,
+	.option_knockout = false,
+};
+
+
+/* content layer used by the handlers */
+
+nserror content_factory_register_handler(const char *mime_type,
+		const struct content_handler *handler)
+{
+	if (bench_handler_count == MAX_HANDLERS) {
+		return NSERROR_NOMEM;
+	}
+	bench_handlers[bench_handler_count].mime_type = mime_type;
+	bench_handlers[bench_handler_count].handler = handler;
+	bench_handler_count++;
+
+	return NSERROR_OK;
+}
+
+nserror content__init(struct content *c, const struct content_handler *handler,
+		lwc_string *imime_type, const struct http_parameter *params,
+		struct llcache_handle *llcache, const char *fallback_charset,
+		bool quirks)
+{
+	c->handler = handler;
+	c->llcache = llcache;
+	c->status = CONTENT_STATUS_LOADING;
+	return NSERROR_OK;
+}
+
+nserror content__clone(const struct content *c, struct content *nc)
+{
+	return NSERROR_NOT_IMPLEMENTED;
+}
+
+const uint8_t *content__get_source_data(struct content *c, size_t *size)
+{
+	*size = bench_size;
+	return bench_data;
+}
+
+void content_set_ready(struct content *c)
+{
+	c->status = CONTENT_STATUS_READY;
+}
+
+void content_set_done(struct content *c)
+{
+	c->status = CONTENT_STATUS_DONE;
+}
+
+void content_set_status(struct content *c, const char *status_message)
+{
+}
+
+void content_broadcast(struct content *c, content_msg msg,
+		const union content_msg_data *data)
+{
+}
+
+void content_broadcast_error(struct content *c, nserror errorcode,
+		const char *msg)
+{
+}
+
+bool content__set_title(struct content *c, const char *title)
+{
+	return true;
+}
+
+uint32_t content_count_users(struct content *c)
+{
+	return 1;
+}
+
+struct nsurl *content_get_url(struct content *c)
+{
+	return NULL;
+}
+
+void content_destroy(struct content *c)
+{
+	c->handler->destroy(c);
+	free(c);
+}
+
+nsurl *llcache_handle_get_url(const llcache_handle *handle)
+{
+	return NULL;
+}
+
+const char *nsurl_access(const nsurl *url)
+{
+	return "";
+}
+
+const char *nsurl_access_leaf(const nsurl *url)
+{
+	return "";
+}
+
+const char *messages_get(const char *key)
+{
+	return key;
+}
+
+char *messages_get_buff(const char *key, ...)
+{
+	return NULL;
+}
+
+bool image_bitmap_plot(struct bitmap *bitmap,
+		struct content_redraw_data *data,
+		const struct rect *clip,
+		const struct redraw_context *ctx)
+{
+	return true;
+}
+
+
+/* image cache used by the handlers, holds the converted bitmap */
+
+nserror image_cache_add(struct content *content, struct bitmap *bitmap,
+		image_cache_convert_fn *convert)
+{
+	bench_cache.bitmap = bitmap;
+	bench_cache.convert = convert;
+	bench_cache.render = NULL;
+	return NSERROR_OK;
+}
+
+nserror image_cache_set_decoder(struct content *content,
+		const struct image_cache_decoder *decoder)
+{
+	return NSERROR_OK;
+}
+
+struct bitmap *image_cache_decode(const struct image_cache_decoder *decoder,
+		const uint8_t *data, size_t size, int width, int height)
+{
+	struct image_cache_decode_params params = {
+		.target_width = width,
+		.target_height = height,
+		.flags = BITMAP_NEW,
+	};
+	struct bitmap *bitmap;
+	uint8_t *pixels;
+
+	if (decoder->measure(data, size, &params) == false) {
+		return NULL;
+	}
+	bitmap = guit->bitmap->create(params.width, params.height,
+			params.flags);
+	if (bitmap == NULL) {
+		return NULL;
+	}
+	pixels = guit->bitmap->get_buffer(bitmap);
+	if ((pixels == NULL) ||
+	    (decoder->decode(data, size, &params, pixels,
+			     guit->bitmap->get_rowstride(bitmap)) == false)) {
+		guit->bitmap->destroy(bitmap);
+		return NULL;
+	}
+	guit->bitmap->modified(bitmap);
+	return bitmap;
+}
+
+nserror image_cache_set_renderer(struct content *content,
+		image_cache_render_fn *render)
+{
+	if (bench_cache.bitmap != NULL) {
+		guit->bitmap->destroy(bench_cache.bitmap);
+		bench_cache.bitmap = NULL;
+	}
+	bench_cache.render = render;
+	return NSERROR_OK;
+}
+
+nserror image_cache_progress(struct content *content, struct bitmap *bitmap,
+		int y0, int y1)
+{
+	return NSERROR_OK;
+}
+
+bool image_cache_speculate(struct content *c)
+{
+	return false;
+}
+
+bool image_cache_progressive(struct content *c)
+{
+	return false;
+}
+
+struct bitmap *image_cache_find_bitmap(struct content *c)
+{
+	return bench_cache.bitmap;
+}
+
+void image_cache_destroy(struct content *c)
+{
+	if (bench_cache.bitmap != NULL) {
+		guit->bitmap->destroy(bench_cache.bitmap);
+	}
+	memset(&bench_cache, 0, sizeof(bench_cache));
+}
+
+bool image_cache_redraw(struct content *c, struct content_redraw_data *data,
+		const struct rect *clip, const struct redraw_context *ctx)
+{
+	if (bench_cache.bitmap == NULL) {
+		if (bench_cache.render != NULL) {
+			bench_cache.bitmap = bench_cache.render(c,
+					data->width, data->height);
+		} else if (bench_cache.convert != NULL) {
+			bench_cache.bitmap = bench_cache.convert(c);
+		}
+	}
+	return bench_cache.bitmap != NULL;
+}
+
+void *image_cache_get_internal(const struct content *c, void *context)
+{
+	return bench_cache.bitmap;
+}
+
+bool image_cache_is_opaque(struct content *c)
+{
+	return true;
+}
+
+content_type image_cache_content_type(void)
+{
+	return CONTENT_IMAGE;
+}
+
+
+/* corpus */
+
+static void buffer_append(struct bench_buffer *buf, const void *data,
+		size_t size)
+{
+	if (buf->failed) {
+		return;
+	}
+	if (buf->size + size > buf->alloc) {
+		size_t alloc = buf->alloc ? buf->alloc : 4096;
+		uint8_t *ndata;
+
+		while (alloc < buf->size + size) {
+			alloc *= 2;
+		}
+		ndata = realloc(buf->data, alloc);
+		if (ndata == NULL) {
+			buf->failed = true;
+			return;
+		}
+		buf->data = ndata;
+		buf->alloc = alloc;
+	}
+	memcpy(buf->data + buf->size, data, size);
+	buf->size += size;
+}
+
+#if defined(WITH_GIF) || defined(WITH_BMP)
+static void buffer_u8(struct bench_buffer *buf, uint8_t value)
+{
+	buffer_append(buf, &value, 1);
+}
+
+static void buffer_le16(struct bench_buffer *buf, uint16_t value)
+{
+	uint8_t b[2] = { value & 0xff, value >> 8 };
+	buffer_append(buf, b, sizeof(b));
+}
+
+static void buffer_le32(struct bench_buffer *buf, uint32_t value)
+{
+	uint8_t b[4] = {
+		value & 0xff, (value >> 8) & 0xff,
+		(value >> 16) & 0xff, value >> 24
+	};
+	buffer_append(buf, b, sizeof(b));
+}
+#endif
+
+#ifdef WITH_NS_SVG
+static void buffer_printf(struct bench_buffer *buf, const char *fmt, ...)
+{
+	char text[256];
+	va_list ap;
+	int len;
+
+	va_start(ap, fmt);
+	len = vsnprintf(text, sizeof(text), fmt, ap);
+	va_end(ap);
+
+	if ((len < 0) || ((size_t)len >= sizeof(text))) {
+		buf->failed = true;
+		return;
+	}
+	buffer_append(buf, text, len);
+}
+#endif
+
+/**
+ * Add an image to the corpus.
+ *
+ * The corpus takes ownership of the buffer contents, which are freed
+ * if the image cannot be added.
+ */
+static bool
+corpus_add(struct bench_corpus *corpus, const struct bench_format *format,
+	   const char *name, struct bench_buffer *buf, int width, int height)
+{
+	struct bench_image *image;
+
+	if (buf->failed || (buf->size == 0)) {
+		free(buf->data);
+		return false;
+	}
+
+	if (corpus->count == corpus->alloc) {
+		size_t alloc = corpus->alloc ? corpus->alloc * 2 : 32;
+		image = realloc(corpus->image, alloc * sizeof(*image));
+		if (image == NULL) {
+			free(buf->data);
+			return false;
+		}
+		corpus->image = image;
+		corpus->alloc = alloc;
+	}
+
+	image = &corpus->image[corpus->count];
+	image->format = format;
+	image->name = strdup(name);
+	image->data = buf->data;
+	image->size = buf->size;
+	image->width = width;
+	image->height = height;
+	if (image->name == NULL) {
+		free(buf->data);
+		return false;
+	}
+	corpus->count++;
+
+	return true;
+}
+
+#if defined(WITH_PNG) || defined(WITH_GIF) || defined(WITH_BMP) || \
+	defined(WITH_WEBP)
+/**
+ * Generate the RGBA pixels of an image.
+ *
+ * The image is smooth gradients with some noise, which compresses
+ * much like a photograph. The alpha channel is opaque unless alpha is
+ * set, when it fades across the image.
+ */
+static uint8_t *corpus_pixels(int width, int height, bool alpha)
+{
+	uint8_t *pixels;
+	uint8_t *p;
+	int x, y;
+
+	pixels = malloc((size_t)width * height * 4);
+	if (pixels == NULL) {
+		return NULL;
+	}
+
+	p = pixels;
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			int noise = rand() & 0x1f;
+			*p++ = ((x * 255 / width) + noise) * 7 / 8;
+			*p++ = ((y * 255 / height) + noise) * 7 / 8;
+			*p++ = (((x + y) * 255 / (width + height)) + noise) * 7 / 8;
+			*p++ = alpha ? 64 + (x * 191 / width) : 255;
+		}
+	}
+
+	return pixels;
+}
+#endif
+
+#ifdef WITH_JPEG
+static bool
+corpus_jpeg_image(struct bench_corpus *corpus,
+		  const struct bench_format *format, int width, int height,
+		  bool grey, bool progressive, int quality)
+{
+	struct jpeg_compress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+	struct bench_buffer buf = { NULL, 0, 0, false };
+	unsigned char *out = NULL;
+	unsigned long out_size = 0;
+	JSAMPROW row;
+	int components = grey ? 1 : 3;
+	int x;
+	char name[64];
+
+	row = malloc((size_t)width * components);
+	if (row == NULL) {
+		return false;
+	}
+
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_compress(&cinfo);
+	jpeg_mem_dest(&cinfo, &out, &out_size);
+
+	cinfo.image_width = width;
+	cinfo.image_height = height;
+	cinfo.input_components = components;
+	cinfo.in_color_space = grey ? JCS_GRAYSCALE : JCS_RGB;
+	jpeg_set_defaults(&cinfo);
+	jpeg_set_quality(&cinfo, quality, TRUE);
+	if (progressive) {
+		jpeg_simple_progression(&cinfo);
+	}
+
+	jpeg_start_compress(&cinfo, TRUE);
+	while (cinfo.next_scanline < cinfo.image_height) {
+		int y = cinfo.next_scanline;
+		for (x = 0; x < width * components; x++) {
+			row[x] = ((x * 255 / (width * components)) +
+				  (y * 255 / height) + (rand() & 0x1f)) / 2;
+		}
+		jpeg_write_scanlines(&cinfo, &row, 1);
+	}
+	jpeg_finish_compress(&cinfo);
+	jpeg_destroy_compress(&cinfo);
+	free(row);
+
+	/* the corpus frees with the C library, which libjpeg may not use */
+	buffer_append(&buf, out, out_size);
+	free(out);
+
+	snprintf(name, sizeof(name), "%dx%d-%s%s-q%d", width, height,
+		 grey ? "grey" : "rgb", progressive ? "-prog" : "", quality);
+
+	return corpus_add(corpus, format, name, &buf, 0, 0);
+}
+
+static bool
+corpus_jpeg(struct bench_corpus *corpus, const struct bench_format *format)
+{
+	unsigned int s;
+
+	for (s = 0; s < NOF_ELEMENTS(bench_sizes); s++) {
+		int w = bench_sizes[s].width;
+		int h = bench_sizes[s].height;
+
+		if (!corpus_jpeg_image(corpus, format, w, h, false, false, 85) ||
+		    !corpus_jpeg_image(corpus, format, w, h, false, true, 75) ||
+		    !corpus_jpeg_image(corpus, format, w, h, true, false, 85)) {
+			return false;
+		}
+	}
+	return true;
+}
+#endif
+
+#ifdef WITH_PNG
+static void
+corpus_png_write(png_structp png, png_bytep data, png_size_t length)
+{
+	buffer_append(png_get_io_ptr(png), data, length);
+}
+
+static void corpus_png_flush(png_structp png)
+{
+}
+
+/**
+ * Encode rows of RGB or RGBA pixels as png.
+ */
+static bool
+corpus_png_encode(struct bench_buffer *buf, png_bytep *rows, int width,
+		  int height, bool alpha, bool interlace)
+{
+	png_structp png;
+	png_infop info;
+
+	png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	info = (png != NULL) ? png_create_info_struct(png) : NULL;
+	if (info == NULL) {
+		png_destroy_write_struct(&png, NULL);
+		return false;
+	}
+	if (setjmp(png_jmpbuf(png))) {
+		png_destroy_write_struct(&png, &info);
+		return false;
+	}
+
+	png_set_write_fn(png, buf, corpus_png_write, corpus_png_flush);
+	png_set_IHDR(png, info, width, height, 8,
+		     alpha ? PNG_COLOR_TYPE_RGB_ALPHA : PNG_COLOR_TYPE_RGB,
+		     interlace ? PNG_INTERLACE_ADAM7 : PNG_INTERLACE_NONE,
+		     PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png, info);
+	png_write_image(png, rows);
+	png_write_end(png, NULL);
+	png_destroy_write_struct(&png, &info);
+
+	return true;
+}
+
+static bool
+corpus_png_image(struct bench_corpus *corpus,
+		 const struct bench_format *format, int width, int height,
+		 bool alpha, bool interlace)
+{
+	struct bench_buffer buf = { NULL, 0, 0, false };
+	png_bytep *rows;
+	uint8_t *pixels;
+	int components = alpha ? 4 : 3;
+	int x, y;
+	bool ok;
+	char name[64];
+
+	pixels = corpus_pixels(width, height, alpha);
+	rows = malloc(height * sizeof(*rows));
+	if ((pixels == NULL) || (rows == NULL)) {
+		free(pixels);
+		free(rows);
+		return false;
+	}
+
+	/* pack rows down to the number of components written */
+	for (y = 0; y < height; y++) {
+		uint8_t *row = pixels + (size_t)y * width * components;
+		const uint8_t *src = pixels + (size_t)y * width * 4;
+
+		for (x = 0; x < width * 4; x++) {
+			if (((x & 3) != 3) || alpha) {
+				*row++ = src[x];
+			}
+		}
+		rows[y] = pixels + (size_t)y * width * components;
+	}
+
+	ok = corpus_png_encode(&buf, rows, width, height, alpha, interlace);
+	free(pixels);
+	free(rows);
+	if (!ok) {
+		free(buf.data);
+		return false;
+	}
+
+	snprintf(name, sizeof(name), "%dx%d-%s%s", width, height,
+		 alpha ? "rgba" : "rgb", interlace ? "-interlace" : "");
+
+	return corpus_add(corpus, format, name, &buf, 0, 0);
+}
+
+static bool
+corpus_png(struct bench_corpus *corpus, const struct bench_format *format)
+{
+	unsigned int s;
+
+	for (s = 0; s < NOF_ELEMENTS(bench_sizes); s++) {
+		int w = bench_sizes[s].width;
+		int h = bench_sizes[s].height;
+
+		if (!corpus_png_image(corpus, format, w, h, false, false) ||
+		    !corpus_png_image(corpus, format, w, h, true, false) ||
+		    !corpus_png_image(corpus, format, w, h, true, true)) {
+			return false;
+		}
+	}
+	return true;
+}
+#endif
+
+#ifdef WITH_GIF
+/** size of the gif encoder string table, a prime above 4096 * 1.2 */
+#define GIF_HASH_SIZE 5003
+
+/** gif lzw encoder state */
+struct gif_lzw {
+	struct bench_buffer *buf;
+	uint32_t key[GIF_HASH_SIZE]; /**< prefix and suffix + 1, 0 if free */
+	uint16_t code[GIF_HASH_SIZE];
+	unsigned int next; /**< next code to be assigned */
+	unsigned int code_size; /**< current code size in bits */
+	uint32_t bits; /**< bits waiting to be written */
+	unsigned int nbits;
+	uint8_t block[255]; /**< data sub-block being filled */
+	unsigned int block_len;
+};
+
+static void gif_lzw_byte(struct gif_lzw *lzw, uint8_t byte)
+{
+	lzw->block[lzw->block_len++] = byte;
+	if (lzw->block_len == sizeof(lzw->block)) {
+		buffer_u8(lzw->buf, lzw->block_len);
+		buffer_append(lzw->buf, lzw->block, lzw->block_len);
+		lzw->block_len = 0;
+	}
+}
+
+static void gif_lzw_code(struct gif_lzw *lzw, unsigned int code)
+{
+	lzw->bits |= (uint32_t)code << lzw->nbits;
+	lzw->nbits += lzw->code_size;
+	while (lzw->nbits >= 8) {
+		gif_lzw_byte(lzw, lzw->bits & 0xff);
+		lzw->bits >>= 8;
+		lzw->nbits -= 8;
+	}
+
+	/* the decoder widens its codes one code after the table grows */
+	if ((lzw->next >= (1u << lzw->code_size)) && (lzw->code_size < 12)) {
+		lzw->code_size++;
+	}
+}
+
+static void gif_lzw_clear(struct gif_lzw *lzw)
+{
+	gif_lzw_code(lzw, 256);
+	memset(lzw->key, 0, sizeof(lzw->key));
+	lzw->next = 258;
+	lzw->code_size = 9;
+}
+
+/**
+ * Compress 8 bit colour indices as gif image data.
+ */
+static void
+gif_lzw_encode(struct bench_buffer *buf, const uint8_t *index, size_t count)
+{
+	struct gif_lzw *lzw;
+	unsigned int prefix;
+	size_t i;
+
+	lzw = calloc(1, sizeof(*lzw));
+	if (lzw == NULL) {
+		buf->failed = true;
+		return;
+	}
+	lzw->buf = buf;
+	lzw->code_size = 9;
+
+	buffer_u8(buf, 8);
+	gif_lzw_clear(lzw);
+
+	prefix = index[0];
+	for (i = 1; i < count; i++) {
+		uint32_t key = ((prefix << 8) | index[i]) + 1;
+		unsigned int h = key % GIF_HASH_SIZE;
+
+		while ((lzw->key[h] != 0) && (lzw->key[h] != key)) {
+			h = (h + 1) % GIF_HASH_SIZE;
+		}
+		if (lzw->key[h] == key) {
+			prefix = lzw->code[h];
+			continue;
+		}
+
+		gif_lzw_code(lzw, prefix);
+		if (lzw->next >= 4095) {
+			gif_lzw_clear(lzw);
+		} else {
+			lzw->key[h] = key;
+			lzw->code[h] = lzw->next++;
+		}
+		prefix = index[i];
+	}
+	gif_lzw_code(lzw, prefix);
+	gif_lzw_code(lzw, 257);
+
+	if (lzw->nbits > 0) {
+		gif_lzw_byte(lzw, lzw->bits & 0xff);
+	}
+	if (lzw->block_len > 0) {
+		buffer_u8(buf, lzw->block_len);
+		buffer_append(buf, lzw->block, lzw->block_len);
+	}
+	buffer_u8(buf, 0);
+
+	free(lzw);
+}
+
+static bool
+corpus_gif_image(struct bench_corpus *corpus,
+		 const struct bench_format *format, int width, int height)
+{
+	struct bench_buffer buf = { NULL, 0, 0, false };
+	uint8_t *pixels;
+	uint8_t *index;
+	size_t count = (size_t)width * height;
+	size_t i;
+	char name[64];
+
+	pixels = corpus_pixels(width, height, false);
+	index = malloc(count);
+	if ((pixels == NULL) || (index == NULL)) {
+		free(pixels);
+		free(index);
+		return false;
+	}
+
+	/* quantise to a 3-3-2 palette */
+	for (i = 0; i < count; i++) {
+		const uint8_t *p = pixels + i * 4;
+		index[i] = (p[0] & 0xe0) | ((p[1] >> 3) & 0x1c) | (p[2] >> 6);
+	}
+	free(pixels);
+
+	buffer_append(&buf, "GIF89a", 6);
+	buffer_le16(&buf, width);
+	buffer_le16(&buf, height);
+	buffer_u8(&buf, 0xf7); /* 256 entry global colour table */
+	buffer_u8(&buf, 0);
+	buffer_u8(&buf, 0);
+	for (i = 0; i < 256; i++) {
+		buffer_u8(&buf, (i >> 5) * 255 / 7);
+		buffer_u8(&buf, ((i >> 2) & 7) * 255 / 7);
+		buffer_u8(&buf, (i & 3) * 255 / 3);
+	}
+
+	buffer_u8(&buf, 0x2c);
+	buffer_le16(&buf, 0);
+	buffer_le16(&buf, 0);
+	buffer_le16(&buf, width);
+	buffer_le16(&buf, height);
+	buffer_u8(&buf, 0);
+	gif_lzw_encode(&buf, index, count);
+	buffer_u8(&buf, 0x3b);
+	free(index);
+
+	snprintf(name, sizeof(name), "%dx%d-332", width, height);
+
+	return corpus_add(corpus, format, name, &buf, 0, 0);
+}
+
+static bool
+corpus_gif(struct bench_corpus *corpus, const struct bench_format *format)
+{
+	unsigned int s;
+
+	for (s = 0; s < NOF_ELEMENTS(bench_sizes); s++) {
+		if (!corpus_gif_image(corpus, format, bench_sizes[s].width,
+				      bench_sizes[s].height)) {
+			return false;
+		}
+	}
+	return true;
+}
+#endif
+
+#ifdef WITH_BMP
+/**
+ * Write a BITMAPINFOHEADER and bottom up BGR(A) rows.
+ *
+ * \param height The height recorded in the header, which for icons
+ *		 includes the mask.
+ */
+static void
+corpus_dib(struct bench_buffer *buf, const uint8_t *pixels, int width,
+	   int height, int header_height, unsigned int bpp)
+{
+	size_t stride = ((size_t)width * (bpp / 8) + 3) & ~(size_t)3;
+	int x, y;
+
+	buffer_le32(buf, 40);
+	buffer_le32(buf, width);
+	buffer_le32(buf, header_height);
+	buffer_le16(buf, 1);
+	buffer_le16(buf, bpp);
+	buffer_le32(buf, 0); /* BI_RGB */
+	buffer_le32(buf, stride * height);
+	buffer_le32(buf, 2835);
+	buffer_le32(buf, 2835);
+	buffer_le32(buf, 0);
+	buffer_le32(buf, 0);
+
+	for (y = height - 1; y >= 0; y--) {
+		const uint8_t *p = pixels + (size_t)y * width * 4;
+		size_t pad = stride - (size_t)width * (bpp / 8);
+
+		for (x = 0; x < width; x++, p += 4) {
+			uint8_t bgra[4] = { p[2], p[1], p[0], p[3] };
+			buffer_append(buf, bgra, bpp / 8);
+		}
+		while (pad-- > 0) {
+			buffer_u8(buf, 0);
+		}
+	}
+}
+
+static bool
+corpus_bmp_image(struct bench_corpus *corpus,
+		 const struct bench_format *format, int width, int height,
+		 unsigned int bpp)
+{
+	struct bench_buffer buf = { NULL, 0, 0, false };
+	size_t stride = ((size_t)width * (bpp / 8) + 3) & ~(size_t)3;
+	uint8_t *pixels;
+	char name[64];
+
+	pixels = corpus_pixels(width, height, bpp == 32);
+	if (pixels == NULL) {
+		return false;
+	}
+
+	buffer_append(&buf, "BM", 2);
+	buffer_le32(&buf, 14 + 40 + stride * height);
+	buffer_le32(&buf, 0);
+	buffer_le32(&buf, 14 + 40);
+	corpus_dib(&buf, pixels, width, height, height, bpp);
+	free(pixels);
+
+	snprintf(name, sizeof(name), "%dx%d-%ubpp", width, height, bpp);
+
+	return corpus_add(corpus, format, name, &buf, 0, 0);
+}
+
+static bool
+corpus_bmp(struct bench_corpus *corpus, const struct bench_format *format)
+{
+	unsigned int s;
+
+	for (s = 0; s < NOF_ELEMENTS(bench_sizes); s++) {
+		int w = bench_sizes[s].width;
+		int h = bench_sizes[s].height;
+
+		if (!corpus_bmp_image(corpus, format, w, h, 24) ||
+		    !corpus_bmp_image(corpus, format, w, h, 32)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool
+corpus_ico(struct bench_corpus *corpus, const struct bench_format *format)
+{
+	static const int sizes[] = { 16, 32, 48, 256 };
+	struct bench_buffer buf = { NULL, 0, 0, false };
+	size_t offset = 6 + 16 * NOF_ELEMENTS(sizes);
+	unsigned int i;
+
+	buffer_le16(&buf, 0);
+	buffer_le16(&buf, 1); /* icon */
+	buffer_le16(&buf, NOF_ELEMENTS(sizes));
+
+	for (i = 0; i < NOF_ELEMENTS(sizes); i++) {
+		size_t mask = ((sizes[i] + 31) / 32) * 4;
+		size_t size = 40 + (size_t)sizes[i] * sizes[i] * 4 +
+			mask * sizes[i];
+
+		buffer_u8(&buf, sizes[i] & 0xff); /* 256 is recorded as 0 */
+		buffer_u8(&buf, sizes[i] & 0xff);
+		buffer_u8(&buf, 0);
+		buffer_u8(&buf, 0);
+		buffer_le16(&buf, 1);
+		buffer_le16(&buf, 32);
+		buffer_le32(&buf, size);
+		buffer_le32(&buf, offset);
+		offset += size;
+	}
+
+	for (i = 0; i < NOF_ELEMENTS(sizes); i++) {
+		size_t mask = ((sizes[i] + 31) / 32) * 4 * sizes[i];
+		uint8_t *pixels;
+
+		pixels = corpus_pixels(sizes[i], sizes[i], true);
+		if (pixels == NULL) {
+			free(buf.data);
+			return false;
+		}
+		corpus_dib(&buf, pixels, sizes[i], sizes[i], sizes[i] * 2, 32);
+		free(pixels);
+		while (mask-- > 0) {
+			buffer_u8(&buf, 0);
+		}
+	}
+
+	return corpus_add(corpus, format, "16-256-32bpp", &buf, 0, 0);
+}
+#endif
+
+#ifdef WITH_WEBP
+static bool
+corpus_webp_image(struct bench_corpus *corpus,
+		  const struct bench_format *format, int width, int height,
+		  bool lossless)
+{
+	struct bench_buffer buf = { NULL, 0, 0, false };
+	uint8_t *pixels;
+	uint8_t *out = NULL;
+	size_t size;
+	char name[64];
+
+	pixels = corpus_pixels(width, height, lossless);
+	if (pixels == NULL) {
+		return false;
+	}
+	if (lossless) {
+		size = WebPEncodeLosslessRGBA(pixels, width, height,
+					      width * 4, &out);
+	} else {
+		size = WebPEncodeRGBA(pixels, width, height, width * 4,
+				      80, &out);
+	}
+	free(pixels);
+	if (size == 0) {
+		return false;
+	}
+
+	/* the corpus frees with the C library, which libwebp may not use */
+	buffer_append(&buf, out, size);
+	WebPFree(out);
+
+	snprintf(name, sizeof(name), "%dx%d-%s", width, height,
+		 lossless ? "lossless-rgba" : "lossy-q80");
+
+	return corpus_add(corpus, format, name, &buf, 0, 0);
+}
+
+static bool
+corpus_webp(struct bench_corpus *corpus, const struct bench_format *format)
+{
+	unsigned int s;
+
+	for (s = 0; s < NOF_ELEMENTS(bench_sizes); s++) {
+		int w = bench_sizes[s].width;
+		int h = bench_sizes[s].height;
+
+		if (!corpus_webp_image(corpus, format, w, h, false) ||
+		    !corpus_webp_image(corpus, format, w, h, true)) {
+			return false;
+		}
+	}
+	return true;
+}
+#endif
+
+#ifdef WITH_NS_SVG
+static bool
+corpus_svg_image(struct bench_corpus *corpus,
+		 const struct bench_format *format, int width, int height,
+		 unsigned int shapes)
+{
+	struct bench_buffer buf = { NULL, 0, 0, false };
+	unsigned int i;
+	char name[64];
+
+	buffer_printf(&buf, "<?xml version=\"1.0\"?>\n"
+		      "<svg xmlns=\"http://www.w3.org/2000/svg\" "
+		      "width=\"%d\" height=\"%d\" viewBox=\"0 0 %d %d\">\n",
+		      width, height, width, height);
+
+	for (i = 0; i < shapes; i++) {
+		int x = rand() % width;
+		int y = rand() % height;
+		int r = 4 + rand() % (width / 8);
+		unsigned int fill = rand() & 0xffffff;
+		unsigned int stroke = rand() & 0xffffff;
+
+		switch (i % 4) {
+		case 0:
+			buffer_printf(&buf, "<rect x=\"%d\" y=\"%d\" "
+				      "width=\"%d\" height=\"%d\" "
+				      "fill=\"#%06x\"/>\n",
+				      x, y, r * 2, r, fill);
+			break;
+
+		case 1:
+			buffer_printf(&buf, "<circle cx=\"%d\" cy=\"%d\" "
+				      "r=\"%d\" fill=\"#%06x\" "
+				      "stroke=\"#%06x\" stroke-width=\"2\"/>\n",
+				      x, y, r, fill, stroke);
+			break;
+
+		case 2:
+			buffer_printf(&buf, "<path d=\"M%d %d C%d %d %d %d "
+				      "%d %d Z\" fill=\"#%06x\" "
+				      "fill-opacity=\"0.6\"/>\n",
+				      x, y, x + r, y - r, x + 2 * r, y + r,
+				      x, y + 2 * r, fill);
+			break;
+
+		default:
+			buffer_printf(&buf, "<polyline points=\"%d,%d %d,%d "
+				      "%d,%d %d,%d\" fill=\"none\" "
+				      "stroke=\"#%06x\" stroke-width=\"3\"/>\n",
+				      x, y, x + r, y + r / 2, x, y + r,
+				      x + r, y + 2 * r, stroke);
+			break;
+		}
+	}
+	buffer_printf(&buf, "</svg>\n");
+
+	snprintf(name, sizeof(name), "%dx%d-%ushapes", width, height, shapes);
+
+	return corpus_add(corpus, format, name, &buf, width, height);
+}
+
+static bool
+corpus_svg(struct bench_corpus *corpus, const struct bench_format *format)
+{
+	return corpus_svg_image(corpus, format, 320, 240, 200) &&
+		corpus_svg_image(corpus, format, 1024, 768, 2000) &&
+		corpus_svg_image(corpus, format, 2048, 1536, 5000);
+}
+#endif
+
+/** formats with a handler built in */
+static const struct bench_format bench_formats[] = {
+#ifdef WITH_PNG
+	{ "png", "image/png", { ".png", NULL }, false,
+	  nspng_init, corpus_png },
+#endif
+#ifdef WITH_JPEG
+	{ "jpeg", "image/jpeg", { ".jpg", ".jpeg", NULL }, true,
+	  nsjpeg_init, corpus_jpeg },
+#endif
+#ifdef WITH_GIF
+	{ "gif", "image/gif", { ".gif", NULL }, false,
+	  nsgif_init, corpus_gif },
+#endif
+#ifdef WITH_BMP
+	{ "bmp", "image/bmp", { ".bmp", NULL }, false,
+	  nsbmp_init, corpus_bmp },
+	{ "ico", "image/x-icon", { ".ico", NULL }, false,
+	  nsico_init, corpus_ico },
+#endif
+#ifdef WITH_WEBP
+	{ "webp", "image/webp", { ".webp", NULL }, false,
+	  nswebp_init, corpus_webp },
+#endif
+#ifdef WITH_NS_SVG
+	{ "svg", "image/svg+xml", { ".svg", NULL }, false,
+	  svg_init, corpus_svg },
+#endif
+	{ NULL, NULL, { NULL }, false, NULL, NULL }
+};
+
+static const struct bench_format *corpus_format(const char *path)
+{
+	const char *ext = strrchr(path, '.');
+	const struct bench_format *format;
+	unsigned int e;
+
+	if (ext == NULL) {
+		return NULL;
+	}
+	for (format = bench_formats; format->name != NULL; format++) {
+		for (e = 0; format->ext[e] != NULL; e++) {
+			if (strcasecmp(ext, format->ext[e]) == 0) {
+				return format;
+			}
+		}
+	}
+	return NULL;
+}
+
+static bool corpus_load(struct bench_corpus *corpus, const char *path)
+{
+	struct bench_buffer buf = { NULL, 0, 0, false };
+	const struct bench_format *format;
+	FILE *fp;
+	long size;
+
+	format = corpus_format(path);
+	if (format == NULL) {
+		return false;
+	}
+
+	fp = fopen(path, "rb");
+	if (fp == NULL) {
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	rewind(fp);
+
+	buf.data = malloc(size);
+	if ((buf.data == NULL) ||
+	    (fread(buf.data, 1, size, fp) != (size_t)size)) {
+		free(buf.data);
+		fclose(fp);
+		return false;
+	}
+	fclose(fp);
+	buf.size = size;
+
+	return corpus_add(corpus, format, path, &buf,
+			  DEFAULT_VIEWPORT_WIDTH, DEFAULT_VIEWPORT_HEIGHT);
+}
+
+
+/* measurement */
+
+static double now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static const content_handler *bench_handler(const char *mime_type)
+{
+	unsigned int h;
+
+	for (h = 0; h < bench_handler_count; h++) {
+		if (strcmp(bench_handlers[h].mime_type, mime_type) == 0) {
+			return bench_handlers[h].handler;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Convert an image through its content handler.
+ *
+ * The content is given all its data, laid out if the handler lays
+ * out, and redrawn once at its intrinsic size.
+ *
+ * \param image The image to convert.
+ * \param result Updated with the measurement.
+ * \return true on success else false.
+ */
+static bool
+bench_convert(const struct bench_image *image, struct bench_result *result)
+{
+	const content_handler *handler;
+	struct content_redraw_data data;
+	struct redraw_context ctx = {
+		.interactive = false,
+		.background_images = true,
+		.plot = &bench_plotters,
+	};
+	struct rect clip;
+	struct content *c;
+	double start, end;
+	bool ok;
+#ifdef BENCH_HEAP_TRACKING
+	size_t heap_base = heap_current;
+	heap_peak = heap_current;
+#endif
+
+	handler = bench_handler(image->format->mime_type);
+	if (handler == NULL) {
+		return false;
+	}
+
+	bench_data = image->data;
+	bench_size = image->size;
+
+	if (handler->create(handler, NULL, NULL, NULL, NULL, false,
+			    &c) != NSERROR_OK) {
+		return false;
+	}
+
+	start = now_ms();
+	ok = handler->process_data(c, (const char *)image->data,
+				   image->size) &&
+		handler->data_complete(c);
+	if (ok && (handler->reformat != NULL)) {
+		handler->reformat(c, image->width, image->height);
+	}
+	ok = ok && (c->width > 0) && (c->height > 0);
+	if (ok) {
+		memset(&data, 0, sizeof(data));
+		data.width = c->width;
+		data.height = c->height;
+		data.background_colour = 0xffffff;
+		data.scale = 1;
+		clip.x0 = 0;
+		clip.y0 = 0;
+		clip.x1 = c->width;
+		clip.y1 = c->height;
+		ok = handler->redraw(c, &data, &clip, &ctx);
+	}
+	end = now_ms();
+
+	result->ms = end - start;
+	result->width = c->width;
+	result->height = c->height;
+	result->peak = 0;
+#ifdef BENCH_HEAP_TRACKING
+	result->peak = heap_peak - heap_base;
+#endif
+
+	content_destroy(c);
+
+	return ok;
+}
+
+/**
+ * Measure an image with the current options and report the result.
+ */
+static void
+bench_image(const struct bench_image *image, const char *profile, int runs,
+	    bool csv)
+{
+	struct bench_result best = { -1, 0, 0, 0 };
+	double total = 0;
+	int count = 0;
+	int run;
+
+	for (run = 0; run < runs; run++) {
+		struct bench_result result;
+
+		if (!bench_convert(image, &result)) {
+			continue;
+		}
+		if ((best.ms < 0) || (result.ms < best.ms)) {
+			best.ms = result.ms;
+			best.width = result.width;
+			best.height = result.height;
+		}
+		if (result.peak > best.peak) {
+			best.peak = result.peak;
+		}
+		total += result.ms;
+		count++;
+	}
+
+	if (count == 0) {
+		if (csv) {
+			printf("%s,\"%s\",%s,%zu,,,,,,,\n",
+			       image->format->name, image->name, profile,
+			       image->size);
+		} else {
+			printf("%-5s %-30s %-8s %9zu %11s\n",
+			       image->format->name, image->name, profile,
+			       image->size, "failed");
+		}
+		return;
+	}
+
+	if (csv) {
+		printf("%s,\"%s\",%s,%zu,%d,%d,%.3f,%.3f,%.3f,%.3f,",
+		       image->format->name, image->name, profile,
+		       image->size, best.width, best.height,
+		       best.ms, total / count,
+		       image->size / (best.ms * 1000.0),
+		       (double)best.width * best.height / (best.ms * 1000.0));
+#ifdef BENCH_HEAP_TRACKING
+		printf("%zu", best.peak / 1024);
+#endif
+		printf("\n");
+	} else {
+		char size[24];
+		char peak[24] = "-";
+
+		snprintf(size, sizeof(size), "%dx%d", best.width, best.height);
+#ifdef BENCH_HEAP_TRACKING
+		snprintf(peak, sizeof(peak), "%zu", best.peak / 1024);
+#endif
+		printf("%-5s %-30s %-8s %9zu %11s %9.2f %9.2f %8.2f %8.2f "
+		       "%10s\n",
+		       image->format->name, image->name, profile,
+		       image->size, size, best.ms, total / count,
+		       image->size / (best.ms * 1000.0),
+		       (double)best.width * best.height / (best.ms * 1000.0),
+		       peak);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const struct bench_format *format;
+	struct bench_corpus corpus = { NULL, 0, 0 };
+	int runs = DEFAULT_RUNS;
+	bool csv = false;
+	unsigned int p;
+	size_t i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "cr:")) != -1) {
+		if (opt == 'c') {
+			csv = true;
+		} else if (opt == 'r') {
+			runs = atoi(optarg);
+		} else {
+			fprintf(stderr, "usage: %s [-c] [-r runs] [file ...]\n",
+				argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (runs < 1) {
+		runs = 1;
+	}
+
+	bench_table.bitmap = monkey_bitmap_table;
+
+	if (nsoption_init(NULL, NULL, NULL) != NSERROR_OK) {
+		fprintf(stderr, "initialisation failed\n");
+		return EXIT_FAILURE;
+	}
+	nsoption_set_bool(progressive_images, false);
+
+	srand(0);
+	for (format = bench_formats; format->name != NULL; format++) {
+		if (format->init() != NSERROR_OK) {
+			fprintf(stderr, "unable to initialise %s handler\n",
+				format->name);
+			return EXIT_FAILURE;
+		}
+		if (!format->generate(&corpus, format)) {
+			fprintf(stderr, "unable to generate %s corpus\n",
+				format->name);
+		}
+	}
+	for (; optind < argc; optind++) {
+		if (!corpus_load(&corpus, argv[optind])) {
+			fprintf(stderr, "unable to read %s\n", argv[optind]);
+		}
+	}
+
+	if (csv) {
+		printf("format,image,profile,bytes,width,height,best_ms,"
+		       "mean_ms,mb_per_s,mpx_per_s,peak_kib\n");
+	} else {
+		printf("%-5s %-30s %-8s %9s %11s %9s %9s %8s %8s %10s\n",
+		       "fmt", "image", "profile", "bytes", "size",
+		       "best(ms)", "mean(ms)", "MB/s", "Mpx/s", "peak(KiB)");
+	}
+
+	for (i = 0; i < corpus.count; i++) {
+		const struct bench_image *image = &corpus.image[i];
+
+		if (!image->format->profiles) {
+			bench_image(image, "-", runs, csv);
+			continue;
+		}
+		for (p = 0; p < NOF_ELEMENTS(bench_profiles); p++) {
+			nsoption_set_int(jpeg_decode_profile,
+					 bench_profiles[p].profile);
+			bench_image(image, bench_profiles[p].name, runs, csv);
+		}
+	}
+
+	for (i = 0; i < corpus.count; i++) {
+		free(corpus.image[i].name);
+		free(corpus.image[i].data);
+	}
+	free(corpus.image);
+	nsoption_finalise(NULL, NULL);
+
+	return EXIT_SUCCESS;
+}
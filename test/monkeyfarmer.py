@@ -216,6 +216,7 @@ class Browser:
             wrapper=wrapper)
         self.windows = {}
         self.logins = {}
+        self.downloads = {}
         self.current_draw_target = None
         self.started = False
         self.stopped = False
@@ -287,6 +288,17 @@ class Browser:
                 if win.alive and win.ready:
                     self.handle_ready_login(win)
 
+    def handle_DOWNLOAD(self, action, _dwin, dwinid, *args):
+        if action == "CREATE":
+            new_win = DownloadWindow(self, dwinid, *args)
+            self.downloads[dwinid] = new_win
+        else:
+            win = self.downloads.get(dwinid, None)
+            if win is None:
+                print("    Unknown download window id {}".format(dwinid))
+            else:
+                win.handle(action, *args)
+
     def handle_PLOT(self, *args):
         if self.current_draw_target is not None:
             self.current_draw_target.handle_plot(*args)
@@ -309,6 +321,16 @@ class Browser:
         # Override this method to do useful stuff
         lwin.destroy()
 
+    def resume_download(self, map_path):
+        """Resume the next download created from a saved segment map"""
+        self.farmer.tell_monkey("DOWNLOAD RESUMEMAP {}".format(map_path))
+
+    def wait_for_download(self):
+        dwins_known = set(self.downloads.keys())
+        while len(set(self.downloads.keys()).difference(dwins_known)) == 0:
+            self.farmer.loop(once=True)
+        return self.downloads[set(self.downloads.keys()).difference(dwins_known).pop()]
+
 
 class LoginWindow:
 
@@ -366,6 +388,75 @@ class LoginWindow:
         self._wait_dead()
 
 
+class DownloadWindow:
+
+    # pylint: disable=locally-disabled, too-many-instance-attributes, invalid-name
+
+    def __init__(self, browser, dwinid, _win, winid):
+        self.alive = True
+        self.browser = browser
+        self.dwinid = dwinid
+        self.winid = winid
+        self.data_size = 0
+        self.ranges = []
+        self.resumed = None
+        self.saved_map = None
+        self.done = False
+        self.error = None
+
+    def handle(self, action, *args):
+        if action == "DATA":
+            self.data_size += int(args[1])
+        elif action == "DATA_AT":
+            self.ranges.append((int(args[1]), int(args[3])))
+        elif action == "RESUME":
+            self.resumed = int(args[1]) if args[0] == "DONE" else False
+        elif action == "SAVEMAP":
+            self.saved_map = args[0] == "OK"
+        elif action == "DONE":
+            self.done = True
+            self.alive = False
+        elif action == "ERROR":
+            self.error = " ".join(args[1:])
+        elif action == "DESTROY":
+            self.alive = False
+        else:
+            raise AssertionError("Unknown action {} for download window".format(action))
+
+    @property
+    def received(self):
+        return self.data_size + sum(size for (_offset, size) in self.ranges)
+
+    def wait_for_data(self, size):
+        while self.alive and self.error is None and self.received < size:
+            self.browser.farmer.loop(once=True)
+
+    def wait_finished(self, timeout=None):
+        def stalled(_farmer):
+            self.error = "not finished after {}s".format(timeout)
+            self.browser.farmer.tell_monkey("DOWNLOAD ABORT {}".format(self.dwinid))
+
+        if timeout is not None:
+            self.browser.farmer.schedule_event(stalled, secs=timeout)
+        while self.alive and self.error is None:
+            self.browser.farmer.loop(once=True)
+        self.browser.farmer.unschedule_event(stalled)
+
+    def save_map(self, path):
+        assert self.alive
+        self.saved_map = None
+        self.browser.farmer.tell_monkey("DOWNLOAD SAVEMAP {} {}".format(self.dwinid, path))
+        while self.saved_map is None:
+            self.browser.farmer.loop(once=True)
+        return self.saved_map
+
+    def abort(self):
+        assert self.alive
+        self.browser.farmer.tell_monkey("DOWNLOAD ABORT {}".format(self.dwinid))
+        while self.alive:
+            self.browser.farmer.loop(once=True)
+
+
 class BrowserWindow:
 
     # pylint: disable=locally-disabled, too-many-instance-attributes, too-many-public-methods, invalid-name
@@ -0,0 +1,747 @@
+#!/usr/bin/python3
+#
+# This file is part of NetSurf, http://www.netsurf-browser.org/
+#
+# NetSurf is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; version 2 of the License.
+#
+# NetSurf is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""
+Network simulation harness for fetch-layer benchmarks
+
+Serves a generated corpus of pages from a loopback HTTP server which
+can inject request latency, a shared bandwidth limit and a per
+connection throttle. Each page is loaded in nsmonkey, so the fetch
+goes through the real fetch, llcache and hlcache layers. For every
+page and network profile the harness reports:
+
+ - time to first byte of the page
+ - time until every subresource is done (the throbber stops)
+ - peak number of concurrent connections seen by the server
+
+The corpus downloads are served with byte range support. With -d they
+are fetched through nsmonkey under a per connection throttle and the
+segmented download behaviour is checked instead:
+
+ - the split into parallel ranged segments
+ - rejection of a response with the wrong Content-Range
+ - refusal of a full response sent because If-Range did not match
+ - rejection of a response one byte short of the requested range
+ - resuming a segment whose connection was dropped
+ - resuming from a saved segment map, and starting afresh when the
+   map no longer matches the resource
+ - finishing a resumed download whose saved map has nothing left
+
+usage: netsim.py [-m <monkey>] [-j] [-r <runs>] [-d] [corpus.yaml]
+"""
+
+# pylint: disable=locally-disabled, missing-docstring
+
+import getopt
+import http.server
+import json
+import os
+import random
+import re
+import socketserver
+import struct
+import sys
+import tempfile
+import threading
+import time
+import zlib
+
+import yaml
+
+from monkeyfarmer import Browser
+
+
+class TokenBucket:
+    """Bandwidth limit shared by every connection of the server"""
+
+    def __init__(self, rate):
+        self.rate = rate
+        self.level = 0.0
+        self.stamp = time.monotonic()
+        self.lock = threading.Lock()
+
+    def take(self, count):
+        if self.rate is None:
+            return
+        with self.lock:
+            now = time.monotonic()
+            self.level = min(self.rate, self.level + (now - self.stamp) * self.rate)
+            self.stamp = now
+            self.level -= count
+            delay = -self.level / self.rate if self.level < 0 else 0
+        if delay > 0:
+            time.sleep(delay)
+
+
+def make_png(size):
+    """Build a valid greyscale PNG of roughly size bytes"""
+
+    side = max(1, int(size ** 0.5))
+    rows = b"".join(b"\0" + bytes(random.getrandbits(8) for _ in range(side))
+                    for _ in range(side))
+
+    def chunk(kind, data):
+        return (struct.pack(">I", len(data)) + kind + data +
+                struct.pack(">I", zlib.crc32(kind + data) & 0xffffffff))
+
+    return (b"\x89PNG\r\n\x1a\n" +
+            chunk(b"IHDR", struct.pack(">IIBBBBB", side, side, 8, 0, 0, 0, 0)) +
+            chunk(b"IDAT", zlib.compress(rows, 0)) +
+            chunk(b"IEND", b""))
+
+
+def make_payload(size):
+    """Build printable download content of size bytes"""
+
+    return ("%0*x" % (size, random.getrandbits(size * 4))).encode()
+
+
+def parse_range(header, length):
+    """Parse a single byte range, returning (start, end) or None"""
+
+    match = re.fullmatch(r"bytes=(\d*)-(\d*)", header.strip())
+    if match is None or match.group(1) == match.group(2) == "":
+        return None
+    if match.group(1) == "":
+        start = max(0, length - int(match.group(2)))
+        end = length
+    else:
+        start = int(match.group(1))
+        end = length if match.group(2) == "" else int(match.group(2)) + 1
+    if start >= length or end <= start:
+        return None
+    return (start, min(end, length))
+
+
+class Corpus:
+    """Pages and their subresources generated from the corpus description"""
+
+    def __init__(self, pages, downloads=()):
+        random.seed(0)
+        self.resources = {}
+        self.downloads = {}
+        self.pages = []
+        for page in pages:
+            name = page["name"]
+            body = ["<!DOCTYPE html><html><head><title>%s</title>" % name]
+            for idx in range(page.get("stylesheets", 0)):
+                path = "/%s/style%d.css" % (name, idx)
+                css = "p.c%d { margin: 1px; }\n" % idx
+                css *= max(1, page.get("stylesheet_size", 1024) // len(css))
+                self.resources[path] = ("text/css", css.encode())
+                body.append('<link rel="stylesheet" href="%s">' % path)
+            body.append("</head><body>")
+            for idx in range(page.get("images", 0)):
+                path = "/%s/image%d.png" % (name, idx)
+                self.resources[path] = ("image/png",
+                                        make_png(page.get("image_size", 4096)))
+                body.append('<img src="%s">' % path)
+            text = "<p>Lorem ipsum dolor sit amet.</p>\n"
+            body.append(text * max(1, page.get("html_size", 4096) // len(text)))
+            body.append("</body></html>\n")
+            path = "/%s/" % name
+            self.resources[path] = ("text/html", "".join(body).encode())
+            self.pages.append(path)
+        for download in downloads:
+            path = "/downloads/%s.bin" % download["name"]
+            self.resources[path] = ("application/octet-stream",
+                                    make_payload(download["size"]))
+            self.downloads[path] = download
+
+
+class NetSimHandler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def setup(self):
+        super().setup()
+        self.server.connection_opened()
+
+    def finish(self):
+        try:
+            super().finish()
+        finally:
+            self.server.connection_closed()
+
+    def log_message(self, *args):
+        pass
+
+    def do_GET(self):
+        srv = self.server
+        received = time.monotonic()
+        resource = srv.corpus.resources.get(self.path.split("?")[0])
+
+        if srv.latency > 0:
+            time.sleep(srv.latency)
+
+        if resource is None:
+            self.send_error(404)
+            return
+
+        mimetype, data = resource
+        download = srv.corpus.downloads.get(self.path)
+        if download is not None:
+            self.send_download(mimetype, data, download, received)
+            return
+
+        self.send_response(200)
+        self.send_header("Content-Type", mimetype)
+        self.send_header("Content-Length", str(len(data)))
+        self.send_header("Cache-Control", "no-store")
+        self.end_headers()
+        self.wfile.flush()
+        first_byte = time.monotonic()
+
+        self.send_body(data)
+
+        srv.record(self.path, received, first_byte, time.monotonic())
+
+    def send_body(self, data):
+        """Send data under the bandwidth limit and connection throttle"""
+
+        srv = self.server
+        try:
+            for start in range(0, len(data), srv.chunk):
+                block = data[start:start + srv.chunk]
+                srv.bucket.take(len(block))
+                if srv.per_connection is not None:
+                    time.sleep(len(block) / srv.per_connection)
+                self.wfile.write(block)
+            self.wfile.flush()
+        except (BrokenPipeError, ConnectionResetError):
+            # the client abandoned the fetch
+            self.close_connection = True
+
+    def send_download(self, mimetype, data, download, received):
+        """Send a download, honouring a single byte range"""
+
+        srv = self.server
+        etag = srv.etag(self.path)
+        byte_range = None
+
+        header = self.headers.get("Range")
+        if_range = self.headers.get("If-Range")
+        if header is not None and (if_range is None or if_range == etag):
+            byte_range = parse_range(header, len(data))
+            if byte_range is None:
+                self.send_response(416)
+                self.send_header("Content-Range", "bytes */%d" % len(data))
+                self.send_header("Content-Length", "0")
+                self.end_headers()
+                srv.record(self.path, received, None, time.monotonic(), None)
+                return
+
+        if byte_range is None:
+            body = data
+            self.send_response(200)
+        else:
+            (start, end) = byte_range
+            if download.get("wrong_range", False):
+                # answer with the start of the file whatever was asked
+                (start, end) = (0, end - start)
+            elif download.get("short_range", False):
+                # answer one byte short of the range that was asked
+                end = end - 1
+            body = data[start:end]
+            self.send_response(206)
+            self.send_header("Content-Range",
+                             "bytes %d-%d/%d" % (start, end - 1, len(data)))
+
+        self.send_header("Content-Type", mimetype)
+        self.send_header("Content-Length", str(len(body)))
+        self.send_header("Accept-Ranges", "bytes")
+        self.send_header("ETag", etag)
+        self.send_header("Cache-Control", "no-store")
+        self.end_headers()
+        self.wfile.flush()
+        first_byte = time.monotonic()
+
+        if header is None and download.get("changes", False):
+            # the resource changes once the download has started
+            srv.bump(self.path)
+
+        if byte_range is not None and srv.take_drop(self.path):
+            # lose the connection part way through the range
+            srv.record_drop(byte_range)
+            self.send_body(body[:download["drop_after"]])
+            self.close_connection = True
+        else:
+            self.send_body(body)
+
+        srv.record(self.path, received, first_byte, time.monotonic(),
+                   byte_range)
+
+
+class NetSimServer(socketserver.ThreadingMixIn, http.server.HTTPServer):
+    """Loopback HTTP server with injected network conditions"""
+
+    daemon_threads = True
+    chunk = 1024
+
+    def __init__(self, corpus, latency=0.0, bandwidth=None, per_connection=None):
+        super().__init__(("127.0.0.1", 0), NetSimHandler)
+        self.corpus = corpus
+        self.latency = latency
+        self.bucket = TokenBucket(bandwidth)
+        self.per_connection = per_connection
+        self.lock = threading.Lock()
+        self.connections = 0
+        self.peak = 0
+        self.requests = []
+        self.versions = {}
+        self.drops = {}
+        self.dropped = []
+        self.thread = threading.Thread(target=self.serve_forever, daemon=True)
+        self.thread.start()
+
+    def url(self, path):
+        return "http://127.0.0.1:%d%s" % (self.server_address[1], path)
+
+    def connection_opened(self):
+        with self.lock:
+            self.connections += 1
+            self.peak = max(self.peak, self.connections)
+
+    def connection_closed(self):
+        with self.lock:
+            self.connections -= 1
+
+    def record(self, path, received, first_byte, done, byte_range=None):
+        with self.lock:
+            self.requests.append((path, received, first_byte, done,
+                                  byte_range))
+
+    def etag(self, path):
+        with self.lock:
+            return '"%s-%d"' % (path, self.versions.get(path, 0))
+
+    def bump(self, path):
+        """Change the validator of a download"""
+        with self.lock:
+            self.versions[path] = self.versions.get(path, 0) + 1
+
+    def take_drop(self, path):
+        """Check if a ranged response should lose its connection"""
+        with self.lock:
+            if self.drops.get(path, 0) > 0:
+                self.drops[path] -= 1
+                return True
+            return False
+
+    def record_drop(self, byte_range):
+        with self.lock:
+            self.dropped.append(byte_range)
+
+    def reset(self):
+        with self.lock:
+            self.peak = self.connections
+            self.requests = []
+            self.versions = {}
+            self.drops = {path: download.get("drops", 0)
+                          for (path, download) in self.corpus.downloads.items()}
+            self.dropped = []
+
+    def stop(self):
+        self.shutdown()
+        self.server_close()
+
+
+def measure(monkey_cmd, server, page):
+    """Load a page in a fresh browser and return its timings in seconds"""
+
+    browser = Browser(monkey_cmd=monkey_cmd + ["--enable_javascript=0"],
+                      quiet=True)
+    win = browser.new_window()
+
+    server.reset()
+    start = time.monotonic()
+    win.load_page(server.url(page))
+    loaded = time.monotonic()
+
+    with server.lock:
+        requests = list(server.requests)
+        peak = server.peak
+
+    win.kill()
+    win.wait_until_dead()
+    browser.quit_and_wait()
+
+    ttfb = None
+    for (path, _received, first_byte, _done, _range) in requests:
+        if path == page:
+            ttfb = first_byte - start
+
+    return {
+        "ttfb": ttfb,
+        "all_done": loaded - start,
+        "requests": len(requests),
+        "peak_connections": peak,
+    }
+
+
+def run(monkey_cmd, corpus_file, runs):
+    with open(corpus_file) as stream:
+        desc = yaml.safe_load(stream)
+
+    corpus = Corpus(desc["pages"])
+    results = []
+
+    for profile in desc["profiles"]:
+        server = NetSimServer(corpus,
+                              latency=profile.get("latency", 0.0),
+                              bandwidth=profile.get("bandwidth"),
+                              per_connection=profile.get("per_connection"))
+        try:
+            for page in corpus.pages:
+                for run_idx in range(runs):
+                    result = measure(monkey_cmd, server, page)
+                    result.update(profile=profile["name"], page=page, run=run_idx)
+                    results.append(result)
+        finally:
+            server.stop()
+
+    return results
+
+
+# Options the download checks run nsmonkey with
+DOWNLOAD_OPTIONS = ["--download_segments=4",
+                    "--download_segment_min_size=1048576"]
+
+# Limits on the segments a download is split into, as in desktop/download.c
+DOWNLOAD_SEGMENT_MAX = 16
+DOWNLOAD_SEGMENT_MIN_LENGTH = 256 * 1024
+
+# Seconds a download may take before a check gives up on it
+DOWNLOAD_TIMEOUT = 60
+
+
+def expected_segments(length, segments=4):
+    """The ranges a download of length bytes is split into"""
+
+    count = min(segments, DOWNLOAD_SEGMENT_MAX)
+    if length // count < DOWNLOAD_SEGMENT_MIN_LENGTH:
+        count = length // DOWNLOAD_SEGMENT_MIN_LENGTH
+    seglen = length // count
+    ranges = [(idx * seglen, (idx + 1) * seglen) for idx in range(count)]
+    ranges[-1] = (ranges[-1][0], length)
+    return ranges
+
+
+def coverage(ranges):
+    """Merge written (offset, size) ranges, or None if any overlap"""
+
+    merged = []
+    for (offset, size) in sorted(ranges):
+        if len(merged) > 0 and offset < merged[-1][1]:
+            return None
+        if len(merged) > 0 and offset == merged[-1][1]:
+            merged[-1][1] = offset + size
+        else:
+            merged.append([offset, offset + size])
+    return [tuple(span) for span in merged]
+
+
+def read_segment_map(map_path):
+    """Read the (start, end, done) segments of a saved segment map"""
+
+    with open(map_path) as stream:
+        lines = stream.read().splitlines()
+    return [tuple(int(val) for val in line.split()) for line in lines[4:]]
+
+
+class DownloadRun:
+    """A download fetched by a fresh browser"""
+
+    def __init__(self, monkey_cmd, server, path, map_path=None):
+        self.server = server
+        self.path = path
+        self.start = time.monotonic()
+        self.browser = Browser(monkey_cmd=monkey_cmd +
+                               ["--enable_javascript=0"] + DOWNLOAD_OPTIONS,
+                               quiet=True)
+        if map_path is not None:
+            self.browser.resume_download(map_path)
+        self.win = self.browser.new_window()
+        self.browser.farmer.tell_monkey("WINDOW GO %s %s" % (
+            self.win.winid, server.url(path)))
+        self.dwin = self.browser.wait_for_download()
+
+    def ranges_requested(self):
+        """Byte ranges the server was asked for during this run"""
+        with self.server.lock:
+            return sorted(byte_range for (path, received, _first, _done,
+                                          byte_range) in self.server.requests
+                          if path == self.path and byte_range is not None and
+                          received >= self.start)
+
+    def close(self):
+        if self.dwin.alive:
+            self.dwin.abort()
+        self.win.kill()
+        self.win.wait_until_dead()
+        self.browser.quit_and_wait()
+
+
+def check_complete(run, download):
+    failures = []
+    run.dwin.wait_finished(DOWNLOAD_TIMEOUT)
+    if not run.dwin.done:
+        failures.append("download failed: %s" % run.dwin.error)
+    if coverage(run.dwin.ranges) != [(0, download["size"])]:
+        failures.append("written ranges do not cover the file once")
+    if run.dwin.data_size != 0:
+        failures.append("data written sequentially")
+    return failures
+
+
+def check_split(run, download):
+    failures = check_complete(run, download)
+    segments = expected_segments(download["size"])
+    if run.ranges_requested() != segments:
+        failures.append("requested %s, expected %s" % (
+            run.ranges_requested(), segments))
+    if run.server.peak < len(segments):
+        failures.append("only %d concurrent connections" % run.server.peak)
+    return failures
+
+
+def check_wrong_range(run, download):
+    failures = []
+    run.dwin.wait_finished(DOWNLOAD_TIMEOUT)
+    first = expected_segments(download["size"])[0]
+    if run.dwin.error is None:
+        failures.append("wrong Content-Range was accepted")
+    for (offset, size) in run.dwin.ranges:
+        if offset < first[0] or offset + size > first[1]:
+            failures.append("data written at %d from a wrong range" % offset)
+    return failures
+
+
+def check_changed(run, _download):
+    failures = []
+    run.dwin.wait_finished(DOWNLOAD_TIMEOUT)
+    if run.dwin.error is None:
+        failures.append("full response to a mismatched If-Range was accepted")
+    if len(run.dwin.ranges) > 0 or run.dwin.data_size > 0:
+        failures.append("data of the changed resource was written")
+    return failures
+
+
+def check_short_range(run, _download):
+    failures = []
+    run.dwin.wait_finished(DOWNLOAD_TIMEOUT)
+    if run.dwin.error is None:
+        failures.append("short Content-Range was accepted")
+    if len(run.dwin.ranges) > 0:
+        failures.append("data of a short range was written")
+    return failures
+
+
+def check_dropped(run, download):
+    failures = check_complete(run, download)
+    requested = run.ranges_requested()
+    with run.server.lock:
+        dropped = list(run.server.dropped)
+    if len(dropped) != download["drops"]:
+        failures.append("%d connections dropped" % len(dropped))
+    for (start, end) in dropped:
+        if (start + download["drop_after"], end) not in requested:
+            failures.append("segment %d-%d was not resumed" % (start, end))
+    return failures
+
+
+# Checks of a single download run, by the check named in the corpus
+CHECKS = {
+    "split": check_split,
+    "wrong_range": check_wrong_range,
+    "short_range": check_short_range,
+    "changed": check_changed,
+    "dropped": check_dropped,
+}
+
+
+def complete_segment_map(map_path):
+    """Rewrite a saved segment map as if every segment had finished"""
+
+    with open(map_path) as stream:
+        lines = stream.read().splitlines()
+    segments = read_segment_map(map_path)
+    with open(map_path, "w") as stream:
+        for line in lines[:4]:
+            stream.write(line + "\n")
+        for (start, end, _done) in segments:
+            stream.write("%d %d %d\n" % (start, end, end - start))
+
+
+def check_map(monkey_cmd, server, path, download, check):
+    failures = []
+    with tempfile.NamedTemporaryFile(suffix=".map") as map_file:
+        run = DownloadRun(monkey_cmd, server, path)
+        try:
+            run.dwin.wait_for_data(download["size"] // 4)
+            if not run.dwin.save_map(map_file.name):
+                failures.append("segment map was not saved")
+        finally:
+            run.close()
+        if len(failures) > 0:
+            return failures
+
+        segments = read_segment_map(map_file.name)
+        written = coverage(run.dwin.ranges) or []
+        for (start, end, done) in segments:
+            if done > 0 and not any(span[0] <= start and
+                                    start + done <= span[1]
+                                    for span in written):
+                failures.append("map claims unwritten data in %d-%d" % (
+                    start, end))
+
+        if check == "stale_map":
+            server.bump(path)
+        elif check == "complete_map":
+            complete_segment_map(map_file.name)
+            segments = read_segment_map(map_file.name)
+
+        run = DownloadRun(monkey_cmd, server, path, map_file.name)
+        try:
+            run.dwin.wait_finished(DOWNLOAD_TIMEOUT)
+        finally:
+            run.close()
+
+    if check == "stale_map":
+        if run.dwin.resumed is not False:
+            failures.append("stale segment map was accepted")
+        return failures + check_split(run, download)
+
+    remaining = [(start + done, end) for (start, end, done) in segments
+                 if start + done < end]
+    if run.dwin.resumed != sum(done for (_start, _end, done) in segments):
+        failures.append("resumed with %s bytes done" % run.dwin.resumed)
+    if not run.dwin.done:
+        failures.append("resumed download failed: %s" % run.dwin.error)
+    if run.ranges_requested() != remaining:
+        failures.append("requested %s, expected %s" % (
+            run.ranges_requested(), remaining))
+    if coverage(run.dwin.ranges) != coverage(
+            [(start, end - start) for (start, end) in remaining]):
+        failures.append("resumed download did not write the remainder once")
+    return failures
+
+
+def run_downloads(monkey_cmd, corpus_file):
+    with open(corpus_file) as stream:
+        desc = yaml.safe_load(stream)
+
+    corpus = Corpus(desc["pages"], desc.get("downloads", []))
+    profile = desc.get("download_profile", {})
+    server = NetSimServer(corpus,
+                          latency=profile.get("latency", 0.0),
+                          bandwidth=profile.get("bandwidth"),
+                          per_connection=profile.get("per_connection"))
+    results = []
+
+    try:
+        for (path, download) in corpus.downloads.items():
+            server.reset()
+            start = time.monotonic()
+            check = download["check"]
+            if check in ("map", "stale_map", "complete_map"):
+                failures = check_map(monkey_cmd, server, path, download,
+                                     check)
+            else:
+                run = DownloadRun(monkey_cmd, server, path)
+                try:
+                    failures = CHECKS[check](run, download)
+                finally:
+                    run.close()
+            results.append({
+                "download": download["name"],
+                "check": check,
+                "time": time.monotonic() - start,
+                "failures": failures,
+            })
+    finally:
+        server.stop()
+
+    return results
+
+
+def print_downloads(results):
+    for res in results:
+        print("%-4s %-12s %-10s %7.1fs" % (
+            "FAIL" if len(res["failures"]) > 0 else "PASS",
+            res["download"], res["check"], res["time"]))
+        for failure in res["failures"]:
+            print("     %s" % failure)
+
+
+def print_table(results):
+    print("%-12s %-16s %4s %9s %9s %5s %5s" % (
+        "profile", "page", "run", "ttfb(ms)", "done(ms)", "reqs", "peak"))
+    for res in results:
+        ttfb = "-" if res["ttfb"] is None else "%.1f" % (res["ttfb"] * 1000)
+        print("%-12s %-16s %4d %9s %9.1f %5d %5d" % (
+            res["profile"], res["page"], res["run"], ttfb,
+            res["all_done"] * 1000, res["requests"], res["peak_connections"]))
+
+
+def main(argv):
+    monkey_cmd = ["./nsmonkey"]
+    as_json = False
+    downloads = False
+    runs = 1
+    corpus_file = os.path.join(os.path.dirname(__file__), "netsim-corpus.yaml")
+
+    try:
+        opts, args = getopt.getopt(argv, "hm:jr:d",
+                                   ["monkey=", "json", "runs=", "downloads"])
+    except getopt.GetoptError:
+        print(__doc__)
+        sys.exit(2)
+
+    for opt, arg in opts:
+        if opt == "-h":
+            print(__doc__)
+            sys.exit()
+        elif opt in ("-m", "--monkey"):
+            monkey_cmd = [arg]
+        elif opt in ("-j", "--json"):
+            as_json = True
+        elif opt in ("-r", "--runs"):
+            runs = int(arg)
+        elif opt in ("-d", "--downloads"):
+            downloads = True
+
+    if len(args) > 0:
+        corpus_file = args[0]
+
+    if downloads:
+        results = run_downloads(monkey_cmd, corpus_file)
+    else:
+        results = run(monkey_cmd, corpus_file, runs)
+
+    if as_json:
+        json.dump(results, sys.stdout, indent=1)
+        print()
+    elif downloads:
+        print_downloads(results)
+    else:
+        print_table(results)
+
+    if downloads and any(len(res["failures"]) > 0 for res in results):
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
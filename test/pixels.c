@@ -0,0 +1,319 @@
+/*
+ * Copyright 2026 NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Tests for pixel format conversion kernels.
+ *
+ * Each kernel is compared with a plain reference implementation. The
+ * length tests cover every remainder of the vector block sizes at
+ * every source alignment, converting both in place and between
+ * buffers. The value tests cover every combination of the inputs
+ * which the arithmetic kernels combine.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+
+#include "utils/pixels.h"
+
+/** longest run of pixels the length tests convert */
+#define PIXELS_TEST_LENGTH 80
+
+/** number of source alignments tested */
+#define PIXELS_TEST_ALIGN 4
+
+/** scatter steps tested, as used by Adam7 */
+static const size_t scatter_steps[] = { 1, 2, 4, 8 };
+
+
+/* Reference implementations */
+
+static void ref_rgb_to_rgba(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	size_t i;
+	for (i = 0; i < count; i++) {
+		dst[i * 4 + 0] = src[i * 3 + 0];
+		dst[i * 4 + 1] = src[i * 3 + 1];
+		dst[i * 4 + 2] = src[i * 3 + 2];
+		dst[i * 4 + 3] = 0xff;
+	}
+}
+
+static void ref_grey_to_rgba(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	size_t i;
+	for (i = 0; i < count; i++) {
+		dst[i * 4 + 0] = src[i];
+		dst[i * 4 + 1] = src[i];
+		dst[i * 4 + 2] = src[i];
+		dst[i * 4 + 3] = 0xff;
+	}
+}
+
+static void ref_cmyk_to_rgba(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	size_t i;
+	int c;
+	for (i = 0; i < count; i++) {
+		for (c = 0; c < 3; c++) {
+			dst[i * 4 + c] = (src[i * 4 + c] *
+					  src[i * 4 + 3]) / 255;
+		}
+		dst[i * 4 + 3] = 0xff;
+	}
+}
+
+
+/* Helpers */
+
+typedef void (pixels_fn)(uint8_t *dst, const uint8_t *src, size_t count);
+
+static void fill_random(uint8_t *buf, size_t size, unsigned int seed)
+{
+	size_t i;
+
+	srand(seed);
+	for (i = 0; i < size; i++) {
+		buf[i] = rand() & 0xff;
+	}
+}
+
+/**
+ * Check a kernel against its reference for one length.
+ *
+ * Every source alignment is tried, converting between buffers and in
+ * place. Bytes around the destination must be left alone.
+ */
+static void
+check_kernel(pixels_fn *kernel, pixels_fn *ref, size_t src_bpp, size_t count)
+{
+	uint8_t src[PIXELS_TEST_LENGTH * 4 + PIXELS_TEST_ALIGN];
+	uint8_t dst[PIXELS_TEST_LENGTH * 4 + PIXELS_TEST_ALIGN + 8];
+	uint8_t expect[PIXELS_TEST_LENGTH * 4];
+	size_t align;
+
+	for (align = 0; align < PIXELS_TEST_ALIGN; align++) {
+		fill_random(src, sizeof(src), count * 4 + align);
+		ref(expect, src + align, count);
+
+		/* separate buffers */
+		memset(dst, 0xa5, sizeof(dst));
+		kernel(dst + 4 + align, src + align, count);
+		ck_assert(memcmp(dst + 4 + align, expect, count * 4) == 0);
+		ck_assert(dst[3 + align] == 0xa5);
+		ck_assert(dst[4 + align + count * 4] == 0xa5);
+
+		/* in place */
+		memset(dst, 0xa5, sizeof(dst));
+		memcpy(dst + align, src + align, count * src_bpp);
+		kernel(dst + align, dst + align, count);
+		ck_assert(memcmp(dst + align, expect, count * 4) == 0);
+		ck_assert(dst[align + count * 4] == 0xa5);
+	}
+}
+
+
+/* Tests */
+
+START_TEST(pixels_rgb_to_rgba_length_test)
+{
+	check_kernel(pixels_rgb_to_rgba, ref_rgb_to_rgba, 3, _i);
+}
+END_TEST
+
+START_TEST(pixels_grey_to_rgba_length_test)
+{
+	check_kernel(pixels_grey_to_rgba, ref_grey_to_rgba, 1, _i);
+}
+END_TEST
+
+START_TEST(pixels_cmyk_to_rgba_length_test)
+{
+	check_kernel(pixels_cmyk_to_rgba, ref_cmyk_to_rgba, 4, _i);
+}
+END_TEST
+
+/**
+ * Opacity of every length with a translucent pixel at each position.
+ */
+START_TEST(pixels_opaque_length_test)
+{
+	uint8_t pixels[PIXELS_TEST_LENGTH * 4];
+	size_t count = _i;
+	size_t i;
+
+	fill_random(pixels, sizeof(pixels), count);
+	for (i = 0; i < count; i++) {
+		pixels[i * 4 + 3] = 0xff;
+	}
+	ck_assert(pixels_opaque(pixels, count) == true);
+
+	for (i = 0; i < count; i++) {
+		pixels[i * 4 + 3] = 0xfe;
+		ck_assert(pixels_opaque(pixels, count) == false);
+		pixels[i * 4 + 3] = 0x7f;
+		ck_assert(pixels_opaque(pixels, count) == false);
+		pixels[i * 4 + 3] = 0xff;
+	}
+}
+END_TEST
+
+/**
+ * Scatter every length at each Adam7 step.
+ */
+START_TEST(pixels_scatter_length_test)
+{
+	uint8_t src[PIXELS_TEST_LENGTH * 4];
+	uint8_t dst[PIXELS_TEST_LENGTH * 4 * 8];
+	size_t count = _i;
+	size_t s, i;
+
+	fill_random(src, sizeof(src), count);
+
+	for (s = 0; s < sizeof(scatter_steps) / sizeof(scatter_steps[0]); s++) {
+		size_t step = scatter_steps[s];
+
+		memset(dst, 0xa5, sizeof(dst));
+		pixels_scatter(dst, src, count, step);
+
+		for (i = 0; i < sizeof(dst) / 4; i++) {
+			if ((i % step == 0) && (i / step < count)) {
+				ck_assert(memcmp(dst + i * 4,
+						 src + (i / step) * 4, 4) == 0);
+			} else {
+				ck_assert(dst[i * 4 + 0] == 0xa5);
+				ck_assert(dst[i * 4 + 3] == 0xa5);
+			}
+		}
+	}
+}
+END_TEST
+
+/**
+ * Convert every ink value with every black value.
+ */
+START_TEST(pixels_cmyk_to_rgba_value_test)
+{
+	uint8_t *src = malloc(256 * 256 * 4);
+	uint8_t *dst = malloc(256 * 256 * 4);
+	uint8_t *expect = malloc(256 * 256 * 4);
+	int i;
+
+	ck_assert(src != NULL && dst != NULL && expect != NULL);
+
+	for (i = 0; i < 256 * 256; i++) {
+		src[i * 4 + 0] = i & 0xff;
+		src[i * 4 + 1] = 0xff - (i & 0xff);
+		src[i * 4 + 2] = (i & 0xff) ^ 0x5a;
+		src[i * 4 + 3] = i >> 8;
+	}
+
+	ref_cmyk_to_rgba(expect, src, 256 * 256);
+	pixels_cmyk_to_rgba(dst, src, 256 * 256);
+	ck_assert(memcmp(dst, expect, 256 * 256 * 4) == 0);
+
+	free(expect);
+	free(dst);
+	free(src);
+}
+END_TEST
+
+/**
+ * Expand every grey and channel value.
+ */
+START_TEST(pixels_expand_value_test)
+{
+	uint8_t src[256 * 3];
+	uint8_t dst[256 * 4];
+	uint8_t expect[256 * 4];
+	int i;
+
+	for (i = 0; i < 256 * 3; i++) {
+		src[i] = (i * 7) & 0xff;
+	}
+
+	ref_rgb_to_rgba(expect, src, 256);
+	pixels_rgb_to_rgba(dst, src, 256);
+	ck_assert(memcmp(dst, expect, sizeof(dst)) == 0);
+
+	ref_grey_to_rgba(expect, src, 256);
+	pixels_grey_to_rgba(dst, src, 256);
+	ck_assert(memcmp(dst, expect, sizeof(dst)) == 0);
+}
+END_TEST
+
+
+static TCase *pixels_length_case_create(void)
+{
+	TCase *tc;
+	tc = tcase_create("Lengths");
+
+	tcase_add_loop_test(tc, pixels_rgb_to_rgba_length_test,
+			    0, PIXELS_TEST_LENGTH + 1);
+	tcase_add_loop_test(tc, pixels_grey_to_rgba_length_test,
+			    0, PIXELS_TEST_LENGTH + 1);
+	tcase_add_loop_test(tc, pixels_cmyk_to_rgba_length_test,
+			    0, PIXELS_TEST_LENGTH + 1);
+	tcase_add_loop_test(tc, pixels_opaque_length_test,
+			    0, PIXELS_TEST_LENGTH + 1);
+	tcase_add_loop_test(tc, pixels_scatter_length_test,
+			    0, PIXELS_TEST_LENGTH + 1);
+
+	return tc;
+}
+
+static TCase *pixels_value_case_create(void)
+{
+	TCase *tc;
+	tc = tcase_create("Values");
+
+	tcase_add_test(tc, pixels_cmyk_to_rgba_value_test);
+	tcase_add_test(tc, pixels_expand_value_test);
+
+	return tc;
+}
+
+static Suite *pixels_suite(void)
+{
+	Suite *s;
+	s = suite_create("Pixel conversion");
+
+	suite_add_tcase(s, pixels_length_case_create());
+	suite_add_tcase(s, pixels_value_case_create());
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	int number_failed;
+	SRunner *sr;
+
+	sr = srunner_create(pixels_suite());
+
+	srunner_run_all(sr, CK_ENV);
+
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2026 NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Test single producer, single consumer queue operations.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <check.h>
+
+#include "utils/spsc.h"
+
+/** number of items pushed through the queue in the threaded test */
+#define TRANSFER_COUNT 100000
+
+/* Tests */
+
+/**
+ * Test queue creation and trivial push/pop
+ */
+START_TEST(spsc_create_test)
+{
+	struct spsc_queue *q;
+	int item;
+
+	q = spsc_queue_create(4);
+	ck_assert(q != NULL);
+	ck_assert(spsc_queue_empty(q));
+	ck_assert(spsc_queue_pop(q) == NULL);
+
+	ck_assert(spsc_queue_push(q, &item));
+	ck_assert(!spsc_queue_empty(q));
+	ck_assert(spsc_queue_pop(q) == &item);
+	ck_assert(spsc_queue_empty(q));
+
+	spsc_queue_destroy(q);
+}
+END_TEST
+
+/**
+ * Test a queue reports full at its capacity and preserves ordering
+ */
+START_TEST(spsc_full_test)
+{
+	struct spsc_queue *q;
+	uintptr_t i;
+
+	/* rounded up to eight */
+	q = spsc_queue_create(5);
+	ck_assert(q != NULL);
+
+	for (i = 1; i <= 8; i++) {
+		ck_assert(spsc_queue_push(q, (void *)i));
+	}
+	ck_assert(!spsc_queue_push(q, (void *)i));
+
+	for (i = 1; i <= 8; i++) {
+		ck_assert(spsc_queue_pop(q) == (void *)i);
+	}
+	ck_assert(spsc_queue_pop(q) == NULL);
+
+	spsc_queue_destroy(q);
+}
+END_TEST
+
+
+/**
+ * Basic API test case
+ */
+static TCase *spsc_api_case_create(void)
+{
+	TCase *tc;
+
+	tc = tcase_create("API");
+
+	tcase_add_test(tc, spsc_create_test);
+	tcase_add_test(tc, spsc_full_test);
+
+	return tc;
+}
+
+
+static void *spsc_producer(void *pw)
+{
+	struct spsc_queue *q = pw;
+	uintptr_t i;
+
+	for (i = 1; i <= TRANSFER_COUNT; i++) {
+		while (!spsc_queue_push(q, (void *)i)) {
+			/* wait for consumer to make space */
+			sched_yield();
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Test items cross between threads in order and without loss
+ */
+START_TEST(spsc_thread_test)
+{
+	struct spsc_queue *q;
+	pthread_t producer;
+	uintptr_t expected = 1;
+	void *item;
+
+	q = spsc_queue_create(64);
+	ck_assert(q != NULL);
+
+	ck_assert(pthread_create(&producer, NULL, spsc_producer, q) == 0);
+
+	while (expected <= TRANSFER_COUNT) {
+		item = spsc_queue_pop(q);
+		if (item != NULL) {
+			ck_assert(item == (void *)expected);
+			expected++;
+		} else {
+			sched_yield();
+		}
+	}
+
+	pthread_join(producer, NULL);
+	ck_assert(spsc_queue_empty(q));
+
+	spsc_queue_destroy(q);
+}
+END_TEST
+
+
+/**
+ * Threaded transfer test case
+ */
+static TCase *spsc_thread_case_create(void)
+{
+	TCase *tc;
+
+	tc = tcase_create("Threaded");
+
+	tcase_add_test(tc, spsc_thread_test);
+
+	return tc;
+}
+
+
+static Suite *spsc_suite(void)
+{
+	Suite *s;
+	s = suite_create("SPSC queue");
+
+	suite_add_tcase(s, spsc_api_case_create());
+	suite_add_tcase(s, spsc_thread_case_create());
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = spsc_suite();
+
+	sr = srunner_create(s);
+	srunner_run_all(sr, CK_ENV);
+
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright 2026 NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Bump pointer arena allocator implementation.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/arena.h"
+
+/** Alignment of every allocation, and the size class granularity */
+#define ARENA_ALIGN 16
+
+/** Number of size classes kept on free lists */
+#define ARENA_CLASSES 64
+
+/** Default block size */
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+/** Round a size up to the allocation alignment */
+#define ARENA_ROUND(s) (((s) + ARENA_ALIGN - 1) & ~((size_t)ARENA_ALIGN - 1))
+
+/**
+ * A block of memory allocations are made from.
+ */
+struct arena_block {
+	struct arena_block *next; /**< Next block in the arena */
+	size_t size; /**< Usable size of the block */
+	size_t used; /**< Bytes handed out from the block */
+};
+
+/** Offset of the first allocation within a block */
+#define ARENA_HEADER ARENA_ROUND(sizeof(struct arena_block))
+
+/**
+ * Freed allocation on a size class free list.
+ */
+struct arena_free {
+	struct arena_free *next; /**< Next free allocation of the class */
+};
+
+/**
+ * An arena.
+ */
+struct arena {
+	/** Blocks, the first is the one currently allocated from */
+	struct arena_block *blocks;
+	/** Size of blocks */
+	size_t block_size;
+	/** Free lists, indexed by rounded size over alignment less one */
+	struct arena_free *free[ARENA_CLASSES];
+};
+
+
+/**
+ * Allocate a new block.
+ *
+ * \param size The usable size of the block.
+ * \return The block, or NULL on failure.
+ */
+static struct arena_block *arena_block_create(size_t size)
+{
+	struct arena_block *block;
+
+	block = malloc(ARENA_HEADER + size);
+	if (block == NULL) {
+		return NULL;
+	}
+	block->next = NULL;
+	block->size = size;
+	block->used = 0;
+
+	return block;
+}
+
+
+/* exported interface documented in utils/arena.h */
+struct arena *arena_create(size_t block_size)
+{
+	struct arena *arena;
+
+	arena = calloc(1, sizeof(*arena));
+	if (arena == NULL) {
+		return NULL;
+	}
+
+	if (block_size == 0) {
+		block_size = ARENA_BLOCK_SIZE;
+	}
+	arena->block_size = ARENA_ROUND(block_size);
+
+	return arena;
+}
+
+
+/* exported interface documented in utils/arena.h */
+void arena_destroy(struct arena *arena)
+{
+	struct arena_block *block, *next;
+
+	if (arena == NULL) {
+		return;
+	}
+
+	for (block = arena->blocks; block != NULL; block = next) {
+		next = block->next;
+		free(block);
+	}
+	free(arena);
+}
+
+
+/* exported interface documented in utils/arena.h */
+void *arena_alloc(struct arena *arena, size_t size)
+{
+	struct arena_block *block = arena->blocks;
+	size_t rsize;
+	size_t class;
+	void *ptr;
+
+	rsize = ARENA_ROUND(size == 0 ? 1 : size);
+	if (rsize < size) {
+		return NULL;
+	}
+
+	/* reuse a freed allocation of the same class */
+	class = rsize / ARENA_ALIGN - 1;
+	if (class < ARENA_CLASSES && arena->free[class] != NULL) {
+		ptr = arena->free[class];
+		arena->free[class] = arena->free[class]->next;
+		return ptr;
+	}
+
+	if (block == NULL || block->size - block->used < rsize) {
+		if (rsize > arena->block_size / 4) {
+			/* large allocations get a block of their own, kept
+			 * behind the current block so it is still used */
+			block = arena_block_create(rsize);
+			if (block == NULL) {
+				return NULL;
+			}
+			if (arena->blocks != NULL) {
+				block->next = arena->blocks->next;
+				arena->blocks->next = block;
+			} else {
+				arena->blocks = block;
+			}
+		} else {
+			block = arena_block_create(arena->block_size);
+			if (block == NULL) {
+				return NULL;
+			}
+			block->next = arena->blocks;
+			arena->blocks = block;
+		}
+	}
+
+	ptr = (char *)block + ARENA_HEADER + block->used;
+	block->used += rsize;
+
+	return ptr;
+}
+
+
+/* exported interface documented in utils/arena.h */
+void arena_free(struct arena *arena, void *ptr, size_t size)
+{
+	struct arena_free *f = ptr;
+	size_t class;
+
+	if (ptr == NULL) {
+		return;
+	}
+
+	class = ARENA_ROUND(size == 0 ? 1 : size) / ARENA_ALIGN - 1;
+	if (class >= ARENA_CLASSES) {
+		/* large allocations are released with the arena */
+		return;
+	}
+
+	f->next = arena->free[class];
+	arena->free[class] = f;
+}
+
+
+/* exported interface documented in utils/arena.h */
+char *arena_strndup(struct arena *arena, const char *s, size_t len)
+{
+	char *copy;
+
+	copy = arena_alloc(arena, len + 1);
+	if (copy == NULL) {
+		return NULL;
+	}
+	memcpy(copy, s, len);
+	copy[len] = '\0';
+
+	return copy;
+}
+
+
+/* exported interface documented in utils/arena.h */
+char *arena_strdup(struct arena *arena, const char *s)
+{
+	return arena_strndup(arena, s, strlen(s));
+}
+
+
+/* exported interface documented in utils/arena.h */
+void arena_walk(struct arena *arena, size_t size,
+		void (*cb)(void *ptr, void *pw), void *pw)
+{
+	struct arena_block *block;
+	size_t rsize = ARENA_ROUND(size == 0 ? 1 : size);
+	size_t offset;
+
+	for (block = arena->blocks; block != NULL; block = block->next) {
+		for (offset = 0; offset + rsize <= block->used;
+				offset += rsize) {
+			cb((char *)block + ARENA_HEADER + offset, pw);
+		}
+	}
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2026 NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Bump pointer arena allocator.
+ *
+ * Allocations are carved sequentially out of large blocks and are all
+ * released together when the arena is destroyed. Small allocations that
+ * are freed individually are kept on a free list for their size class
+ * and reused by later allocations of the same class.
+ *
+ * Allocations are aligned suitably for any pointer, integer or double.
+ */
+
+#ifndef NETSURF_UTILS_ARENA_H
+#define NETSURF_UTILS_ARENA_H
+
+#include <stddef.h>
+
+struct arena;
+
+/**
+ * Create a new arena.
+ *
+ * \param block_size The size of the blocks allocations are made from,
+ *                   or zero for the default.
+ * \return Handle for the newly created arena, or NULL on failure.
+ */
+struct arena *arena_create(size_t block_size);
+
+/**
+ * Destroy an arena and every allocation made from it.
+ *
+ * \param arena The arena to destroy.
+ */
+void arena_destroy(struct arena *arena);
+
+/**
+ * Allocate memory from an arena.
+ *
+ * The memory is not initialised.
+ *
+ * \param arena The arena to allocate from.
+ * \param size The number of bytes required.
+ * \return The allocated memory, or NULL on failure.
+ */
+void *arena_alloc(struct arena *arena, size_t size);
+
+/**
+ * Return memory to an arena for reuse.
+ *
+ * The memory is kept for later allocations of a similar size, and is
+ * only released to the system when the arena is destroyed.
+ *
+ * \param arena The arena the memory was allocated from.
+ * \param ptr The memory to free, or NULL.
+ * \param size The size the memory was allocated with.
+ */
+void arena_free(struct arena *arena, void *ptr, size_t size);
+
+/**
+ * Copy a string into an arena.
+ *
+ * \param arena The arena to allocate from.
+ * \param s The string to copy, which need not be terminated.
+ * \param len The length of the string.
+ * \return The terminated copy, or NULL on failure.
+ */
+char *arena_strndup(struct arena *arena, const char *s, size_t len);
+
+/**
+ * Copy a terminated string into an arena.
+ *
+ * \param arena The arena to allocate from.
+ * \param s The string to copy.
+ * \return The copy, or NULL on failure.
+ */
+char *arena_strdup(struct arena *arena, const char *s);
+
+/**
+ * Visit every allocation in an arena which holds objects of one size.
+ *
+ * The callback is made for each slot the arena has handed out,
+ * including slots which have since been freed. The arena must only
+ * ever have been used for allocations of the given size.
+ *
+ * \param arena The arena to walk.
+ * \param size The size of every allocation made from the arena.
+ * \param cb The function to call for each allocation.
+ * \param pw Private word passed to the callback.
+ */
+void arena_walk(struct arena *arena, size_t size,
+		void (*cb)(void *ptr, void *pw), void *pw);
+
+#endif
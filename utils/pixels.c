@@ -0,0 +1,317 @@
+/*
+ * Copyright 2026 NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Pixel format conversion kernels implementation.
+ *
+ * Every kernel converts whole blocks of pixels with vector
+ * instructions and finishes with the scalar loop, which is also the
+ * complete implementation on targets without a vector unit. Kernels
+ * which expand pixels run from the end of the buffer so they can
+ * convert in place.
+ */
+
+#include <string.h>
+
+#include "utils/pixels.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PIXELS_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define PIXELS_SSE2
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define PIXELS_SSSE3
+#endif
+#endif
+
+/** Divide a product of two bytes by 255, rounding down, without division */
+#define DIV255(x) (((x) + 1 + ((x) >> 8)) >> 8)
+
+
+#if defined(PIXELS_NEON)
+
+/**
+ * Multiply two vectors of bytes and divide the products by 255.
+ */
+static inline uint8x16_t pixels_neon_mul_div255(uint8x16_t a, uint8x16_t b)
+{
+	uint16x8_t lo = vmull_u8(vget_low_u8(a), vget_low_u8(b));
+	uint16x8_t hi = vmull_u8(vget_high_u8(a), vget_high_u8(b));
+
+	lo = vaddq_u16(vaddq_u16(lo, vshrq_n_u16(lo, 8)), vdupq_n_u16(1));
+	hi = vaddq_u16(vaddq_u16(hi, vshrq_n_u16(hi, 8)), vdupq_n_u16(1));
+
+	return vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8));
+}
+
+#endif
+
+#if defined(PIXELS_SSE2)
+
+/**
+ * Broadcast the alpha of each of two pixels held as 16 bit channels.
+ */
+static inline __m128i pixels_sse2_alpha(__m128i x)
+{
+	return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xff), 0xff);
+}
+
+/**
+ * Mask of the alpha channels of two pixels held as 16 bit channels.
+ */
+static inline __m128i pixels_sse2_alpha_lanes(void)
+{
+	return _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+}
+
+/**
+ * Mask of the alpha bytes of four pixels.
+ */
+static inline __m128i pixels_sse2_alpha_bytes(void)
+{
+	return _mm_slli_epi32(_mm_set1_epi32(0xff), 24);
+}
+
+/**
+ * Convert two inverted CMYK pixels held as 16 bit channels.
+ */
+static inline __m128i pixels_sse2_cmyk(__m128i x)
+{
+	__m128i m = _mm_mullo_epi16(x, pixels_sse2_alpha(x));
+
+	m = _mm_add_epi16(_mm_add_epi16(m, _mm_srli_epi16(m, 8)),
+			  _mm_set1_epi16(1));
+	m = _mm_srli_epi16(m, 8);
+
+	return _mm_or_si128(_mm_andnot_si128(pixels_sse2_alpha_lanes(), m),
+			    _mm_set_epi16(0xff, 0, 0, 0, 0xff, 0, 0, 0));
+}
+
+#endif
+
+
+/* exported interface documented in utils/pixels.h */
+void pixels_rgb_to_rgba(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	size_t done = 0;
+	size_t i;
+
+#if defined(PIXELS_NEON)
+	done = count & ~(size_t)15;
+#elif defined(PIXELS_SSSE3)
+	/* each block of four pixels loads four bytes past its end */
+	done = (count >= 6) ? ((count - 2) & ~(size_t)3) : 0;
+#endif
+
+	for (i = count; i-- > done; ) {
+		uint8_t r = src[i * 3 + 0];
+		uint8_t g = src[i * 3 + 1];
+		uint8_t b = src[i * 3 + 2];
+
+		dst[i * 4 + 0] = r;
+		dst[i * 4 + 1] = g;
+		dst[i * 4 + 2] = b;
+		dst[i * 4 + 3] = 0xff;
+	}
+
+#if defined(PIXELS_NEON)
+	for (i = done; i > 0; ) {
+		uint8x16x3_t rgb;
+		uint8x16x4_t rgba;
+
+		i -= 16;
+		rgb = vld3q_u8(src + i * 3);
+		rgba.val[0] = rgb.val[0];
+		rgba.val[1] = rgb.val[1];
+		rgba.val[2] = rgb.val[2];
+		rgba.val[3] = vdupq_n_u8(0xff);
+		vst4q_u8(dst + i * 4, rgba);
+	}
+#elif defined(PIXELS_SSSE3)
+	for (i = done; i > 0; ) {
+		const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1,
+						      3, 4, 5, -1,
+						      6, 7, 8, -1,
+						      9, 10, 11, -1);
+		__m128i p;
+
+		i -= 4;
+		p = _mm_loadu_si128((const __m128i *)(src + i * 3));
+		p = _mm_or_si128(_mm_shuffle_epi8(p, shuffle),
+				 pixels_sse2_alpha_bytes());
+		_mm_storeu_si128((__m128i *)(dst + i * 4), p);
+	}
+#endif
+}
+
+
+/* exported interface documented in utils/pixels.h */
+void pixels_grey_to_rgba(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	size_t done = 0;
+	size_t i;
+
+#if defined(PIXELS_NEON) || defined(PIXELS_SSE2)
+	done = count & ~(size_t)15;
+#endif
+
+	for (i = count; i-- > done; ) {
+		uint8_t g = src[i];
+
+		dst[i * 4 + 0] = g;
+		dst[i * 4 + 1] = g;
+		dst[i * 4 + 2] = g;
+		dst[i * 4 + 3] = 0xff;
+	}
+
+#if defined(PIXELS_NEON)
+	for (i = done; i > 0; ) {
+		uint8x16x4_t rgba;
+
+		i -= 16;
+		rgba.val[0] = vld1q_u8(src + i);
+		rgba.val[1] = rgba.val[0];
+		rgba.val[2] = rgba.val[0];
+		rgba.val[3] = vdupq_n_u8(0xff);
+		vst4q_u8(dst + i * 4, rgba);
+	}
+#elif defined(PIXELS_SSE2)
+	for (i = done; i > 0; ) {
+		__m128i alpha = pixels_sse2_alpha_bytes();
+		__m128i g, lo, hi;
+
+		i -= 16;
+		g = _mm_loadu_si128((const __m128i *)(src + i));
+		lo = _mm_unpacklo_epi8(g, g);
+		hi = _mm_unpackhi_epi8(g, g);
+		_mm_storeu_si128((__m128i *)(dst + i * 4 + 0), _mm_or_si128(
+				_mm_unpacklo_epi16(lo, lo), alpha));
+		_mm_storeu_si128((__m128i *)(dst + i * 4 + 16), _mm_or_si128(
+				_mm_unpackhi_epi16(lo, lo), alpha));
+		_mm_storeu_si128((__m128i *)(dst + i * 4 + 32), _mm_or_si128(
+				_mm_unpacklo_epi16(hi, hi), alpha));
+		_mm_storeu_si128((__m128i *)(dst + i * 4 + 48), _mm_or_si128(
+				_mm_unpackhi_epi16(hi, hi), alpha));
+	}
+#endif
+}
+
+
+/* exported interface documented in utils/pixels.h */
+void pixels_cmyk_to_rgba(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	size_t i = 0;
+
+#if defined(PIXELS_NEON)
+	for (; i + 16 <= count; i += 16) {
+		uint8x16x4_t p = vld4q_u8(src + i * 4);
+
+		p.val[0] = pixels_neon_mul_div255(p.val[0], p.val[3]);
+		p.val[1] = pixels_neon_mul_div255(p.val[1], p.val[3]);
+		p.val[2] = pixels_neon_mul_div255(p.val[2], p.val[3]);
+		p.val[3] = vdupq_n_u8(0xff);
+		vst4q_u8(dst + i * 4, p);
+	}
+#elif defined(PIXELS_SSE2)
+	for (; i + 4 <= count; i += 4) {
+		__m128i zero = _mm_setzero_si128();
+		__m128i p = _mm_loadu_si128((const __m128i *)(src + i * 4));
+		__m128i lo = pixels_sse2_cmyk(_mm_unpacklo_epi8(p, zero));
+		__m128i hi = pixels_sse2_cmyk(_mm_unpackhi_epi8(p, zero));
+
+		_mm_storeu_si128((__m128i *)(dst + i * 4),
+				 _mm_packus_epi16(lo, hi));
+	}
+#endif
+
+	for (; i < count; i++) {
+		const int c = src[i * 4 + 0];
+		const int m = src[i * 4 + 1];
+		const int y = src[i * 4 + 2];
+		const int k = src[i * 4 + 3];
+
+		dst[i * 4 + 0] = DIV255(c * k);
+		dst[i * 4 + 1] = DIV255(m * k);
+		dst[i * 4 + 2] = DIV255(y * k);
+		dst[i * 4 + 3] = 0xff;
+	}
+}
+
+
+/* exported interface documented in utils/pixels.h */
+void pixels_scatter(uint8_t *dst, const uint8_t *src, size_t count,
+		size_t step)
+{
+	size_t i;
+
+	if (step == 1) {
+		memcpy(dst, src, count * 4);
+		return;
+	}
+
+	/* four byte copies compile to single loads and stores */
+	for (i = 0; i < count; i++) {
+		memcpy(dst + i * step * 4, src + i * 4, 4);
+	}
+}
+
+
+/* exported interface documented in utils/pixels.h */
+bool pixels_opaque(const uint8_t *pixels, size_t count)
+{
+	size_t i = 0;
+
+#if defined(PIXELS_NEON)
+	for (; i + 16 <= count; i += 16) {
+		uint8x16x4_t p = vld4q_u8(pixels + i * 4);
+		uint8x8_t a = vand_u8(vget_low_u8(p.val[3]),
+				      vget_high_u8(p.val[3]));
+
+		if (vget_lane_u64(vreinterpret_u64_u8(a), 0) != UINT64_MAX) {
+			return false;
+		}
+	}
+#elif defined(PIXELS_SSE2)
+	for (; i + 16 <= count; i += 16) {
+		const __m128i *p = (const __m128i *)(pixels + i * 4);
+		__m128i alpha = pixels_sse2_alpha_bytes();
+		__m128i a;
+
+		a = _mm_and_si128(_mm_loadu_si128(p + 0),
+				  _mm_loadu_si128(p + 1));
+		a = _mm_and_si128(a, _mm_and_si128(_mm_loadu_si128(p + 2),
+						   _mm_loadu_si128(p + 3)));
+		a = _mm_cmpeq_epi8(_mm_and_si128(a, alpha), alpha);
+		if (_mm_movemask_epi8(a) != 0xffff) {
+			return false;
+		}
+	}
+#endif
+
+	for (; i < count; i++) {
+		if (pixels[i * 4 + 3] != 0xff) {
+			return false;
+		}
+	}
+
+	return true;
+}
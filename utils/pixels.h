@@ -0,0 +1,90 @@
+/*
+ * Copyright 2026 NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Pixel format conversion kernels.
+ *
+ * Conversions between the pixel layouts produced by image decoders
+ * and the RGBA byte order of core bitmaps. Each kernel has a vector
+ * implementation where the target provides SSE2, SSSE3 or NEON, and
+ * a scalar fallback used for the remainder and on other targets.
+ *
+ * Counts are in pixels. Unless noted otherwise the destination is
+ * RGBA with four bytes per pixel, and may be the same buffer as the
+ * source to convert in place. Buffers need no particular alignment.
+ */
+
+#ifndef NETSURF_UTILS_PIXELS_H_
+#define NETSURF_UTILS_PIXELS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Expand three byte RGB pixels to opaque RGBA.
+ *
+ * \param dst The converted pixels.
+ * \param src The RGB pixels to convert.
+ * \param count The number of pixels.
+ */
+void pixels_rgb_to_rgba(uint8_t *dst, const uint8_t *src, size_t count);
+
+/**
+ * Expand one byte greyscale pixels to opaque RGBA.
+ *
+ * \param dst The converted pixels.
+ * \param src The greyscale pixels to convert.
+ * \param count The number of pixels.
+ */
+void pixels_grey_to_rgba(uint8_t *dst, const uint8_t *src, size_t count);
+
+/**
+ * Convert inverted CMYK pixels, as written by Adobe, to opaque RGBA.
+ *
+ * \param dst The converted pixels.
+ * \param src The CMYK pixels to convert.
+ * \param count The number of pixels.
+ */
+void pixels_cmyk_to_rgba(uint8_t *dst, const uint8_t *src, size_t count);
+
+/**
+ * Copy contiguous RGBA pixels to every step'th pixel of a row.
+ *
+ * This spreads a pass of an interlaced image over its row. Pixels
+ * in between are left untouched. The buffers must not overlap.
+ *
+ * \param dst The first destination pixel.
+ * \param src The pixels to copy.
+ * \param count The number of pixels.
+ * \param step The distance between destination pixels.
+ */
+void pixels_scatter(uint8_t *dst, const uint8_t *src, size_t count,
+		size_t step);
+
+/**
+ * Find whether every RGBA pixel is fully opaque.
+ *
+ * \param pixels The pixels to test.
+ * \param count The number of pixels.
+ * \return true if every alpha value is 0xff, else false.
+ */
+bool pixels_opaque(const uint8_t *pixels, size_t count);
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2026 NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Lock-free single producer, single consumer pointer queue.
+ *
+ * This is a classic bounded ring buffer. The head index is only ever
+ * written by the consumer and the tail index only by the producer so
+ * no read-modify-write atomics are required, only ordered loads and
+ * stores.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "utils/utils.h"
+#include "utils/spsc.h"
+
+/** Size of a cache line, used to keep the indices apart */
+#define SPSC_CACHELINE 64
+
+struct spsc_queue {
+	size_t mask; /**< ring size minus one, size is a power of two */
+
+	/** index of next item to pop, written by consumer only */
+	size_t head;
+	uint8_t pad0[SPSC_CACHELINE - sizeof(size_t)];
+
+	/** index of next free slot, written by producer only */
+	size_t tail;
+	uint8_t pad1[SPSC_CACHELINE - sizeof(size_t)];
+
+	void *slots[FLEX_ARRAY_LEN_DECL]; /**< item storage */
+};
+
+/* exported interface documented in utils/spsc.h */
+struct spsc_queue *spsc_queue_create(size_t size)
+{
+	struct spsc_queue *q;
+	size_t ring = 2;
+
+	while (ring < size) {
+		ring <<= 1;
+	}
+
+	q = calloc(1, sizeof(*q) + (ring * sizeof(void *)));
+	if (q == NULL) {
+		return NULL;
+	}
+
+	q->mask = ring - 1;
+
+	return q;
+}
+
+/* exported interface documented in utils/spsc.h */
+void spsc_queue_destroy(struct spsc_queue *q)
+{
+	free(q);
+}
+
+/* exported interface documented in utils/spsc.h */
+bool spsc_queue_push(struct spsc_queue *q, void *item)
+{
+	size_t tail = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+	size_t head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+
+	if ((tail - head) > q->mask) {
+		/* full */
+		return false;
+	}
+
+	q->slots[tail & q->mask] = item;
+
+	/* publish the slot contents before the new tail */
+	__atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/* exported interface documented in utils/spsc.h */
+void *spsc_queue_pop(struct spsc_queue *q)
+{
+	size_t head = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+	size_t tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+	void *item;
+
+	if (head == tail) {
+		/* empty */
+		return NULL;
+	}
+
+	item = q->slots[head & q->mask];
+
+	/* release the slot back to the producer */
+	__atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+
+	return item;
+}
+
+/* exported interface documented in utils/spsc.h */
+bool spsc_queue_empty(struct spsc_queue *q)
+{
+	return __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) ==
+		__atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2026 NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Lock-free single producer, single consumer pointer queue.
+ *
+ * Exactly one thread may push items and exactly one (other) thread may
+ * pop them. No locks are taken by either side, the head and tail
+ * indices are published with release/acquire ordering so everything
+ * written to an item before it is pushed is visible to the consumer
+ * once it has been popped.
+ */
+
+#ifndef NETSURF_UTILS_SPSC_H
+#define NETSURF_UTILS_SPSC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct spsc_queue;
+
+/**
+ * Create a new queue.
+ *
+ * \param size The minimum number of items the queue can hold, rounded
+ *             up to the next power of two.
+ * \return Handle for the newly created queue, or NULL on failure.
+ */
+struct spsc_queue *spsc_queue_create(size_t size);
+
+/**
+ * Destroy a queue.
+ *
+ * Any items still in the queue are not freed; the caller should drain
+ * it first if they own resources.
+ *
+ * \param q The queue to destroy.
+ */
+void spsc_queue_destroy(struct spsc_queue *q);
+
+/**
+ * Add an item to the tail of the queue.
+ *
+ * Must only be called from the producer thread.
+ *
+ * \param q The queue to add to.
+ * \param item The item to add, must not be NULL.
+ * \return true if the item was added, false if the queue is full.
+ */
+bool spsc_queue_push(struct spsc_queue *q, void *item);
+
+/**
+ * Remove an item from the head of the queue.
+ *
+ * Must only be called from the consumer thread.
+ *
+ * \param q The queue to remove from.
+ * \return The item, or NULL if the queue is empty.
+ */
+void *spsc_queue_pop(struct spsc_queue *q);
+
+/**
+ * Check if the queue is empty.
+ *
+ * The result is only a snapshot; it may be stale by the time the
+ * caller acts upon it unless called from the consumer thread.
+ *
+ * \param q The queue to examine.
+ * \return true if there are no items in the queue.
+ */
+bool spsc_queue_empty(struct spsc_queue *q);
+
+#endif